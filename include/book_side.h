@@ -0,0 +1,193 @@
+// ============================================================================
+// FILE: include/book_side.h
+// ============================================================================
+#pragma once
+#include "order_pool.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Price range (in integer ticks, same units as Order::price) for symbols that
+// use the array-indexed ladder instead of the std::map levels.
+struct PriceBand {
+    long long min_price = 0;
+    long long max_price = 0;
+    long long tick_size = 1;
+
+    bool contains(long long price) const {
+        return price >= min_price && price <= max_price &&
+               (price - min_price) % tick_size == 0;
+    }
+    size_t num_levels() const {
+        return static_cast<size_t>((max_price - min_price) / tick_size) + 1;
+    }
+};
+
+namespace book_side_detail {
+    inline int lowest_bit(uint64_t w) {
+        #if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long idx; _BitScanForward64(&idx, w); return static_cast<int>(idx);
+        #else
+        return __builtin_ctzll(w);
+        #endif
+    }
+    inline int highest_bit(uint64_t w) {
+        #if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long idx; _BitScanReverse64(&idx, w); return static_cast<int>(idx);
+        #else
+        return 63 - __builtin_clzll(w);
+        #endif
+    }
+}
+
+// One side of an OrderBook, iterated best price first (highest for bids,
+// lowest for asks). By default levels live in a std::map; after use_ladder()
+// they live in a contiguous array indexed by tick, with a two-level bitmap of
+// non-empty levels and a cursor on the best one.
+template <bool IsBid>
+class BookSide {
+public:
+    using Compare = typename std::conditional<IsBid, std::greater<long long>, std::less<long long>>::type;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    void use_ladder(const PriceBand &band) {
+        if (band.tick_size <= 0 || band.max_price < band.min_price) {
+            throw std::invalid_argument("invalid price band");
+        }
+        band_ = band;
+        ladder_ = true;
+        ladder_levels_.assign(band.num_levels(), PriceLevel{});
+        for (size_t i = 0; i < ladder_levels_.size(); ++i) {
+            ladder_levels_[i].price = band.min_price + static_cast<long long>(i) * band.tick_size;
+        }
+        words_.assign((ladder_levels_.size() + 63) / 64, 0);
+        summary_.assign((words_.size() + 63) / 64, 0);
+        best_idx_ = npos;
+    }
+
+    bool uses_ladder() const { return ladder_; }
+    bool accepts(long long price) const { return !ladder_ || band_.contains(price); }
+
+    bool empty() const { return ladder_ ? best_idx_ == npos : levels_.empty(); }
+
+    PriceLevel *best() {
+        if (ladder_) return best_idx_ == npos ? nullptr : &ladder_levels_[best_idx_];
+        return levels_.empty() ? nullptr : &levels_.begin()->second;
+    }
+
+    // Appends a node to the FIFO at price, creating the level if needed
+    void push_back(long long price, OrderNode *node) {
+        if (!ladder_) {
+            PriceLevel &level = levels_[price];
+            level.price = price;
+            level.push_back(node);
+            return;
+        }
+        size_t idx = index_of(price);
+        PriceLevel &level = ladder_levels_[idx];
+        if (level.empty()) {
+            set_bit(idx);
+            if (best_idx_ == npos || better(idx, best_idx_)) best_idx_ = idx;
+        }
+        level.push_back(node);
+    }
+
+    // Unlinks a node and drops its level once the level is empty
+    void remove(OrderNode *node) {
+        PriceLevel *level = node->level;
+        level->unlink(node);
+        release_if_empty(level);
+    }
+
+    void release_if_empty(PriceLevel *level) {
+        if (!level->empty()) return;
+        if (!ladder_) {
+            levels_.erase(level->price);
+            return;
+        }
+        size_t idx = static_cast<size_t>(level - ladder_levels_.data());
+        clear_bit(idx);
+        if (idx == best_idx_) best_idx_ = next_nonempty(idx);
+    }
+
+    // Visits levels best-first until f(const PriceLevel&) returns false
+    template <class F>
+    void for_each_level(F &&f) const {
+        if (!ladder_) {
+            for (const auto &entry : levels_) {
+                if (!f(entry.second)) return;
+            }
+            return;
+        }
+        for (size_t idx = best_idx_; idx != npos; idx = next_nonempty(idx)) {
+            if (!f(ladder_levels_[idx])) return;
+        }
+    }
+
+private:
+    std::map<long long, PriceLevel, Compare> levels_;
+
+    bool ladder_ = false;
+    PriceBand band_;
+    std::vector<PriceLevel> ladder_levels_;
+    std::vector<uint64_t> words_;    // bit i: ladder level i is non-empty
+    std::vector<uint64_t> summary_;  // bit i: words_[i] != 0
+    size_t best_idx_ = npos;
+
+    size_t index_of(long long price) const {
+        if (!band_.contains(price)) throw std::out_of_range("price outside band");
+        return static_cast<size_t>((price - band_.min_price) / band_.tick_size);
+    }
+
+    static bool better(size_t a, size_t b) { return IsBid ? a > b : a < b; }
+
+    void set_bit(size_t idx) {
+        size_t w = idx / 64;
+        words_[w] |= (1ULL << (idx % 64));
+        summary_[w / 64] |= (1ULL << (w % 64));
+    }
+
+    void clear_bit(size_t idx) {
+        size_t w = idx / 64;
+        words_[w] &= ~(1ULL << (idx % 64));
+        if (words_[w] == 0) summary_[w / 64] &= ~(1ULL << (w % 64));
+    }
+
+    // Next non-empty level strictly worse than idx, or npos
+    size_t next_nonempty(size_t idx) const {
+        using namespace book_side_detail;
+        size_t w = idx / 64;
+        unsigned bit = static_cast<unsigned>(idx % 64);
+        if (IsBid) {
+            uint64_t below = bit == 0 ? 0 : (words_[w] & ((1ULL << bit) - 1));
+            if (below) return w * 64 + highest_bit(below);
+            size_t sw = w / 64;
+            unsigned sbit = static_cast<unsigned>(w % 64);
+            uint64_t s = sbit == 0 ? 0 : (summary_[sw] & ((1ULL << sbit) - 1));
+            while (!s) {
+                if (sw == 0) return npos;
+                s = summary_[--sw];
+            }
+            size_t word = sw * 64 + highest_bit(s);
+            return word * 64 + highest_bit(words_[word]);
+        } else {
+            uint64_t above = bit == 63 ? 0 : (words_[w] & ~((2ULL << bit) - 1));
+            if (above) return w * 64 + lowest_bit(above);
+            size_t sw = w / 64;
+            unsigned sbit = static_cast<unsigned>(w % 64);
+            uint64_t s = sbit == 63 ? 0 : (summary_[sw] & ~((2ULL << sbit) - 1));
+            while (!s) {
+                if (++sw == summary_.size()) return npos;
+                s = summary_[sw];
+            }
+            size_t word = sw * 64 + lowest_bit(s);
+            return word * 64 + lowest_bit(words_[word]);
+        }
+    }
+};
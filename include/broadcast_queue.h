@@ -2,54 +2,108 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <queue>
 #include <mutex>
-#include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <unordered_map>
 #include "../vendor/json.hpp"
 #include "../include/ws_server.h" // Forward-declare global_state is tricky, just include ws_server
+#include "../include/order_book.h" // Trade
+#include "../include/mpsc_ring.h"
+#include "../include/engine_config.h"
 
 using json = nlohmann::json;
 
 // Pre-declare global_state variables to break circular dependency
 extern WebSocketServer* g_ws_server;
+struct DepthSnapshot;
 
-// A variant-like struct to hold different message types
+// A variant-like struct to hold different message types. Small and
+// allocation-free to move: symbols travel as registry ids and the depth
+// window as a shared snapshot.
 struct BroadcastMessage {
     enum Type { Trade, BookUpdate };
-    Type type;
-    std::string symbol;
-    json data; // Can hold trade json
-    std::vector<std::pair<long long, long long>> bids;
-    std::vector<std::pair<long long, long long>> asks;
+    Type type = Trade;
+    uint32_t symbol_id = 0;
+    ::Trade trade; // Typed; serialized once by the broadcast thread
+    std::shared_ptr<const DepthSnapshot> book; // BookUpdate only
 };
 
+// Levels (price, new quantity) that differ between two top-of-book windows;
+// quantity 0 means the price left the window. `descending` for bids.
+std::vector<std::pair<long long,long long>> diff_levels(const std::vector<std::pair<long long,long long>> &before,
+                                                        const std::vector<std::pair<long long,long long>> &after,
+                                                        bool descending);
+
+struct BroadcastStats {
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;    // ring full: the message was not queued
+    uint64_t conflated = 0;  // book updates superseded before they were sent
+    uint64_t queue_depth = 0;
+    uint64_t queue_capacity = 0;
+    unsigned shards = 0;
+};
+
+// Matching-path side of the market-data feed. Each symbol hashes to one shard:
+// a bounded lock-free MpscRing drained by a single writer thread, so pushes
+// never lock or allocate and a symbol's trades and depth updates reach the
+// WebSocket server in the order they were pushed.
 class BroadcastQueue {
 public:
+    // A full "orderbook" snapshot goes out every this many depth updates
+    static constexpr uint64_t DEPTH_SNAPSHOT_EVERY = 100;
+    static constexpr size_t RING_CAPACITY = 65536; // per shard
+    static constexpr unsigned MAX_SHARDS = 4;
+
     BroadcastQueue();
     ~BroadcastQueue();
 
-    // Fast, non-blocking push for the server thread
-    void push_trade(const json& trade_json);
-    void push_book_update(const std::string& symbol, 
-                          const std::vector<std::pair<long long, long long>>& bids, 
-                          const std::vector<std::pair<long long, long long>>& asks);
+    // Starts the writer shards (once); pushes before this are dropped
+    void start(const BroadcastConfig &config = BroadcastConfig());
+
+    // Wait-free for the caller apart from the ring CAS; a full ring drops the
+    // message and counts it rather than stalling matching
+    void push_trade(const ::Trade& trade);
+    // Updates for a symbol still waiting in the ring are conflated by the
+    // writer: only the newest window of a drained batch is sent
+    void push_book_update(uint32_t symbol_id, std::shared_ptr<const DepthSnapshot> book);
+
+    // Last depth window published for the symbol and its sequence number (for
+    // resync); false if nothing has been published yet
+    bool depth_state(const std::string& symbol, std::shared_ptr<const DepthSnapshot>& book, uint64_t& seq);
+
+    BroadcastStats stats() const;
     
-    // Graceful shutdown
+    // Graceful shutdown: writers drain what is queued, then exit
     void stop();
 
 private:
-    // The consumer thread loop
-    void writer_thread_loop();
+    // Per-symbol L2 stream: the window/sequence number clients are tracking.
+    // Written only by the owning shard's writer; resync readers take the lock.
+    struct DepthStream {
+        std::shared_ptr<const DepthSnapshot> last;
+        uint64_t seq = 0;
+        uint64_t since_snapshot = 0;
+    };
 
-    std::queue<BroadcastMessage> queue_;
-    std::mutex mu_;
-    std::condition_variable cv_;
-    std::atomic<bool> running_{true};
-    
-    // --- UPDATED: From single thread to thread pool ---
-    unsigned int num_threads_;
-    std::vector<std::thread> writer_threads_;
-};
+    struct Shard {
+        Shard() : ring(RING_CAPACITY) {}
+        MpscRing<BroadcastMessage> ring;
+        std::thread thread;
+        std::mutex depth_mu; // guards depth (resync reads from WS workers)
+        std::unordered_map<uint32_t, DepthStream> depth;
+    };
 
+    void writer_thread_loop(Shard &shard);
+    void publish_depth(Shard &shard, uint32_t symbol_id, std::shared_ptr<const DepthSnapshot> book);
+    Shard &shard_for(uint32_t symbol_id) { return *shards_[symbol_id % shards_.size()]; }
+    bool push(BroadcastMessage msg);
+
+    ThreadGroupConfig threads_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> conflated_{0};
+};
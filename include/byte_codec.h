@@ -0,0 +1,61 @@
+// ============================================================================
+// FILE: include/byte_codec.h
+// ============================================================================
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Little-endian encoding shared by the binary WAL and book snapshots.
+inline void put_u8(std::string &b, uint8_t v) { b.push_back(static_cast<char>(v)); }
+inline void put_u16(std::string &b, uint16_t v) {
+    for (int i = 0; i < 2; ++i) b.push_back(static_cast<char>(v >> (8 * i)));
+}
+inline void put_u32(std::string &b, uint32_t v) {
+    for (int i = 0; i < 4; ++i) b.push_back(static_cast<char>(v >> (8 * i)));
+}
+inline void put_u64(std::string &b, uint64_t v) {
+    for (int i = 0; i < 8; ++i) b.push_back(static_cast<char>(v >> (8 * i)));
+}
+inline void put_i64(std::string &b, int64_t v) { put_u64(b, static_cast<uint64_t>(v)); }
+inline void put_str(std::string &b, const std::string &s) {
+    size_t n = s.size() > 0xFFFF ? 0xFFFF : s.size();
+    put_u16(b, static_cast<uint16_t>(n));
+    b.append(s.data(), n);
+}
+
+// Bounds-checked cursor; reads past `end` return 0 and clear `ok`
+struct ByteReader {
+    const unsigned char *p;
+    const unsigned char *end;
+    bool ok = true;
+
+    uint64_t uint(int bytes) {
+        if (end - p < bytes) { ok = false; return 0; }
+        uint64_t v = 0;
+        for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(p[i]) << (8 * i);
+        p += bytes;
+        return v;
+    }
+    uint8_t u8() { return static_cast<uint8_t>(uint(1)); }
+    uint16_t u16() { return static_cast<uint16_t>(uint(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(uint(4)); }
+    uint64_t u64() { return uint(8); }
+    int64_t i64() { return static_cast<int64_t>(uint(8)); }
+    std::string str() {
+        size_t n = u16();
+        if (!ok || static_cast<size_t>(end - p) < n) { ok = false; return {}; }
+        std::string s(reinterpret_cast<const char *>(p), n);
+        p += n;
+        return s;
+    }
+};
+
+inline int64_t to_ns(const std::chrono::system_clock::time_point &tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count();
+}
+
+inline std::chrono::system_clock::time_point from_ns(int64_t ns) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns)));
+}
@@ -0,0 +1,32 @@
+// ============================================================================
+// FILE: include/crc32.h
+// ============================================================================
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, reflected, same as zlib's crc32). Pass the previous
+// result as `crc` to checksum a record in several pieces.
+namespace crc32_detail {
+    inline const std::array<uint32_t, 256> &table() {
+        static const std::array<uint32_t, 256> t = [] {
+            std::array<uint32_t, 256> out{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                out[i] = c;
+            }
+            return out;
+        }();
+        return t;
+    }
+}
+
+inline uint32_t crc32(const void *data, size_t len, uint32_t crc = 0) {
+    const auto &t = crc32_detail::table();
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) crc = t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
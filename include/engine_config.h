@@ -0,0 +1,135 @@
+// FILE: include/engine_config.h
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "book_side.h"
+#include "thread_topology.h"
+
+struct MatchingEngineConfig {
+    size_t shards = 0;             // 0 = engine mode off (handlers match inline)
+    size_t ring_capacity = 65536;  // requests per shard ring
+    ThreadGroupConfig threads;     // "threads.matching"; its count sets shards
+};
+
+enum class WalFormat { Json, Binary };
+enum class WalSync {
+    None,   // hand each batch to the OS, never fsync
+    Batch,  // fdatasync after every writer batch
+    Group   // fdatasync every sync_every_records records or sync_interval_us
+};
+
+struct WalConfig {
+    std::string path = "./data/wal.jsonl";
+    WalFormat format = WalFormat::Json;
+    WalSync sync = WalSync::None;
+    size_t sync_every_records = 0;
+    long long sync_interval_us = 1000;
+    bool ack_durable = false;      // order acks wait until their records are synced
+    long long snapshot_interval_s = 0; // 0 = never snapshot/compact the WAL
+    ThreadGroupConfig threads;     // "threads.wal": the single writer thread
+};
+
+enum class SlowConsumerPolicy {
+    DropOldest, // evict the oldest queued frames to make room
+    Conflate,   // replace a still-queued book update for the same symbol, else drop oldest
+    Disconnect  // close a client whose queue is full
+};
+
+// Per-client WebSocket send queue bounds
+struct WebSocketConfig {
+    size_t max_queued_frames = 4096;
+    size_t max_queued_bytes = 8u << 20;
+    SlowConsumerPolicy slow_consumer = SlowConsumerPolicy::Conflate;
+    ThreadGroupConfig threads;     // "threads.websocket": epoll workers (default min(4, cores / 2))
+};
+
+// Market-data fan-out: writer shards between matching and the WebSocket feed
+struct BroadcastConfig {
+    ThreadGroupConfig threads;     // "threads.broadcast" (default min(4, cores))
+};
+
+// HTTP API request pool
+struct HttpConfig {
+    ThreadGroupConfig threads;     // "threads.http" (default: httplib's pool)
+};
+
+// Binary TCP order-entry gateway (see order_gateway.h)
+struct GatewayConfig {
+    int port = 0;           // 0 = gateway off
+    ThreadGroupConfig threads; // "threads.gateway": the event loop; busy_poll spins on epoll
+};
+
+enum class ReplicationRole { None, Primary, Standby };
+enum class ReplicationAck {
+    Async,  // acks never wait for standbys
+    Quorum  // acks wait until `quorum` standbys have the records durable
+};
+
+// WAL streaming to hot standbys (see replication.h)
+struct ReplicationConfig {
+    ReplicationRole role = ReplicationRole::None;
+    int port = 0;                       // primary (or a promoted standby): standbys connect here
+    std::string primary_host = "127.0.0.1"; // standby: the primary to follow
+    int primary_port = 0;
+    ReplicationAck ack = ReplicationAck::Async;
+    size_t quorum = 1;                  // standbys that must confirm each ack in quorum mode
+    long long ack_timeout_ms = 1000;    // a quorum wait fails after this
+    size_t backlog_bytes = 64u << 20;   // recent batches kept for standbys catching up
+};
+
+// Startup configuration, loaded once from a JSON file before WAL replay.
+// A missing file means defaults everywhere.
+//
+// {
+//   "price_bands": {
+//     "BTC-USDT": { "min_price": 20000.0, "max_price": 120000.0, "tick_size": 0.5 }
+//   },
+//   "max_ladder_levels": 1048576,
+//   "matching_engine": { "shards": 2, "ring_capacity": 65536, "cpus": [2, 3] },
+//   "wal": { "path": "./data/wal.bin", "format": "binary", "sync": "group",
+//            "sync_every_records": 256, "sync_interval_us": 500, "ack_durable": true,
+//            "snapshot_interval_seconds": 300 },
+//   "websocket": { "max_queued_frames": 4096, "max_queued_bytes": 8388608,
+//                  "slow_consumer": "conflate" },
+//   "gateway": { "port": 9003, "busy_poll": false },
+//   "replication": { "role": "primary", "port": 9004, "ack": "quorum", "quorum": 1,
+//                    "ack_timeout_ms": 1000, "backlog_bytes": 67108864 },
+//   "threads": {
+//     "matching":  { "count": 2, "cpus": [2, 3], "busy_poll": true },
+//     "wal":       { "cpus": [4] },
+//     "broadcast": { "count": 1, "numa_node": 0 },
+//     "websocket": { "count": 2, "numa_node": 0 },
+//     "http":      { "count": 8, "cpus": [6, 7] },
+//     "gateway":   { "cpus": [5], "busy_poll": true }
+//   }
+// }
+//
+// Each "threads" group takes count, cpus (one per thread, reused round robin),
+// numa_node (used when cpus is empty) and busy_poll. The WAL writer and the
+// gateway are single threads. matching_engine.cpus and gateway.busy_poll are
+// the older spellings of threads.matching.cpus and threads.gateway.busy_poll.
+// A standby sets "replication": { "role": "standby", "primary_host": "10.0.0.1",
+// "primary_port": 9004 } (plus "port" to serve standbys of its own once promoted).
+struct EngineConfig {
+    // Symbols listed here get the array-indexed ladder book; prices are in
+    // display units in the file and stored as ticks (x100) like the API.
+    std::unordered_map<std::string, PriceBand> price_bands;
+    // Both sides of a ladder are allocated when the symbol is created, so a
+    // band with more levels than this is rejected at load
+    size_t max_ladder_levels = 1u << 20;
+
+    MatchingEngineConfig matching;
+    WalConfig wal;
+    WebSocketConfig websocket;
+    GatewayConfig gateway;
+    BroadcastConfig broadcast;
+    HttpConfig http;
+    ReplicationConfig replication;
+
+    const PriceBand *price_band(const std::string &symbol) const;
+
+    static EngineConfig load(const std::string &path);
+};
+
+extern EngineConfig g_engine_config;
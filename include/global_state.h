@@ -1,21 +1,24 @@
 // FILE: include/global_state.h
 #pragma once
-#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <atomic>
 #include "order_book.h"
 #include "stop_order_manager.h"
+#include "symbol_registry.h"
 #include "ws_server.h"
 #include "../include/broadcast_queue.h"
 
-// This mutex protects shared access to the order books and maps
-extern std::mutex g_global_mutex;
+// Symbol -> book/stop-manager registry; lock-free lookups
+extern SymbolRegistry g_symbol_registry;
 
-// Maps for tracking and managing books
-extern std::unordered_map<std::string, OrderBook> g_order_books;
-extern std::unordered_map<std::string, StopOrderManager> g_stop_order_managers;
-extern std::unordered_map<std::string, std::string> g_order_id_to_symbol;
+// Symbols of recovered orders whose ids do not name their book in this
+// process: ids from before the symbol-tagged layout (order.h), or tagged by
+// a log written before symbol records pinned the interning order. Filled
+// only by recovery, before any request thread starts (or by a standby
+// loading its primary's snapshot, while order entry is refused), and
+// read-only afterwards, so lookups take no lock.
+extern std::unordered_map<uint64_t, uint32_t> g_legacy_order_symbols;
 
 // Global server stats
 extern std::atomic<uint64_t> g_total_orders;
@@ -0,0 +1,110 @@
+// ============================================================================
+// FILE: include/iso_time.h
+// ============================================================================
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Timestamps are kept as integer ns since the epoch (UTC) and only turned
+// into ISO 8601 text when serialized. The formatter does integer civil-date
+// arithmetic into a caller's buffer: no gmtime, locale or allocation.
+
+inline int64_t wall_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ"
+constexpr size_t ISO8601_LEN = 30;
+
+namespace iso_time_detail {
+    inline void put_digits(char *out, long long v, int width) {
+        for (int i = width - 1; i >= 0; --i) {
+            out[i] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        }
+    }
+}
+
+// Writes exactly ISO8601_LEN chars (no terminator); returns ISO8601_LEN
+inline size_t format_iso8601(int64_t ns, char *out) {
+    using iso_time_detail::put_digits;
+    const int64_t NS_PER_DAY = 86400LL * 1000000000LL;
+    int64_t days = ns / NS_PER_DAY;
+    int64_t rem = ns % NS_PER_DAY;
+    if (rem < 0) {
+        rem += NS_PER_DAY;
+        --days;
+    }
+    // Civil date from days since 1970-01-01 (proleptic Gregorian)
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t d = doy - (153 * mp + 2) / 5 + 1;
+    int64_t m = mp < 10 ? mp + 3 : mp - 9;
+    int64_t y = yoe + era * 400 + (m <= 2);
+
+    int64_t secs = rem / 1000000000LL;
+    put_digits(out, y, 4);
+    out[4] = '-';
+    put_digits(out + 5, m, 2);
+    out[7] = '-';
+    put_digits(out + 8, d, 2);
+    out[10] = 'T';
+    put_digits(out + 11, secs / 3600, 2);
+    out[13] = ':';
+    put_digits(out + 14, secs / 60 % 60, 2);
+    out[16] = ':';
+    put_digits(out + 17, secs % 60, 2);
+    out[19] = '.';
+    put_digits(out + 20, rem % 1000000000LL, 9);
+    out[29] = 'Z';
+    return ISO8601_LEN;
+}
+
+inline std::string iso8601(int64_t ns) {
+    char buf[ISO8601_LEN];
+    return std::string(buf, format_iso8601(ns, buf));
+}
+
+// Inverse of format_iso8601 (UTC; the fraction is optional and may have any
+// number of digits), exact to the nanosecond. False if the date/time part is
+// malformed.
+inline bool parse_iso8601(std::string_view s, int64_t &ns) {
+    long long f[6] = {};
+    const char seps[6] = {'-', '-', 'T', ':', ':', '\0'};
+    size_t pos = 0;
+    for (int i = 0; i < 6; ++i) {
+        size_t start = pos;
+        while (pos < s.size() && s[pos] >= '0' && s[pos] <= '9') f[i] = f[i] * 10 + (s[pos++] - '0');
+        if (pos == start) return false;
+        if (seps[i]) {
+            if (pos >= s.size() || s[pos] != seps[i]) return false;
+            ++pos;
+        }
+    }
+    long long y = f[0], mo = f[1], d = f[2];
+    // Days since the epoch for a proleptic Gregorian date
+    y -= mo <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yoe = y - era * 400;
+    long long doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long long days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+    ns = (((days * 24 + f[3]) * 60 + f[4]) * 60 + f[5]) * 1000000000LL;
+    if (pos < s.size() && s[pos] == '.') {
+        long long scale = 1000000000LL;
+        for (++pos; pos < s.size() && s[pos] >= '0' && s[pos] <= '9'; ++pos) {
+            if (scale > 1) {
+                scale /= 10;
+                ns += (s[pos] - '0') * scale;
+            }
+        }
+    }
+    return true;
+}
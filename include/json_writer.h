@@ -0,0 +1,131 @@
+// ============================================================================
+// FILE: include/json_writer.h
+// ============================================================================
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Append-only JSON writer for hot-path messages: no DOM, no per-value
+// allocation. clear() keeps the buffer's capacity, so a thread_local writer
+// renders every message into the same memory. Callers are responsible for
+// well-formedness (matching begin/end, a key before each object member).
+class JsonWriter {
+public:
+    void clear() {
+        out_.clear();
+        need_comma_ = false;
+        after_key_ = false;
+    }
+
+    const std::string &str() const { return out_; }
+
+    JsonWriter &begin_object() { return open('{'); }
+    JsonWriter &end_object() { return close('}'); }
+    JsonWriter &begin_array() { return open('['); }
+    JsonWriter &end_array() { return close(']'); }
+
+    JsonWriter &key(std::string_view k) {
+        separate();
+        write_string(k);
+        out_ += ':';
+        after_key_ = true;
+        return *this;
+    }
+
+    JsonWriter &value(std::string_view s) {
+        separate();
+        write_string(s);
+        need_comma_ = true;
+        return *this;
+    }
+    JsonWriter &value(const char *s) { return value(std::string_view(s)); }
+    JsonWriter &value(const std::string &s) { return value(std::string_view(s)); }
+
+    JsonWriter &value(bool b) {
+        separate();
+        out_ += b ? "true" : "false";
+        need_comma_ = true;
+        return *this;
+    }
+
+    template <class T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    JsonWriter &value(T v) {
+        separate();
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), v);
+        out_.append(buf, static_cast<size_t>(res.ptr - buf));
+        need_comma_ = true;
+        return *this;
+    }
+
+    JsonWriter &null() {
+        separate();
+        out_ += "null";
+        need_comma_ = true;
+        return *this;
+    }
+
+    // Already-serialized JSON (e.g. from nlohmann's dump())
+    JsonWriter &raw(std::string_view json) {
+        separate();
+        out_.append(json.data(), json.size());
+        need_comma_ = true;
+        return *this;
+    }
+
+    template <class V>
+    JsonWriter &field(std::string_view k, const V &v) { return key(k).value(v); }
+
+private:
+    std::string out_;
+    bool need_comma_ = false;
+    bool after_key_ = false;
+
+    void separate() {
+        if (after_key_) after_key_ = false;
+        else if (need_comma_) out_ += ',';
+    }
+
+    JsonWriter &open(char c) {
+        separate();
+        out_ += c;
+        need_comma_ = false;
+        return *this;
+    }
+
+    JsonWriter &close(char c) {
+        out_ += c;
+        need_comma_ = true;
+        return *this;
+    }
+
+    void write_string(std::string_view s) {
+        static const char HEX[] = "0123456789abcdef";
+        out_ += '"';
+        size_t run = 0; // start of the pending unescaped run
+        for (size_t i = 0; i < s.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(s[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') continue;
+            out_.append(s.data() + run, i - run);
+            run = i + 1;
+            switch (c) {
+                case '"': out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\b': out_ += "\\b"; break;
+                case '\f': out_ += "\\f"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                default:
+                    out_ += "\\u00";
+                    out_ += HEX[c >> 4];
+                    out_ += HEX[c & 0xf];
+            }
+        }
+        out_.append(s.data() + run, s.size() - run);
+        out_ += '"';
+    }
+};
@@ -0,0 +1,80 @@
+// ============================================================================
+// FILE: include/latency_histogram.h
+// ============================================================================
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Log-linear histogram in the style of HdrHistogram. Values below 2^SUB_BITS
+// are counted exactly; each higher power of two is split into 2^(SUB_BITS-1)
+// equal buckets, so a reported value is within 1/128 (SUB_BITS = 8) of what
+// was recorded. Fixed size (~58 KB), O(1) record, no allocation.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 8;
+    static constexpr uint64_t SUB_COUNT = 1ull << SUB_BITS;
+    static constexpr uint64_t HALF_COUNT = SUB_COUNT / 2;
+    static constexpr size_t BUCKETS = SUB_COUNT + (64 - SUB_BITS) * HALF_COUNT;
+
+    void record(uint64_t value) {
+        ++counts_[index_of(value)];
+        ++count_;
+        sum_ += static_cast<double>(value);
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? sum_ / static_cast<double>(count_) : 0; }
+
+    // Smallest recorded value v such that `percent` of the values are <= v
+    // (reported as the top of its bucket, capped at max())
+    uint64_t percentile(double percent) const {
+        if (count_ == 0) return 0;
+        uint64_t target = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(count_)));
+        target = std::max<uint64_t>(1, std::min(target, count_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= target) return std::min(highest_in(i), max_);
+        }
+        return max_;
+    }
+
+    static size_t index_of(uint64_t value) {
+        if (value < SUB_COUNT) return static_cast<size_t>(value);
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - SUB_BITS + 1;
+        uint64_t sub = value >> shift; // in [HALF_COUNT, SUB_COUNT)
+        return static_cast<size_t>(SUB_COUNT + (shift - 1) * HALF_COUNT + (sub - HALF_COUNT));
+    }
+
+    static uint64_t highest_in(size_t index) {
+        if (index < SUB_COUNT) return index;
+        uint64_t k = index - SUB_COUNT;
+        int shift = static_cast<int>(k / HALF_COUNT) + 1;
+        uint64_t sub = k % HALF_COUNT + HALF_COUNT;
+        return (sub << shift) + ((1ull << shift) - 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t count_ = 0;
+    double sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
@@ -0,0 +1,85 @@
+// ============================================================================
+// FILE: include/matching_engine.h
+// ============================================================================
+#pragma once
+#include "order.h"
+#include "order_book.h"
+#include "stop_order_manager.h"
+#include "mpsc_ring.h"
+#include "engine_config.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One command for a matching shard. Requests live on the submitting thread's
+// stack; the ring only carries pointers, so submission never allocates.
+struct EngineRequest {
+    enum class Type { NewOrder, Cancel, Amend, StopOrder, Batch };
+    Type type = Type::NewOrder;
+    uint32_t symbol_id = 0;
+    Order order;          // NewOrder; Amend: the new quantity and price
+    StopOrder stop;       // StopOrder
+    uint64_t order_id = 0; // Cancel, Amend
+    std::vector<BookOp> *ops = nullptr; // Batch: one symbol's ops, results written in place
+
+    // Results, written by the matching thread before complete()
+    std::vector<Trade> trades; // NewOrder: fills appended (the submitter may lend a buffer)
+    bool cancelled = false;
+    AmendResult amend;    // Amend
+    std::vector<TriggeredStop> fired; // NewOrder, Batch: stops the trades fired
+    OrderBook *book = nullptr;
+    uint64_t wal_seq = 0;      // Batch: last WAL record of the group (apply_batch_group)
+    std::exception_ptr error;  // rethrown by execute() on the submitting thread
+
+    void wait();
+    void complete();
+
+private:
+    std::atomic<bool> done_{false};
+    std::mutex mu_;
+    std::condition_variable cv_;
+};
+
+// Optional single-writer engine: every symbol belongs to exactly one shard
+// thread, which drains an MPSC ring of requests and is the only writer of the
+// books it owns. HTTP handlers enqueue a request and wait for its completion.
+class MatchingEngine {
+public:
+    explicit MatchingEngine(const MatchingEngineConfig &config);
+    ~MatchingEngine();
+
+    void start();
+    void stop();
+
+    // Enqueue and block until the owning shard has applied the request;
+    // rethrows anything the shard caught while applying it
+    void execute(EngineRequest &req);
+
+    size_t shard_for(uint32_t symbol_id) const { return symbol_id % shards_.size(); }
+    size_t num_shards() const { return shards_.size(); }
+    size_t queue_depth(size_t shard) const { return shards_[shard]->ring.size(); }
+
+private:
+    struct Shard {
+        explicit Shard(size_t capacity) : ring(capacity) {}
+        MpscRing<EngineRequest*> ring;
+        std::thread thread;
+        size_t index = 0; // position in the matching thread group
+    };
+
+    void run_shard(Shard &shard);
+    void apply(EngineRequest &req);
+
+    ThreadGroupConfig threads_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> submitting_{0}; // execute() calls between the running_ check and their push
+};
+
+// nullptr unless the matching engine mode is configured
+extern MatchingEngine* g_matching_engine;
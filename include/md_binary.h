@@ -0,0 +1,100 @@
+// ============================================================================
+// FILE: include/md_binary.h
+// Binary market-data encoding for WebSocket clients that opt in
+// ============================================================================
+#pragma once
+#include "byte_codec.h"
+#include "order_book.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+// SBE-style layout, all integers little-endian. Every message is one
+// WebSocket binary frame:
+//
+//   header   u16 block_length, u16 template_id, u16 schema_id, u16 version
+//   block    fixed fields of the template (block_length bytes)
+//   groups   depth only: bid_count then ask_count (price i64, quantity i64)
+//   symbol   u16 length + bytes
+//
+// Decoders skip block bytes they do not know, so fields can be appended to a
+// block without a schema break. Prices and quantities are the engine's
+// integer ticks/lots; timestamps are ns since the epoch: a trade's is its
+// execution time, book and BBO messages carry their publication time.
+namespace md_binary {
+
+constexpr uint16_t SCHEMA_ID = 1;
+constexpr uint16_t SCHEMA_VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+
+enum Template : uint16_t { TradeMsg = 1, BboMsg = 2, DepthSnapshotMsg = 3, DepthUpdateMsg = 4 };
+
+// trade_id, maker/taker order ids, price, quantity, maker/taker fee,
+// timestamp_ns, aggressor side (0 buy, 1 sell)
+constexpr uint16_t TRADE_BLOCK = 8 * 8 + 1;
+// bid, bid_quantity, ask, ask_quantity, timestamp_ns, flags (1 bid, 2 ask present)
+constexpr uint16_t BBO_BLOCK = 5 * 8 + 1;
+// seq, timestamp_ns, bid_count, ask_count
+constexpr uint16_t DEPTH_BLOCK = 8 + 8 + 2 + 2;
+
+using Levels = std::vector<std::pair<long long, long long>>;
+
+inline void put_header(std::string &out, uint16_t block_length, Template id) {
+    put_u16(out, block_length);
+    put_u16(out, id);
+    put_u16(out, SCHEMA_ID);
+    put_u16(out, SCHEMA_VERSION);
+}
+
+inline void encode_trade(std::string &out, const Trade &t, const std::string &symbol) {
+    out.reserve(out.size() + HEADER_SIZE + TRADE_BLOCK + 2 + symbol.size());
+    put_header(out, TRADE_BLOCK, TradeMsg);
+    put_u64(out, t.trade_id);
+    put_u64(out, t.maker_order_id);
+    put_u64(out, t.taker_order_id);
+    put_i64(out, t.price);
+    put_i64(out, t.quantity);
+    put_i64(out, t.maker_fee);
+    put_i64(out, t.taker_fee);
+    put_i64(out, t.timestamp_ns);
+    put_u8(out, t.aggressor_side == Side::Buy ? 0 : 1);
+    put_str(out, symbol);
+}
+
+inline void encode_bbo(std::string &out, const std::string &symbol, bool has_bid, long long bid, long long bid_qty,
+                       bool has_ask, long long ask, long long ask_qty, int64_t timestamp_ns) {
+    out.reserve(out.size() + HEADER_SIZE + BBO_BLOCK + 2 + symbol.size());
+    put_header(out, BBO_BLOCK, BboMsg);
+    put_i64(out, bid);
+    put_i64(out, bid_qty);
+    put_i64(out, ask);
+    put_i64(out, ask_qty);
+    put_i64(out, timestamp_ns);
+    put_u8(out, static_cast<uint8_t>((has_bid ? 1 : 0) | (has_ask ? 2 : 0)));
+    put_str(out, symbol);
+}
+
+// A full window (DepthSnapshotMsg) or changed levels (DepthUpdateMsg,
+// quantity 0 = level gone), as in the JSON orderbook/depth_update messages
+inline void encode_depth(std::string &out, Template id, const std::string &symbol, uint64_t seq,
+                         const Levels &bids, const Levels &asks, int64_t timestamp_ns) {
+    size_t nb = std::min<size_t>(bids.size(), 0xFFFF), na = std::min<size_t>(asks.size(), 0xFFFF);
+    out.reserve(out.size() + HEADER_SIZE + DEPTH_BLOCK + 16 * (nb + na) + 2 + symbol.size());
+    put_header(out, DEPTH_BLOCK, id);
+    put_u64(out, seq);
+    put_i64(out, timestamp_ns);
+    put_u16(out, static_cast<uint16_t>(nb));
+    put_u16(out, static_cast<uint16_t>(na));
+    for (size_t i = 0; i < nb; ++i) {
+        put_i64(out, bids[i].first);
+        put_i64(out, bids[i].second);
+    }
+    for (size_t i = 0; i < na; ++i) {
+        put_i64(out, asks[i].first);
+        put_i64(out, asks[i].second);
+    }
+    put_str(out, symbol);
+}
+
+} // namespace md_binary
@@ -0,0 +1,72 @@
+// ============================================================================
+// FILE: include/metrics.h
+// ============================================================================
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Order-path stages timed for /metrics
+enum class Stage : uint8_t {
+    Parse,            // HTTP body -> validated order fields
+    BookLockWait,     // waiting for a book's write lock (0 when uncontended)
+    Match,            // add/cancel/amend/batch under the book lock
+    WalEnqueue,       // append_* on the caller's thread
+    WalWrite,         // writer thread: encode and write() one batch
+    WalSync,          // writer thread: fdatasync
+    BroadcastEnqueue, // push_trade / push_book_update
+    WsSend,           // one client flush (its sendmsg calls)
+    Count
+};
+
+// Stage latency histograms. Each thread records into its own shard of
+// relaxed atomics that only it writes (no lock, no contended cache line); a
+// scrape sums the shards. Bucket i counts durations <= 2^(6+i) ns (64 ns up
+// to ~17 s); the last bucket is +Inf.
+namespace metrics {
+
+constexpr size_t STAGES = static_cast<size_t>(Stage::Count);
+constexpr size_t BUCKETS = 30;
+
+const char *stage_name(Stage stage);
+
+inline uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline size_t bucket_of(uint64_t ns) {
+    if (ns <= 64) return 0;
+    size_t b = static_cast<size_t>(64 - __builtin_clzll(ns - 1)) - 6;
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+void record(Stage stage, uint64_t ns);
+
+struct StageTotals {
+    uint64_t buckets[BUCKETS] = {}; // per bucket, not cumulative
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+};
+StageTotals totals(Stage stage);
+
+// Stamps a stage from construction to destruction
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage_(stage), start_(now_ns()) {}
+    ~StageTimer() { record(stage_, now_ns() - start_); }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    Stage stage_;
+    uint64_t start_;
+};
+
+// Prometheus text exposition (version 0.0.4)
+void write_stage_histograms(std::string &out);
+void write_metric(std::string &out, const char *name, const char *type, const char *help, uint64_t value);
+
+} // namespace metrics
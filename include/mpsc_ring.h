@@ -0,0 +1,92 @@
+// ============================================================================
+// FILE: include/mpsc_ring.h
+// ============================================================================
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+// Bounded lock-free ring for many producers and one consumer (per-cell
+// sequence numbers, after Vyukov's bounded queue). Producers claim a slot with
+// a CAS on the tail; the consumer owns the head and never contends with them.
+// Capacity is rounded up to a power of two.
+template <class T>
+class MpscRing {
+public:
+    explicit MpscRing(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask_ = cap - 1;
+        cells_.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    // Returns false when the ring is full
+    bool try_push(T value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Single consumer only
+    bool try_pop(T &out) {
+        Cell &cell = cells_[head_ & mask_];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (seq != head_ + 1) return false;
+        out = std::move(cell.value);
+        cell.seq.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        // Keeps size() current under sustained load, not only once drained
+        if ((head_ & (HEAD_PUBLISH_EVERY - 1)) == 0) publish_head();
+        return true;
+    }
+
+    // Approximate (behind by fewer than HEAD_PUBLISH_EVERY pops until the
+    // consumer calls publish_head); safe to call from any thread
+    size_t size() const {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_snapshot_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Consumer publishes its position for size(); cheap enough to call per batch
+    void publish_head() { head_snapshot_.store(head_, std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t HEAD_PUBLISH_EVERY = 64; // a power of two
+
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+    std::atomic<size_t> head_snapshot_{0};
+};
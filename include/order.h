@@ -2,41 +2,96 @@
 // FILE: include/order.h
 // ============================================================================
 #pragma once
-#include <string>
+#include <cstdint>
 #include <chrono>
-#include "../vendor/json.hpp" // <-- ADDED
-#include <iomanip>           // <-- ADDED
-#include <sstream>           // <-- ADDED
+#include <string>
 
-using json = nlohmann::json; // <-- ADDED
-    
+enum class Side : uint8_t { Buy, Sell };
+enum class OrderType : uint8_t { Market, Limit, Ioc, Fok };
+
+// Compact internal order. Ids and symbols are integers here; the "ORD-123" /
+// "BTC-USDT" strings only exist at the JSON boundary (order_json.h).
 struct Order {
-    std::string order_id;
-    std::string symbol;
-    std::string order_type; // market, limit, ioc, fok
-    std::string side; // buy or sell
+    uint64_t order_id;
+    uint32_t symbol_id;
+    OrderType order_type;
+    Side side;
     long long quantity;
     long long price; // 0 for market orders
     std::chrono::system_clock::time_point timestamp;
+};
 
-    // --- ADDED HELPER FUNCTION ---
-    static Order from_json(const json& j) {
-        Order o;
-        o.order_id = j.at("order_id").get<std::string>();
-        o.symbol = j.at("symbol").get<std::string>();
-        o.order_type = j.at("order_type").get<std::string>();
-        o.side = j.at("side").get<std::string>();
-        o.quantity = j.at("quantity").get<long long>();
-        o.price = j.at("price").get<long long>();
-        
-        // Deserialize ISO 8601 timestamp
-        std::string ts_str = j.at("timestamp").get<std::string>();
-        std::tm tm = {};
-        std::stringstream ss(ts_str);
-        ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
-        o.timestamp = std::chrono::system_clock::from_time_t(std::mktime(&tm));
-        
-        return o;
+// --- String boundary helpers ---
+inline const char *to_string(Side side) {
+    return side == Side::Buy ? "buy" : "sell";
+}
+
+inline const char *to_string(OrderType type) {
+    switch (type) {
+    case OrderType::Market: return "market";
+    case OrderType::Limit: return "limit";
+    case OrderType::Ioc: return "ioc";
+    case OrderType::Fok: return "fok";
     }
-};
+    return "limit";
+}
+
+inline bool parse_side(const std::string &s, Side &out) {
+    if (s == "buy") { out = Side::Buy; return true; }
+    if (s == "sell") { out = Side::Sell; return true; }
+    return false;
+}
+
+inline bool parse_order_type(const std::string &s, OrderType &out) {
+    if (s == "market") { out = OrderType::Market; return true; }
+    if (s == "limit") { out = OrderType::Limit; return true; }
+    if (s == "ioc") { out = OrderType::Ioc; return true; }
+    if (s == "fok") { out = OrderType::Fok; return true; }
+    return false;
+}
+
+// Order ids carry their symbol: (symbol_id + 1) in the top bits, a global
+// sequence below. Any id resolves to its book without a shared id index, so
+// nothing has to be registered on entry or reclaimed on fill/cancel. A top
+// field of 0 is an id from before this layout (older WALs).
+constexpr unsigned ORDER_ID_SEQ_BITS = 44;
+constexpr uint64_t ORDER_ID_SEQ_MASK = (1ull << ORDER_ID_SEQ_BITS) - 1;
+
+inline uint64_t make_order_id(uint32_t symbol_id, uint64_t seq) {
+    return (static_cast<uint64_t>(symbol_id) + 1) << ORDER_ID_SEQ_BITS | (seq & ORDER_ID_SEQ_MASK);
+}
+
+// False for a legacy id that does not encode a symbol
+inline bool order_id_symbol(uint64_t order_id, uint32_t &symbol_id) {
+    uint64_t tag = order_id >> ORDER_ID_SEQ_BITS;
+    if (tag == 0) return false;
+    symbol_id = static_cast<uint32_t>(tag - 1);
+    return true;
+}
+
+// Orders and stop orders share one id space; only the display prefix differs
+inline std::string format_order_id(uint64_t id) { return "ORD-" + std::to_string(id); }
+inline std::string format_stop_order_id(uint64_t id) { return "STO-" + std::to_string(id); }
+inline std::string format_trade_id(uint64_t id) { return "T-" + std::to_string(id); }
+
+// Accepts "ORD-123", "STO-123" or a bare number
+inline bool parse_order_id(const std::string &s, uint64_t &out) {
+    size_t pos = 0;
+    if (s.compare(0, 4, "ORD-") == 0 || s.compare(0, 4, "STO-") == 0) pos = 4;
+    if (pos >= s.size()) return false;
+    uint64_t value = 0;
+    for (size_t i = pos; i < s.size(); ++i) {
+        char c = s[i];
+        if (c < '0' || c > '9') return false;
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return false; // overflow
+        value = value * 10 + digit;
+    }
+    out = value;
+    return true;
+}
 
+// Accepts "T-123" or a bare number
+inline bool parse_trade_id(const std::string &s, uint64_t &out) {
+    return s.compare(0, 2, "T-") == 0 ? parse_order_id(s.substr(2), out) : parse_order_id(s, out);
+}
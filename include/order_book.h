@@ -3,8 +3,14 @@
 // ============================================================================
  #pragma once
  #include "order.h"
- #include <map>
- #include <deque>
+ #include "order_pool.h"
+ #include "book_side.h"
+ #include "trade_ring.h"
+ #include <atomic>
+ #include <climits>
+ #include <cstdint>
+ #include <functional>
+ #include <memory>
  #include <mutex>
  #include <string>
  #include <vector>
@@ -12,16 +18,64 @@
  #include <shared_mutex>
 
  struct Trade {
-     std::string trade_id;
-     std::string symbol;
+     uint64_t trade_id;
+     uint64_t maker_order_id;
+     uint64_t taker_order_id;
+     uint32_t symbol_id;
+     Side aggressor_side;
      long long price;
      long long quantity;
-     std::string aggressor_side;
-     std::string maker_order_id;
-     std::string taker_order_id;
-     std::string timestamp_iso;
      long long maker_fee;
      long long taker_fee;
+     int64_t timestamp_ns; // execution time, ns since the epoch (format with iso_time.h)
+ };
+
+ // Immutable top-N depth; version changes whenever the covered levels do
+ struct DepthSnapshot {
+     uint64_t version = 0;
+     std::vector<std::pair<long long,long long>> bids;
+     std::vector<std::pair<long long,long long>> asks;
+ };
+
+ // One operation of a batched request, applied by OrderBook::apply_batch
+ struct BookOp {
+     enum class Type { New, Cancel, Replace };
+     Type type = Type::New;
+     size_t index = 0;       // position in the client's batch
+     Order order{};          // New, Replace (the replacement order)
+     uint64_t order_id = 0;  // Cancel, Replace (the resting order)
+
+     // Results
+     std::vector<Trade> trades;
+     bool cancelled = false; // Cancel/Replace found and removed the resting order
+ };
+
+ // apply_batch callbacks, made while it still holds the book lock: replacing
+ // once a Replace's cancel succeeded (before its order is matched), after_op
+ // once each op is applied, then done. Orders they match go through
+ // add_order_in_batch.
+ struct BatchHooks {
+     std::function<void(BookOp &op)> replacing;
+     std::function<void(BookOp &op)> after_op;
+     std::function<void()> done;
+ };
+
+ // A stop that fired (StopOrderManager::process_trades): the order it
+ // became and the trades that order made
+ struct TriggeredStop {
+     Order order{};
+     std::vector<Trade> trades;
+     uint64_t wal_seq = 0; // its Cancel/Order records, when a trigger hook logged them
+ };
+
+ // Outcome of OrderBook::amend_order
+ struct AmendResult {
+     bool amended = false;       // the order was resting and now has the new size/price
+     bool requeued = false;      // price change or size-up: re-entered at the back of its level
+     long long previous_quantity = 0; // open quantity just before the amend
+     Order order{};              // the order as amended (open quantity, price, priority time)
+     std::vector<Trade> trades;  // a re-priced order can cross
+     std::vector<TriggeredStop> triggered; // stops those trades fired (set by the caller)
  };
 
  struct FeeConfig {
@@ -31,25 +85,90 @@
 
  class OrderBook {
 public:
-     explicit OrderBook(const std::string &symbol);
+     explicit OrderBook(uint32_t symbol_id);
+     // Array-indexed ladder for symbols with a fixed price band
+     OrderBook(uint32_t symbol_id, const PriceBand &band);
     
      std::vector<Trade> add_order(const Order &order);
-     bool cancel_order(const std::string &order_id);
+     // Same, appending the fills to a caller-owned buffer (not cleared) so a
+     // reused buffer matches without allocating; returns the fills appended
+     size_t add_order(const Order &order, std::vector<Trade> &fills);
+     bool cancel_order(uint64_t order_id);
+     // Applies ops in order under one lock acquisition; a Replace cancels the
+     // resting order and, only if that succeeded, adds the replacement (which
+     // queues behind existing orders at its price)
+     void apply_batch(std::vector<BookOp> &ops, const BatchHooks &hooks = {});
+     // add_order for a BatchHooks callback, which already holds the lock
+     void add_order_in_batch(const Order &order, std::vector<Trade> &fills);
+     // Sets a resting order's open quantity and price in one step (0 keeps
+     // the current value). A smaller quantity at the same price keeps the
+     // order's place in the level FIFO; a new price or a larger quantity
+     // re-queues it at the back, matching first if the new price crosses.
+     // Not amended if the order is not resting, a value is negative or the
+     // price cannot rest on this book.
+     AmendResult amend_order(uint64_t order_id, long long quantity, long long price);
      void add_order_from_replay(const Order &order);
+     // Log records applied without matching (a standby following its
+     // primary): a trade reduces its maker and taker if they rest here,
+     // removing filled ones, and enters the recent-trades ring; an amend
+     // changes the open quantity by its delta, in place for a same-price
+     // size-down, otherwise re-queued at its new price and priority time
+     void apply_trade_from_replay(const Trade &trade);
+     void apply_amend_from_replay(const Order &amended, long long previous_quantity);
+     // Drops every resting order (a standby about to load a full snapshot)
+     void clear();
 
      std::vector<std::pair<long long,long long>> top_bids(size_t n) const;
      std::vector<std::pair<long long,long long>> top_asks(size_t n) const;
 
+     // Cached top-n snapshot, rebuilt only after the top n levels changed
+     std::shared_ptr<const DepthSnapshot> depth_snapshot(size_t n) const;
+     bool best_bid(long long &price) const;
+     bool best_ask(long long &price) const;
+
+     // True if version is newer than the last published snapshot (claims it)
+     bool mark_published(uint64_t version);
+
      void set_fee_config(const FeeConfig &config) { fee_config_ = config; }
 
+     // False for limit prices a ladder-backed book cannot rest
+     bool accepts_price(long long price) const;
+     bool uses_ladder() const { return bids_.uses_ladder(); }
+
+     // Last RECENT_TRADES trades of this book, newest first (see TradeRing)
+     static constexpr size_t RECENT_TRADES = 1024;
+     std::vector<Trade> recent_trades(size_t limit, uint64_t since_trade_id = 0) const;
+     // Seeds the ring with trades recovered from the WAL
+     void record_trade(const Trade &trade);
+
 private:
-     std::string symbol_;
-     std::map<long long, std::deque<Order>, std::greater<long long>> bids_;
-     std::map<long long, std::deque<Order>> asks_;
-     std::unordered_map<std::string, std::pair<long long,bool>> order_index_;
+     uint32_t symbol_id_;
+     BookSide<true> bids_;
+     BookSide<false> asks_;
+     std::unordered_map<uint64_t, OrderNode*> order_index_;
+     OrderPool pool_;
      mutable std::shared_mutex mu_;
      FeeConfig fee_config_;
+     TradeRing<Trade> recent_trades_{RECENT_TRADES};
+
+     // Top-of-book tracking for depth_snapshot(); bounds are the worst cached
+     // price per side and are only written while mu_ is held (shared + snapshot_mu_)
+     uint64_t top_version_ = 1;
+     mutable long long bid_bound_ = LLONG_MIN;
+     mutable long long ask_bound_ = LLONG_MAX;
+     mutable std::mutex snapshot_mu_;
+     mutable std::shared_ptr<const DepthSnapshot> snapshot_;
+     mutable size_t snapshot_depth_ = 0;
+     std::atomic<uint64_t> published_version_{0};
     
-     static std::string now_iso();
      void calculate_fees(Trade &trade);
+     // Must be called with mu_ held exclusively; appends to fills
+     void add_order_locked(const Order &order, std::vector<Trade> &fills);
+     bool cancel_order_locked(uint64_t order_id);
+     // Must be called with mu_ held exclusively
+     void rest_order(const Order &order);
+     void remove_node(OrderNode *node);
+     void touch_level(bool is_buy, long long price);
+     template <class Side>
+     static std::vector<std::pair<long long,long long>> collect_levels(const Side &side, size_t n);
  };
\ No newline at end of file
@@ -0,0 +1,116 @@
+// ============================================================================
+// FILE: include/order_entry.h
+// What the order-entry front ends (HTTP API, binary gateway) share: field
+// validation, id assignment, WAL records, the id -> symbol map, matching and
+// market-data publication.
+// ============================================================================
+#pragma once
+#include "order.h"
+#include "order_book.h"
+#include "symbol_registry.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Order fields in engine units (quantity * 1e6, price * 100)
+struct OrderFields {
+    std::string symbol;
+    OrderType order_type = OrderType::Limit;
+    Side side = Side::Buy;
+    long long quantity = 0;
+    long long price = 0;
+};
+
+enum class OrderReject : uint8_t {
+    None = 0,
+    InvalidMessage = 1,
+    InvalidSymbol = 2,
+    InvalidSide = 3,
+    InvalidOrderType = 4,
+    InvalidQuantity = 5,
+    InvalidPrice = 6,
+    PriceOutsideBand = 7,
+    UnknownOrder = 8,
+    SymbolMismatch = 9,
+    NotCommitted = 10 // accepted, but the WAL sync or replication quorum failed
+};
+
+enum class OrderStatus : uint8_t { Open, PartiallyFilled, Filled, Cancelled };
+
+inline const char *to_string(OrderStatus status) {
+    switch (status) {
+    case OrderStatus::Open: return "open";
+    case OrderStatus::PartiallyFilled: return "partially_filled";
+    case OrderStatus::Filled: return "filled";
+    case OrderStatus::Cancelled: return "cancelled";
+    }
+    return "open";
+}
+
+// Quantity, price and price band checks (symbol/side/type are already parsed)
+OrderReject validate_order(const OrderFields &f);
+
+OrderStatus order_status(OrderType type, long long quantity, long long filled);
+
+// The next order id (g_total_orders), tagged with symbol_id
+uint64_t next_order_id(uint32_t symbol_id);
+
+// Assigns the next order id, tagged with symbol_id; timestamp is now
+Order make_order(const OrderFields &f, uint32_t symbol_id);
+// The same without an id: a batch Replace takes one only once its cancel
+// succeeds (apply_batch_group)
+Order unnumbered_order(const OrderFields &f, uint32_t symbol_id);
+
+struct OrderEntryResult {
+    Order order{};
+    std::vector<Trade> trades;
+    std::vector<TriggeredStop> triggered; // stops the trades fired, with their own trades
+    uint64_t wal_seq = 0; // last WAL record written for the request
+    long long filled_quantity() const;
+};
+
+// Logs the order, matches it (inline or on its shard) along with any stops
+// it triggers, logs the trades and publishes them with the new depth
+OrderEntryResult submit_order(SymbolEntry &entry, const Order &order);
+// Same, into a result the caller reuses: its vectors are cleared but keep
+// their capacity, so steady-state entry allocates nothing for the fills
+void submit_order(SymbolEntry &entry, const Order &order, OrderEntryResult &result);
+
+// Resting order or stop: true if found and cancelled (logged, depth
+// published). entry is set to the order's symbol when known.
+bool submit_cancel(uint64_t order_id, SymbolEntry *&entry, uint64_t &wal_seq);
+
+// Amend of a resting limit order (0 keeps the quantity/price): one WAL
+// record, then the trades of a re-priced order that crossed; depth
+// published. UnknownOrder if the id is not resting; entry is set whenever
+// the id is known.
+OrderReject submit_amend(uint64_t order_id, long long quantity, long long price, SymbolEntry *&entry,
+                         AmendResult &result, uint64_t &wal_seq);
+
+// process_trades trigger hook: logs the stop's Cancel ("triggered") and
+// Order records before its order enters the book, so no trade against a
+// resting stop-limit can be logged ahead of it
+void log_stop_trigger(TriggeredStop &stop);
+
+// One symbol's ops of a batch (request order) on its book, under one lock
+// (the caller is the symbol's shard, or runs inline). Stops fire after each
+// op, as if the ops were sent one at a time, and every record is appended
+// before the lock is released, so no trade against a batch order can be
+// logged ahead of it. fired collects the stops; returns the last WAL seq
+// (0 if nothing was logged).
+uint64_t apply_batch_group(SymbolEntry &entry, std::vector<BookOp> &ops, std::vector<TriggeredStop> &fired);
+
+// Holds an ack until its last WAL record is as committed as configured:
+// synced locally with wal.ack_durable, held by the replication quorum on a
+// quorum primary. False if either wait failed; true at once for seq 0.
+bool wait_committed(uint64_t wal_seq);
+// Whether wait_committed can block (wal.ack_durable or a quorum primary)
+bool commit_waits();
+
+// Symbol an order id belongs to (decoded from the id; recovered ids whose
+// tag is stale by lookup). Whether the order is still resting is up to its book.
+SymbolEntry *order_symbol(uint64_t order_id);
+
+// Trades and the book's depth to the WebSocket feed (no-op without clients)
+void publish_market_data(SymbolEntry &entry, const std::vector<Trade> &trades,
+                         const std::vector<TriggeredStop> &triggered = {});
@@ -0,0 +1,91 @@
+// ============================================================================
+// FILE: include/order_gateway.h
+// ============================================================================
+#pragma once
+#include "engine_config.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// Binary order-entry protocol over a persistent TCP session. Every message is
+// a u16 total length (including itself), a u8 type and fixed fields, all
+// little-endian. Symbols are 16 bytes, NUL padded. Prices and quantities are
+// engine units (price * 100, quantity * 1e6).
+//
+//   NewOrder (1)  u64 client_order_id, symbol[16], u8 side, u8 order_type, i64 price, i64 quantity
+//   Cancel   (2)  u64 client_order_id, u64 order_id
+//   Replace  (3)  u64 client_order_id, u64 order_id, then the NewOrder fields after client_order_id
+//   Amend    (4)  u64 client_order_id, u64 order_id, i64 price, i64 quantity (0 keeps either)
+//
+//   Ack    (0x81) u64 client_order_id, u64 order_id, u8 status, i64 filled_quantity,
+//                 i64 leaves_quantity, i64 timestamp_ns
+//   Fill   (0x82) u64 client_order_id, u64 order_id, u64 trade_id, i64 price, i64 quantity,
+//                 u8 side, u8 liquidity (0 maker, 1 taker), i64 fee
+//   Reject (0x83) u64 client_order_id, u8 reason (OrderReject)
+//
+// side: 0 buy, 1 sell. order_type: 0 market, 1 limit, 2 ioc, 3 fok.
+// status: OrderStatus (0 open, 1 partially filled, 2 filled, 3 cancelled).
+// A new order, replace or amend is acked with its order id before its taker
+// fills; a cancel ack carries the cancelled id. Replace cancels and re-enters
+// (a new id at the back of the queue); Amend changes a resting limit order
+// in place and keeps its queue position when only the quantity shrinks. Resting orders entered on a gateway
+// session also get maker fills on that session. Replies that wait for the
+// commit (wal.ack_durable, quorum replication) are held, not blocking the
+// loop; a failed commit turns the Ack and fills into a NotCommitted reject.
+// A malformed frame (unknown type or wrong length) closes the session.
+namespace gateway_proto {
+
+enum MsgType : uint8_t {
+    NewOrder = 1,
+    Cancel = 2,
+    Replace = 3,
+    Amend = 4,
+    Ack = 0x81,
+    Fill = 0x82,
+    Reject = 0x83
+};
+
+constexpr size_t SYMBOL_LEN = 16;
+constexpr size_t HEADER_SIZE = 3;
+constexpr size_t NEW_ORDER_SIZE = HEADER_SIZE + 8 + SYMBOL_LEN + 1 + 1 + 8 + 8;
+constexpr size_t CANCEL_SIZE = HEADER_SIZE + 8 + 8;
+constexpr size_t REPLACE_SIZE = NEW_ORDER_SIZE + 8;
+constexpr size_t AMEND_SIZE = HEADER_SIZE + 8 + 8 + 8 + 8;
+constexpr size_t ACK_SIZE = HEADER_SIZE + 8 + 8 + 1 + 8 + 8 + 8;
+constexpr size_t FILL_SIZE = HEADER_SIZE + 8 + 8 + 8 + 8 + 8 + 1 + 1 + 8;
+constexpr size_t REJECT_SIZE = HEADER_SIZE + 8 + 1;
+
+} // namespace gateway_proto
+
+// Accepts sessions and runs them on one event-loop thread that calls
+// straight into the matching core (order_entry.h), the same path as the HTTP
+// API. Linux (epoll) only; start() returns false elsewhere.
+class OrderGateway {
+public:
+    explicit OrderGateway(const GatewayConfig &config);
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway &) = delete;
+    OrderGateway &operator=(const OrderGateway &) = delete;
+
+    bool start();
+    void stop();
+
+    bool is_running() const { return running_.load(); }
+    size_t session_count() const { return sessions_.load(); }
+
+private:
+    struct Impl;
+
+    GatewayConfig config_;
+    Impl *impl_ = nullptr;
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> sessions_{0};
+    std::thread thread_;
+
+    void loop();
+};
+
+// nullptr unless a gateway port is configured
+extern OrderGateway *g_order_gateway;
@@ -0,0 +1,38 @@
+// ============================================================================
+// FILE: include/order_json.h
+// JSON boundary: the only place compact ids/enums become strings and back.
+// ============================================================================
+#pragma once
+#include "order.h"
+#include "order_book.h"
+#include "stop_order_manager.h"
+#include "json_writer.h"
+#include "../vendor/json.hpp"
+#include <chrono>
+#include <string>
+
+using json = nlohmann::json;
+
+std::string to_iso8601(const std::chrono::system_clock::time_point &tp);
+
+const char *to_string(StopOrderType type);
+bool parse_stop_type(const std::string &s, StopOrderType &out);
+
+// Order as written to the WAL and returned by the API
+json order_to_json(const Order &o);
+// Interns the symbol; throws on missing fields or unknown enum strings
+Order order_from_json(const json &j);
+// Same, but returns the symbol name and leaves symbol_id at 0 (parallel WAL
+// replay interns symbols later, in log order, so ids stay deterministic)
+Order order_from_json(const json &j, std::string &symbol);
+
+json trade_to_json(const Trade &t);
+Trade trade_from_json(const json &j, std::string &symbol);
+// Hot-path rendering of the same object (byte-identical to trade_to_json's dump)
+void write_trade_json(JsonWriter &w, const Trade &t);
+// order_to_json(o) plus "status", byte-identical to its dump()
+void write_order_json(JsonWriter &w, const Order &o, const char *status);
+
+json stop_order_to_json(const StopOrder &so);
+StopOrder stop_order_from_json(const json &j);
+StopOrder stop_order_from_json(const json &j, std::string &symbol);
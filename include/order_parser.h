@@ -0,0 +1,26 @@
+// ============================================================================
+// FILE: include/order_parser.h
+// Fast path for POST /orders bodies: on-demand parse of the fixed order
+// schema straight into OrderFields, no json DOM.
+// ============================================================================
+#pragma once
+#include "order_entry.h"
+#include <string_view>
+
+// Engine fixed-point scales, as powers of ten
+constexpr int QUANTITY_DECIMALS = 6; // quantity * 1e6
+constexpr int PRICE_DECIMALS = 2;    // price * 100
+
+// Exact conversion of a JSON number's text to fixed point: ("0.29", 2) -> 29.
+// Digits past the scale are truncated toward zero, as the old double cast did;
+// exponents are applied. False for text that is not a JSON number or a value
+// outside long long.
+bool decimal_to_fixed(std::string_view text, int decimals, long long &out);
+
+// Parses a flat JSON object with symbol/order_type/side/quantity/price (other
+// members are skipped) and validates it like the DOM path. True only for a
+// valid order; anything else (malformed JSON, escaped strings, nested values,
+// missing or invalid fields) returns false, and the caller reruns the DOM
+// path to produce the exact error message. Symbols up to 15 bytes fit the
+// string's inline buffer, so a valid order parses without allocating.
+bool parse_order_fast(std::string_view body, OrderFields &f);
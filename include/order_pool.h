@@ -0,0 +1,106 @@
+// ============================================================================
+// FILE: include/order_pool.h
+// ============================================================================
+#pragma once
+#include "order.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct PriceLevel;
+
+// A resting order. Nodes are owned by an OrderPool and linked into the FIFO
+// of the price level they rest on, so fills and cancels touch them in place.
+struct OrderNode {
+    Order order;
+    PriceLevel *level = nullptr;
+    OrderNode *prev = nullptr;
+    OrderNode *next = nullptr;
+};
+
+// Intrusive FIFO of resting orders at a single price, with the running
+// total quantity and order count kept in step with every add/fill/cancel.
+struct PriceLevel {
+    long long price = 0;
+    long long total_quantity = 0;
+    size_t order_count = 0;
+    OrderNode *head = nullptr;
+    OrderNode *tail = nullptr;
+
+    bool empty() const { return head == nullptr; }
+
+    void push_back(OrderNode *node) {
+        total_quantity += node->order.quantity;
+        ++order_count;
+        node->level = this;
+        node->prev = tail;
+        node->next = nullptr;
+        if (tail) tail->next = node;
+        else head = node;
+        tail = node;
+    }
+
+    // Partial fill of a resting order; it keeps its queue position
+    void reduce(OrderNode *node, long long qty) {
+        node->order.quantity -= qty;
+        total_quantity -= qty;
+    }
+
+    void unlink(OrderNode *node) {
+        total_quantity -= node->order.quantity;
+        --order_count;
+        if (node->prev) node->prev->next = node->next;
+        else head = node->next;
+        if (node->next) node->next->prev = node->prev;
+        else tail = node->prev;
+        node->prev = node->next = nullptr;
+        node->level = nullptr;
+    }
+};
+
+// Chunked arena of OrderNodes with a free list. Nodes are never returned to
+// the allocator while the pool lives; released nodes are recycled, which also
+// lets the strings inside Order keep their capacity between uses.
+class OrderPool {
+public:
+    explicit OrderPool(size_t chunk_size = 4096) : chunk_size_(chunk_size) {}
+
+    OrderPool(const OrderPool &) = delete;
+    OrderPool &operator=(const OrderPool &) = delete;
+
+    OrderNode *acquire(const Order &order) {
+        OrderNode *node = free_list_;
+        if (node) {
+            free_list_ = node->next;
+        } else {
+            if (chunks_.empty() || next_in_chunk_ == chunk_size_) {
+                chunks_.emplace_back(new OrderNode[chunk_size_]);
+                next_in_chunk_ = 0;
+            }
+            node = &chunks_.back()[next_in_chunk_++];
+        }
+        node->order = order;
+        node->level = nullptr;
+        node->prev = node->next = nullptr;
+        ++live_;
+        return node;
+    }
+
+    void release(OrderNode *node) {
+        node->level = nullptr;
+        node->prev = nullptr;
+        node->next = free_list_;
+        free_list_ = node;
+        --live_;
+    }
+
+    size_t live() const { return live_; }
+    size_t capacity() const { return chunks_.size() * chunk_size_; }
+
+private:
+    size_t chunk_size_;
+    size_t next_in_chunk_ = 0;
+    size_t live_ = 0;
+    OrderNode *free_list_ = nullptr;
+    std::vector<std::unique_ptr<OrderNode[]>> chunks_;
+};
@@ -12,13 +12,13 @@ public:
     OrderStore(const std::string &wal_path = "./data/wal.jsonl");
     ~OrderStore();
 
-    std::string next_id();
+    uint64_t next_id();
     void add_order(const Order &o);
-    bool has_order(const std::string &id);
-    Order get_order(const std::string &id);
+    bool has_order(uint64_t id);
+    Order get_order(uint64_t id);
 
 private:
-    std::unordered_map<std::string, Order> orders;
+    std::unordered_map<uint64_t, Order> orders;
     std::mutex mu;
     std::atomic<uint64_t> id_counter;
     std::string wal_path; // kept for compatibility, actual WAL is global
@@ -0,0 +1,102 @@
+// ============================================================================
+// FILE: include/recovery.h
+// ============================================================================
+#pragma once
+#include "wal.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Open orders/stops as of a WAL sequence number: what replay rebuilds and
+// what a snapshot stores. Both startup recovery and the snapshotter fold WAL
+// records into one of these, so a snapshot is exactly the state a full
+// replay up to its sequence number would produce.
+class RecoveryState {
+public:
+    void apply(const WalRecord &rec);
+    // A folded segment covers everything up to its seal seq, even if its
+    // last records carried no seq (raw append_json lines)
+    void advance_to(uint64_t seq);
+
+    // Compact binary file (magic, seq, counters, symbol table, orders, stops,
+    // highest order id seq, CRC-32). save() writes a temp file and renames it into place.
+    bool load_snapshot(const std::string &path); // false if there is none; throws if corrupt
+    void save_snapshot(const std::string &path) const;
+    // The same bytes in memory (replication ships them to a standby);
+    // decode throws if corrupt, naming `source`
+    std::string encode() const;
+    void decode(const std::string &data, const std::string &source);
+
+    // Rests the open orders/stops in g_symbol_registry in id (= arrival) order
+    void load_into_books() const;
+
+    uint64_t last_seq() const { return last_seq_; }
+    uint64_t total_orders() const { return total_orders_; }
+    // Where g_total_orders resumes: past every order id seen. Ids can be
+    // skipped, so the record count is not the highest one.
+    uint64_t next_order_seq() const { return std::max(total_orders_, max_order_seq_); }
+    uint64_t total_trades() const { return total_trades_; }
+    const std::unordered_map<uint64_t, Order> &orders() const { return orders_; }
+    const std::unordered_map<uint64_t, StopOrder> &stops() const { return stops_; }
+
+private:
+    std::unordered_map<uint64_t, Order> orders_;
+    std::unordered_map<uint64_t, StopOrder> stops_;
+    uint64_t last_seq_ = 0;
+    uint64_t total_orders_ = 0;
+    uint64_t max_order_seq_ = 0; // highest order_id & ORDER_ID_SEQ_MASK in Order/StopOrder records
+    uint64_t total_trades_ = 0;
+};
+
+std::string snapshot_path(const WalConfig &config);
+
+// Sealed segments of the WAL at config.path, oldest first
+std::vector<std::pair<uint64_t, std::string>> sealed_segments(const WalConfig &config);
+
+// Latest snapshot + leftover sealed segments + the active file. Segments the
+// snapshot already covers are deleted.
+RecoveryState recover(WAL &wal);
+
+// Makes `state` what this WAL recovers to, for a standby resynced from its
+// primary's snapshot: the active file is sealed, the snapshot written, every
+// sealed segment (all older than it) deleted and appends continue after its
+// seq. Records queued on the WAL are flushed first.
+void install_snapshot(WAL &wal, const RecoveryState &state);
+
+// Background compaction: every interval, seal the active WAL segment, fold it
+// into the in-memory RecoveryState, write the snapshot and delete the
+// segment. It only reads sealed files, so matching is never paused.
+class Snapshotter {
+public:
+    Snapshotter(WAL &wal, RecoveryState state);
+    ~Snapshotter();
+
+    void start();
+    void stop();
+
+    // One compaction cycle; false if there was nothing new to fold in
+    bool snapshot_now();
+    // install_snapshot, then continue folding from `state`
+    void reset(RecoveryState state);
+
+    uint64_t snapshot_seq() const { return snapshot_seq_.load(); }
+
+private:
+    WAL &wal_;
+    RecoveryState state_;
+    std::mutex mu_; // one cycle at a time
+    std::atomic<uint64_t> snapshot_seq_{0};
+
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+    std::mutex wait_mu_;
+    std::condition_variable cv_;
+
+    void loop();
+};
@@ -0,0 +1,196 @@
+// ============================================================================
+// FILE: include/replication.h
+// WAL streaming from a primary to hot standbys
+// ============================================================================
+#pragma once
+#include "engine_config.h"
+#include "recovery.h"
+#include "wal.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// One TCP connection per standby. Every message is a u32 length of what
+// follows, a u8 type and a body, little-endian:
+//
+//   Hello    (1)  standby -> primary: u64 last seq in the standby's WAL
+//   Snapshot (2)  primary -> standby: RecoveryState::encode() bytes
+//   Records  (3)  primary -> standby: whole records in the binary WAL format
+//   Ack      (4)  standby -> primary: u64 seq durable in the standby's WAL
+//
+// After Hello the primary streams from the standby's seq if its backlog
+// still holds the next record, and sends a Snapshot first otherwise. Records
+// frames are the primary's WAL writer batches, so a standby's log is a copy
+// of the primary's with the same sequence numbers.
+namespace replication_proto {
+
+enum MsgType : uint8_t {
+    Hello = 1,
+    Snapshot = 2,
+    Records = 3,
+    Ack = 4
+};
+
+constexpr size_t HEADER_SIZE = 5;
+constexpr size_t MAX_FRAME = 1u << 30;
+
+} // namespace replication_proto
+
+// Applies replicated records to this process's books with the rules
+// recovery folds by: limit orders rest whole and trades then reduce maker
+// and taker, cancels and amends go by id, stops are added and cancelled.
+// Trades also feed the recent-trades rings and trailing stops. A taker can
+// rest a moment before the trades logged after it arrive, so a standby book
+// may briefly cross; it never diverges.
+class ReplicaApplier {
+public:
+    void apply(const WalRecord &rec);
+    // Publishes the trades and depth of every book touched since the last call
+    void publish();
+
+private:
+    std::unordered_map<uint32_t, std::vector<Trade>> touched_; // by symbol id
+};
+
+// Primary side: taps the WAL writer, keeps the last backlog_bytes of batches
+// and the current RecoveryState (for standbys that are too far behind), and
+// runs a sender and an ack reader per standby. Linux only; start() returns
+// false elsewhere.
+class ReplicationPrimary {
+public:
+    // state: what recovery rebuilt, as of the WAL's last seq
+    ReplicationPrimary(const ReplicationConfig &config, WAL &wal, RecoveryState state);
+    ~ReplicationPrimary();
+
+    ReplicationPrimary(const ReplicationPrimary &) = delete;
+    ReplicationPrimary &operator=(const ReplicationPrimary &) = delete;
+
+    bool start();
+    void stop();
+
+    // Quorum mode: true once `quorum` standbys have acked seq as durable,
+    // false after ack_timeout_ms or on stop. Async mode: true at once.
+    bool wait_replicated(uint64_t seq);
+    bool waits_for_quorum() const { return config_.ack == ReplicationAck::Quorum; }
+
+    size_t standby_count() const;
+    // Seq durable on every connected standby (0 without standbys)
+    uint64_t min_acked_seq() const;
+    uint64_t last_seq() const;
+
+    // WAL batch tap (writer thread); public for tests
+    void on_batch(const std::vector<WalRecord> &batch, const std::string &binary);
+
+private:
+    struct Frame {
+        uint64_t first_seq = 0;
+        uint64_t last_seq = 0;
+        std::shared_ptr<const std::string> bytes; // header included
+    };
+    struct Peer {
+        int fd = -1;
+        std::atomic<uint64_t> acked{0};
+        std::atomic<bool> alive{true};
+        std::thread sender;
+        std::thread reader;
+    };
+
+    ReplicationConfig config_;
+    WAL &wal_;
+    mutable std::mutex mu_; // state_, backlog_, peers_
+    std::condition_variable cv_;  // new frames, a peer died, stopping
+    RecoveryState state_;
+    std::deque<Frame> backlog_;
+    size_t backlog_size_ = 0;
+    std::vector<std::unique_ptr<Peer>> peers_;
+
+    std::mutex ack_mu_;
+    std::condition_variable ack_cv_;
+
+    int listen_fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+
+    void accept_loop();
+    void send_loop(Peer &peer);
+    void read_acks(Peer &peer);
+    size_t acked_count(uint64_t seq) const;
+    void reap_peers(bool all);
+};
+
+// Standby side: follows the primary (reconnecting on loss), writes the
+// records to the local WAL with their original sequence numbers, applies
+// them to the books and acks what is durable. Writes are refused while it
+// follows; promote() makes this process a primary without any replay.
+class ReplicationStandby {
+public:
+    // state: what recovery rebuilt from the local WAL; snapshotter, if the
+    // local WAL compacts, is reset when the primary sends a snapshot
+    ReplicationStandby(const ReplicationConfig &config, WAL &wal, RecoveryState state,
+                       Snapshotter *snapshotter = nullptr);
+    ~ReplicationStandby();
+
+    ReplicationStandby(const ReplicationStandby &) = delete;
+    ReplicationStandby &operator=(const ReplicationStandby &) = delete;
+
+    void start();
+    void stop();
+
+    // Called by promote() with the state as of the last applied record,
+    // before writes are accepted (main starts order entry and, with a
+    // replication port, a ReplicationPrimary of its own)
+    using PromoteHook = std::function<void(RecoveryState state)>;
+    void set_promote_hook(PromoteHook hook) { promote_hook_ = std::move(hook); }
+    // Stops following and accepts writes; false if already promoted
+    bool promote();
+
+    bool connected() const { return connected_.load(); }
+    bool promoted() const { return promoted_.load(); }
+    uint64_t applied_seq() const { return applied_seq_.load(); }
+
+    // One Records/Snapshot message body; false if the stream must be
+    // restarted (corrupt or out of sequence). Public for tests.
+    bool handle_records(const std::string &body);
+    void handle_snapshot(const std::string &body);
+
+private:
+    ReplicationConfig config_;
+    WAL &wal_;
+    RecoveryState state_; // standby thread only
+    Snapshotter *snapshotter_;
+    ReplicaApplier applier_;
+    PromoteHook promote_hook_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> promoted_{false};
+    std::atomic<uint64_t> applied_seq_{0};
+    std::mutex fd_mu_;
+    int fd_ = -1; // the live connection, guarded by fd_mu_ (stop() shuts it down)
+    std::thread thread_;
+
+    std::mutex ack_mu_;
+    std::condition_variable ack_cv_;
+    uint64_t ack_target_ = 0; // guarded by ack_mu_
+
+    void loop();
+    void follow(int fd);
+    void ack_loop(int fd, const std::atomic<bool> &session_alive);
+    void note_applied(uint64_t seq);
+};
+
+// True on a standby that has not been promoted: order entry answers 503
+bool replication_read_only();
+
+// nullptr unless this process has that role
+extern ReplicationPrimary *g_replication_primary;
+extern ReplicationStandby *g_replication_standby;
@@ -4,7 +4,9 @@
 #pragma once
 #include "order.h"
 #include "order_book.h"
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <string>
@@ -12,12 +14,6 @@
 #include <atomic>
 #include <cstdint>
 #include <chrono>
-#include "../vendor/json.hpp" // <-- ADDED
-#include <iomanip>           // <-- ADDED
-#include <sstream>           // <-- ADDED
-
-using json = nlohmann::json; // <-- ADDED
-
 enum class StopOrderType {
     STOP_LOSS,      // Trigger market order when price hits trigger
     STOP_LIMIT,     // Trigger limit order when price hits trigger
@@ -26,84 +22,100 @@ enum class StopOrderType {
 };
 
 struct StopOrder {
-    std::string order_id;
-    std::string symbol;
-    StopOrderType stop_type;
-    std::string side;  // buy or sell
-    long long trigger_price;
-    long long limit_price;  // For stop-limit orders
-    long long quantity;
-    long long trail_amount;  // For trailing stops
+    uint64_t order_id = 0;  // 0 = assign one in add_stop_order
+    uint32_t symbol_id = 0;
+    StopOrderType stop_type = StopOrderType::STOP_LOSS;
+    Side side = Side::Buy;
+    long long trigger_price = 0;
+    long long limit_price = 0;  // For stop-limit orders
+    long long quantity = 0;
+    long long trail_amount = 0;  // For trailing stops
     std::chrono::system_clock::time_point created_at;
     std::string user_id;
     
     // Trailing stop tracking
-    long long best_price;  // Track best price seen
-
-    // --- ADDED HELPER FUNCTION ---
-    static StopOrder from_json(const json& j) {
-        StopOrder so;
-        so.order_id = j.at("order_id").get<std::string>();
-        so.symbol = j.at("symbol").get<std::string>();
-        so.side = j.at("side").get<std::string>();
-        so.quantity = j.at("quantity").get<long long>();
-        so.trigger_price = j.at("trigger_price").get<long long>();
-        
-        std::string stop_type_str = j.at("stop_type").get<std::string>();
-        if (stop_type_str == "stop_limit") {
-            so.stop_type = StopOrderType::STOP_LIMIT;
-            so.limit_price = j.at("limit_price").get<long long>();
-        } else {
-            so.stop_type = StopOrderType::STOP_LOSS;
-            so.limit_price = 0;
-        }
-        
-        // Note: We don't need to parse the timestamp for replay logic,
-        // but you could add it here if needed.
-        so.best_price = so.trigger_price; // Default best price
-        so.trail_amount = 0; // Default
-        
-        return so;
-    }
+    long long best_price = 0;  // Track best price seen
 };
 
 class StopOrderManager {
-// ... (rest of the file is unchanged)
 public:
-    explicit StopOrderManager(const std::string &symbol);
+    explicit StopOrderManager(uint32_t symbol_id);
     
     // Add stop order
-    std::string add_stop_order(const StopOrder &order);
+    uint64_t add_stop_order(const StopOrder &order);
     
     // Cancel stop order
-    bool cancel_stop_order(const std::string &order_id);
+    bool cancel_stop_order(uint64_t order_id);
     
-    // Check if any stop orders should trigger at current price
+    // Moves trailing stops to a trade price, then removes every stop the
+    // price crosses and returns the orders they become (market, or limit
+    // for stop-limit), in trigger order
     std::vector<Order> check_triggers(long long last_trade_price);
+
+    // Feeds trades to check_triggers and matches the triggered orders on
+    // book, including the trades those orders make in turn, before returning.
+    // on_trigger sees each fired stop (its order set) before the order enters
+    // the book; in_batch matches through add_order_in_batch from a BatchHooks
+    // callback.
+    using TriggerHook = void (*)(TriggeredStop &stop);
+    void process_trades(OrderBook &book, const std::vector<Trade> &trades, std::vector<TriggeredStop> &fired,
+                        TriggerHook on_trigger = nullptr, bool in_batch = false);
     
     // --- ADDED FOR WAL REPLAY ---
     void add_stop_order_from_replay(const StopOrder &order);
+    // Drops every stop (a standby about to load a full snapshot)
+    void clear();
 
-    // Update trailing stops
+    // Update trailing stops (a new extreme price moves their triggers)
     void update_trailing_stops(long long current_price);
     
     // Get all active stop orders
     std::vector<StopOrder> get_active_stops() const;
+    size_t size() const;
     
 private:
-    std::string symbol_;
-    
-    // Buy stop orders trigger when price rises
-    std::multimap<long long, StopOrder> buy_stops_;
+    // Trailing stops with the same trail amount that have seen the same
+    // extreme price share a bucket keyed by it. A new extreme merges every
+    // bucket it passes into one (list splice + union-find link), so a tick
+    // costs O(buckets merged or fired), not O(stops).
+    struct TrailBucket {
+        long long best = 0;                      // extreme seen by every stop here
+        std::shared_ptr<TrailBucket> merged_into; // set once absorbed by a newer extreme
+        std::list<StopOrder> stops;              // only used while this is a root
+    };
+    using BucketPtr = std::shared_ptr<TrailBucket>;
+    using Buckets = std::map<long long, BucketPtr>;     // live buckets by best price
+    using FixedStops = std::multimap<long long, StopOrder>; // by trigger price
+
+    enum class Kind : uint8_t { Fixed, Trailing };
+    struct StopRef {
+        Kind kind = Kind::Fixed;
+        Side side = Side::Buy;
+        FixedStops::iterator fixed;              // Fixed
+        BucketPtr bucket;                        // Trailing: a bucket on the way to its root
+        std::list<StopOrder>::iterator trailing; // Trailing: position in the root's list
+    };
+
+    uint32_t symbol_id_;
     
-    // Sell stop orders trigger when price falls
-    std::multimap<long long, StopOrder> sell_stops_;
+    // Buy stops trigger when price rises to their trigger (lowest first),
+    // sell stops when it falls to theirs (highest first)
+    FixedStops buy_stops_;
+    FixedStops sell_stops_;
+
+    // Trailing stops by trail amount; buys track the low, sells the high
+    std::map<long long, Buckets> buy_trailing_;
+    std::map<long long, Buckets> sell_trailing_;
     
-    std::unordered_map<std::string, long long> order_index_;  // order_id -> trigger_price
+    std::unordered_map<uint64_t, StopRef> order_index_;
     
-    std::mutex mu_;
+    mutable std::mutex mu_;
     std::atomic<std::uint64_t> stop_order_counter_{1};
     
-    std::string generate_stop_order_id();
+    uint64_t generate_stop_order_id();
+    void insert_locked(StopOrder stop);
+    void update_trailing_locked(long long current_price);
+    static BucketPtr root_of(BucketPtr &bucket);
+    static void refresh_trailing(StopOrder &stop, long long best);
+    Order to_order(const StopOrder &stop) const;
 };
-
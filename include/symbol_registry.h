@@ -0,0 +1,68 @@
+// ============================================================================
+// FILE: include/symbol_registry.h
+// ============================================================================
+#pragma once
+#include "order_book.h"
+#include "stop_order_manager.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Everything the engine keeps per symbol. Entries are created once and never
+// destroyed while the registry lives, so the pointers handed out stay valid.
+struct SymbolEntry {
+    SymbolEntry(uint32_t id, const std::string &symbol);
+    SymbolEntry(uint32_t id, const std::string &symbol, const PriceBand &band);
+
+    const uint32_t id;
+    const std::string symbol;
+    OrderBook book;
+    StopOrderManager stops;
+};
+
+// Fixed-capacity, insert-only symbol table. Lookups are lock-free (probe an
+// open-addressed array of atomic pointers); only creating a new symbol takes
+// a mutex, and readers never wait for it.
+class SymbolRegistry {
+public:
+    explicit SymbolRegistry(size_t max_symbols = 16384);
+
+    SymbolRegistry(const SymbolRegistry &) = delete;
+    SymbolRegistry &operator=(const SymbolRegistry &) = delete;
+
+    // nullptr if the symbol has never been seen
+    SymbolEntry *find(const std::string &symbol) const;
+    // Creates the entry (ladder book if the symbol has a configured band)
+    SymbolEntry &get_or_create(const std::string &symbol);
+
+    // Called for each new entry, in id order, while creation is serialized
+    // (main logs it to the WAL so replay and standbys assign the same ids)
+    using CreateHook = std::function<void(const SymbolEntry &)>;
+    void set_create_hook(CreateHook hook);
+
+    // Entries in creation order; ids are dense indices into it
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+    SymbolEntry *at(uint32_t id) const;
+
+    template <class F>
+    void for_each(F &&f) const {
+        size_t n = size();
+        for (size_t i = 0; i < n; ++i) f(*entries_[i].load(std::memory_order_acquire));
+    }
+
+private:
+    size_t max_symbols_;
+    size_t mask_;
+    std::unique_ptr<std::atomic<SymbolEntry*>[]> slots_;    // hash table
+    std::unique_ptr<std::atomic<SymbolEntry*>[]> entries_;  // by id
+    std::atomic<size_t> count_{0};
+    std::mutex create_mu_;
+    std::vector<std::unique_ptr<SymbolEntry>> owned_;        // guarded by create_mu_
+    CreateHook create_hook_;                                 // guarded by create_mu_
+
+    SymbolEntry *probe(const std::string &symbol, size_t &slot) const;
+};
@@ -0,0 +1,32 @@
+// ============================================================================
+// FILE: include/thread_topology.h
+// ============================================================================
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Size, placement and idle strategy of one group of long-lived threads
+// (matching shards, the WAL writer, broadcast writers, WebSocket workers,
+// the HTTP pool, the gateway loop). Defaults leave a group as it was: its
+// built-in size, free to float, backing off when idle.
+struct ThreadGroupConfig {
+    size_t count = 0;       // threads in the group; 0 = the group's default
+    std::vector<int> cpus;  // thread i is pinned to cpus[i % cpus.size()]
+    int numa_node = -1;     // without cpus: confine the group to this node's CPUs
+    bool busy_poll = false; // spin when idle instead of sleeping/blocking (one core per thread)
+
+    bool places_threads() const { return !cpus.empty() || numa_node >= 0; }
+};
+
+// Applies the group's placement to the calling thread (its index within the
+// group) and names it "<name>-<index>" for top/perf. Placement failures are
+// logged, not fatal. Call it first thing on the new thread: memory the
+// thread first touches afterwards is then allocated on its node.
+void place_current_thread(const ThreadGroupConfig &group, size_t index, const char *name);
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}; false if malformed
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus);
+
+// CPUs of a NUMA node from /sys/devices/system/node (empty if unknown)
+std::vector<int> numa_node_cpus(int node);
@@ -0,0 +1,57 @@
+// ============================================================================
+// FILE: include/trade_ring.h
+// ============================================================================
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-capacity ring of the most recent trades of one book. Trade ids are
+// assigned in increasing order, so the ring is always sorted by id and
+// "trades after X" is a binary search. Not synchronized: the owning book
+// guards it with its own mutex.
+template <class T>
+class TradeRing {
+public:
+    explicit TradeRing(size_t capacity) : buf_(capacity ? capacity : 1) {}
+
+    void push(const T &trade) {
+        buf_[(start_ + count_) % buf_.size()] = trade;
+        if (count_ < buf_.size()) ++count_;
+        else start_ = (start_ + 1) % buf_.size();
+    }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return buf_.size(); }
+
+    // Newest first, at most `limit`. With since_id != 0 the result is the
+    // `limit` trades immediately after since_id, so polling with the highest
+    // id seen never skips a trade that is still in the ring.
+    std::vector<T> recent(size_t limit, uint64_t since_id = 0) const {
+        size_t first = 0;
+        if (since_id != 0) {
+            size_t lo = 0, hi = count_;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (at(mid).trade_id <= since_id) lo = mid + 1;
+                else hi = mid;
+            }
+            first = lo;
+        }
+        size_t n = std::min(limit, count_ - first);
+        size_t last = since_id != 0 ? first + n : count_; // one past the newest returned
+
+        std::vector<T> out;
+        out.reserve(n);
+        for (size_t i = last; i > last - n; --i) out.push_back(at(i - 1));
+        return out;
+    }
+
+private:
+    std::vector<T> buf_;
+    size_t start_ = 0; // oldest element
+    size_t count_ = 0;
+
+    const T &at(size_t i) const { return buf_[(start_ + i) % buf_.size()]; }
+};
@@ -3,63 +3,199 @@
 
 #include <string>
 #include <mutex>
-#include <fstream>
 #include <vector>
 #include <chrono>
 #include <atomic>
-#include <queue>
 #include <thread>
 #include <condition_variable>
+#include <functional>
+#include <cstdint>
 #include "../vendor/json.hpp"
+#include "engine_config.h"
+#include "order.h"
+#include "order_book.h"
+#include "stop_order_manager.h"
+
+// Binary WAL layout (little-endian). A file starts with the 8-byte
+// WAL_FILE_MAGIC, followed by records of
+//
+//   u32 payload_len | u8 type | u8 version | u16 reserved | u64 seq |
+//   i64 timestamp_ns | u32 crc32(header[0..24) + payload) | payload
+//
+// Replay stops at the first truncated or corrupt record (a torn tail).
+static constexpr char WAL_FILE_MAGIC[8] = {'M', 'E', 'W', 'A', 'L', '0', '1', '\n'};
+static constexpr size_t WAL_HEADER_SIZE = 28;
+
+enum class WalRecordType : uint8_t {
+    Order = 1,
+    StopOrder = 2,
+    Trade = 3,
+    Cancel = 4,
+    Amend = 5,
+    Symbol = 6, // a symbol was interned; replay recreates ids in this order
+    Json = 15 // free-form append_json entries
+};
+
+// One queued WAL entry; only the member matching `type` is meaningful.
+struct WalRecord {
+    WalRecordType type = WalRecordType::Json;
+    uint64_t seq = 0;
+    int64_t timestamp_ns = 0;
+    Order order{};         // Order; Amend: id, new open quantity, price, priority time
+    StopOrder stop;
+    Trade trade{};
+    uint64_t order_id = 0; // Cancel
+    long long previous_quantity = 0; // Amend: open quantity before it
+    std::string text;      // Cancel reason, or the dumped Json entry
+    std::string symbol;    // Symbol: its name; others: set by replay decoding until interned
+    uint32_t symbol_id = 0; // Symbol: the id it was created with
+};
+
+struct WalReplayStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    uint64_t last_seq = 0;
+    double seconds = 0;
+    bool torn_tail = false; // stopped at a truncated or corrupt record
+
+    double records_per_sec() const { return seconds > 0 ? records / seconds : 0; }
+    double mb_per_sec() const { return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0; }
+};
 
 class WAL {
 public:
-    // Constructor no longer takes flush intervals
     explicit WAL(const std::string &path = "./data/wal.jsonl");
+    explicit WAL(const WalConfig &config);
     ~WAL();
 
-    // Append a generic JSON object (now very fast)
-    void append_json(const nlohmann::json &j);
+    // Reopens the log with a new path/format/sync policy (startup only,
+    // before anything is appended)
+    void configure(const WalConfig &config);
+
+    // Appends return the record's sequence number (0 if the WAL is stopped).
+    // Typed records are encoded on the writer thread, not the caller's.
+    uint64_t append_json(const nlohmann::json &j);
+    uint64_t append_order(const Order &o);
+    uint64_t append_trade(const Trade &t);
+    uint64_t append_stop_order(const StopOrder &so);
+    uint64_t append_cancel(uint64_t order_id, const std::string &reason);
+    // In-place change of a resting order (see OrderBook::amend_order)
+    uint64_t append_amend(const Order &amended, long long previous_quantity);
+    // A new symbol and its id (SymbolRegistry create hook)
+    uint64_t append_symbol(uint32_t symbol_id, const std::string &symbol);
+    // Queues records under one lock acquisition with consecutive sequence
+    // numbers; returns the last one (0 if stopped or empty)
+    uint64_t append_batch(std::vector<WalRecord> &records);
+    // Standby side of replication: records that already carry the primary's
+    // sequence numbers and timestamps, which are kept. They must continue
+    // this log exactly (first seq = last seq + 1, no gaps); returns the last
+    // seq, or 0 if stopped, empty or out of sequence.
+    uint64_t append_replicated(std::vector<WalRecord> &records);
+
+    // Called on the writer thread after each batch reached the file (before
+    // its sync), with the batch and its binary encoding whatever the file
+    // format. It runs with the writer's I/O lock held, so it must not block.
+    using BatchTap = std::function<void(const std::vector<WalRecord> &batch, const std::string &binary)>;
+    void set_batch_tap(BatchTap tap);
 
-    // Convenience helpers (unchanged)
-    void append_order(const nlohmann::json &order_json);
-    void append_trade(const nlohmann::json &trade_json);
-    void append_cancel(const std::string &order_id, const std::string &reason);
-    
-    // Force flush of the ofstream buffer
+    // Durability: records up to durable_seq() have been written and, unless
+    // sync is "none", fdatasync'd. wait_durable blocks until `seq` is covered;
+    // it returns false if the WAL stopped or a write/sync failed first. After
+    // a failed write or sync nothing more is written (a torn record would hide
+    // every later one from replay): later records are dropped and their waits
+    // fail until configure() reopens the log.
+    uint64_t durable_seq() const { return durable_seq_.load(std::memory_order_acquire); }
+    bool wait_durable(uint64_t seq);
+
+    // Force flush of everything queued so far (blocks until written)
     void flush();
-    
-    // Recovery: replay all entries from WAL (unchanged)
+
+    // Recovery: streams the log (mmap where available) in windows; each window
+    // is split across `threads` parsers (0 = hardware concurrency, max 8) and
+    // its records are handed to `apply` one by one in log (= sequence) order,
+    // with symbol ids already interned. Binary and JSON files are told apart
+    // by the file magic.
+    using ApplyFn = std::function<void(WalRecord &)>;
+    WalReplayStats replay_stream(const ApplyFn &apply, size_t threads = 0,
+                                 size_t window_bytes = 32u << 20);
+
+    // Same for an arbitrary file (sealed segments); no effect on this WAL.
+    static WalReplayStats replay_file(const std::string &path, const ApplyFn &apply,
+                                      size_t threads = 0, size_t window_bytes = 32u << 20);
+    // Records replayed from elsewhere (snapshot, segments) count as on disk
+    void note_replayed_seq(uint64_t seq);
+
+    // Closes the active file at a record boundary and renames it to
+    // segment_path(path, last_seq); appends continue in a fresh file.
+    // Returns last_seq, or 0 if nothing was written since the last seal.
+    uint64_t seal_segment(std::string &sealed_path);
+    static std::string segment_path(const std::string &path, uint64_t last_seq);
+
+    // Debug/export helper: every record as a {"type","seq","timestamp","payload"} object
     std::vector<nlohmann::json> replay();
-    
-    // Rotate WAL file (now thread-safe against the writer)
+
+    // Rotate WAL file (thread-safe against the writer)
     void rotate(const std::string &new_path);
 
     // Stop the writer thread gracefully
     void stop();
-    
+
     // Get stats
-    size_t pending_writes(); // Now returns queue_size
+    size_t pending_writes();
     size_t total_entries() const { return total_entries_; }
+    const WalConfig &config() const { return config_; }
+
+    // Test hook: the writer's next write puts only `bytes` of its batch in the
+    // file and then fails, like a full disk
+    void fail_next_write(size_t bytes) { fail_next_write_.store(static_cast<long long>(bytes)); }
+
+    // Encoding used by the writer; exposed for tests and tools
+    static void encode_binary(const WalRecord &rec, std::string &out);
+    static nlohmann::json record_to_json(const WalRecord &rec);
+    // Inverse of encode_binary for a buffer of whole records (no file magic),
+    // symbols interned in order; false at the first truncated or corrupt one
+    static bool decode_binary(const char *data, size_t len, std::vector<WalRecord> &out);
 
 private:
-    std::string path_;
-    std::ofstream ofs_;
-    std::mutex mu_; // Protects the queue AND ofs_
-    
+    WalConfig config_;
+    int fd_ = -1;
+    std::mutex mu_; // Protects queue_ and next_seq_
+    std::mutex io_mu_; // Held by the writer while touching fd_
+
     // --- Asynchronous Writer Components ---
     std::atomic<bool> running_{false};
     std::thread writer_thread_;
-    std::queue<std::string> queue_;
+    std::vector<WalRecord> queue_;
     std::condition_variable cv_;
-    
+    uint64_t next_seq_ = 0;
+
     std::atomic<size_t> total_entries_{0};
-    
-    // Internal writer loop
-    void writer_thread_loop();
 
-    // Internal flush helper (must be called while mu_ is locked)
-    void flush_internal();
+    // Group commit state (writer thread only)
+    std::string write_buf_;
+    std::string tap_buf_;  // binary copy of a JSON-format batch for tap_
+    BatchTap tap_;         // guarded by io_mu_
+    uint64_t written_seq_ = 0;
+    uint64_t sealed_seq_ = 0;
+    size_t unsynced_records_ = 0;
+    std::chrono::steady_clock::time_point last_sync_;
+
+    std::atomic<uint64_t> durable_seq_{0};
+    std::atomic<bool> io_error_{false};
+    std::atomic<long long> fail_next_write_{-1};
+    std::mutex durable_mu_;
+    std::condition_variable durable_cv_;
+
+    uint64_t enqueue(WalRecord rec);
+    void open_file();
+    void close_file();
+    void start_writer();
+    void writer_thread_loop();
+    void write_batch(std::vector<WalRecord> &batch);
+    void sync_pending();
+    void sync_locked(); // io_mu_ held
+    void publish_durable(uint64_t seq);
 };
 
 // global WAL instance (defined in wal_integration.cpp)
@@ -4,35 +4,74 @@
 #pragma once
 // Forward declarations to avoid pulling in headers that "using namespace std" (Windows byte conflict)
 struct Trade;
+struct WebSocketConfig;
 #include <string>
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <cstdint>
 #include <set>
 #include <mutex>
 
+// Feed channels a client can subscribe to per symbol
+enum class WsChannel : uint8_t { Trades, Depth, Bbo };
+
+// Slow-consumer counters since start
+struct WebSocketStats {
+    uint64_t frames_dropped = 0;   // evicted from a full client queue
+    uint64_t frames_conflated = 0; // book updates replaced by a newer one still queued
+    uint64_t slow_disconnects = 0;
+    // Send backlog right now, over all clients (epoll backend)
+    uint64_t queued_frames = 0;
+    uint64_t queued_bytes = 0;
+    uint64_t max_client_queued_bytes = 0;
+};
+
 class WebSocketServer {
 public:
     explicit WebSocketServer(int port);
     ~WebSocketServer();
     
+    // Queue limits and slow-consumer policy (before start())
+    void configure(const WebSocketConfig &config);
     void start();
     void stop();
     
     void broadcast_trade(const Trade &trade);
+    // Full top-of-book window ("orderbook"); seq is the depth stream position
     void broadcast_orderbook_update(const std::string &symbol, 
                                     const std::vector<std::pair<long long, long long>> &bids,
-                                    const std::vector<std::pair<long long, long long>> &asks);
+                                    const std::vector<std::pair<long long, long long>> &asks,
+                                    uint64_t seq = 0);
+    // Changed levels since seq - 1 ("depth_update", quantity 0 = level gone);
+    // bids/asks are the resulting window, used for the BBO channel
+    void broadcast_depth_update(const std::string &symbol, uint64_t seq,
+                                const std::vector<std::pair<long long, long long>> &bid_changes,
+                                const std::vector<std::pair<long long, long long>> &ask_changes,
+                                const std::vector<std::pair<long long, long long>> &bids,
+                                const std::vector<std::pair<long long, long long>> &asks);
     
     bool is_running() const { return running_.load(); }
     size_t client_count() const;
+    WebSocketStats stats() const;
     
 private:
     int port_;
     std::atomic<bool> running_;
     void* server_impl_;
     
-    void broadcast_json(const std::string &json_msg);
+    // Sends to clients subscribed to (symbol, channel) and to those that never
+    // subscribed, each in the format it asked for (an empty payload skips that
+    // format); only full_state frames may replace a queued one when conflating
+    void broadcast_message(const std::string &json_msg, const std::string &binary_msg,
+                           const std::string &symbol, WsChannel channel, bool full_state = true);
+    void publish_bbo(const std::string &symbol,
+                     const std::vector<std::pair<long long, long long>> &bids,
+                     const std::vector<std::pair<long long, long long>> &asks);
+    // kind is md_binary::DepthSnapshotMsg ("orderbook") or DepthUpdateMsg ("depth_update")
+    void publish_depth(uint16_t kind, const std::string &symbol, uint64_t seq,
+                       const std::vector<std::pair<long long, long long>> &bids,
+                       const std::vector<std::pair<long long, long long>> &asks);
 };
 
 extern WebSocketServer* global_ws_server;
@@ -1,110 +1,205 @@
 // FILE: src/broadcast_queue.cpp
 #include "../include/broadcast_queue.h"
 #include "../include/global_state.h" // Include this to get g_ws_server
-#include "../include/order_book.h"   // For Trade struct
+#include "../include/metrics.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 // Define the global instance
 BroadcastQueue g_broadcast_queue;
 
-BroadcastQueue::BroadcastQueue() {
-    // --- UPDATED: Create a pool of threads ---
-    num_threads_ = std::thread::hardware_concurrency();
-    if (num_threads_ == 0) num_threads_ = 4; // Default to 4 if detection fails
-    
-    std::cout << "[BroadcastQueue] Starting " << num_threads_ << " writer threads." << std::endl;
-    for(unsigned int i = 0; i < num_threads_; ++i) {
-        writer_threads_.emplace_back(&BroadcastQueue::writer_thread_loop, this);
-    }
-}
+BroadcastQueue::BroadcastQueue() = default;
 
 BroadcastQueue::~BroadcastQueue() {
-    if (running_) {
-        stop();
+    stop();
+}
+
+void BroadcastQueue::start(const BroadcastConfig &config) {
+    if (!shards_.empty()) return;
+    threads_ = config.threads;
+    size_t n = threads_.count;
+    if (n == 0) {
+        n = std::thread::hardware_concurrency();
+        if (n == 0) n = MAX_SHARDS; // Default if detection fails
+        n = std::min<size_t>(n, MAX_SHARDS);
     }
-    // --- UPDATED: Join all threads ---
-    std::cout << "[BroadcastQueue] Joining writer threads..." << std::endl;
-    for(auto& t : writer_threads_) {
-        if (t.joinable()) {
-            t.join();
-        }
+
+    std::cout << "[BroadcastQueue] Starting " << n << " writer shards." << std::endl;
+    for (size_t i = 0; i < n; ++i) shards_.push_back(std::make_unique<Shard>());
+    running_ = true;
+    for (size_t i = 0; i < n; ++i) {
+        Shard *s = shards_[i].get();
+        s->thread = std::thread([this, s, i] {
+            place_current_thread(threads_, i, "broadcast");
+            writer_thread_loop(*s);
+        });
     }
 }
 
 void BroadcastQueue::stop() {
     running_ = false;
-    cv_.notify_all(); // <-- UPDATED: Wake up ALL threads to exit
+    for (auto &shard : shards_) {
+        if (shard->thread.joinable()) shard->thread.join();
+    }
 }
 
-// (push_trade is unchanged)
-void BroadcastQueue::push_trade(const json& trade_json) {
-    if (!running_) return;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        queue_.push({BroadcastMessage::Type::Trade, "", trade_json});
+bool BroadcastQueue::push(BroadcastMessage msg) {
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    if (!shard_for(msg.symbol_id).ring.try_push(std::move(msg))) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
     }
-    cv_.notify_one(); // Wake up one available thread
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-// (push_book_update is unchanged)
-void BroadcastQueue::push_book_update(const std::string& symbol, 
-                                      const std::vector<std::pair<long long, long long>>& bids, 
-                                      const std::vector<std::pair<long long, long long>>& asks) {
-    if (!running_) return;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        queue_.push({BroadcastMessage::Type::BookUpdate, symbol, {}, bids, asks});
+void BroadcastQueue::push_trade(const ::Trade& trade) {
+    metrics::StageTimer timer(Stage::BroadcastEnqueue);
+    BroadcastMessage msg;
+    msg.type = BroadcastMessage::Type::Trade;
+    msg.symbol_id = trade.symbol_id;
+    msg.trade = trade;
+    push(std::move(msg));
+}
+
+void BroadcastQueue::push_book_update(uint32_t symbol_id, std::shared_ptr<const DepthSnapshot> book) {
+    if (!book) return;
+    metrics::StageTimer timer(Stage::BroadcastEnqueue);
+    BroadcastMessage msg;
+    msg.type = BroadcastMessage::Type::BookUpdate;
+    msg.symbol_id = symbol_id;
+    msg.book = std::move(book);
+    push(std::move(msg));
+}
+
+bool BroadcastQueue::depth_state(const std::string& symbol, std::shared_ptr<const DepthSnapshot>& book, uint64_t& seq) {
+    SymbolEntry *entry = g_symbol_registry.find(symbol);
+    if (!entry || shards_.empty()) return false;
+    Shard &shard = shard_for(entry->id);
+    std::lock_guard<std::mutex> lk(shard.depth_mu);
+    auto it = shard.depth.find(entry->id);
+    if (it == shard.depth.end() || !it->second.last) return false;
+    book = it->second.last;
+    seq = it->second.seq;
+    return true;
+}
+
+BroadcastStats BroadcastQueue::stats() const {
+    BroadcastStats s;
+    s.pushed = pushed_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.conflated = conflated_.load(std::memory_order_relaxed);
+    s.shards = static_cast<unsigned>(shards_.size());
+    for (const auto &shard : shards_) {
+        s.queue_depth += shard->ring.size();
+        s.queue_capacity += shard->ring.capacity();
     }
-    cv_.notify_one(); // Wake up one available thread
+    return s;
 }
 
-void BroadcastQueue::writer_thread_loop() {
-    // --- UPDATED: Thread loop logic ---
-    while (running_) {
+std::vector<std::pair<long long,long long>> diff_levels(const std::vector<std::pair<long long,long long>> &before,
+                                                        const std::vector<std::pair<long long,long long>> &after,
+                                                        bool descending) {
+    auto ahead = [descending](long long a, long long b) { return descending ? a > b : a < b; };
+    std::vector<std::pair<long long,long long>> changes;
+    size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size()) {
+        if (j == after.size() || (i < before.size() && ahead(before[i].first, after[j].first))) {
+            changes.push_back({before[i++].first, 0});
+        } else if (i == before.size() || ahead(after[j].first, before[i].first)) {
+            changes.push_back(after[j++]);
+        } else {
+            if (before[i].second != after[j].second) changes.push_back(after[j]);
+            ++i;
+            ++j;
+        }
+    }
+    return changes;
+}
+
+// Sends the window as a delta against the last one sent (or as a full
+// snapshot on the first update and every DEPTH_SNAPSHOT_EVERY updates). Runs
+// on the symbol's shard writer only, so seq order is wire order.
+void BroadcastQueue::publish_depth(Shard &shard, uint32_t symbol_id, std::shared_ptr<const DepthSnapshot> book) {
+    SymbolEntry *entry = g_symbol_registry.at(symbol_id);
+    if (!entry || !g_ws_server || !g_ws_server->is_running()) return;
+    const std::string &symbol = entry->symbol;
+
+    std::unique_lock<std::mutex> lk(shard.depth_mu);
+    DepthStream &stream = shard.depth[symbol_id];
+    lk.unlock();
+    // Snapshots are versioned; never step a stream backwards
+    if (stream.last && book->version <= stream.last->version) return;
+
+    // Record the new position before sending, so a resync taken meanwhile is
+    // never behind a frame already on the wire
+    bool full = !stream.last || stream.since_snapshot + 1 >= DEPTH_SNAPSHOT_EVERY;
+    std::vector<std::pair<long long,long long>> bid_changes, ask_changes;
+    if (!full) {
+        bid_changes = diff_levels(stream.last->bids, book->bids, true);
+        ask_changes = diff_levels(stream.last->asks, book->asks, false);
+        if (bid_changes.empty() && ask_changes.empty()) return;
+    }
+    lk.lock();
+    stream.last = book;
+    uint64_t seq = ++stream.seq;
+    stream.since_snapshot = full ? 0 : stream.since_snapshot + 1;
+    lk.unlock();
+
+    if (full) {
+        g_ws_server->broadcast_orderbook_update(symbol, book->bids, book->asks, seq);
+    } else {
+        g_ws_server->broadcast_depth_update(symbol, seq, bid_changes, ask_changes, book->bids, book->asks);
+    }
+}
+
+void BroadcastQueue::writer_thread_loop(Shard &shard) {
+    constexpr size_t BATCH = 256;
+    std::vector<BroadcastMessage> batch;
+    batch.reserve(BATCH);
+    std::unordered_map<uint32_t, size_t> newest_update; // symbol -> index in batch
+
+    unsigned idle = 0;
+    // Keep draining after stop() so queued market data still goes out
+    while (running_.load(std::memory_order_relaxed) || shard.ring.size() > 0) {
         BroadcastMessage msg;
-        
-        {
-            std::unique_lock<std::mutex> lk(mu_);
-            // Wait until queue has data or we are stopping
-            cv_.wait(lk, [&]{ return !queue_.empty() || !running_; });
-
-            if (!running_ && queue_.empty()) {
-                return; // Exit
+        while (batch.size() < BATCH && shard.ring.try_pop(msg)) batch.push_back(std::move(msg));
+        shard.ring.publish_head();
+        if (batch.empty()) {
+            // Spin, then yield, then sleep briefly when there is no flow;
+            // a busy-polling group never leaves its core
+            if (++idle < 1000 || threads_.busy_poll) continue;
+            if (idle < 2000) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
             }
-            
-            // Grab ONE message from the queue
-            msg = std::move(queue_.front());
-            queue_.pop();
-        } // --- Mutex is unlocked here ---
-
-        // Process this ONE message outside the lock
-        // This allows other threads to be processing other messages in parallel
-        try {
-            if (!g_ws_server || !g_ws_server->is_running()) continue;
-
-            if (msg.type == BroadcastMessage::Type::Trade) {
-                // Manually parse JSON to Trade object
-                Trade trade;
-                trade.trade_id = msg.data.value("trade_id", "");
-                trade.symbol = msg.data.value("symbol", "");
-                trade.price = msg.data.value("price", 0LL);
-                trade.quantity = msg.data.value("quantity", 0LL);
-                trade.aggressor_side = msg.data.value("aggressor_side", "");
-                trade.maker_order_id = msg.data.value("maker_order_id", "");
-                trade.taker_order_id = msg.data.value("taker_order_id", "");
-                trade.maker_fee = msg.data.value("maker_fee", 0LL);
-                trade.taker_fee = msg.data.value("taker_fee", 0LL);
-                trade.timestamp_iso = msg.data.value("timestamp", "");
-                
-                g_ws_server->broadcast_trade(trade);
-            } 
-            else if (msg.type == BroadcastMessage::Type::BookUpdate) {
-                g_ws_server->broadcast_orderbook_update(msg.symbol, msg.bids, msg.asks);
+            continue;
+        }
+        idle = 0;
+
+        // Only the newest window per symbol is worth diffing and sending
+        newest_update.clear();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].type == BroadcastMessage::Type::BookUpdate) newest_update[batch[i].symbol_id] = i;
+        }
+        for (size_t i = 0; i < batch.size(); ++i) {
+            BroadcastMessage &m = batch[i];
+            try {
+                if (m.type == BroadcastMessage::Type::BookUpdate) {
+                    if (newest_update[m.symbol_id] != i) {
+                        conflated_.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    publish_depth(shard, m.symbol_id, std::move(m.book));
+                } else if (g_ws_server && g_ws_server->is_running()) {
+                    g_ws_server->broadcast_trade(m.trade);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[BroadcastThread] Error: " << e.what() << std::endl;
             }
-        } catch (const std::exception& e) {
-            std::cerr << "[BroadcastThread] Error: " << e.what() << std::endl;
         }
+        batch.clear();
     }
-    // --- End of update ---
 }
-
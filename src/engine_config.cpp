@@ -0,0 +1,181 @@
+// FILE: src/engine_config.cpp
+#include "../include/engine_config.h"
+#include "../vendor/json.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+EngineConfig g_engine_config;
+
+static long long to_ticks(double price) {
+    return static_cast<long long>(std::llround(price * 100.0));
+}
+
+// threads.<name>: { "count", "cpus" (array or "0-3,8" list), "numa_node", "busy_poll" }
+static void read_thread_group(const json &threads, const char *name, ThreadGroupConfig &group) {
+    if (!threads.contains(name)) return;
+    const json &g = threads[name];
+    const std::string where = std::string("threads.") + name;
+    group.count = g.value("count", group.count);
+    if (g.contains("cpus")) {
+        const json &cpus = g["cpus"];
+        if (cpus.is_string()) {
+            if (!parse_cpu_list(cpus.get<std::string>(), group.cpus)) {
+                throw std::runtime_error(where + ".cpus is not a CPU list like \"0-3,8\"");
+            }
+        } else {
+            group.cpus = cpus.get<std::vector<int>>();
+        }
+        for (int cpu : group.cpus) {
+            if (cpu < 0) throw std::runtime_error(where + ".cpus must not be negative");
+        }
+    }
+    group.numa_node = g.value("numa_node", group.numa_node);
+    group.busy_poll = g.value("busy_poll", group.busy_poll);
+    if (group.numa_node >= 0 && group.cpus.empty() && numa_node_cpus(group.numa_node).empty()) {
+        std::cout << "[Config] " << where << ": NUMA node " << group.numa_node
+                  << " not found, threads will not be confined\n";
+    }
+}
+
+const PriceBand *EngineConfig::price_band(const std::string &symbol) const {
+    auto it = price_bands.find(symbol);
+    return it == price_bands.end() ? nullptr : &it->second;
+}
+
+EngineConfig EngineConfig::load(const std::string &path) {
+    EngineConfig config;
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cout << "[Config] No config at " << path << ", using defaults\n";
+        return config;
+    }
+
+    json j = json::parse(ifs);
+    config.max_ladder_levels = j.value("max_ladder_levels", config.max_ladder_levels);
+    if (j.contains("price_bands")) {
+        for (auto &[symbol, band_json] : j["price_bands"].items()) {
+            PriceBand band;
+            band.min_price = to_ticks(band_json.at("min_price").get<double>());
+            band.max_price = to_ticks(band_json.at("max_price").get<double>());
+            band.tick_size = to_ticks(band_json.value("tick_size", 0.01));
+            if (band.tick_size <= 0 || band.max_price < band.min_price ||
+                (band.max_price - band.min_price) % band.tick_size != 0) {
+                throw std::runtime_error("invalid price band for " + symbol);
+            }
+            if (band.num_levels() > config.max_ladder_levels) {
+                throw std::runtime_error("price band for " + symbol + " has " + std::to_string(band.num_levels()) +
+                                         " levels, more than max_ladder_levels (" +
+                                         std::to_string(config.max_ladder_levels) + ")");
+            }
+            config.price_bands[symbol] = band;
+            std::cout << "[Config] " << symbol << ": ladder book with "
+                      << band.num_levels() << " levels\n";
+        }
+    }
+    if (j.contains("matching_engine")) {
+        const auto &m = j["matching_engine"];
+        config.matching.shards = m.value("shards", static_cast<size_t>(0));
+        config.matching.ring_capacity = m.value("ring_capacity", config.matching.ring_capacity);
+        config.matching.threads.cpus = m.value("cpus", std::vector<int>{});
+        if (config.matching.ring_capacity == 0) {
+            throw std::runtime_error("matching_engine.ring_capacity must be positive");
+        }
+    }
+    if (j.contains("wal")) {
+        const auto &w = j["wal"];
+        config.wal.path = w.value("path", config.wal.path);
+        std::string format = w.value("format", std::string("json"));
+        if (format == "json") config.wal.format = WalFormat::Json;
+        else if (format == "binary") config.wal.format = WalFormat::Binary;
+        else throw std::runtime_error("wal.format must be json or binary");
+        std::string sync = w.value("sync", std::string("none"));
+        if (sync == "none") config.wal.sync = WalSync::None;
+        else if (sync == "batch") config.wal.sync = WalSync::Batch;
+        else if (sync == "group") config.wal.sync = WalSync::Group;
+        else throw std::runtime_error("wal.sync must be none, batch or group");
+        config.wal.sync_every_records = w.value("sync_every_records", config.wal.sync_every_records);
+        config.wal.sync_interval_us = w.value("sync_interval_us", config.wal.sync_interval_us);
+        config.wal.ack_durable = w.value("ack_durable", config.wal.ack_durable);
+        config.wal.snapshot_interval_s = w.value("snapshot_interval_seconds", config.wal.snapshot_interval_s);
+        if (config.wal.sync == WalSync::Group && config.wal.sync_interval_us <= 0) {
+            // Without a deadline a quiet period would leave records unsynced forever
+            throw std::runtime_error("wal.sync_interval_us must be positive for group sync");
+        }
+        if (config.wal.ack_durable && config.wal.sync == WalSync::None) {
+            std::cout << "[Config] wal.ack_durable with sync=none only waits for the OS write\n";
+        }
+    }
+    if (j.contains("websocket")) {
+        const auto &w = j["websocket"];
+        config.websocket.max_queued_frames = w.value("max_queued_frames", config.websocket.max_queued_frames);
+        config.websocket.max_queued_bytes = w.value("max_queued_bytes", config.websocket.max_queued_bytes);
+        std::string policy = w.value("slow_consumer", std::string("conflate"));
+        if (policy == "drop_oldest") config.websocket.slow_consumer = SlowConsumerPolicy::DropOldest;
+        else if (policy == "conflate") config.websocket.slow_consumer = SlowConsumerPolicy::Conflate;
+        else if (policy == "disconnect") config.websocket.slow_consumer = SlowConsumerPolicy::Disconnect;
+        else throw std::runtime_error("websocket.slow_consumer must be drop_oldest, conflate or disconnect");
+        if (config.websocket.max_queued_frames == 0 || config.websocket.max_queued_bytes == 0) {
+            throw std::runtime_error("websocket queue limits must be positive");
+        }
+    }
+    if (j.contains("gateway")) {
+        const auto &g = j["gateway"];
+        config.gateway.port = g.value("port", config.gateway.port);
+        config.gateway.threads.busy_poll = g.value("busy_poll", config.gateway.threads.busy_poll);
+        if (config.gateway.port < 0 || config.gateway.port > 65535) {
+            throw std::runtime_error("gateway.port must be 0-65535");
+        }
+    }
+    if (j.contains("replication")) {
+        const auto &r = j["replication"];
+        ReplicationConfig &rc = config.replication;
+        std::string role = r.value("role", std::string("none"));
+        if (role == "none") rc.role = ReplicationRole::None;
+        else if (role == "primary") rc.role = ReplicationRole::Primary;
+        else if (role == "standby") rc.role = ReplicationRole::Standby;
+        else throw std::runtime_error("replication.role must be none, primary or standby");
+        rc.port = r.value("port", rc.port);
+        rc.primary_host = r.value("primary_host", rc.primary_host);
+        rc.primary_port = r.value("primary_port", rc.primary_port);
+        std::string ack = r.value("ack", std::string("async"));
+        if (ack == "async") rc.ack = ReplicationAck::Async;
+        else if (ack == "quorum") rc.ack = ReplicationAck::Quorum;
+        else throw std::runtime_error("replication.ack must be async or quorum");
+        rc.quorum = r.value("quorum", rc.quorum);
+        rc.ack_timeout_ms = r.value("ack_timeout_ms", rc.ack_timeout_ms);
+        rc.backlog_bytes = r.value("backlog_bytes", rc.backlog_bytes);
+        if (rc.port < 0 || rc.port > 65535 || rc.primary_port < 0 || rc.primary_port > 65535) {
+            throw std::runtime_error("replication ports must be 0-65535");
+        }
+        if (rc.role == ReplicationRole::Primary && rc.port == 0) {
+            throw std::runtime_error("replication.port is required for a primary");
+        }
+        if (rc.role == ReplicationRole::Standby && rc.primary_port == 0) {
+            throw std::runtime_error("replication.primary_port is required for a standby");
+        }
+        if (rc.quorum == 0 || rc.ack_timeout_ms <= 0 || rc.backlog_bytes == 0) {
+            throw std::runtime_error("replication.quorum, ack_timeout_ms and backlog_bytes must be positive");
+        }
+    }
+    if (j.contains("threads")) {
+        const auto &t = j["threads"];
+        read_thread_group(t, "matching", config.matching.threads);
+        read_thread_group(t, "wal", config.wal.threads);
+        read_thread_group(t, "broadcast", config.broadcast.threads);
+        read_thread_group(t, "websocket", config.websocket.threads);
+        read_thread_group(t, "http", config.http.threads);
+        read_thread_group(t, "gateway", config.gateway.threads);
+        for (const char *single : {"wal", "gateway"}) {
+            if (t.contains(single) && t[single].value("count", static_cast<size_t>(1)) != 1) {
+                throw std::runtime_error(std::string("threads.") + single + ".count must be 1");
+            }
+        }
+        // A matching group size turns the sharded engine on
+        if (config.matching.threads.count > 0) config.matching.shards = config.matching.threads.count;
+    }
+    return config;
+}
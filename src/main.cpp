@@ -4,12 +4,18 @@
 #include <csignal>
 #include <atomic>
 #include <vector>
-#include <map>
+#include <memory>
 #include "../vendor/json.hpp"
 #include "../include/order.h"
+#include "../include/order_json.h"
 #include "../include/wal.h"
 #include "../include/ws_server.h"
 #include "../include/global_state.h"
+#include "../include/engine_config.h"
+#include "../include/matching_engine.h"
+#include "../include/order_gateway.h"
+#include "../include/recovery.h"
+#include "../include/replication.h"
 #include "../include/order_book.h"
 #include "../include/stop_order_manager.h"
 //#include "../include/broadcast_queue.h" // <-- ADD THIS INCLUDE
@@ -26,81 +32,57 @@ void signal_handler(int signal) {
     shutdown_requested = true;
 }
 
-// (replay_wal function is unchanged from before)
-void replay_wal() {
-    auto entries = global_wal.replay();
-    if (entries.empty()) {
+// Latest snapshot + WAL tail -> books. Returns the state for the snapshotter.
+RecoveryState replay_wal() {
+    RecoveryState state = recover(global_wal);
+    if (state.last_seq() == 0 && state.total_orders() == 0) {
         std::cout << "[Main] No WAL entries found (fresh start)\n";
-        return;
-    }
-    std::cout << "[Main] Replaying " << entries.size() << " WAL entries...\n";
-    std::map<std::string, Order> live_orders;
-    std::map<std::string, StopOrder> live_stop_orders;
-    for (const auto& j : entries) {
-        try {
-            std::string type = j["type"].get<std::string>();
-            auto payload = j["payload"];
-            if (type == "order") {
-                Order o = Order::from_json(payload);
-                live_orders[o.order_id] = o;
-                g_total_orders.fetch_add(1, std::memory_order_relaxed);
-            } 
-            else if (type == "stop_order") {
-                StopOrder so = StopOrder::from_json(payload);
-                live_stop_orders[so.order_id] = so;
-                g_total_orders.fetch_add(1, std::memory_order_relaxed);
-            }
-            else if (type == "trade") {
-                std::string maker_id = payload["maker_order_id"].get<std::string>();
-                std::string taker_id = payload["taker_order_id"].get<std::string>();
-                long long qty = payload["quantity"].get<long long>();
-                if (live_orders.count(maker_id)) {
-                    live_orders[maker_id].quantity -= qty;
-                    if (live_orders[maker_id].quantity <= 0) {
-                        live_orders.erase(maker_id);
-                    }
-                }
-                if (live_orders.count(taker_id)) {
-                    live_orders[taker_id].quantity -= qty;
-                    if (live_orders[taker_id].quantity <= 0) {
-                        live_orders.erase(taker_id);
-                    }
-                }
-                g_total_trades.fetch_add(1, std::memory_order_relaxed);
-            }
-            else if (type == "cancel") {
-                std::string id = payload["order_id"].get<std::string>();
-                live_orders.erase(id);
-                live_stop_orders.erase(id);
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "[Main] WAL replay error: " << e.what() << " on entry: " << j.dump() << std::endl;
-        }
-    }
-    std::lock_guard<std::mutex> lk(g_global_mutex);
-    for (const auto& [id, order] : live_orders) {
-        g_order_books.try_emplace(order.symbol, order.symbol);
-        g_order_books.at(order.symbol).add_order_from_replay(order); 
-        g_order_id_to_symbol[id] = order.symbol;
-    }
-    for (const auto& [id, order] : live_stop_orders) {
-        g_stop_order_managers.try_emplace(order.symbol, order.symbol);
-        g_stop_order_managers.at(order.symbol).add_stop_order_from_replay(order); 
-        g_order_id_to_symbol[id] = order.symbol;
+        return state;
     }
+    state.load_into_books();
+    g_total_orders.store(state.next_order_seq(), std::memory_order_relaxed);
+    g_total_trades.store(state.total_trades(), std::memory_order_relaxed);
     std::cout << "[Main] WAL replay complete. " 
-              << g_order_books.size() << " symbol(s) loaded." << std::endl;
+              << g_symbol_registry.size() << " symbol(s), " << state.orders().size()
+              << " resting order(s) loaded." << std::endl;
     std::cout << "[Main] Total Orders: " << g_total_orders.load() 
               << ", Total Trades: " << g_total_trades.load() << std::endl;
+    return state;
+}
+
+// From here on every new symbol is logged before it can be used, so replay
+// and standbys intern symbols in the primary's id order
+static void log_new_symbols() {
+    g_symbol_registry.set_create_hook([](const SymbolEntry &entry) { global_wal.append_symbol(entry.id, entry.symbol); });
+}
+
+static void start_order_gateway() {
+    if (g_engine_config.gateway.port <= 0) return;
+    std::cout << "[Main] Starting binary order gateway...\n";
+    g_order_gateway = new OrderGateway(g_engine_config.gateway);
+    if (!g_order_gateway->start()) {
+        delete g_order_gateway;
+        g_order_gateway = nullptr;
+    }
+}
+
+static void start_replication_primary(RecoveryState state) {
+    g_replication_primary = new ReplicationPrimary(g_engine_config.replication, global_wal, std::move(state));
+    if (!g_replication_primary->start()) {
+        delete g_replication_primary;
+        g_replication_primary = nullptr;
+    }
 }
 
 
 int main(int argc, char** argv) {
     int http_port = 8080;
     int ws_port = 9002;
+    std::string config_path = "./config/engine.json";
     
     if (argc > 1) http_port = std::stoi(argv[1]);
     if (argc > 2) ws_port = std::stoi(argv[2]);
+    if (argc > 3) config_path = argv[3];
 
     std::cout << "========================================\n";
     std::cout << "  Matching Engine - C++ Implementation  \n";
@@ -113,14 +95,51 @@ int main(int argc, char** argv) {
     std::signal(SIGTERM, signal_handler);
 
     try {
-        replay_wal();
+        g_engine_config = EngineConfig::load(config_path);
+    } catch (const std::exception &e) {
+        std::cerr << "[Main] CRITICAL: invalid config " << config_path << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    try {
+        global_wal.configure(g_engine_config.wal);
+    } catch (const std::exception &e) {
+        std::cerr << "[Main] CRITICAL: cannot open WAL " << g_engine_config.wal.path << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    const ReplicationConfig &replication = g_engine_config.replication;
+    std::unique_ptr<Snapshotter> snapshotter;
+    RecoveryState standby_state; // a standby continues folding from here
+    try {
+        RecoveryState state = replay_wal();
+        if (replication.role == ReplicationRole::Standby) {
+            standby_state = state;
+        } else {
+            log_new_symbols();
+            if (replication.role == ReplicationRole::Primary) start_replication_primary(state);
+        }
+        if (g_engine_config.wal.snapshot_interval_s > 0) {
+            snapshotter = std::make_unique<Snapshotter>(global_wal, std::move(state));
+            snapshotter->start();
+            std::cout << "[Main] Snapshotting every " << g_engine_config.wal.snapshot_interval_s << " s\n";
+        }
     } catch (const std::exception &e) {
         std::cerr << "[Main] CRITICAL: WAL replay failed: " << e.what() << "\n";
         return 1;
     }
 
+    if (g_engine_config.matching.shards > 0) {
+        std::cout << "[Main] Starting single-writer matching engine...\n";
+        g_matching_engine = new MatchingEngine(g_engine_config.matching);
+        g_matching_engine->start();
+    }
+
+    g_broadcast_queue.start(g_engine_config.broadcast);
+
     std::cout << "[Main] Initializing WebSocket server...\n";
     g_ws_server = new WebSocketServer(ws_port);
+    g_ws_server->configure(g_engine_config.websocket);
     
     std::thread ws_thread([&]() {
         try {
@@ -130,6 +149,20 @@ int main(int argc, char** argv) {
         }
     });
 
+    if (replication.role == ReplicationRole::Standby) {
+        // Read-only until promoted; order entry then starts as on a primary
+        g_replication_standby = new ReplicationStandby(replication, global_wal, std::move(standby_state),
+                                                       snapshotter.get());
+        g_replication_standby->set_promote_hook([](RecoveryState state) {
+            log_new_symbols();
+            start_order_gateway();
+            if (g_engine_config.replication.port > 0) start_replication_primary(std::move(state));
+        });
+        g_replication_standby->start();
+    } else {
+        start_order_gateway();
+    }
+
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
     std::cout << "\n[Main] Starting HTTP server...\n";
@@ -143,6 +176,14 @@ int main(int argc, char** argv) {
     std::cout << "========================================\n";
     std::cout << "HTTP API:    http://localhost:" << http_port << "\n";
     std::cout << "WebSocket:   ws://localhost:" << ws_port << "\n";
+    if (g_order_gateway) {
+        std::cout << "Gateway:     tcp://localhost:" << g_engine_config.gateway.port << "\n";
+    }
+    if (g_replication_primary) {
+        std::cout << "Replication: tcp://localhost:" << replication.port << "\n";
+    } else if (g_replication_standby) {
+        std::cout << "Standby of:  tcp://" << replication.primary_host << ":" << replication.primary_port << "\n";
+    }
     std::cout << "Health:      http://localhost:" << http_port << "/health\n";
     std::cout << "Stats:       http://localhost:" << http_port << "/stats\n";
     std::cout << "========================================\n";
@@ -154,7 +195,19 @@ int main(int argc, char** argv) {
 
     // --- UPDATED SHUTDOWN LOGIC ---
     std::cout << "\n[Main] Shutting down gracefully...\n";
+
+    if (g_order_gateway) {
+        std::cout << "[Main] Stopping order gateway...\n";
+        g_order_gateway->stop();
+        delete g_order_gateway;
+        g_order_gateway = nullptr;
+    }
     
+    if (g_replication_standby) {
+        std::cout << "[Main] Stopping replication standby...\n";
+        g_replication_standby->stop();
+    }
+
     if (g_ws_server) {
         std::cout << "[Main] Stopping WebSocket server...\n";
         g_ws_server->stop();
@@ -162,8 +215,23 @@ int main(int argc, char** argv) {
         g_ws_server = nullptr;
     }
     
+    if (g_matching_engine) {
+        std::cout << "[Main] Stopping matching engine...\n";
+        g_matching_engine->stop();
+    }
+
+    if (snapshotter) {
+        std::cout << "[Main] Stopping snapshotter...\n";
+        snapshotter->stop();
+    }
+
     std::cout << "[Main] Stopping WAL writer thread...\n";
     global_wal.stop(); // Stop async WAL
+
+    if (g_replication_primary) {
+        std::cout << "[Main] Stopping replication primary...\n";
+        g_replication_primary->stop(); // after the WAL, so standbys get its last batches
+    }
     
     std::cout << "[Main] Stopping Broadcast queue thread...\n";
     g_broadcast_queue.stop(); // <-- ADD THIS LINE
@@ -0,0 +1,147 @@
+// ============================================================================
+// FILE: src/matching_engine.cpp
+// ============================================================================
+#include "../include/matching_engine.h"
+#include "../include/global_state.h"
+#include "../include/order_entry.h"
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+MatchingEngine* g_matching_engine = nullptr;
+
+void EngineRequest::wait() {
+    // Matching usually finishes within a few microseconds: spin briefly first
+    for (int i = 0; i < 2000 && !done_.load(std::memory_order_acquire); ++i) {
+    }
+    // Always take the lock before returning: complete() may still hold it,
+    // and the request (a stack local) must outlive its last touch there
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [&]{ return done_.load(std::memory_order_acquire); });
+}
+
+void EngineRequest::complete() {
+    // Notify under the lock: once it is released the waiter may destroy us
+    std::lock_guard<std::mutex> lk(mu_);
+    done_.store(true, std::memory_order_release);
+    cv_.notify_one();
+}
+
+MatchingEngine::MatchingEngine(const MatchingEngineConfig &config) : threads_(config.threads) {
+    size_t n = config.shards == 0 ? 1 : config.shards;
+    for (size_t i = 0; i < n; ++i) {
+        auto shard = std::make_unique<Shard>(config.ring_capacity);
+        shard->index = i;
+        shards_.push_back(std::move(shard));
+    }
+}
+
+MatchingEngine::~MatchingEngine() {
+    stop();
+}
+
+void MatchingEngine::start() {
+    if (running_.exchange(true)) return;
+    for (auto &shard : shards_) {
+        shard->thread = std::thread(&MatchingEngine::run_shard, this, std::ref(*shard));
+    }
+    std::cout << "[Engine] Started " << shards_.size() << " matching shard(s)" << std::endl;
+}
+
+void MatchingEngine::stop() {
+    if (!running_.exchange(false)) return;
+    for (auto &shard : shards_) {
+        if (shard->thread.joinable()) shard->thread.join();
+    }
+    std::cout << "[Engine] Matching shards stopped" << std::endl;
+}
+
+void MatchingEngine::execute(EngineRequest &req) {
+    // Announce the push before checking running_: a shard only exits once
+    // running_ is false and no submitter that saw it true is still pushing
+    submitting_.fetch_add(1);
+    if (!running_.load()) {
+        submitting_.fetch_sub(1);
+        throw std::runtime_error("matching engine is not running");
+    }
+    Shard &shard = *shards_[shard_for(req.symbol_id)];
+    while (!shard.ring.try_push(&req)) {
+        // Ring full: the shard is saturated, back off until it drains
+        std::this_thread::yield();
+    }
+    submitting_.fetch_sub(1);
+    req.wait();
+    if (req.error) std::rethrow_exception(req.error);
+}
+
+void MatchingEngine::run_shard(Shard &shard) {
+    place_current_thread(threads_, shard.index, "match");
+
+    unsigned idle = 0;
+    EngineRequest *req = nullptr;
+    // Keep draining after stop() so no submitter is left waiting
+    while (running_.load() || submitting_.load() > 0 || shard.ring.size() > 0) {
+        if (shard.ring.try_pop(req)) {
+            idle = 0;
+            apply(*req);
+            req->complete();
+            continue;
+        }
+        shard.ring.publish_head();
+        // Spin, then yield, then sleep briefly when there is no flow;
+        // a busy-polling group never leaves its core
+        if (++idle < 1000 || threads_.busy_poll) continue;
+        if (idle < 2000) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+void MatchingEngine::apply(EngineRequest &req) {
+    try {
+        switch (req.type) {
+        case EngineRequest::Type::NewOrder: {
+            SymbolEntry *entry = g_symbol_registry.at(req.symbol_id);
+            if (!entry) throw std::runtime_error("unknown symbol id");
+            req.book = &entry->book;
+            entry->book.add_order(req.order, req.trades);
+            entry->stops.process_trades(entry->book, req.trades, req.fired, log_stop_trigger);
+            break;
+        }
+        case EngineRequest::Type::Cancel: {
+            SymbolEntry *entry = g_symbol_registry.at(req.symbol_id);
+            if (!entry) break;
+            req.book = &entry->book;
+            req.cancelled = entry->book.cancel_order(req.order_id) ||
+                            entry->stops.cancel_stop_order(req.order_id);
+            break;
+        }
+        case EngineRequest::Type::Amend: {
+            SymbolEntry *entry = g_symbol_registry.at(req.symbol_id);
+            if (!entry) break;
+            req.book = &entry->book;
+            req.amend = entry->book.amend_order(req.order_id, req.order.quantity, req.order.price);
+            entry->stops.process_trades(entry->book, req.amend.trades, req.amend.triggered, log_stop_trigger);
+            break;
+        }
+        case EngineRequest::Type::Batch: {
+            SymbolEntry *entry = g_symbol_registry.at(req.symbol_id);
+            if (!entry) throw std::runtime_error("unknown symbol id");
+            req.book = &entry->book;
+            // Logged on the shard, before later requests can trade against it
+            req.wal_seq = apply_batch_group(*entry, *req.ops, req.fired);
+            break;
+        }
+        case EngineRequest::Type::StopOrder: {
+            SymbolEntry *entry = g_symbol_registry.at(req.symbol_id);
+            if (!entry) throw std::runtime_error("unknown symbol id");
+            entry->stops.add_stop_order(req.stop);
+            break;
+        }
+        }
+    } catch (...) {
+        req.error = std::current_exception();
+    }
+}
@@ -0,0 +1,130 @@
+// ============================================================================
+// FILE: src/metrics.cpp
+// ============================================================================
+#include "../include/metrics.h"
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace metrics {
+
+namespace {
+
+struct Shard {
+    std::atomic<uint64_t> buckets[STAGES][BUCKETS];
+    std::atomic<uint64_t> count[STAGES];
+    std::atomic<uint64_t> sum_ns[STAGES];
+};
+
+// Shards are never freed: a finished thread's counts stay in the totals, and
+// threads joined during static destruction (the WAL writer) can still record
+std::mutex &shards_mu() {
+    static std::mutex *mu = new std::mutex;
+    return *mu;
+}
+
+std::vector<Shard *> &shards() {
+    static std::vector<Shard *> *all = new std::vector<Shard *>;
+    return *all;
+}
+
+Shard &local_shard() {
+    thread_local Shard *shard = nullptr;
+    if (!shard) {
+        shard = new Shard(); // value-initialized: all zero
+        std::lock_guard<std::mutex> lk(shards_mu());
+        shards().push_back(shard);
+    }
+    return *shard;
+}
+
+// Only the owning thread writes a shard, so a plain load/store is enough
+inline void bump(std::atomic<uint64_t> &a, uint64_t by) {
+    a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+void append_double(std::string &out, double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", v);
+    out += buf;
+}
+
+} // namespace
+
+const char *stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::Parse: return "parse";
+    case Stage::BookLockWait: return "book_lock_wait";
+    case Stage::Match: return "match";
+    case Stage::WalEnqueue: return "wal_enqueue";
+    case Stage::WalWrite: return "wal_write";
+    case Stage::WalSync: return "wal_sync";
+    case Stage::BroadcastEnqueue: return "broadcast_enqueue";
+    case Stage::WsSend: return "ws_send";
+    case Stage::Count: break;
+    }
+    return "unknown";
+}
+
+void record(Stage stage, uint64_t ns) {
+    Shard &s = local_shard();
+    size_t i = static_cast<size_t>(stage);
+    bump(s.buckets[i][bucket_of(ns)], 1);
+    bump(s.count[i], 1);
+    bump(s.sum_ns[i], ns);
+}
+
+StageTotals totals(Stage stage) {
+    StageTotals t;
+    size_t i = static_cast<size_t>(stage);
+    std::lock_guard<std::mutex> lk(shards_mu());
+    for (const Shard *s : shards()) {
+        for (size_t b = 0; b < BUCKETS; ++b) t.buckets[b] += s->buckets[i][b].load(std::memory_order_relaxed);
+        t.count += s->count[i].load(std::memory_order_relaxed);
+        t.sum_ns += s->sum_ns[i].load(std::memory_order_relaxed);
+    }
+    return t;
+}
+
+void write_stage_histograms(std::string &out) {
+    out += "# HELP matching_engine_stage_seconds Time spent in each order-path stage\n";
+    out += "# TYPE matching_engine_stage_seconds histogram\n";
+    for (size_t i = 0; i < STAGES; ++i) {
+        Stage stage = static_cast<Stage>(i);
+        StageTotals t = totals(stage);
+        const std::string label = std::string("stage=\"") + stage_name(stage) + "\"";
+        // Bucket counts are summed shard by shard while threads keep
+        // recording, so derive the cumulative +Inf and _count from them
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            cumulative += t.buckets[b];
+            out += "matching_engine_stage_seconds_bucket{" + label + ",le=\"";
+            if (b + 1 < BUCKETS) {
+                append_double(out, static_cast<double>(1ull << (6 + b)) / 1e9);
+            } else {
+                out += "+Inf";
+            }
+            out += "\"} " + std::to_string(cumulative) + "\n";
+        }
+        out += "matching_engine_stage_seconds_sum{" + label + "} ";
+        append_double(out, static_cast<double>(t.sum_ns) / 1e9);
+        out += "\nmatching_engine_stage_seconds_count{" + label + "} " + std::to_string(cumulative) + "\n";
+    }
+}
+
+void write_metric(std::string &out, const char *name, const char *type, const char *help, uint64_t value) {
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+    out += name;
+    out += " " + std::to_string(value) + "\n";
+}
+
+} // namespace metrics
@@ -2,35 +2,42 @@
 // FILE: src/order_book.cpp
 // ============================================================================
 #include "../include/order_book.h"
+#include "../include/iso_time.h"
+#include "../include/metrics.h"
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <chrono>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <climits>
 #include <stdexcept>
 #include <shared_mutex>
 using namespace std;
 
 static atomic<uint64_t> trade_counter{1};
 
-static string make_trade_id() {
-    auto id = trade_counter.fetch_add(1);
-    ostringstream ss; 
-    ss << "T-" << id;
-    return ss.str();
+static uint64_t make_trade_id() {
+    return trade_counter.fetch_add(1, memory_order_relaxed);
 }
 
-string OrderBook::now_iso() {
-    auto tp = chrono::system_clock::now();
-    auto t = chrono::system_clock::to_time_t(tp);
-    ostringstream ss;
-    ss << put_time(gmtime(&t), "%Y-%m-%dT%H:%M:%SZ");
-    return ss.str();
+// Takes the book's write lock, stamping how long it was contended
+static unique_lock<shared_mutex> lock_for_write(shared_mutex &mu) {
+    unique_lock<shared_mutex> lk(mu, try_to_lock);
+    if (lk.owns_lock()) {
+        metrics::record(Stage::BookLockWait, 0);
+        return lk;
+    }
+    uint64_t start = metrics::now_ns();
+    lk.lock();
+    metrics::record(Stage::BookLockWait, metrics::now_ns() - start);
+    return lk;
 }
 
-OrderBook::OrderBook(const string &symbol) : symbol_(symbol) {}
+OrderBook::OrderBook(uint32_t symbol_id) : symbol_id_(symbol_id) {}
+
+OrderBook::OrderBook(uint32_t symbol_id, const PriceBand &band) : symbol_id_(symbol_id) {
+    bids_.use_ladder(band);
+    asks_.use_ladder(band);
+}
 
 void OrderBook::calculate_fees(Trade &trade) {
     long long notional = (trade.price * trade.quantity) / 100000000LL;
@@ -40,85 +47,159 @@ void OrderBook::calculate_fees(Trade &trade) {
 
 vector<Trade> OrderBook::add_order(const Order &order) {
     vector<Trade> trades;
-    unique_lock<shared_mutex> lk(mu_);
+    add_order(order, trades);
+    return trades;
+}
 
+size_t OrderBook::add_order(const Order &order, vector<Trade> &fills) {
+    size_t before = fills.size();
+    auto lk = lock_for_write(mu_);
+    metrics::StageTimer timer(Stage::Match);
+    add_order_locked(order, fills);
+    return fills.size() - before;
+}
+
+void OrderBook::apply_batch(vector<BookOp> &ops, const BatchHooks &hooks) {
+    auto lk = lock_for_write(mu_);
+    metrics::StageTimer timer(Stage::Match);
+    for (BookOp &op : ops) {
+        switch (op.type) {
+        case BookOp::Type::New:
+            add_order_locked(op.order, op.trades);
+            break;
+        case BookOp::Type::Cancel:
+            op.cancelled = cancel_order_locked(op.order_id);
+            break;
+        case BookOp::Type::Replace:
+            op.cancelled = cancel_order_locked(op.order_id);
+            if (!op.cancelled) break;
+            if (hooks.replacing) hooks.replacing(op);
+            add_order_locked(op.order, op.trades);
+            break;
+        }
+        if (hooks.after_op) hooks.after_op(op);
+    }
+    if (hooks.done) hooks.done();
+}
+
+void OrderBook::add_order_in_batch(const Order &order, vector<Trade> &fills) {
+    add_order_locked(order, fills);
+}
+
+AmendResult OrderBook::amend_order(uint64_t order_id, long long quantity, long long price) {
+    AmendResult result;
+    auto lk = lock_for_write(mu_);
+    metrics::StageTimer timer(Stage::Match);
+    auto it = order_index_.find(order_id);
+    if (it == order_index_.end() || quantity < 0 || price < 0) return result;
+
+    OrderNode *node = it->second;
+    Order &resting = node->order;
+    if (quantity == 0) quantity = resting.quantity;
+    if (price == 0) price = resting.price;
+    if (!bids_.accepts(price)) return result;
+    result.amended = true;
+    result.previous_quantity = resting.quantity;
+    bool is_buy = (resting.side == Side::Buy);
+    if (price == resting.price && quantity <= resting.quantity) {
+        // Size-down in place: the node stays where it is in the FIFO
+        node->level->reduce(node, resting.quantity - quantity);
+        touch_level(is_buy, price);
+        result.order = resting;
+        return result;
+    }
+
+    Order amended = resting;
+    amended.quantity = quantity;
+    amended.price = price;
+    amended.timestamp = chrono::system_clock::now(); // new queue priority
+    order_index_.erase(it);
+    remove_node(node);
+    result.requeued = true;
+    result.order = amended;
+    add_order_locked(amended, result.trades);
+    return result;
+}
+
+void OrderBook::add_order_locked(const Order &order, vector<Trade> &trades) {
+    const size_t first_fill = trades.size();
     long long remaining = order.quantity;
     long long original_qty = order.quantity;
-    bool is_buy = (order.side == "buy");
+    bool is_buy = (order.side == Side::Buy);
+
+    // Limit orders must be able to rest on the ladder
+    if (order.order_type == OrderType::Limit && !bids_.accepts(order.price)) {
+        return;
+    }
 
-    // Pre-check for FOK: ensure full fillability without mutating the book
-    if (order.order_type == "fok") {
+    // Pre-check for FOK: ensure full fillability without mutating the book.
+    // Levels keep their open quantity, so this costs one step per level.
+    if (order.order_type == OrderType::Fok) {
         long long fillable = 0;
-        if (is_buy) {
-            for (const auto &level : asks_) {
-                long long price_level = level.first;
-                if (order.price > 0 && price_level > order.price) break; // price constraint
-                for (const auto &o : level.second) {
-                    fillable += o.quantity;
-                    if (fillable >= order.quantity) break;
-                }
-                if (fillable >= order.quantity) break;
+        auto count_fillable = [&](const PriceLevel &level) {
+            if (order.price > 0) { // price constraint
+                if (is_buy && level.price > order.price) return false;
+                if (!is_buy && level.price < order.price) return false;
             }
+            fillable += level.total_quantity;
+            return fillable < order.quantity;
+        };
+        if (is_buy) {
+            asks_.for_each_level(count_fillable);
         } else { // sell
-            for (const auto &level : bids_) {
-                long long price_level = level.first;
-                if (order.price > 0 && price_level < order.price) break; // price constraint
-                for (const auto &o : level.second) {
-                    fillable += o.quantity;
-                    if (fillable >= order.quantity) break;
-                }
-                if (fillable >= order.quantity) break;
-            }
+            bids_.for_each_level(count_fillable);
         }
         if (fillable < order.quantity) {
             // Not fully fillable: cancel without side-effects
-            return trades; // empty
+            return;
         }
     }
 
-    auto match_against_book = [&](auto &book_map) {
-        while (remaining > 0 && !book_map.empty()) {
-            auto it = book_map.begin();
-            long long price_level = it->first;
+    // One clock read per matching pass, shared by all of its fills
+    int64_t fill_ns = 0;
+    auto match_against_book = [&](auto &side) {
+        while (remaining > 0 && !side.empty()) {
+            PriceLevel &q = *side.best();
+            long long price_level = q.price;
 
             // Price constraint for limit orders
-            if (order.order_type == "limit") {
+            if (order.order_type == OrderType::Limit) {
                 if (is_buy && price_level > order.price) break;
                 if (!is_buy && price_level < order.price) break;
             }
 
-            auto &q = it->second;
             while (remaining > 0 && !q.empty()) {
-                Order maker = q.front();
+                OrderNode *node = q.head;
+                Order &maker = node->order;
                 long long trade_qty = min(remaining, maker.quantity);
 
                 Trade tr;
                 tr.trade_id = make_trade_id();
-                tr.symbol = symbol_;
+                tr.symbol_id = symbol_id_;
                 tr.price = price_level;
                 tr.quantity = trade_qty;
                 tr.aggressor_side = order.side;
                 tr.maker_order_id = maker.order_id;
                 tr.taker_order_id = order.order_id;
-                tr.timestamp_iso = now_iso();
+                if (fill_ns == 0) fill_ns = wall_clock_ns();
+                tr.timestamp_ns = fill_ns;
                 calculate_fees(tr);
 
                 trades.push_back(tr);
+                recent_trades_.push(tr);
 
                 remaining -= trade_qty;
-                maker.quantity -= trade_qty;
+                q.reduce(node, trade_qty);
 
-                q.pop_front();
-                if (maker.quantity > 0) {
-                    q.push_front(maker);
-                } else {
+                // Partial fills stay in place at the head of the level
+                if (maker.quantity == 0) {
                     order_index_.erase(maker.order_id);
+                    q.unlink(node);
+                    pool_.release(node);
                 }
             }
 
-            if (q.empty()) {
-                book_map.erase(it);
-            }
+            side.release_if_empty(&q);
         }
     };
 
@@ -127,109 +208,207 @@ vector<Trade> OrderBook::add_order(const Order &order) {
     } else {
         match_against_book(bids_);
     }
+    // Fills always hit the best level, which is inside any cached window
+    if (trades.size() > first_fill) ++top_version_;
 
     // Handle IOC - cancel unfilled portion
-    if (order.order_type == "ioc" && remaining > 0) {
-        return trades;
+    if (order.order_type == OrderType::Ioc && remaining > 0) {
+        return;
     }
 
     // Handle FOK - at this point we've ensured full fillability; if anything left, treat as cancel
-    if (order.order_type == "fok") {
+    if (order.order_type == OrderType::Fok) {
         // If some remaining (shouldn't happen due to pre-check), cancel without resting
         if (remaining > 0) {
-            trades.clear();
+            trades.resize(first_fill);
         }
-        return trades;
+        return;
     }
 
     // Rest limit orders on book
-    if (remaining > 0 && order.order_type == "limit") {
+    if (remaining > 0 && order.order_type == OrderType::Limit) {
         Order resting = order;
         resting.quantity = remaining;
-        if (is_buy) {
-            bids_[order.price].push_back(resting);
-        } else {
-            asks_[order.price].push_back(resting);
-        }
-        order_index_[order.order_id] = {order.price, is_buy};
+        rest_order(resting);
     }
+}
 
-    return trades;
+vector<Trade> OrderBook::recent_trades(size_t limit, uint64_t since_trade_id) const {
+    shared_lock<shared_mutex> lk(mu_);
+    return recent_trades_.recent(limit, since_trade_id);
+}
+
+void OrderBook::record_trade(const Trade &trade) {
+    unique_lock<shared_mutex> lk(mu_);
+    recent_trades_.push(trade);
+}
+
+void OrderBook::rest_order(const Order &order) {
+    OrderNode *node = pool_.acquire(order);
+    bool is_buy = (order.side == Side::Buy);
+    if (is_buy) {
+        bids_.push_back(order.price, node);
+    } else {
+        asks_.push_back(order.price, node);
+    }
+    order_index_[order.order_id] = node;
+    touch_level(is_buy, order.price);
+}
+
+void OrderBook::remove_node(OrderNode *node) {
+    bool is_buy = (node->order.side == Side::Buy);
+    long long price = node->order.price;
+    if (is_buy) {
+        bids_.remove(node);
+    } else {
+        asks_.remove(node);
+    }
+    pool_.release(node);
+    touch_level(is_buy, price);
+}
+
+// A change at or better than the worst cached level invalidates the snapshot
+void OrderBook::touch_level(bool is_buy, long long price) {
+    if (is_buy ? price >= bid_bound_ : price <= ask_bound_) ++top_version_;
 }
 
 void OrderBook::add_order_from_replay(const Order &order) {
     // Only 'limit' orders can be replayed, as others are instant
-    if (order.order_type != "limit") {
+    if (order.order_type != OrderType::Limit || !bids_.accepts(order.price)) {
         return;
     }
 
     std::unique_lock<std::shared_mutex> lk(mu_);
-    
-    // Add to the correct side
-    if (order.side == "buy") {
-        bids_[order.price].push_back(order);
-    } else {
-        asks_[order.price].push_back(order);
+    rest_order(order);
+}
+
+void OrderBook::apply_trade_from_replay(const Trade &trade) {
+    auto lk = lock_for_write(mu_);
+    for (uint64_t id : {trade.maker_order_id, trade.taker_order_id}) {
+        auto it = order_index_.find(id);
+        if (it == order_index_.end()) continue;
+        OrderNode *node = it->second;
+        long long qty = min(trade.quantity, node->order.quantity);
+        node->level->reduce(node, qty);
+        touch_level(node->order.side == Side::Buy, node->order.price);
+        if (node->order.quantity == 0) {
+            order_index_.erase(it);
+            remove_node(node);
+        }
     }
-    // Add to index for cancellation
-    order_index_[order.order_id] = {order.price, (order.side == "buy")};
+    recent_trades_.push(trade);
 }
 
-bool OrderBook::cancel_order(const string &order_id) {
-    unique_lock<shared_mutex> lk(mu_);
+void OrderBook::apply_amend_from_replay(const Order &amended, long long previous_quantity) {
+    auto lk = lock_for_write(mu_);
+    auto it = order_index_.find(amended.order_id);
+    if (it == order_index_.end()) return;
+    OrderNode *node = it->second;
+    Order resting = node->order;
+    long long quantity = resting.quantity + amended.quantity - previous_quantity;
+    if (quantity <= 0 || !bids_.accepts(amended.price)) {
+        order_index_.erase(it);
+        remove_node(node);
+        return;
+    }
+    if (amended.price == resting.price && quantity <= resting.quantity) {
+        node->level->reduce(node, resting.quantity - quantity);
+        touch_level(resting.side == Side::Buy, resting.price);
+        return;
+    }
+    order_index_.erase(it);
+    remove_node(node);
+    resting.quantity = quantity;
+    resting.price = amended.price;
+    resting.timestamp = amended.timestamp;
+    rest_order(resting);
+}
+
+void OrderBook::clear() {
+    auto lk = lock_for_write(mu_);
+    for (auto &entry : order_index_) remove_node(entry.second);
+    order_index_.clear();
+}
+
+bool OrderBook::cancel_order(uint64_t order_id) {
+    auto lk = lock_for_write(mu_);
+    metrics::StageTimer timer(Stage::Match);
+    return cancel_order_locked(order_id);
+}
+
+bool OrderBook::cancel_order_locked(uint64_t order_id) {
     auto it = order_index_.find(order_id);
     if (it == order_index_.end()) return false;
-    
-    long long price = it->second.first;
-    bool is_buy = it->second.second;
 
-    if (is_buy) {
-        auto lvl_it = bids_.find(price);
-        if (lvl_it == bids_.end()) return false;
-        auto &dq = lvl_it->second;
-        for (auto dq_it = dq.begin(); dq_it != dq.end(); ++dq_it) {
-            if (dq_it->order_id == order_id) {
-                dq.erase(dq_it);
-                order_index_.erase(it);
-                if (dq.empty()) bids_.erase(lvl_it);
-                return true;
-            }
-        }
-    } else {
-        auto lvl_it = asks_.find(price);
-        if (lvl_it == asks_.end()) return false;
-        auto &dq = lvl_it->second;
-        for (auto dq_it = dq.begin(); dq_it != dq.end(); ++dq_it) {
-            if (dq_it->order_id == order_id) {
-                dq.erase(dq_it);
-                order_index_.erase(it);
-                if (dq.empty()) asks_.erase(lvl_it);
-                return true;
-            }
-        }
-    }
+    OrderNode *node = it->second;
+    order_index_.erase(it);
+    remove_node(node);
+    return true;
+}
 
-    return false;
+bool OrderBook::accepts_price(long long price) const {
+    return bids_.accepts(price);
 }
 
 vector<pair<long long,long long>> OrderBook::top_bids(size_t n) const{
     shared_lock<shared_mutex> lk(mu_);
-    vector<pair<long long,long long>> out;
-    for (auto it = bids_.begin(); it != bids_.end() && out.size() < n; ++it) {
-        long long total = 0;
-        for (auto &o : it->second) total += o.quantity;
-        out.emplace_back(it->first, total);
-    }
-    return out;
+    return collect_levels(bids_, n);
 }
 
 vector<pair<long long,long long>> OrderBook::top_asks(size_t n) const {
     shared_lock<shared_mutex> lk(mu_);
+    return collect_levels(asks_, n);
+}
+
+template <class Side>
+vector<pair<long long,long long>> OrderBook::collect_levels(const Side &side, size_t n) {
     vector<pair<long long,long long>> out;
-    for (auto it = asks_.begin(); it != asks_.end() && out.size() < n; ++it) {
-        long long total = 0;
-        for (auto &o : it->second) total += o.quantity;
-        out.emplace_back(it->first, total);
-    }
+    if (n == 0) return out;
+    out.reserve(n);
+    side.for_each_level([&](const PriceLevel &level) {
+        out.emplace_back(level.price, level.total_quantity);
+        return out.size() < n;
+    });
     return out;
-}
\ No newline at end of file
+}
+
+shared_ptr<const DepthSnapshot> OrderBook::depth_snapshot(size_t n) const {
+    shared_lock<shared_mutex> lk(mu_);
+    lock_guard<mutex> snap_lk(snapshot_mu_);
+    if (snapshot_ && snapshot_->version == top_version_ && snapshot_depth_ == n) {
+        return snapshot_;
+    }
+
+    auto snap = make_shared<DepthSnapshot>();
+    snap->version = top_version_;
+    snap->bids = collect_levels(bids_, n);
+    snap->asks = collect_levels(asks_, n);
+    // Only a full window has a bound; a short side is affected by any change
+    bid_bound_ = (n > 0 && snap->bids.size() == n) ? snap->bids.back().first : LLONG_MIN;
+    ask_bound_ = (n > 0 && snap->asks.size() == n) ? snap->asks.back().first : LLONG_MAX;
+    snapshot_depth_ = n;
+    snapshot_ = snap;
+    return snapshot_;
+}
+
+bool OrderBook::best_bid(long long &price) const {
+    shared_lock<shared_mutex> lk(mu_);
+    bool found = false;
+    bids_.for_each_level([&](const PriceLevel &level) { price = level.price; found = true; return false; });
+    return found;
+}
+
+bool OrderBook::best_ask(long long &price) const {
+    shared_lock<shared_mutex> lk(mu_);
+    bool found = false;
+    asks_.for_each_level([&](const PriceLevel &level) { price = level.price; found = true; return false; });
+    return found;
+}
+
+bool OrderBook::mark_published(uint64_t version) {
+    uint64_t prev = published_version_.load(memory_order_relaxed);
+    while (version > prev) {
+        if (published_version_.compare_exchange_weak(prev, version, memory_order_relaxed)) return true;
+    }
+    return false;
+}
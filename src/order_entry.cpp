@@ -0,0 +1,290 @@
+// ============================================================================
+// FILE: src/order_entry.cpp
+// ============================================================================
+#include "../include/order_entry.h"
+#include "../include/engine_config.h"
+#include "../include/global_state.h"
+#include "../include/matching_engine.h"
+#include "../include/replication.h"
+#include "../include/wal.h"
+#include <algorithm>
+#include <chrono>
+
+OrderReject validate_order(const OrderFields &f) {
+    if (f.quantity <= 0) return OrderReject::InvalidQuantity;
+    if (f.order_type != OrderType::Market && f.price <= 0) return OrderReject::InvalidPrice;
+    if (f.order_type == OrderType::Limit) {
+        const PriceBand *band = g_engine_config.price_band(f.symbol);
+        if (band && !band->contains(f.price)) return OrderReject::PriceOutsideBand;
+    }
+    return OrderReject::None;
+}
+
+OrderStatus order_status(OrderType type, long long quantity, long long filled) {
+    long long remaining = std::max(0LL, quantity - filled);
+    if (type == OrderType::Fok) return filled == quantity ? OrderStatus::Filled : OrderStatus::Cancelled;
+    if (type == OrderType::Ioc) {
+        if (filled == 0 && remaining > 0) return OrderStatus::Cancelled;
+        return remaining == 0 ? OrderStatus::Filled : OrderStatus::PartiallyFilled;
+    }
+    if (type == OrderType::Market) {
+        if (filled == 0) return OrderStatus::Cancelled;
+        return remaining > 0 ? OrderStatus::PartiallyFilled : OrderStatus::Filled;
+    }
+    if (remaining == 0) return OrderStatus::Filled;
+    return filled > 0 ? OrderStatus::PartiallyFilled : OrderStatus::Open;
+}
+
+uint64_t next_order_id(uint32_t symbol_id) {
+    return make_order_id(symbol_id, g_total_orders.fetch_add(1) + 1);
+}
+
+Order make_order(const OrderFields &f, uint32_t symbol_id) {
+    Order o = unnumbered_order(f, symbol_id);
+    o.order_id = next_order_id(symbol_id);
+    return o;
+}
+
+Order unnumbered_order(const OrderFields &f, uint32_t symbol_id) {
+    Order o;
+    o.symbol_id = symbol_id;
+    o.order_type = f.order_type;
+    o.side = f.side;
+    o.quantity = f.quantity;
+    o.price = f.price;
+    o.timestamp = std::chrono::system_clock::now();
+    return o;
+}
+
+long long OrderEntryResult::filled_quantity() const {
+    long long filled = 0;
+    for (const auto &t : trades) filled += t.quantity;
+    return filled;
+}
+
+void publish_market_data(SymbolEntry &entry, const std::vector<Trade> &trades,
+                         const std::vector<TriggeredStop> &triggered) {
+    if (!g_ws_server || !g_ws_server->is_running()) return;
+    for (const auto &t : trades) {
+        g_broadcast_queue.push_trade(t);
+    }
+    for (const auto &stop : triggered) {
+        for (const auto &t : stop.trades) g_broadcast_queue.push_trade(t);
+    }
+    // Cached snapshot: only rebuilt/pushed if the top 10 levels changed
+    auto snapshot = entry.book.depth_snapshot(10);
+    if (entry.book.mark_published(snapshot->version)) {
+        g_broadcast_queue.push_book_update(entry.id, snapshot);
+    }
+}
+
+// WAL records for fired[first..], in firing order: the stop is cancelled as
+// "triggered", then its order and trades are logged as if just submitted
+static void append_triggered_records(const std::vector<TriggeredStop> &fired, size_t first,
+                                     std::vector<WalRecord> &out) {
+    for (size_t i = first; i < fired.size(); ++i) {
+        const TriggeredStop &stop = fired[i];
+        WalRecord cancel;
+        cancel.type = WalRecordType::Cancel;
+        cancel.order_id = stop.order.order_id;
+        cancel.text = "triggered";
+        out.push_back(std::move(cancel));
+        WalRecord rec;
+        rec.type = WalRecordType::Order;
+        rec.order = stop.order;
+        out.push_back(std::move(rec));
+        for (const auto &t : stop.trades) {
+            WalRecord trade;
+            trade.type = WalRecordType::Trade;
+            trade.trade = t;
+            out.push_back(std::move(trade));
+        }
+    }
+}
+
+void log_stop_trigger(TriggeredStop &stop) {
+    std::vector<WalRecord> records(2);
+    records[0].type = WalRecordType::Cancel;
+    records[0].order_id = stop.order.order_id;
+    records[0].text = "triggered";
+    records[1].type = WalRecordType::Order;
+    records[1].order = stop.order;
+    stop.wal_seq = global_wal.append_batch(records);
+}
+
+// The trades of stops whose Cancel/Order log_stop_trigger already logged, in
+// one append; counts them
+static void log_triggered(const std::vector<TriggeredStop> &fired, uint64_t &wal_seq) {
+    if (fired.empty()) return;
+    std::vector<WalRecord> records;
+    for (const auto &stop : fired) {
+        wal_seq = std::max(wal_seq, stop.wal_seq);
+        for (const auto &t : stop.trades) {
+            WalRecord trade;
+            trade.type = WalRecordType::Trade;
+            trade.trade = t;
+            records.push_back(std::move(trade));
+        }
+    }
+    g_total_trades.fetch_add(records.size());
+    if (records.empty()) return;
+    if (uint64_t seq = global_wal.append_batch(records)) wal_seq = seq;
+}
+
+// Same records, in the same order, as the single-order endpoints
+static void append_op_records(const BookOp &op, std::vector<WalRecord> &out) {
+    if (op.type != BookOp::Type::New) {
+        if (!op.cancelled) return;
+        WalRecord rec;
+        rec.type = WalRecordType::Cancel;
+        rec.order_id = op.order_id;
+        rec.text = op.type == BookOp::Type::Cancel ? "user_request" : "replaced";
+        out.push_back(std::move(rec));
+        if (op.type == BookOp::Type::Cancel) return;
+    }
+    WalRecord rec;
+    rec.type = WalRecordType::Order;
+    rec.order = op.order;
+    out.push_back(std::move(rec));
+    for (const Trade &t : op.trades) {
+        WalRecord trade;
+        trade.type = WalRecordType::Trade;
+        trade.trade = t;
+        out.push_back(std::move(trade));
+    }
+}
+
+uint64_t apply_batch_group(SymbolEntry &entry, std::vector<BookOp> &ops, std::vector<TriggeredStop> &fired) {
+    std::vector<WalRecord> records;
+    size_t trades = 0;
+    uint64_t wal_seq = 0;
+    BatchHooks hooks;
+    hooks.replacing = [](BookOp &op) { op.order.order_id = next_order_id(op.order.symbol_id); };
+    hooks.after_op = [&](BookOp &op) {
+        if (op.type == BookOp::Type::Cancel && !op.cancelled) {
+            op.cancelled = entry.stops.cancel_stop_order(op.order_id);
+        }
+        size_t first = fired.size();
+        entry.stops.process_trades(entry.book, op.trades, fired, nullptr, true);
+        append_op_records(op, records);
+        trades += op.trades.size();
+        append_triggered_records(fired, first, records);
+        for (size_t i = first; i < fired.size(); ++i) trades += fired[i].trades.size();
+    };
+    hooks.done = [&] {
+        if (!records.empty()) wal_seq = global_wal.append_batch(records);
+    };
+    entry.book.apply_batch(ops, hooks);
+    g_total_trades.fetch_add(trades);
+    return wal_seq;
+}
+
+OrderEntryResult submit_order(SymbolEntry &entry, const Order &order) {
+    OrderEntryResult result;
+    submit_order(entry, order, result);
+    return result;
+}
+
+void submit_order(SymbolEntry &entry, const Order &order, OrderEntryResult &result) {
+    result.order = order;
+    result.trades.clear();
+    result.triggered.clear();
+    result.wal_seq = global_wal.append_order(order); // Async push, encoded by the writer
+
+    // Inline under the book lock, or on the symbol's shard
+    if (g_matching_engine) {
+        EngineRequest req;
+        req.type = EngineRequest::Type::NewOrder;
+        req.symbol_id = entry.id;
+        req.order = order;
+        req.trades.swap(result.trades); // the shard fills the caller's buffer
+        g_matching_engine->execute(req);
+        result.trades.swap(req.trades);
+        result.triggered = std::move(req.fired);
+    } else {
+        entry.book.add_order(order, result.trades);
+        entry.stops.process_trades(entry.book, result.trades, result.triggered, log_stop_trigger);
+    }
+    g_total_trades.fetch_add(result.trades.size());
+
+    for (const auto &t : result.trades) {
+        result.wal_seq = global_wal.append_trade(t); // Async push
+    }
+    log_triggered(result.triggered, result.wal_seq);
+    publish_market_data(entry, result.trades, result.triggered);
+}
+
+bool wait_committed(uint64_t wal_seq) {
+    if (wal_seq == 0) return true;
+    if (g_engine_config.wal.ack_durable && !global_wal.wait_durable(wal_seq)) return false;
+    return !g_replication_primary || g_replication_primary->wait_replicated(wal_seq);
+}
+
+bool commit_waits() {
+    return g_engine_config.wal.ack_durable || (g_replication_primary && g_replication_primary->waits_for_quorum());
+}
+
+SymbolEntry *order_symbol(uint64_t order_id) {
+    if (!g_legacy_order_symbols.empty()) {
+        auto it = g_legacy_order_symbols.find(order_id);
+        if (it != g_legacy_order_symbols.end()) return g_symbol_registry.at(it->second);
+    }
+    uint32_t symbol_id;
+    return order_id_symbol(order_id, symbol_id) ? g_symbol_registry.at(symbol_id) : nullptr;
+}
+
+bool submit_cancel(uint64_t order_id, SymbolEntry *&entry, uint64_t &wal_seq) {
+    entry = order_symbol(order_id);
+    if (!entry) return false;
+
+    bool cancelled = false;
+    if (g_matching_engine) {
+        EngineRequest req;
+        req.type = EngineRequest::Type::Cancel;
+        req.symbol_id = entry->id;
+        req.order_id = order_id;
+        g_matching_engine->execute(req);
+        cancelled = req.cancelled;
+    } else {
+        cancelled = entry->book.cancel_order(order_id) || entry->stops.cancel_stop_order(order_id);
+    }
+    if (!cancelled) return false;
+
+    wal_seq = global_wal.append_cancel(order_id, "user_request");
+    publish_market_data(*entry, {});
+    return true;
+}
+
+OrderReject submit_amend(uint64_t order_id, long long quantity, long long price, SymbolEntry *&entry,
+                         AmendResult &result, uint64_t &wal_seq) {
+    if (quantity < 0) return OrderReject::InvalidQuantity;
+    if (price < 0) return OrderReject::InvalidPrice;
+    entry = order_symbol(order_id);
+    if (!entry) return OrderReject::UnknownOrder;
+    const PriceBand *band = g_engine_config.price_band(entry->symbol);
+    if (price > 0 && band && !band->contains(price)) return OrderReject::PriceOutsideBand;
+
+    if (g_matching_engine) {
+        EngineRequest req;
+        req.type = EngineRequest::Type::Amend;
+        req.symbol_id = entry->id;
+        req.order_id = order_id;
+        req.order.quantity = quantity;
+        req.order.price = price;
+        g_matching_engine->execute(req);
+        result = std::move(req.amend);
+    } else {
+        result = entry->book.amend_order(order_id, quantity, price);
+        entry->stops.process_trades(entry->book, result.trades, result.triggered, log_stop_trigger);
+    }
+    if (!result.amended) return OrderReject::UnknownOrder;
+
+    wal_seq = global_wal.append_amend(result.order, result.previous_quantity);
+    g_total_trades.fetch_add(result.trades.size());
+    for (const auto &t : result.trades) {
+        wal_seq = global_wal.append_trade(t);
+    }
+    log_triggered(result.triggered, wal_seq);
+    publish_market_data(*entry, result.trades, result.triggered);
+    return OrderReject::None;
+}
@@ -0,0 +1,557 @@
+// ============================================================================
+// FILE: src/order_gateway.cpp
+// ============================================================================
+#include "../include/order_gateway.h"
+#include "../include/byte_codec.h"
+#include "../include/global_state.h"
+#include "../include/order_entry.h"
+#include "../include/wal.h"
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+OrderGateway *g_order_gateway = nullptr;
+
+#ifdef __linux__
+
+using namespace gateway_proto;
+
+namespace {
+
+constexpr size_t MAX_INBOUND_BYTES = 1 << 16;
+constexpr size_t MAX_OUTBOUND_BYTES = 4u << 20; // a session this far behind is dropped
+
+// Replies waiting for their WAL seq to be committed (wal.ack_durable or a
+// quorum primary). A session's own ack and fills become a NotCommitted reject
+// if the commit fails; maker fills and anything queued behind go out anyway.
+struct HeldReply {
+    uint64_t wal_seq = 0;
+    uint64_t client_order_id = 0;
+    bool own = false;
+    std::string bytes;
+};
+
+struct Session {
+    int fd = -1;
+    uint64_t id = 0;
+    std::string in;
+    std::string out;
+    std::deque<HeldReply> held;
+    bool want_write = false; // EPOLLOUT armed
+};
+
+// A resting order entered on a gateway session, for routing maker fills
+struct OrderOwner {
+    uint64_t session = 0;
+    uint64_t client_order_id = 0;
+    Side side = Side::Buy;
+    long long leaves = 0;
+};
+
+void put_header(std::string &out, size_t size, MsgType type) {
+    put_u16(out, static_cast<uint16_t>(size));
+    put_u8(out, type);
+}
+
+void put_ack(std::string &out, uint64_t client_order_id, uint64_t order_id, OrderStatus status,
+             long long filled, long long leaves) {
+    put_header(out, ACK_SIZE, Ack);
+    put_u64(out, client_order_id);
+    put_u64(out, order_id);
+    put_u8(out, static_cast<uint8_t>(status));
+    put_i64(out, filled);
+    put_i64(out, leaves);
+    put_i64(out, to_ns(std::chrono::system_clock::now()));
+}
+
+void put_fill(std::string &out, uint64_t client_order_id, uint64_t order_id, const Trade &t, Side side, bool taker) {
+    put_header(out, FILL_SIZE, Fill);
+    put_u64(out, client_order_id);
+    put_u64(out, order_id);
+    put_u64(out, t.trade_id);
+    put_i64(out, t.price);
+    put_i64(out, t.quantity);
+    put_u8(out, side == Side::Buy ? 0 : 1);
+    put_u8(out, taker ? 1 : 0);
+    put_i64(out, taker ? t.taker_fee : t.maker_fee);
+}
+
+void put_reject(std::string &out, uint64_t client_order_id, OrderReject reason) {
+    put_header(out, REJECT_SIZE, Reject);
+    put_u64(out, client_order_id);
+    put_u8(out, static_cast<uint8_t>(reason));
+}
+
+// symbol[16], u8 side, u8 order_type, i64 price, i64 quantity
+OrderReject read_order_fields(ByteReader &r, OrderFields &f) {
+    std::string symbol(reinterpret_cast<const char *>(r.p), SYMBOL_LEN);
+    r.p += SYMBOL_LEN;
+    f.symbol = symbol.substr(0, symbol.find('\0'));
+    uint8_t side = r.u8(), type = r.u8();
+    f.price = r.i64();
+    f.quantity = r.i64();
+    if (f.symbol.empty()) return OrderReject::InvalidSymbol;
+    if (side > 1) return OrderReject::InvalidSide;
+    if (type > static_cast<uint8_t>(OrderType::Fok)) return OrderReject::InvalidOrderType;
+    f.side = side == 0 ? Side::Buy : Side::Sell;
+    f.order_type = static_cast<OrderType>(type);
+    if (f.order_type == OrderType::Market) f.price = 0;
+    return validate_order(f);
+}
+
+} // namespace
+
+struct OrderGateway::Impl {
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions; // by fd
+    std::unordered_map<uint64_t, Session *> by_id;
+    std::unordered_map<uint64_t, OrderOwner> owners;            // by order id
+    std::vector<Session *> dirty;                               // output queued this round
+    OrderEntryResult entry_scratch;                             // reused by every new order
+    uint64_t next_session = 1;
+
+    // The committer thread waits on commits so the event loop never blocks
+    std::thread committer;
+    std::mutex commit_mu;
+    std::condition_variable commit_cv;
+    uint64_t commit_want = 0;                                   // highest seq a held reply needs
+    std::vector<std::pair<uint64_t, bool>> commit_results;      // (seq, committed), in seq order
+    bool commit_stop = false;
+
+    void commit_loop() {
+        uint64_t done = 0;
+        std::unique_lock<std::mutex> lk(commit_mu);
+        for (;;) {
+            commit_cv.wait(lk, [&]{ return commit_stop || commit_want > done; });
+            if (commit_stop) return;
+            uint64_t target = commit_want;
+            lk.unlock();
+            bool ok = wait_committed(target);
+            lk.lock();
+            commit_results.emplace_back(target, ok);
+            done = target;
+            uint64_t one = 1;
+            ssize_t ignored = write(wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+
+    // Where a reply for wal_seq goes: straight out when nothing needs to wait,
+    // otherwise held (and kept behind anything the session already holds)
+    std::string &reply_out(Session &s, uint64_t wal_seq, uint64_t client_order_id, bool own) {
+        bool wait = wal_seq != 0 && commit_waits();
+        if (!wait) {
+            if (s.held.empty()) return s.out;
+            wal_seq = s.held.back().wal_seq;
+            own = false;
+        }
+        if (s.held.empty() || s.held.back().wal_seq != wal_seq || s.held.back().own || own) {
+            s.held.push_back(HeldReply{wal_seq, client_order_id, own, {}});
+        }
+        if (wait) {
+            std::lock_guard<std::mutex> lk(commit_mu);
+            if (wal_seq > commit_want) {
+                commit_want = wal_seq;
+                commit_cv.notify_one();
+            }
+        }
+        return s.held.back().bytes;
+    }
+
+    // Sends the held replies the committer has resolved
+    void release_committed() {
+        std::vector<std::pair<uint64_t, bool>> results;
+        {
+            std::lock_guard<std::mutex> lk(commit_mu);
+            if (commit_results.empty()) return;
+            results.swap(commit_results);
+        }
+        for (auto &entry : sessions) {
+            Session &s = *entry.second;
+            if (s.held.empty()) continue;
+            for (const auto &result : results) {
+                while (!s.held.empty() && s.held.front().wal_seq <= result.first) {
+                    HeldReply &h = s.held.front();
+                    if (result.second || !h.own) {
+                        s.out += h.bytes;
+                    } else {
+                        put_reject(s.out, h.client_order_id, OrderReject::NotCommitted);
+                    }
+                    s.held.pop_front();
+                }
+            }
+            queue(s);
+        }
+    }
+
+    void queue(Session &s) {
+        if (s.out.empty()) return;
+        for (Session *d : dirty) {
+            if (d == &s) return;
+        }
+        dirty.push_back(&s);
+    }
+
+    // false if the session must be closed
+    bool flush(Session &s) {
+        while (!s.out.empty()) {
+            ssize_t n = ::send(s.fd, s.out.data(), s.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n > 0) {
+                s.out.erase(0, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            return false;
+        }
+        if (s.out.size() > MAX_OUTBOUND_BYTES) return false;
+        bool want = !s.out.empty();
+        if (want != s.want_write) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | (want ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            ev.data.fd = s.fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, s.fd, &ev);
+            s.want_write = want;
+        }
+        return true;
+    }
+
+    void close_session(Session *s) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s->fd, nullptr);
+        ::close(s->fd);
+        for (auto it = dirty.begin(); it != dirty.end(); ++it) {
+            if (*it == s) {
+                dirty.erase(it);
+                break;
+            }
+        }
+        by_id.erase(s->id);
+        sessions.erase(s->fd); // frees s
+    }
+
+    void accept_sessions() {
+        for (;;) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto s = std::make_unique<Session>();
+            s->fd = fd;
+            s->id = next_session++;
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            by_id[s->id] = s.get();
+            sessions[fd] = std::move(s);
+        }
+    }
+
+    void report_maker(const Trade &t, uint64_t wal_seq) {
+        auto it = owners.find(t.maker_order_id);
+        if (it == owners.end()) return;
+        OrderOwner &owner = it->second;
+        auto sit = by_id.find(owner.session);
+        if (sit != by_id.end()) {
+            std::string &out = reply_out(*sit->second, wal_seq, owner.client_order_id, false);
+            put_fill(out, owner.client_order_id, t.maker_order_id, t, owner.side, false);
+            queue(*sit->second);
+        }
+        owner.leaves -= t.quantity;
+        if (owner.leaves <= 0 || sit == by_id.end()) owners.erase(it);
+    }
+
+    // Acks the taker, reports its fills and tells gateway-owned makers
+    void report(Session &s, uint64_t client_order_id, const OrderEntryResult &r, uint64_t wal_seq) {
+        const Order &o = r.order;
+        long long filled = r.filled_quantity();
+        OrderStatus status = order_status(o.order_type, o.quantity, filled);
+        bool rests = status == OrderStatus::Open || status == OrderStatus::PartiallyFilled;
+        if (o.order_type != OrderType::Limit) rests = false;
+        long long leaves = rests ? o.quantity - filled : 0;
+        std::string &out = reply_out(s, wal_seq, client_order_id, true);
+        put_ack(out, client_order_id, o.order_id, status, filled, leaves);
+
+        for (const Trade &t : r.trades) {
+            put_fill(out, client_order_id, o.order_id, t, o.side, true);
+            report_maker(t, wal_seq);
+        }
+        // Stops the order set off trade against resting orders too
+        for (const TriggeredStop &stop : r.triggered) {
+            for (const Trade &t : stop.trades) report_maker(t, wal_seq);
+        }
+        if (rests) {
+            owners[o.order_id] = OrderOwner{s.id, client_order_id, o.side, leaves};
+        } else {
+            owners.erase(o.order_id); // an amend that filled
+        }
+    }
+
+    void on_new_order(Session &s, ByteReader &r) {
+        uint64_t client_order_id = r.u64();
+        OrderFields f;
+        OrderReject reject = read_order_fields(r, f);
+        if (reject != OrderReject::None) {
+            put_reject(reply_out(s, 0, client_order_id, false), client_order_id, reject);
+            return;
+        }
+        SymbolEntry &entry = g_symbol_registry.get_or_create(f.symbol);
+        OrderEntryResult &result = entry_scratch;
+        submit_order(entry, make_order(f, entry.id), result);
+        report(s, client_order_id, result, result.wal_seq);
+    }
+
+    void on_cancel(Session &s, ByteReader &r) {
+        uint64_t client_order_id = r.u64();
+        uint64_t order_id = r.u64();
+        SymbolEntry *entry = nullptr;
+        uint64_t wal_seq = 0;
+        if (!submit_cancel(order_id, entry, wal_seq)) {
+            put_reject(reply_out(s, 0, client_order_id, false), client_order_id, OrderReject::UnknownOrder);
+            return;
+        }
+        owners.erase(order_id);
+        put_ack(reply_out(s, wal_seq, client_order_id, true), client_order_id, order_id, OrderStatus::Cancelled, 0, 0);
+    }
+
+    // Cancel, then the replacement as a new order (it queues at the back)
+    void on_replace(Session &s, ByteReader &r) {
+        uint64_t client_order_id = r.u64();
+        uint64_t order_id = r.u64();
+        OrderFields f;
+        OrderReject reject = read_order_fields(r, f);
+        SymbolEntry *entry = order_symbol(order_id);
+        if (reject == OrderReject::None && !entry) reject = OrderReject::UnknownOrder;
+        if (reject == OrderReject::None && entry->symbol != f.symbol) reject = OrderReject::SymbolMismatch;
+        uint64_t wal_seq = 0;
+        if (reject == OrderReject::None && !submit_cancel(order_id, entry, wal_seq)) {
+            reject = OrderReject::UnknownOrder;
+        }
+        if (reject != OrderReject::None) {
+            put_reject(reply_out(s, 0, client_order_id, false), client_order_id, reject);
+            return;
+        }
+        owners.erase(order_id);
+        OrderEntryResult &result = entry_scratch;
+        submit_order(*entry, make_order(f, entry->id), result);
+        report(s, client_order_id, result, result.wal_seq);
+    }
+
+    void on_amend(Session &s, ByteReader &r) {
+        uint64_t client_order_id = r.u64();
+        uint64_t order_id = r.u64();
+        long long price = r.i64();
+        long long quantity = r.i64();
+        SymbolEntry *entry = nullptr;
+        AmendResult amended;
+        uint64_t wal_seq = 0;
+        OrderReject reject = submit_amend(order_id, quantity, price, entry, amended, wal_seq);
+        if (reject != OrderReject::None) {
+            put_reject(reply_out(s, 0, client_order_id, false), client_order_id, reject);
+            return;
+        }
+        OrderEntryResult result;
+        result.order = amended.order;
+        result.trades = std::move(amended.trades);
+        result.triggered = std::move(amended.triggered);
+        report(s, client_order_id, result, wal_seq);
+    }
+
+    // false if the session must be closed
+    bool on_readable(Session &s) {
+        char buf[16384];
+        for (;;) {
+            ssize_t n = ::recv(s.fd, buf, sizeof(buf), 0);
+            if (n > 0) {
+                s.in.append(buf, static_cast<size_t>(n));
+                if (s.in.size() > MAX_INBOUND_BYTES) return false;
+                continue;
+            }
+            if (n == 0) return false;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+
+        size_t pos = 0;
+        while (s.in.size() - pos >= HEADER_SIZE) {
+            ByteReader r{reinterpret_cast<const unsigned char *>(s.in.data()) + pos,
+                         reinterpret_cast<const unsigned char *>(s.in.data()) + s.in.size()};
+            size_t size = r.u16();
+            uint8_t type = r.u8();
+            size_t expected = type == NewOrder ? NEW_ORDER_SIZE
+                            : type == Cancel   ? CANCEL_SIZE
+                            : type == Replace  ? REPLACE_SIZE
+                            : type == Amend    ? AMEND_SIZE : 0;
+            if (expected == 0 || size != expected) return false;
+            if (s.in.size() - pos < size) break; // wait for the rest
+            r.end = r.p + (size - HEADER_SIZE);
+            switch (type) {
+            case NewOrder: on_new_order(s, r); break;
+            case Cancel: on_cancel(s, r); break;
+            case Replace: on_replace(s, r); break;
+            case Amend: on_amend(s, r); break;
+            }
+            pos += size;
+        }
+        s.in.erase(0, pos);
+        queue(s);
+        return true;
+    }
+
+    void flush_dirty() {
+        std::vector<Session *> failed;
+        for (Session *s : dirty) {
+            if (!flush(*s)) failed.push_back(s);
+        }
+        dirty.clear();
+        for (Session *s : failed) close_session(s);
+    }
+};
+
+OrderGateway::OrderGateway(const GatewayConfig &config) : config_(config), impl_(new Impl) {}
+
+OrderGateway::~OrderGateway() {
+    stop();
+    delete impl_;
+}
+
+bool OrderGateway::start() {
+    if (running_.load()) return true;
+    Impl &g = *impl_;
+    g.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (g.listen_fd < 0) {
+        std::cerr << "[Gateway] Socket creation failed\n";
+        return false;
+    }
+    int one = 1;
+    setsockopt(g.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (bind(g.listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(g.listen_fd, 128) != 0) {
+        std::cerr << "[Gateway] Bind/listen failed on port " << config_.port << "\n";
+        ::close(g.listen_fd);
+        g.listen_fd = -1;
+        return false;
+    }
+    g.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    g.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = g.listen_fd;
+    epoll_ctl(g.epoll_fd, EPOLL_CTL_ADD, g.listen_fd, &ev);
+    ev.data.fd = g.wake_fd;
+    epoll_ctl(g.epoll_fd, EPOLL_CTL_ADD, g.wake_fd, &ev);
+
+    running_ = true;
+    g.commit_stop = false;
+    g.committer = std::thread(&Impl::commit_loop, &g);
+    thread_ = std::thread(&OrderGateway::loop, this);
+    std::cout << "[Gateway] Binary order entry on port " << config_.port
+              << (config_.threads.busy_poll ? " (busy polling)" : "") << "\n";
+    return true;
+}
+
+void OrderGateway::stop() {
+    if (!running_.exchange(false)) return;
+    uint64_t one = 1;
+    ssize_t ignored = write(impl_->wake_fd, &one, sizeof(one));
+    (void)ignored;
+    if (thread_.joinable()) thread_.join();
+
+    Impl &g = *impl_;
+    {
+        std::lock_guard<std::mutex> lk(g.commit_mu);
+        g.commit_stop = true;
+    }
+    g.commit_cv.notify_one();
+    if (g.committer.joinable()) g.committer.join();
+    g.commit_want = 0;
+    g.commit_results.clear();
+    while (!g.sessions.empty()) g.close_session(g.sessions.begin()->second.get());
+    g.owners.clear();
+    ::close(g.listen_fd);
+    ::close(g.epoll_fd);
+    ::close(g.wake_fd);
+    g.listen_fd = g.epoll_fd = g.wake_fd = -1;
+    sessions_ = 0;
+}
+
+void OrderGateway::loop() {
+    place_current_thread(config_.threads, 0, "gateway");
+    Impl &g = *impl_;
+    epoll_event events[64];
+    const int timeout_ms = config_.threads.busy_poll ? 0 : 100;
+    while (running_.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(g.epoll_fd, events, 64, timeout_ms);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == g.listen_fd) {
+                g.accept_sessions();
+                continue;
+            }
+            if (fd == g.wake_fd) {
+                uint64_t count;
+                ssize_t ignored = read(g.wake_fd, &count, sizeof(count));
+                (void)ignored;
+                continue;
+            }
+            auto it = g.sessions.find(fd);
+            if (it == g.sessions.end()) continue;
+            Session *s = it->second.get();
+            bool ok = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (ok && (events[i].events & EPOLLIN)) ok = g.on_readable(*s);
+            if (ok && (events[i].events & EPOLLOUT)) g.queue(*s);
+            if (!ok) g.close_session(s);
+        }
+        g.release_committed();
+        // One send per session per round: acks, fills and other sessions' maker fills
+        g.flush_dirty();
+        sessions_.store(g.sessions.size(), std::memory_order_relaxed);
+    }
+}
+
+#else // other platforms: not available
+
+struct OrderGateway::Impl {};
+
+OrderGateway::OrderGateway(const GatewayConfig &config) : config_(config), impl_(new Impl) {}
+
+OrderGateway::~OrderGateway() {
+    delete impl_;
+}
+
+bool OrderGateway::start() {
+    std::cerr << "[Gateway] Binary order entry needs Linux (epoll)\n";
+    return false;
+}
+
+void OrderGateway::stop() {}
+
+void OrderGateway::loop() {}
+
+#endif
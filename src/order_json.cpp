@@ -0,0 +1,193 @@
+// ============================================================================
+// FILE: src/order_json.cpp
+// ============================================================================
+#include "../include/order_json.h"
+#include "../include/byte_codec.h"
+#include "../include/global_state.h"
+#include "../include/iso_time.h"
+#include <charconv>
+#include <stdexcept>
+
+std::string to_iso8601(const std::chrono::system_clock::time_point &tp) {
+    return iso8601(to_ns(tp));
+}
+
+static std::chrono::system_clock::time_point from_iso8601(const std::string &ts_str) {
+    int64_t ns = 0;
+    return parse_iso8601(ts_str, ns) ? from_ns(ns) : std::chrono::system_clock::time_point();
+}
+
+static const std::string &symbol_name(uint32_t symbol_id) {
+    static const std::string unknown;
+    SymbolEntry *entry = g_symbol_registry.at(symbol_id);
+    return entry ? entry->symbol : unknown;
+}
+
+static uint64_t id_from_json(const json &j, const char *field) {
+    uint64_t id = 0;
+    const json &v = j.at(field);
+    if (v.is_number_unsigned()) return v.get<uint64_t>();
+    const std::string &str = v.get_ref<const std::string &>();
+    bool ok = str.compare(0, 2, "T-") == 0 ? parse_trade_id(str, id) : parse_order_id(str, id);
+    if (!ok) {
+        throw std::runtime_error(std::string("invalid ") + field + ": " + v.get<std::string>());
+    }
+    return id;
+}
+
+const char *to_string(StopOrderType type) {
+    switch (type) {
+    case StopOrderType::STOP_LOSS: return "stop_loss";
+    case StopOrderType::STOP_LIMIT: return "stop_limit";
+    case StopOrderType::TAKE_PROFIT: return "take_profit";
+    case StopOrderType::TRAILING_STOP: return "trailing_stop";
+    }
+    return "stop_loss";
+}
+
+bool parse_stop_type(const std::string &s, StopOrderType &out) {
+    if (s == "stop_loss") { out = StopOrderType::STOP_LOSS; return true; }
+    if (s == "stop_limit") { out = StopOrderType::STOP_LIMIT; return true; }
+    if (s == "take_profit") { out = StopOrderType::TAKE_PROFIT; return true; }
+    if (s == "trailing_stop") { out = StopOrderType::TRAILING_STOP; return true; }
+    return false;
+}
+
+json order_to_json(const Order &o) {
+    return {
+        {"order_id", format_order_id(o.order_id)}, {"symbol", symbol_name(o.symbol_id)},
+        {"order_type", to_string(o.order_type)}, {"side", to_string(o.side)},
+        {"quantity", o.quantity}, {"price", o.price},
+        {"timestamp", to_iso8601(o.timestamp)}
+    };
+}
+
+Order order_from_json(const json &j) {
+    std::string symbol;
+    Order o = order_from_json(j, symbol);
+    o.symbol_id = g_symbol_registry.get_or_create(symbol).id;
+    return o;
+}
+
+Order order_from_json(const json &j, std::string &symbol) {
+    Order o;
+    o.order_id = id_from_json(j, "order_id");
+    o.symbol_id = 0;
+    symbol = j.at("symbol").get<std::string>();
+    if (!parse_order_type(j.at("order_type").get<std::string>(), o.order_type)) {
+        throw std::runtime_error("invalid order_type: " + j.at("order_type").get<std::string>());
+    }
+    if (!parse_side(j.at("side").get<std::string>(), o.side)) {
+        throw std::runtime_error("invalid side: " + j.at("side").get<std::string>());
+    }
+    o.quantity = j.at("quantity").get<long long>();
+    o.price = j.at("price").get<long long>();
+    o.timestamp = from_iso8601(j.at("timestamp").get<std::string>());
+    return o;
+}
+
+json trade_to_json(const Trade &t) {
+    return {
+        {"trade_id", format_trade_id(t.trade_id)}, {"symbol", symbol_name(t.symbol_id)},
+        {"price", t.price}, {"quantity", t.quantity},
+        {"aggressor_side", to_string(t.aggressor_side)},
+        {"maker_order_id", format_order_id(t.maker_order_id)},
+        {"taker_order_id", format_order_id(t.taker_order_id)},
+        {"maker_fee", t.maker_fee}, {"taker_fee", t.taker_fee},
+        {"timestamp", iso8601(t.timestamp_ns)}
+    };
+}
+
+// "ORD-42" etc. without building a temporary string
+static void write_id(JsonWriter &w, std::string_view key, std::string_view prefix, uint64_t id) {
+    char buf[32];
+    prefix.copy(buf, prefix.size());
+    auto res = std::to_chars(buf + prefix.size(), buf + sizeof(buf), id);
+    w.field(key, std::string_view(buf, static_cast<size_t>(res.ptr - buf)));
+}
+
+// Same members and key order as trade_to_json(t).dump()
+void write_trade_json(JsonWriter &w, const Trade &t) {
+    w.begin_object();
+    w.field("aggressor_side", to_string(t.aggressor_side));
+    w.field("maker_fee", t.maker_fee);
+    write_id(w, "maker_order_id", "ORD-", t.maker_order_id);
+    w.field("price", t.price);
+    w.field("quantity", t.quantity);
+    w.field("symbol", symbol_name(t.symbol_id));
+    w.field("taker_fee", t.taker_fee);
+    write_id(w, "taker_order_id", "ORD-", t.taker_order_id);
+    char ts[ISO8601_LEN];
+    w.field("timestamp", std::string_view(ts, format_iso8601(t.timestamp_ns, ts)));
+    write_id(w, "trade_id", "T-", t.trade_id);
+    w.end_object();
+}
+
+void write_order_json(JsonWriter &w, const Order &o, const char *status) {
+    char ts[ISO8601_LEN];
+    w.begin_object();
+    write_id(w, "order_id", "ORD-", o.order_id);
+    w.field("order_type", to_string(o.order_type));
+    w.field("price", o.price);
+    w.field("quantity", o.quantity);
+    w.field("side", to_string(o.side));
+    w.field("status", status);
+    w.field("symbol", symbol_name(o.symbol_id));
+    w.field("timestamp", std::string_view(ts, format_iso8601(to_ns(o.timestamp), ts)));
+    w.end_object();
+}
+
+Trade trade_from_json(const json &j, std::string &symbol) {
+    Trade t{};
+    t.trade_id = id_from_json(j, "trade_id");
+    t.maker_order_id = id_from_json(j, "maker_order_id");
+    t.taker_order_id = id_from_json(j, "taker_order_id");
+    symbol = j.at("symbol").get<std::string>();
+    if (!parse_side(j.at("aggressor_side").get<std::string>(), t.aggressor_side)) {
+        throw std::runtime_error("invalid aggressor_side: " + j.at("aggressor_side").get<std::string>());
+    }
+    t.price = j.at("price").get<long long>();
+    t.quantity = j.at("quantity").get<long long>();
+    t.maker_fee = j.value("maker_fee", 0LL);
+    t.taker_fee = j.value("taker_fee", 0LL);
+    if (!parse_iso8601(j.value("timestamp", std::string()), t.timestamp_ns)) t.timestamp_ns = 0;
+    return t;
+}
+
+json stop_order_to_json(const StopOrder &so) {
+    return {
+        {"order_id", format_stop_order_id(so.order_id)}, {"symbol", symbol_name(so.symbol_id)},
+        {"order_type", "stop"}, {"stop_type", to_string(so.stop_type)},
+        {"side", to_string(so.side)}, {"quantity", so.quantity},
+        {"trigger_price", so.trigger_price}, {"limit_price", so.limit_price},
+        {"trail_amount", so.trail_amount},
+        {"timestamp", to_iso8601(so.created_at)}
+    };
+}
+
+StopOrder stop_order_from_json(const json &j) {
+    std::string symbol;
+    StopOrder so = stop_order_from_json(j, symbol);
+    so.symbol_id = g_symbol_registry.get_or_create(symbol).id;
+    return so;
+}
+
+StopOrder stop_order_from_json(const json &j, std::string &symbol) {
+    StopOrder so;
+    so.order_id = id_from_json(j, "order_id");
+    symbol = j.at("symbol").get<std::string>();
+    if (!parse_side(j.at("side").get<std::string>(), so.side)) {
+        throw std::runtime_error("invalid side: " + j.at("side").get<std::string>());
+    }
+    so.quantity = j.at("quantity").get<long long>();
+    so.trigger_price = j.at("trigger_price").get<long long>();
+    if (!parse_stop_type(j.at("stop_type").get<std::string>(), so.stop_type)) {
+        so.stop_type = StopOrderType::STOP_LOSS;
+    }
+    so.limit_price = so.stop_type == StopOrderType::STOP_LIMIT ? j.at("limit_price").get<long long>() : 0;
+    so.trail_amount = j.value("trail_amount", 0LL);
+    if (j.contains("timestamp")) so.created_at = from_iso8601(j["timestamp"].get<std::string>());
+    // Note: We don't need the exact creation time for replay logic
+    so.best_price = 0; // Trailing stops restart one trail from trigger_price
+    return so;
+}
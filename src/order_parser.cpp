@@ -0,0 +1,193 @@
+// ============================================================================
+// FILE: src/order_parser.cpp
+// ============================================================================
+#include "../include/order_parser.h"
+#include <climits>
+
+namespace {
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+struct Cursor {
+    const char *p;
+    const char *end;
+
+    void skip_ws() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+    }
+
+    bool eat(char c) {
+        skip_ws();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    char peek() {
+        skip_ws();
+        return p < end ? *p : '\0';
+    }
+
+    // A string without escapes or control characters
+    bool string(std::string_view &out) {
+        if (!eat('"')) return false;
+        const char *start = p;
+        while (p < end && *p != '"') {
+            if (*p == '\\' || static_cast<unsigned char>(*p) < 0x20) return false;
+            ++p;
+        }
+        if (p >= end) return false;
+        out = std::string_view(start, static_cast<size_t>(p - start));
+        ++p;
+        return true;
+    }
+
+    // The longest run of number characters; decimal_to_fixed checks the grammar
+    bool number(std::string_view &out) {
+        skip_ws();
+        const char *start = p;
+        while (p < end && (is_digit(*p) || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) ++p;
+        out = std::string_view(start, static_cast<size_t>(p - start));
+        return p > start;
+    }
+
+    bool literal(std::string_view word) {
+        skip_ws();
+        if (static_cast<size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word) return false;
+        p += word.size();
+        return true;
+    }
+
+    // Any scalar member value we do not use
+    bool skip_scalar() {
+        char c = peek();
+        std::string_view ignored;
+        if (c == '"') return string(ignored);
+        if (c == '-' || is_digit(c)) {
+            long long unused;
+            return number(ignored) && decimal_to_fixed(ignored, 0, unused);
+        }
+        return literal("true") || literal("false") || literal("null");
+    }
+};
+
+} // namespace
+
+bool decimal_to_fixed(std::string_view text, int decimals, long long &out) {
+    size_t i = 0, n = text.size();
+    bool negative = i < n && text[i] == '-';
+    if (negative) ++i;
+
+    // JSON grammar: int (no leading zeros), optional fraction, optional exponent
+    size_t int_begin = i;
+    if (i < n && text[i] == '0') {
+        ++i;
+    } else {
+        while (i < n && is_digit(text[i])) ++i;
+    }
+    size_t int_end = i;
+    if (int_end == int_begin) return false;
+    size_t frac_begin = i, frac_end = i;
+    if (i < n && text[i] == '.') {
+        frac_begin = ++i;
+        while (i < n && is_digit(text[i])) ++i;
+        frac_end = i;
+        if (frac_end == frac_begin) return false;
+    }
+    long long exponent = 0;
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        bool exp_negative = i < n && text[i] == '-';
+        if (i < n && (text[i] == '-' || text[i] == '+')) ++i;
+        size_t exp_begin = i;
+        while (i < n && is_digit(text[i])) {
+            if (exponent < 100000) exponent = exponent * 10 + (text[i] - '0');
+            ++i;
+        }
+        if (i == exp_begin) return false;
+        if (exp_negative) exponent = -exponent;
+    }
+    if (i != n) return false;
+
+    // value = digits * 10^(decimals + exponent - fraction length); keep the
+    // digits left of the resulting decimal point, then scale up
+    long long shift = decimals + exponent - static_cast<long long>(frac_end - frac_begin);
+    size_t total = (int_end - int_begin) + (frac_end - frac_begin);
+    long long keep = static_cast<long long>(total) + (shift < 0 ? shift : 0);
+    unsigned long long value = 0;
+    const unsigned long long limit = static_cast<unsigned long long>(LLONG_MAX) + (negative ? 1 : 0);
+    size_t k = 0;
+    auto accumulate = [&](size_t from, size_t to) {
+        for (size_t j = from; j < to && static_cast<long long>(k) < keep; ++j, ++k) {
+            unsigned d = static_cast<unsigned>(text[j] - '0');
+            if (value > (limit - d) / 10) return false;
+            value = value * 10 + d;
+        }
+        return true;
+    };
+    if (!accumulate(int_begin, int_end) || !accumulate(frac_begin, frac_end)) return false;
+    if (value != 0) {
+        for (long long s = 0; s < shift; ++s) {
+            if (value > limit / 10) return false;
+            value *= 10;
+        }
+    }
+    out = negative ? static_cast<long long>(0 - value) : static_cast<long long>(value);
+    return true;
+}
+
+bool parse_order_fast(std::string_view body, OrderFields &f) {
+    Cursor c{body.data(), body.data() + body.size()};
+    if (!c.eat('{')) return false;
+    bool has_symbol = false, has_type = false, has_side = false, has_qty = false, has_price = false;
+    std::string_view price_text;
+
+    if (!c.eat('}')) {
+        do {
+            std::string_view key, text;
+            if (!c.string(key) || !c.eat(':')) return false;
+            if (key == "symbol") {
+                if (!c.string(text)) return false;
+                f.symbol.assign(text.data(), text.size());
+                has_symbol = true;
+            } else if (key == "order_type") {
+                if (!c.string(text)) return false;
+                if (text == "market") f.order_type = OrderType::Market;
+                else if (text == "limit") f.order_type = OrderType::Limit;
+                else if (text == "ioc") f.order_type = OrderType::Ioc;
+                else if (text == "fok") f.order_type = OrderType::Fok;
+                else return false;
+                has_type = true;
+            } else if (key == "side") {
+                if (!c.string(text)) return false;
+                if (text == "buy") f.side = Side::Buy;
+                else if (text == "sell") f.side = Side::Sell;
+                else return false;
+                has_side = true;
+            } else if (key == "quantity") {
+                if (!c.number(text) || !decimal_to_fixed(text, QUANTITY_DECIMALS, f.quantity)) return false;
+                has_qty = true;
+            } else if (key == "price") {
+                // Converted once the order type is known: market orders ignore it
+                if (!c.number(price_text)) return false;
+                has_price = true;
+            } else if (!c.skip_scalar()) {
+                return false;
+            }
+        } while (c.eat(','));
+        if (!c.eat('}')) return false;
+    }
+    c.skip_ws();
+    if (c.p != c.end || !has_symbol || !has_type || !has_side || !has_qty) return false;
+
+    f.price = 0;
+    if (f.order_type != OrderType::Market) {
+        if (!has_price || !decimal_to_fixed(price_text, PRICE_DECIMALS, f.price)) return false;
+    } else if (has_price) {
+        long long unused;
+        if (!decimal_to_fixed(price_text, PRICE_DECIMALS, unused)) return false;
+    }
+    return validate_order(f) == OrderReject::None;
+}
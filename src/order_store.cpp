@@ -1,7 +1,7 @@
 // FILE: src/order_store.cpp
 #include "../include/order_store.h"
 #include <iostream>
-#include <sstream>
+#include <stdexcept>
 
 OrderStore global_order_store = OrderStore();
 
@@ -14,11 +14,8 @@ OrderStore::~OrderStore() {
     // No need to close WAL here since it's managed globally
 }
 
-std::string OrderStore::next_id() {
-    auto id = id_counter.fetch_add(1);
-    std::ostringstream ss;
-    ss << "ORD-" << id;
-    return ss.str();
+uint64_t OrderStore::next_id() {
+    return id_counter.fetch_add(1);
 }
 
 void OrderStore::add_order(const Order &o) {
@@ -27,16 +24,16 @@ void OrderStore::add_order(const Order &o) {
     // WAL writing is now done in server.cpp using global_wal
 }
 
-bool OrderStore::has_order(const std::string &id) {
+bool OrderStore::has_order(uint64_t id) {
     std::lock_guard<std::mutex> lk(mu);
     return orders.find(id) != orders.end();
 }
 
-Order OrderStore::get_order(const std::string &id) {
+Order OrderStore::get_order(uint64_t id) {
     std::lock_guard<std::mutex> lk(mu);
     auto it = orders.find(id);
     if (it == orders.end()) {
-        throw std::runtime_error("Order not found: " + id);
+        throw std::runtime_error("Order not found: " + format_order_id(id));
     }
     return it->second;
 }
\ No newline at end of file
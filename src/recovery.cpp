@@ -0,0 +1,374 @@
+// ============================================================================
+// FILE: src/recovery.cpp
+// ============================================================================
+#include "../include/recovery.h"
+#include "../include/byte_codec.h"
+#include "../include/crc32.h"
+#include "../include/global_state.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static constexpr char SNAPSHOT_MAGIC[8] = {'M', 'E', 'S', 'N', 'A', 'P', '0', '1'};
+
+// Only what add_order_from_replay would rest is kept: market, IOC and FOK
+// takers (and limits outside a ladder band) never rest, and their trades
+// are folded in against the makers alone
+static bool can_rest(const Order &order) {
+    if (order.order_type != OrderType::Limit) return false;
+    SymbolEntry *entry = g_symbol_registry.at(order.symbol_id);
+    return !entry || entry->book.accepts_price(order.price);
+}
+
+void RecoveryState::apply(const WalRecord &rec) {
+    if (rec.seq > last_seq_) last_seq_ = rec.seq;
+    switch (rec.type) {
+    case WalRecordType::Order:
+        if (can_rest(rec.order)) orders_[rec.order.order_id] = rec.order;
+        max_order_seq_ = std::max(max_order_seq_, rec.order.order_id & ORDER_ID_SEQ_MASK);
+        ++total_orders_;
+        break;
+    case WalRecordType::StopOrder:
+        stops_[rec.stop.order_id] = rec.stop;
+        max_order_seq_ = std::max(max_order_seq_, rec.stop.order_id & ORDER_ID_SEQ_MASK);
+        ++total_orders_;
+        break;
+    case WalRecordType::Trade:
+        for (uint64_t id : {rec.trade.maker_order_id, rec.trade.taker_order_id}) {
+            auto it = orders_.find(id);
+            if (it == orders_.end()) continue;
+            it->second.quantity -= rec.trade.quantity;
+            if (it->second.quantity <= 0) orders_.erase(it);
+        }
+        ++total_trades_;
+        break;
+    case WalRecordType::Cancel:
+        orders_.erase(rec.order_id);
+        stops_.erase(rec.order_id);
+        break;
+    case WalRecordType::Amend: {
+        // Applied as a delta so trades logged around it in either order agree
+        auto it = orders_.find(rec.order.order_id);
+        if (it == orders_.end()) break;
+        it->second.quantity += rec.order.quantity - rec.previous_quantity;
+        it->second.price = rec.order.price;
+        it->second.timestamp = rec.order.timestamp;
+        if (it->second.quantity <= 0) orders_.erase(it);
+        break;
+    }
+    case WalRecordType::Symbol:
+    case WalRecordType::Json:
+        break;
+    }
+}
+
+void RecoveryState::advance_to(uint64_t seq) {
+    if (seq > last_seq_) last_seq_ = seq;
+}
+
+std::string RecoveryState::encode() const {
+    // The name table is the whole registry in id order, so loading it into
+    // a fresh process recreates the same ids (and the ids tagged into order ids)
+    std::vector<std::string> symbols;
+    g_symbol_registry.for_each([&](const SymbolEntry &entry) { symbols.push_back(entry.symbol); });
+
+    std::string body;
+    put_u64(body, last_seq_);
+    put_u64(body, total_orders_);
+    put_u64(body, total_trades_);
+    put_u32(body, static_cast<uint32_t>(symbols.size()));
+    for (const auto &name : symbols) put_str(body, name);
+    put_u64(body, orders_.size());
+    for (const auto &entry : orders_) {
+        const Order &o = entry.second;
+        put_u64(body, o.order_id);
+        put_u32(body, o.symbol_id);
+        put_u8(body, static_cast<uint8_t>(o.order_type));
+        put_u8(body, static_cast<uint8_t>(o.side));
+        put_i64(body, o.quantity);
+        put_i64(body, o.price);
+        put_i64(body, to_ns(o.timestamp));
+    }
+    put_u64(body, stops_.size());
+    for (const auto &entry : stops_) {
+        const StopOrder &so = entry.second;
+        put_u64(body, so.order_id);
+        put_u32(body, so.symbol_id);
+        put_u8(body, static_cast<uint8_t>(so.stop_type));
+        put_u8(body, static_cast<uint8_t>(so.side));
+        put_i64(body, so.quantity);
+        put_i64(body, so.trigger_price);
+        put_i64(body, so.limit_price);
+        put_i64(body, so.trail_amount);
+        put_i64(body, so.best_price);
+        put_i64(body, to_ns(so.created_at));
+        put_str(body, so.user_id);
+    }
+    put_u64(body, max_order_seq_);
+    put_u32(body, crc32(body.data(), body.size()));
+    return std::string(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) + body;
+}
+
+void RecoveryState::save_snapshot(const std::string &path) const {
+    std::string data = encode();
+
+    // Sealed segments are deleted once this returns, so it must be on disk
+    std::string tmp = path + ".tmp";
+    std::FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot write snapshot " + tmp);
+    bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size() && std::fflush(f) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(f)) == 0;
+#else
+    ok = ok && ::fsync(fileno(f)) == 0;
+#endif
+    std::fclose(f);
+    if (!ok) throw std::runtime_error("failed writing snapshot " + tmp);
+    std::filesystem::rename(tmp, path);
+}
+
+bool RecoveryState::load_snapshot(const std::string &path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.is_open()) return false;
+    std::string data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    decode(data, path);
+    std::cout << "[Recovery] Snapshot at seq " << last_seq_ << ": " << orders_.size()
+              << " orders, " << stops_.size() << " stop orders" << std::endl;
+    return true;
+}
+
+void RecoveryState::decode(const std::string &data, const std::string &source) {
+    if (data.size() < sizeof(SNAPSHOT_MAGIC) + 4 ||
+        std::memcmp(data.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error("not a snapshot file: " + source);
+    }
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(data.data());
+    const unsigned char *body = base + sizeof(SNAPSHOT_MAGIC);
+    size_t body_len = data.size() - sizeof(SNAPSHOT_MAGIC) - 4;
+    ByteReader crc_reader{body + body_len, body + body_len + 4};
+    if (crc32(body, body_len) != crc_reader.u32()) {
+        throw std::runtime_error("snapshot CRC mismatch: " + source);
+    }
+
+    ByteReader r{body, body + body_len};
+    last_seq_ = r.u64();
+    total_orders_ = r.u64();
+    total_trades_ = r.u64();
+    std::vector<uint32_t> symbol_ids(r.u32());
+    for (auto &id : symbol_ids) {
+        std::string name = r.str();
+        if (!r.ok) break;
+        id = g_symbol_registry.get_or_create(name).id;
+    }
+    auto symbol_id = [&](uint32_t idx) {
+        if (idx >= symbol_ids.size()) r.ok = false;
+        return r.ok ? symbol_ids[idx] : 0u;
+    };
+
+    orders_.clear();
+    uint64_t norders = r.u64();
+    for (uint64_t i = 0; i < norders && r.ok; ++i) {
+        Order o;
+        o.order_id = r.u64();
+        o.symbol_id = symbol_id(r.u32());
+        o.order_type = static_cast<OrderType>(r.u8());
+        o.side = static_cast<Side>(r.u8());
+        o.quantity = r.i64();
+        o.price = r.i64();
+        o.timestamp = from_ns(r.i64());
+        if (can_rest(o)) orders_[o.order_id] = o; // older snapshots kept every taker
+    }
+    stops_.clear();
+    uint64_t nstops = r.u64();
+    for (uint64_t i = 0; i < nstops && r.ok; ++i) {
+        StopOrder so;
+        so.order_id = r.u64();
+        so.symbol_id = symbol_id(r.u32());
+        so.stop_type = static_cast<StopOrderType>(r.u8());
+        so.side = static_cast<Side>(r.u8());
+        so.quantity = r.i64();
+        so.trigger_price = r.i64();
+        so.limit_price = r.i64();
+        so.trail_amount = r.i64();
+        so.best_price = r.i64();
+        so.created_at = from_ns(r.i64());
+        so.user_id = r.str();
+        stops_[so.order_id] = so;
+    }
+    if (!r.ok) throw std::runtime_error("truncated snapshot: " + source);
+    max_order_seq_ = 0;
+    if (r.p < r.end) {
+        max_order_seq_ = r.u64();
+        if (!r.ok) throw std::runtime_error("truncated snapshot: " + source);
+    } else {
+        // Older snapshots: the best left is the highest id still open
+        for (const auto &entry : orders_) max_order_seq_ = std::max(max_order_seq_, entry.first & ORDER_ID_SEQ_MASK);
+        for (const auto &entry : stops_) max_order_seq_ = std::max(max_order_seq_, entry.first & ORDER_ID_SEQ_MASK);
+    }
+}
+
+void RecoveryState::load_into_books() const {
+    // Ids are assigned in arrival order, so sorting by id restores time
+    // priority; a re-queued amend carries the time it went to the back
+    std::vector<const Order*> resting;
+    resting.reserve(orders_.size());
+    for (const auto& entry : orders_) resting.push_back(&entry.second);
+    std::sort(resting.begin(), resting.end(), [](const Order* a, const Order* b) {
+        if (a->timestamp != b->timestamp) return a->timestamp < b->timestamp;
+        return a->order_id < b->order_id;
+    });
+    std::vector<const StopOrder*> stops;
+    stops.reserve(stops_.size());
+    for (const auto& entry : stops_) stops.push_back(&entry.second);
+    std::sort(stops.begin(), stops.end(),
+              [](const StopOrder* a, const StopOrder* b) { return a->order_id < b->order_id; });
+
+    // Ids whose tag does not name their book here (pre-tag ids, or logs
+    // from before symbol records fixed the interning order) are indexed
+    auto index_if_untagged = [](uint64_t order_id, uint32_t symbol_id) {
+        uint32_t tagged;
+        if (!order_id_symbol(order_id, tagged) || tagged != symbol_id) g_legacy_order_symbols[order_id] = symbol_id;
+    };
+    for (const Order* order : resting) {
+        g_symbol_registry.at(order->symbol_id)->book.add_order_from_replay(*order);
+        index_if_untagged(order->order_id, order->symbol_id);
+    }
+    for (const StopOrder* order : stops) {
+        g_symbol_registry.at(order->symbol_id)->stops.add_stop_order_from_replay(*order);
+        index_if_untagged(order->order_id, order->symbol_id);
+    }
+}
+
+std::string snapshot_path(const WalConfig &config) {
+    return config.path + ".snapshot";
+}
+
+std::vector<std::pair<uint64_t, std::string>> sealed_segments(const WalConfig &config) {
+    std::vector<std::pair<uint64_t, std::string>> out;
+    std::filesystem::path wal_path(config.path);
+    std::filesystem::path dir = wal_path.parent_path();
+    if (dir.empty()) dir = ".";
+    std::string prefix = wal_path.filename().string() + ".seg-";
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0) continue;
+        uint64_t seq = 0;
+        if (!parse_order_id(name.substr(prefix.size()), seq)) continue; // plain digits
+        out.emplace_back(seq, entry.path().string());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+RecoveryState recover(WAL &wal) {
+    RecoveryState state;
+    const WalConfig &config = wal.config();
+    state.load_snapshot(snapshot_path(config));
+
+    // Records the snapshot already holds are skipped (seq 0: pre-sequence logs)
+    auto apply = [&](WalRecord &rec) {
+        if (rec.seq != 0 && rec.seq <= state.last_seq()) return;
+        state.apply(rec);
+        // Trades still in the log refill the books' recent-trades rings
+        if (rec.type == WalRecordType::Trade) {
+            if (SymbolEntry *entry = g_symbol_registry.at(rec.trade.symbol_id)) entry->book.record_trade(rec.trade);
+        }
+    };
+    for (const auto &[seq, path] : sealed_segments(config)) {
+        if (seq <= state.last_seq()) {
+            std::filesystem::remove(path); // compacted, but not deleted before a crash
+            continue;
+        }
+        WAL::replay_file(path, apply);
+        state.advance_to(seq);
+    }
+    wal.replay_stream(apply);
+    wal.note_replayed_seq(state.last_seq());
+    return state;
+}
+
+void install_snapshot(WAL &wal, const RecoveryState &state) {
+    wal.flush();
+    std::string sealed;
+    wal.seal_segment(sealed);
+    const WalConfig &config = wal.config();
+    state.save_snapshot(snapshot_path(config));
+    for (const auto &segment : sealed_segments(config)) std::filesystem::remove(segment.second);
+    wal.note_replayed_seq(state.last_seq());
+}
+
+Snapshotter::Snapshotter(WAL &wal, RecoveryState state)
+    : wal_(wal), state_(std::move(state)), snapshot_seq_(state_.last_seq()) {}
+
+Snapshotter::~Snapshotter() {
+    stop();
+}
+
+void Snapshotter::start() {
+    if (running_.exchange(true)) return;
+    thread_ = std::thread(&Snapshotter::loop, this);
+}
+
+void Snapshotter::stop() {
+    if (!running_.exchange(false)) return;
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+bool Snapshotter::snapshot_now() {
+    std::lock_guard<std::mutex> lk(mu_);
+    std::string sealed;
+    if (wal_.seal_segment(sealed) == 0) return false;
+
+    auto started = std::chrono::steady_clock::now();
+    const WalConfig &config = wal_.config();
+    auto segments = sealed_segments(config);
+    for (const auto &[seq, path] : segments) {
+        if (seq <= state_.last_seq()) continue;
+        WAL::replay_file(path, [&](WalRecord &rec) { state_.apply(rec); }, 2);
+        state_.advance_to(seq);
+    }
+    state_.save_snapshot(snapshot_path(config));
+    for (const auto &[seq, path] : segments) {
+        if (seq <= state_.last_seq()) std::filesystem::remove(path);
+    }
+    snapshot_seq_ = state_.last_seq();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "[Snapshot] seq " << state_.last_seq() << ": " << state_.orders().size() << " orders, "
+              << state_.stops().size() << " stop orders in " << secs << " s" << std::endl;
+    return true;
+}
+
+void Snapshotter::reset(RecoveryState state) {
+    std::lock_guard<std::mutex> lk(mu_);
+    install_snapshot(wal_, state);
+    state_ = std::move(state);
+    snapshot_seq_ = state_.last_seq();
+}
+
+void Snapshotter::loop() {
+    const auto interval = std::chrono::seconds(wal_.config().snapshot_interval_s);
+    while (running_.load()) {
+        {
+            std::unique_lock<std::mutex> lk(wait_mu_);
+            cv_.wait_for(lk, interval, [&]{ return !running_.load(); });
+        }
+        if (!running_.load()) break;
+        try {
+            snapshot_now();
+        } catch (const std::exception &e) {
+            std::cerr << "[Snapshot] Failed: " << e.what() << std::endl;
+        }
+    }
+}
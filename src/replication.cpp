@@ -0,0 +1,648 @@
+// ============================================================================
+// FILE: src/replication.cpp
+// ============================================================================
+#include "../include/replication.h"
+#include "../include/byte_codec.h"
+#include "../include/global_state.h"
+#include "../include/order_entry.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+ReplicationPrimary *g_replication_primary = nullptr;
+ReplicationStandby *g_replication_standby = nullptr;
+
+static std::atomic<bool> g_read_only{false};
+
+bool replication_read_only() {
+    return g_read_only.load(std::memory_order_relaxed);
+}
+
+using namespace replication_proto;
+
+static std::string make_frame(MsgType type, const std::string &body) {
+    std::string out;
+    out.reserve(HEADER_SIZE + body.size());
+    put_u32(out, static_cast<uint32_t>(1 + body.size()));
+    put_u8(out, type);
+    out += body;
+    return out;
+}
+
+static std::string make_seq_frame(MsgType type, uint64_t seq) {
+    std::string body;
+    put_u64(body, seq);
+    return make_frame(type, body);
+}
+
+static uint64_t body_seq(const std::string &body) {
+    ByteReader r{reinterpret_cast<const unsigned char *>(body.data()),
+                 reinterpret_cast<const unsigned char *>(body.data()) + body.size()};
+    return r.u64();
+}
+
+// --- Applying replicated records ---
+
+// Ids minted after a promotion must come after every id seen, so the
+// counter follows the ids' sequence field as well as the record count
+static void note_order_id(uint64_t order_id) {
+    uint64_t next = std::max(g_total_orders.load(std::memory_order_relaxed) + 1, order_id & ORDER_ID_SEQ_MASK);
+    g_total_orders.store(next, std::memory_order_relaxed);
+}
+
+void ReplicaApplier::apply(const WalRecord &rec) {
+    switch (rec.type) {
+    case WalRecordType::Order:
+        if (SymbolEntry *entry = g_symbol_registry.at(rec.order.symbol_id)) {
+            entry->book.add_order_from_replay(rec.order);
+            touched_[entry->id];
+        }
+        note_order_id(rec.order.order_id);
+        break;
+    case WalRecordType::StopOrder:
+        if (SymbolEntry *entry = g_symbol_registry.at(rec.stop.symbol_id)) {
+            entry->stops.add_stop_order_from_replay(rec.stop);
+        }
+        note_order_id(rec.stop.order_id);
+        break;
+    case WalRecordType::Trade:
+        if (SymbolEntry *entry = g_symbol_registry.at(rec.trade.symbol_id)) {
+            entry->book.apply_trade_from_replay(rec.trade);
+            entry->stops.update_trailing_stops(rec.trade.price);
+            touched_[entry->id].push_back(rec.trade);
+        }
+        g_total_trades.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case WalRecordType::Cancel:
+        if (SymbolEntry *entry = order_symbol(rec.order_id)) {
+            if (!entry->book.cancel_order(rec.order_id)) entry->stops.cancel_stop_order(rec.order_id);
+            touched_[entry->id];
+        }
+        break;
+    case WalRecordType::Amend:
+        if (SymbolEntry *entry = order_symbol(rec.order.order_id)) {
+            entry->book.apply_amend_from_replay(rec.order, rec.previous_quantity);
+            touched_[entry->id];
+        }
+        break;
+    case WalRecordType::Symbol:
+        // Interned while decoding; ids only line up if this process never
+        // created a symbol of its own
+        if (SymbolEntry *entry = g_symbol_registry.find(rec.symbol)) {
+            if (entry->id != rec.symbol_id) {
+                std::cerr << "[Replication] " << rec.symbol << " has id " << entry->id << " here but "
+                          << rec.symbol_id << " on the primary" << std::endl;
+            }
+        }
+        break;
+    case WalRecordType::Json:
+        break;
+    }
+}
+
+void ReplicaApplier::publish() {
+    for (auto &[symbol_id, trades] : touched_) {
+        if (SymbolEntry *entry = g_symbol_registry.at(symbol_id)) publish_market_data(*entry, trades);
+    }
+    touched_.clear();
+}
+
+// --- Primary ---
+
+ReplicationPrimary::ReplicationPrimary(const ReplicationConfig &config, WAL &wal, RecoveryState state)
+    : config_(config), wal_(wal), state_(std::move(state)) {}
+
+ReplicationPrimary::~ReplicationPrimary() {
+    stop();
+}
+
+void ReplicationPrimary::on_batch(const std::vector<WalRecord> &batch, const std::string &binary) {
+    if (batch.empty()) return;
+    Frame frame;
+    frame.first_seq = batch.front().seq;
+    frame.last_seq = batch.back().seq;
+    frame.bytes = std::make_shared<const std::string>(make_frame(Records, binary));
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        for (const WalRecord &rec : batch) state_.apply(rec);
+        backlog_size_ += frame.bytes->size();
+        backlog_.push_back(std::move(frame));
+        while (backlog_.size() > 1 && backlog_size_ > config_.backlog_bytes) {
+            backlog_size_ -= backlog_.front().bytes->size();
+            backlog_.pop_front();
+        }
+    }
+    cv_.notify_all();
+}
+
+bool ReplicationPrimary::wait_replicated(uint64_t seq) {
+    if (config_.ack == ReplicationAck::Async || seq == 0) return true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.ack_timeout_ms);
+    std::unique_lock<std::mutex> lk(ack_mu_);
+    return ack_cv_.wait_until(lk, deadline, [&] {
+        return !running_.load() || acked_count(seq) >= config_.quorum;
+    }) && running_.load();
+}
+
+size_t ReplicationPrimary::acked_count(uint64_t seq) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    size_t n = 0;
+    for (const auto &peer : peers_) {
+        if (peer->alive.load() && peer->acked.load() >= seq) ++n;
+    }
+    return n;
+}
+
+size_t ReplicationPrimary::standby_count() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    size_t n = 0;
+    for (const auto &peer : peers_) n += peer->alive.load() ? 1 : 0;
+    return n;
+}
+
+uint64_t ReplicationPrimary::min_acked_seq() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    uint64_t min_seq = 0;
+    bool any = false;
+    for (const auto &peer : peers_) {
+        if (!peer->alive.load()) continue;
+        min_seq = any ? std::min(min_seq, peer->acked.load()) : peer->acked.load();
+        any = true;
+    }
+    return min_seq;
+}
+
+uint64_t ReplicationPrimary::last_seq() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return state_.last_seq();
+}
+
+// --- Standby ---
+
+ReplicationStandby::ReplicationStandby(const ReplicationConfig &config, WAL &wal, RecoveryState state,
+                                       Snapshotter *snapshotter)
+    : config_(config), wal_(wal), state_(std::move(state)), snapshotter_(snapshotter),
+      applied_seq_(state_.last_seq()) {}
+
+ReplicationStandby::~ReplicationStandby() {
+    stop();
+}
+
+void ReplicationStandby::note_applied(uint64_t seq) {
+    applied_seq_.store(seq);
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+        ack_target_ = seq;
+    }
+    ack_cv_.notify_all();
+}
+
+bool ReplicationStandby::handle_records(const std::string &body) {
+    std::vector<WalRecord> records;
+    if (!WAL::decode_binary(body.data(), body.size(), records)) {
+        std::cerr << "[Replication] Corrupt records from the primary after seq " << applied_seq_.load() << std::endl;
+        return false;
+    }
+    // A stream resumed inside a batch repeats records already applied
+    uint64_t applied = applied_seq_.load();
+    auto fresh = std::find_if(records.begin(), records.end(), [&](const WalRecord &rec) { return rec.seq > applied; });
+    records.erase(records.begin(), fresh);
+    if (records.empty()) return true;
+    if (records.front().seq != applied + 1) {
+        std::cerr << "[Replication] Gap in the stream: expected seq " << applied + 1 << ", got "
+                  << records.front().seq << std::endl;
+        return false;
+    }
+
+    for (const WalRecord &rec : records) {
+        applier_.apply(rec);
+        state_.apply(rec);
+    }
+    applier_.publish();
+    uint64_t last = records.back().seq;
+    if (wal_.append_replicated(records) != last) {
+        std::cerr << "[Replication] Local WAL refused records up to seq " << last << std::endl;
+        return false;
+    }
+    note_applied(last);
+    return true;
+}
+
+void ReplicationStandby::handle_snapshot(const std::string &body) {
+    RecoveryState state;
+    state.decode(body, "replication snapshot"); // throws before anything is touched
+    g_symbol_registry.for_each([](SymbolEntry &entry) {
+        entry.book.clear();
+        entry.stops.clear();
+    });
+    g_legacy_order_symbols.clear();
+    if (snapshotter_) {
+        snapshotter_->reset(state);
+    } else {
+        install_snapshot(wal_, state);
+    }
+    state.load_into_books();
+    g_total_orders.store(state.next_order_seq(), std::memory_order_relaxed);
+    g_total_trades.store(state.total_trades(), std::memory_order_relaxed);
+    g_symbol_registry.for_each([](SymbolEntry &entry) { publish_market_data(entry, {}); });
+    std::cout << "[Replication] Loaded the primary's snapshot at seq " << state.last_seq() << ": "
+              << state.orders().size() << " orders, " << state.stops().size() << " stop orders" << std::endl;
+    state_ = std::move(state);
+    note_applied(state_.last_seq());
+}
+
+bool ReplicationStandby::promote() {
+    if (promoted_.exchange(true)) return false;
+    stop();
+    wal_.flush();
+    std::cout << "[Replication] Promoted to primary at seq " << applied_seq_.load() << std::endl;
+    if (promote_hook_) promote_hook_(state_);
+    g_read_only = false;
+    return true;
+}
+
+#ifdef __linux__
+
+static bool send_all(int fd, const std::string &data) {
+    const char *p = data.data();
+    size_t left = data.size();
+    while (left > 0) {
+        ssize_t n = ::send(fd, p, left, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool recv_all(int fd, char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = ::recv(fd, p, len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool read_frame(int fd, uint8_t &type, std::string &body) {
+    unsigned char header[HEADER_SIZE];
+    if (!recv_all(fd, reinterpret_cast<char *>(header), HEADER_SIZE)) return false;
+    ByteReader r{header, header + HEADER_SIZE};
+    uint32_t len = r.u32();
+    type = r.u8();
+    if (len < 1 || len > MAX_FRAME) return false;
+    body.resize(len - 1);
+    return len == 1 || recv_all(fd, &body[0], len - 1);
+}
+
+static void set_recv_timeout(int fd, long seconds) {
+    timeval tv{};
+    tv.tv_sec = seconds;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+bool ReplicationPrimary::start() {
+    if (running_.load()) return true;
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        std::cerr << "[Replication] Socket creation failed\n";
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listen_fd_, 16) != 0) {
+        std::cerr << "[Replication] Bind/listen failed on port " << config_.port << "\n";
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    running_ = true;
+    wal_.set_batch_tap([this](const std::vector<WalRecord> &batch, const std::string &binary) {
+        on_batch(batch, binary);
+    });
+    accept_thread_ = std::thread(&ReplicationPrimary::accept_loop, this);
+    std::cout << "[Replication] Streaming the WAL to standbys on port " << config_.port << " ("
+              << (config_.ack == ReplicationAck::Quorum ? "quorum " + std::to_string(config_.quorum) : "async")
+              << ")\n";
+    return true;
+}
+
+void ReplicationPrimary::stop() {
+    if (!running_.exchange(false)) return;
+    wal_.set_batch_tap(nullptr);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+    }
+    cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+    }
+    ack_cv_.notify_all();
+    if (accept_thread_.joinable()) accept_thread_.join();
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    reap_peers(true);
+}
+
+void ReplicationPrimary::accept_loop() {
+    while (running_.load()) {
+        pollfd p{listen_fd_, POLLIN, 0};
+        int n = ::poll(&p, 1, 200);
+        reap_peers(false);
+        if (n <= 0) continue;
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+        auto peer = std::make_unique<Peer>();
+        peer->fd = fd;
+        Peer &ref = *peer;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            peers_.push_back(std::move(peer));
+        }
+        ref.sender = std::thread(&ReplicationPrimary::send_loop, this, std::ref(ref));
+    }
+}
+
+void ReplicationPrimary::send_loop(Peer &peer) {
+    auto mark_dead = [&] {
+        peer.alive = false;
+        ::shutdown(peer.fd, SHUT_RDWR);
+        {
+            std::lock_guard<std::mutex> lk(ack_mu_);
+        }
+        ack_cv_.notify_all();
+    };
+
+    uint8_t type = 0;
+    std::string body;
+    set_recv_timeout(peer.fd, 5);
+    if (!read_frame(peer.fd, type, body) || type != Hello || body.size() != 8) {
+        std::cerr << "[Replication] Standby sent no valid hello\n";
+        mark_dead();
+        return;
+    }
+    set_recv_timeout(peer.fd, 0);
+    uint64_t cursor = body_seq(body);
+    peer.acked = cursor; // what it already has is durable there
+
+    std::vector<std::shared_ptr<const std::string>> out;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        uint64_t last = state_.last_seq();
+        if (cursor > last) {
+            std::cerr << "[Replication] Standby is at seq " << cursor << ", ahead of this primary (" << last
+                      << "); it needs a fresh copy of the log\n";
+            cursor = UINT64_MAX;
+        } else if (cursor < last && (backlog_.empty() || backlog_.front().first_seq > cursor + 1)) {
+            out.push_back(std::make_shared<const std::string>(make_frame(Snapshot, state_.encode())));
+            cursor = last;
+        }
+    }
+    if (cursor == UINT64_MAX) {
+        mark_dead();
+        return;
+    }
+    std::cout << "[Replication] Standby connected at seq " << body_seq(body)
+              << (out.empty() ? "" : ", sending a snapshot") << "\n";
+    peer.reader = std::thread(&ReplicationPrimary::read_acks, this, std::ref(peer));
+
+    while (running_.load() && peer.alive.load()) {
+        for (const auto &bytes : out) {
+            if (!send_all(peer.fd, *bytes)) peer.alive = false;
+        }
+        out.clear();
+
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait(lk, [&] { return !running_.load() || !peer.alive.load() || state_.last_seq() > cursor; });
+        if (!running_.load() || !peer.alive.load()) break;
+        auto it = std::partition_point(backlog_.begin(), backlog_.end(),
+                                       [&](const Frame &f) { return f.last_seq <= cursor; });
+        if (it == backlog_.end() || it->first_seq > cursor + 1) {
+            // Fell out of the backlog: start over from the current state
+            out.push_back(std::make_shared<const std::string>(make_frame(Snapshot, state_.encode())));
+            cursor = state_.last_seq();
+            std::cout << "[Replication] Standby fell behind the backlog, resending a snapshot\n";
+            continue;
+        }
+        for (; it != backlog_.end(); ++it) out.push_back(it->bytes);
+        cursor = backlog_.back().last_seq;
+    }
+    mark_dead();
+}
+
+void ReplicationPrimary::read_acks(Peer &peer) {
+    uint8_t type = 0;
+    std::string body;
+    while (peer.alive.load() && read_frame(peer.fd, type, body)) {
+        if (type != Ack || body.size() != 8) break;
+        uint64_t seq = body_seq(body);
+        if (seq > peer.acked.load()) peer.acked = seq;
+        {
+            std::lock_guard<std::mutex> lk(ack_mu_);
+        }
+        ack_cv_.notify_all();
+    }
+    peer.alive = false;
+    ::shutdown(peer.fd, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+    }
+    cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+    }
+    ack_cv_.notify_all();
+}
+
+void ReplicationPrimary::reap_peers(bool all) {
+    std::vector<std::unique_ptr<Peer>> done;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto keep = std::stable_partition(peers_.begin(), peers_.end(), [&](const std::unique_ptr<Peer> &p) {
+            return !all && p->alive.load();
+        });
+        for (auto it = keep; it != peers_.end(); ++it) done.push_back(std::move(*it));
+        peers_.erase(keep, peers_.end());
+    }
+    if (!done.empty()) cv_.notify_all();
+    for (auto &peer : done) {
+        peer->alive = false;
+        ::shutdown(peer->fd, SHUT_RDWR);
+        if (peer->sender.joinable()) peer->sender.join();
+        if (peer->reader.joinable()) peer->reader.join();
+        ::close(peer->fd);
+        if (!all) std::cout << "[Replication] Standby disconnected\n";
+    }
+}
+
+// Blocking connect with a bounded wait; -1 on failure
+static int connect_to(const std::string &host, int port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return -1;
+    int fd = -1;
+    for (addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        timeval tv{};
+        tv.tv_sec = 2;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)); // bounds connect()
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            ::close(fd);
+            fd = -1;
+            continue;
+        }
+        tv.tv_sec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+void ReplicationStandby::start() {
+    if (running_.exchange(true)) return;
+    g_read_only = true;
+    thread_ = std::thread(&ReplicationStandby::loop, this);
+    std::cout << "[Replication] Standby following " << config_.primary_host << ":" << config_.primary_port
+              << " from seq " << applied_seq_.load() << "\n";
+}
+
+void ReplicationStandby::stop() {
+    if (!running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lk(fd_mu_);
+        if (fd_ >= 0) ::shutdown(fd_, SHUT_RDWR);
+    }
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+    }
+    ack_cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void ReplicationStandby::loop() {
+    while (running_.load()) {
+        int fd = connect_to(config_.primary_host, config_.primary_port);
+        if (fd >= 0) {
+            {
+                std::lock_guard<std::mutex> lk(fd_mu_);
+                fd_ = fd;
+            }
+            if (running_.load()) follow(fd);
+            {
+                std::lock_guard<std::mutex> lk(fd_mu_);
+                fd_ = -1;
+            }
+            ::close(fd);
+        }
+        // Retry about once a second until stopped
+        for (int i = 0; i < 10 && running_.load(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+void ReplicationStandby::follow(int fd) {
+    if (!send_all(fd, make_seq_frame(Hello, applied_seq_.load()))) return;
+    connected_ = true;
+    std::cout << "[Replication] Connected to the primary at seq " << applied_seq_.load() << "\n";
+    std::atomic<bool> session_alive{true};
+    note_applied(applied_seq_.load()); // first ack: where this standby stands
+    std::thread acker(&ReplicationStandby::ack_loop, this, fd, std::cref(session_alive));
+
+    uint8_t type = 0;
+    std::string body;
+    while (running_.load() && read_frame(fd, type, body)) {
+        if (type == Records) {
+            if (!handle_records(body)) break;
+        } else if (type == Snapshot) {
+            try {
+                handle_snapshot(body);
+            } catch (const std::exception &e) {
+                std::cerr << "[Replication] Snapshot from the primary failed: " << e.what() << std::endl;
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+
+    connected_ = false;
+    session_alive = false;
+    ::shutdown(fd, SHUT_RDWR);
+    {
+        std::lock_guard<std::mutex> lk(ack_mu_);
+    }
+    ack_cv_.notify_all();
+    acker.join();
+    if (running_.load()) std::cerr << "[Replication] Lost the primary at seq " << applied_seq_.load() << std::endl;
+}
+
+void ReplicationStandby::ack_loop(int fd, const std::atomic<bool> &session_alive) {
+    uint64_t sent = 0;
+    bool first = true;
+    for (;;) {
+        uint64_t target;
+        {
+            std::unique_lock<std::mutex> lk(ack_mu_);
+            ack_cv_.wait(lk, [&] { return first || ack_target_ > sent || !session_alive.load() || !running_.load(); });
+            if (!session_alive.load() || !running_.load()) return;
+            target = ack_target_;
+        }
+        first = false;
+        // Acks promise durability: wait for the local sync covering target
+        if (!wal_.wait_durable(target)) return;
+        if (!send_all(fd, make_seq_frame(Ack, target))) return;
+        sent = target;
+    }
+}
+
+#else // other platforms: not available
+
+bool ReplicationPrimary::start() {
+    std::cerr << "[Replication] WAL streaming needs Linux\n";
+    return false;
+}
+
+void ReplicationPrimary::stop() {}
+void ReplicationPrimary::accept_loop() {}
+void ReplicationPrimary::send_loop(Peer &) {}
+void ReplicationPrimary::read_acks(Peer &) {}
+void ReplicationPrimary::reap_peers(bool) {}
+
+void ReplicationStandby::start() {
+    std::cerr << "[Replication] WAL streaming needs Linux\n";
+}
+
+void ReplicationStandby::stop() {}
+void ReplicationStandby::loop() {}
+void ReplicationStandby::follow(int) {}
+void ReplicationStandby::ack_loop(int, const std::atomic<bool> &) {}
+
+#endif
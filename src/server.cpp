@@ -3,36 +3,178 @@
 // ============================================================================
 #include <httplib.h>
 #include "../vendor/json.hpp"
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <thread> // Keep this include for std::this_thread
+#include <unordered_map>
 #include "../include/order.h"
+#include "../include/order_json.h"
+#include "../include/order_entry.h"
+#include "../include/order_parser.h"
 #include "../include/global_state.h"
+#include "../include/engine_config.h"
+#include "../include/matching_engine.h"
+#include "../include/metrics.h"
+#include "../include/order_gateway.h"
+#include "../include/replication.h"
 #include "../include/wal.h"
 #include "../include/broadcast_queue.h" // <-- ADD THIS INCLUDE
 
 using json = nlohmann::json;
 
-// (to_iso8601 helper function is unchanged)
-static std::string to_iso8601(const std::chrono::system_clock::time_point &tp) {
-    auto t = std::chrono::system_clock::to_time_t(tp);
-    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()) % 1000000000;
-    std::ostringstream ss;
-    ss << std::put_time(std::gmtime(&t), "%Y-%m-%dT%H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(9) << ns.count() << 'Z';
-    return ss.str();
+// A json number as engine fixed point, exact for the decimal the client sent
+// (dump() prints the shortest text that reads back as the same double).
+// Empty on success, otherwise the message for a 400.
+static std::string json_to_fixed(const json &v, const char *field, int decimals, long long &out) {
+    if (!v.is_number()) return std::string(field) + " must be a number";
+    if (!decimal_to_fixed(v.dump(), decimals, out)) return std::string(field) + " out of range";
+    return std::string();
 }
 
+// A query parameter as a plain unsigned decimal: every character a digit
+static bool parse_count(const std::string &text, uint64_t &out) {
+    const char *end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, out);
+    return !text.empty() && ec == std::errc() && ptr == end;
+}
+
+// JSON order fields shared by /orders and /orders/batch (the DOM path; see
+// parse_order_fast). Empty on success, otherwise the message for a 400.
+static std::string parse_order_fields(const json &j, OrderFields &f) {
+    for (const char *field : {"symbol", "order_type", "side", "quantity"}) {
+        if (!j.contains(field)) return std::string("missing field: ") + field;
+    }
+    f.symbol = j["symbol"].get<std::string>();
+    if (!parse_order_type(j["order_type"].get<std::string>(), f.order_type)) {
+        return "invalid order_type. Use: market, limit, ioc, fok";
+    }
+    if (!parse_side(j["side"].get<std::string>(), f.side)) return "invalid side. Use: buy or sell";
+    std::string error = json_to_fixed(j["quantity"], "quantity", QUANTITY_DECIMALS, f.quantity);
+    if (!error.empty()) return error;
+    if (f.quantity <= 0) return "quantity must be positive";
+    f.price = 0;
+    if (f.order_type != OrderType::Market) {
+        if (!j.contains("price")) return std::string(to_string(f.order_type)) + " order requires price";
+        error = json_to_fixed(j["price"], "price", PRICE_DECIMALS, f.price);
+        if (!error.empty()) return error;
+        if (f.price <= 0) return "price must be positive";
+    }
+    switch (validate_order(f)) {
+    case OrderReject::None: return std::string();
+    case OrderReject::InvalidQuantity: return "quantity must be positive";
+    case OrderReject::InvalidPrice: return "price must be positive";
+    case OrderReject::PriceOutsideBand: return "price outside configured band for " + f.symbol;
+    default: return "invalid order";
+    }
+}
+
+// {"order": {... "status"}, "filled_quantity", "remaining_quantity", "trades"}
+// members of an order result, keys in sorted order
+static void write_order_result(JsonWriter &w, const Order &o, const std::vector<Trade> &trades) {
+    long long filled = 0;
+    for (const auto &t : trades) filled += t.quantity;
+    w.field("filled_quantity", filled);
+    w.key("order");
+    write_order_json(w, o, to_string(order_status(o.order_type, o.quantity, filled)));
+    w.field("remaining_quantity", std::max(0LL, o.quantity - filled));
+    w.key("trades").begin_array();
+    for (const auto &t : trades) write_trade_json(w, t);
+    w.end_array();
+}
+
+// Responses are rendered into a per-thread buffer that keeps its capacity
+static JsonWriter &response_writer() {
+    thread_local JsonWriter w;
+    w.clear();
+    return w;
+}
+
+// httplib's request pool with the "threads.http" group applied to every
+// worker; httplib hands each accepted connection to enqueue()
+class PlacedThreadPool : public httplib::TaskQueue {
+public:
+    explicit PlacedThreadPool(const ThreadGroupConfig &group) {
+        size_t n = group.count;
+        if (n == 0) n = std::max(8u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < n; ++i) {
+            workers_.emplace_back([this, group, i] {
+                place_current_thread(group, i, "http");
+                run();
+            });
+        }
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (shutdown_) return false;
+            jobs_.push_back(std::move(fn));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    void shutdown() override {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            shutdown_ = true;
+        }
+        cv_.notify_all();
+        for (auto &t : workers_) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+private:
+    void run() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [&] { return shutdown_ || !jobs_.empty(); });
+                if (jobs_.empty()) return; // shut down and drained
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool shutdown_ = false;
+};
+
+// Per-thread order entry result; its fill buffers keep their capacity too
+static OrderEntryResult &entry_result() {
+    thread_local OrderEntryResult r;
+    return r;
+}
+
+static constexpr size_t MAX_BATCH_OPS = 1000;
+
 void setup_server(int port) {
     httplib::Server svr;
+    const ThreadGroupConfig &http_threads = g_engine_config.http.threads;
+    if (http_threads.count > 0 || http_threads.places_threads()) {
+        svr.new_task_queue = [&http_threads] { return new PlacedThreadPool(http_threads); };
+    }
 
     // CORS preflight handler
     svr.Options("/(.*)", [](const httplib::Request&, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-        res.set_header("Access-Control-Allow-Methods", "POST, GET, DELETE, OPTIONS");
+        res.set_header("Access-Control-Allow-Methods", "POST, GET, PATCH, DELETE, OPTIONS");
         res.set_header("Access-Control-Allow-Headers", "Content-Type");
         res.status = 204;
     });
@@ -42,13 +184,22 @@ void setup_server(int port) {
         res.set_header("Access-Control-Allow-Origin", "*");
     };
 
+    // A following standby only serves reads; true if the request was refused
+    auto refuse_read_only = [](httplib::Response &res) {
+        if (!replication_read_only()) return false;
+        res.status = 503;
+        res.set_content(json({{"error", "read-only standby"}}).dump(), "application/json");
+        return true;
+    };
+
     // Health check
     svr.Get("/health", [&](const httplib::Request&, httplib::Response& res){
         add_cors(res);
         json health = {
             {"status", "healthy"},
             {"uptime_seconds", std::chrono::steady_clock::now().time_since_epoch().count() / 1000000000},
-            {"ws_clients", g_ws_server ? g_ws_server->client_count() : 0}
+            {"ws_clients", g_ws_server ? g_ws_server->client_count() : 0},
+            {"role", replication_read_only() ? "standby" : "primary"}
         };
         res.set_content(health.dump(), "application/json");
     });
@@ -57,10 +208,9 @@ void setup_server(int port) {
     svr.Get("/symbols", [&](const httplib::Request&, httplib::Response& res) {
         add_cors(res);
         json symbols = json::array();
-        std::lock_guard<std::mutex> lk(g_global_mutex);
-        for (const auto &[symbol, book] : g_order_books) {
-            symbols.push_back(symbol);
-        }
+        g_symbol_registry.for_each([&](const SymbolEntry &entry) {
+            symbols.push_back(entry.symbol);
+        });
         json response = { {"symbols", symbols}, {"count", symbols.size()} };
         res.set_content(response.dump(), "application/json");
     });
@@ -68,153 +218,213 @@ void setup_server(int port) {
     // Create Order (Main)
     svr.Post("/orders", [&](const httplib::Request &req, httplib::Response &res) {
         add_cors(res);
+        if (refuse_read_only(res)) return;
         try {
-            auto j = json::parse(req.body);
-            
-            // --- 1. Validation (Fast) ---
-            // (Validation code is unchanged)
-            std::vector<std::string> required = {"symbol", "order_type", "side", "quantity"};
-            for (const auto &field : required) {
-                if (!j.contains(field)) {
-                    res.status = 400;
-                    json err = {{"error", "missing field: " + field}};
-                    res.set_content(err.dump(), "application/json");
-                    return;
-                }
+            // --- 1. Parse and validate: the on-demand parser takes plain
+            // valid orders; the DOM path words rejections and handles the
+            // rest (escaped strings, nested members) ---
+            uint64_t parse_start = metrics::now_ns();
+            OrderFields fields;
+            std::string error;
+            if (!parse_order_fast(req.body, fields)) {
+                auto j = json::parse(req.body);
+                error = parse_order_fields(j, fields);
             }
-            std::string symbol = j["symbol"].get<std::string>();
-            std::string order_type = j["order_type"].get<std::string>();
-            std::string side = j["side"].get<std::string>();
-            if (order_type != "market" && order_type != "limit" && 
-                order_type != "ioc" && order_type != "fok") {
+            metrics::record(Stage::Parse, metrics::now_ns() - parse_start);
+            if (!error.empty()) {
                 res.status = 400;
-                json err = {{"error", "invalid order_type. Use: market, limit, ioc, fok"}};
+                json err = {{"error", error}};
                 res.set_content(err.dump(), "application/json");
                 return;
             }
-            if (side != "buy" && side != "sell") {
-                res.status = 400;
-                json err = {{"error", "invalid side. Use: buy or sell"}};
+            // --- End Validation ---
+
+            // --- 2. Log, match and publish (shared with the binary gateway) ---
+            // Interning the symbol is lock-free after the first order for it
+            SymbolEntry &entry = g_symbol_registry.get_or_create(fields.symbol);
+            OrderEntryResult &result = entry_result();
+            submit_order(entry, make_order(fields, entry.id), result);
+            const Order &o = result.order;
+            const std::vector<Trade> &trades = result.trades;
+            uint64_t wal_seq = result.wal_seq;
+
+            // --- 3. Optional durable ack: wait for the group commit (and quorum) covering us ---
+            if (!wait_committed(wal_seq)) {
+                res.status = 503;
+                json err = {{"error", "order accepted but WAL sync or replication failed"}, {"order_id", format_order_id(o.order_id)}};
                 res.set_content(err.dump(), "application/json");
                 return;
             }
-            double quantity_d = j["quantity"].get<double>();
-            if (quantity_d <= 0.0) {
+
+            // --- 4. Build Response (Fast) ---
+            // Trades are rendered straight into the body, keys in the order
+            // a json DOM would have sorted them
+            JsonWriter &resp = response_writer();
+            resp.begin_object();
+            write_order_result(resp, o, trades);
+            resp.end_object();
+
+            res.status = 200;
+            res.set_content(resp.str(), "application/json");
+
+        } catch (const json::parse_error &e) {
+            res.status = 400;
+            json err = {{"error", "invalid json: " + std::string(e.what())}};
+            res.set_content(err.dump(), "application/json");
+        } catch (const std::exception &e) {
+            res.status = 500;
+            json err = {{"error", "internal error: " + std::string(e.what())}};
+            res.set_content(err.dump(), "application/json");
+        }
+    });
+    
+    // --- Batch entry: [{"op": "new" | "cancel" | "replace", ...}, ...] ---
+    // Ops are grouped by symbol and each group is applied under one book lock
+    // (in request order within the symbol), logged in one append per group.
+    // Items fail independently; the response lists one result per op.
+    svr.Post("/orders/batch", [&](const httplib::Request &req, httplib::Response &res) {
+        add_cors(res);
+        if (refuse_read_only(res)) return;
+        try {
+            auto body = json::parse(req.body);
+            const json &items = body.is_object() && body.contains("operations") ? body["operations"] : body;
+            if (!items.is_array() || items.empty() || items.size() > MAX_BATCH_OPS) {
                 res.status = 400;
-                json err = {{"error", "quantity must be positive"}};
+                json err = {{"error", "expected a non-empty array of at most " + std::to_string(MAX_BATCH_OPS) +
+                                      " operations"}};
                 res.set_content(err.dump(), "application/json");
                 return;
             }
-            long long quantity = static_cast<long long>(quantity_d * 1000000.0);
-            long long price = 0;
-            if (order_type == "limit" || order_type == "ioc" || order_type == "fok") {
-                if (!j.contains("price")) {
-                    res.status = 400;
-                    json err = {{"error", order_type + " order requires price"}};
-                    res.set_content(err.dump(), "application/json");
-                    return;
-                }
-                double price_d = j["price"].get<double>();
-                if (price_d <= 0.0) {
-                    res.status = 400;
-                    json err = {{"error", "price must be positive"}};
-                    res.set_content(err.dump(), "application/json");
-                    return;
+
+            // --- 1. Validate every item; rejected ones never reach a book ---
+            std::vector<std::string> errors(items.size());
+            std::unordered_map<uint32_t, std::vector<BookOp>> groups;
+            std::vector<std::pair<size_t, uint64_t>> lookups; // cancel/replace: (item, order id)
+            std::vector<OrderFields> fields(items.size());
+            for (size_t i = 0; i < items.size(); ++i) {
+                const json &item = items[i];
+                try {
+                    std::string op = item.is_object() ? item.value("op", std::string()) : std::string();
+                    if (op != "new" && op != "cancel" && op != "replace") {
+                        errors[i] = "op must be new, cancel or replace";
+                        continue;
+                    }
+                    if (op != "cancel") {
+                        errors[i] = parse_order_fields(item, fields[i]);
+                        if (!errors[i].empty()) continue;
+                    }
+                    if (op == "new") {
+                        BookOp book_op;
+                        book_op.index = i;
+                        book_op.order = make_order(fields[i], g_symbol_registry.get_or_create(fields[i].symbol).id);
+                        groups[book_op.order.symbol_id].push_back(std::move(book_op));
+                        continue;
+                    }
+                    uint64_t order_id = 0;
+                    if (!item.contains("order_id") || !item["order_id"].is_string() ||
+                        !parse_order_id(item["order_id"].get<std::string>(), order_id)) {
+                        errors[i] = "order_id required";
+                        continue;
+                    }
+                    lookups.push_back({i, order_id});
+                } catch (const json::exception &e) {
+                    errors[i] = std::string("invalid field: ") + e.what();
                 }
-                price = static_cast<long long>(price_d * 100.0);
             }
-            // --- End Validation ---
 
-            // --- 2. Order Creation & WAL (Fast) ---
-            Order o;
-            o.order_id = "ORD-" + std::to_string(g_total_orders.fetch_add(1) + 1);
-            o.symbol = symbol;
-            o.order_type = order_type;
-            o.side = side;
-            o.quantity = quantity;
-            o.price = price;
-            o.timestamp = std::chrono::system_clock::now();
-            json order_json = {
-                {"order_id", o.order_id}, {"symbol", o.symbol}, {"order_type", o.order_type},
-                {"side", o.side}, {"quantity", o.quantity}, {"price", o.price},
-                {"timestamp", to_iso8601(o.timestamp)}
-            };
-            global_wal.append_order(order_json); // Async push
-
-            
-            // --- 3. Fine-Grained Lock to get Book (Fast) ---
-            OrderBook* book_ptr;
-            {
-                std::lock_guard<std::mutex> lk(g_global_mutex);
-                book_ptr = &g_order_books.try_emplace(symbol, symbol).first->second;
-                g_order_id_to_symbol[o.order_id] = symbol;
+            // --- 2. Resolve resting ids: the symbol is encoded in the id ---
+            for (auto &[i, order_id] : lookups) {
+                SymbolEntry *entry = order_symbol(order_id);
+                if (!entry) {
+                    errors[i] = "order not found or already filled/cancelled";
+                    continue;
+                }
+                BookOp book_op;
+                book_op.index = i;
+                book_op.order_id = order_id;
+                if (items[i]["op"] == "cancel") {
+                    book_op.type = BookOp::Type::Cancel;
+                } else {
+                    if (entry->symbol != fields[i].symbol) {
+                        errors[i] = "replace must keep the order's symbol";
+                        continue;
+                    }
+                    book_op.type = BookOp::Type::Replace;
+                    book_op.order = unnumbered_order(fields[i], entry->id);
+                }
+                groups[entry->id].push_back(std::move(book_op));
             }
-
-            // --- 4. Matching (Fast, uses internal lock) ---
-            auto trades = book_ptr->add_order(o);
-            g_total_trades.fetch_add(trades.size());
-
-            // --- 5. Post-Trade Logic & Response Prep (Fast) ---
-            long long filled_qty = 0;
-            json trades_array = json::array();
-            for (auto &t : trades) {
-                filled_qty += t.quantity;
-                json trade_json = {
-                    {"trade_id", t.trade_id}, {"symbol", t.symbol}, {"price", t.price},
-                    {"quantity", t.quantity}, {"aggressor_side", t.aggressor_side},
-                    {"maker_order_id", t.maker_order_id}, {"taker_order_id", t.taker_order_id},
-                    {"maker_fee", t.maker_fee}, {"taker_fee", t.taker_fee},
-                    {"timestamp", t.timestamp_iso}
-                };
-                global_wal.append_trade(trade_json); // Async push
-                trades_array.push_back(trade_json);
+            // Request order within each symbol (cancel/replace lookups came last)
+            for (auto &[symbol_id, ops] : groups) {
+                std::stable_sort(ops.begin(), ops.end(),
+                                 [](const BookOp &a, const BookOp &b) { return a.index < b.index; });
             }
-            
-            // --- 6. ASYNCHRONOUS BROADCAST (THE REAL FIX) ---
-            if (g_ws_server && g_ws_server->is_running() && (trades.size() > 0)) {
-                // Get data (fast, uses book's internal lock)
-                auto bids_copy = book_ptr->top_bids(10);
-                auto asks_copy = book_ptr->top_asks(10);
-                
-                // --- REMOVED: std::thread().detach() ---
-                
-                // --- ADDED: Fast, non-blocking queue push ---
-                for (const auto& tj : trades_array) {
-                    g_broadcast_queue.push_trade(tj);
+
+            // --- 3. Match: one book lock (or one shard round trip) per symbol ---
+            std::vector<const BookOp *> results(items.size(), nullptr);
+            uint64_t wal_seq = 0;
+            for (auto &[symbol_id, ops] : groups) {
+                SymbolEntry *entry = g_symbol_registry.at(symbol_id);
+                std::vector<TriggeredStop> fired;
+                uint64_t group_seq = 0;
+                if (g_matching_engine) {
+                    EngineRequest ereq;
+                    ereq.type = EngineRequest::Type::Batch;
+                    ereq.symbol_id = symbol_id;
+                    ereq.ops = &ops;
+                    g_matching_engine->execute(ereq);
+                    fired = std::move(ereq.fired);
+                    group_seq = ereq.wal_seq;
+                } else {
+                    group_seq = apply_batch_group(*entry, ops, fired);
                 }
-                g_broadcast_queue.push_book_update(symbol, bids_copy, asks_copy);
-                // --- HTTP thread is now free ---
+                wal_seq = std::max(wal_seq, group_seq);
+
+                std::vector<Trade> group_trades;
+                for (const BookOp &op : ops) {
+                    results[op.index] = &op;
+                    group_trades.insert(group_trades.end(), op.trades.begin(), op.trades.end());
+                }
+                publish_market_data(*entry, group_trades, fired);
             }
 
-            // --- 7. Build Response (Fast) ---
-            // (This code is unchanged)
-            long long remaining_qty = std::max(0LL, quantity - filled_qty);
-            std::string status;
-            if (order_type == "fok") {
-                status = (filled_qty == quantity) ? "filled" : "cancelled";
-            } else if (order_type == "ioc") {
-                status = (filled_qty == 0 && remaining_qty > 0) ? "cancelled" : (remaining_qty == 0 ? "filled" : "partially_filled");
-            } else if (order_type == "market") {
-                if (filled_qty == 0) status = "cancelled";
-                else if (remaining_qty > 0) status = "partially_filled";
-                else status = "filled";
-            } else { // limit
-                if (remaining_qty == 0) status = "filled";
-                else if (filled_qty > 0) status = "partially_filled";
-                else status = "open";
+            if (!wait_committed(wal_seq)) {
+                res.status = 503;
+                json err = {{"error", "batch applied but WAL sync or replication failed"}};
+                res.set_content(err.dump(), "application/json");
+                return;
             }
-            json resp;
-            resp["order"] = {
-                {"order_id", o.order_id}, {"symbol", o.symbol}, {"order_type", o.order_type},
-                {"side", o.side}, {"quantity", o.quantity}, {"price", o.price},
-                {"timestamp", to_iso8601(o.timestamp)}, {"status", status}
-            };
-            resp["trades"] = trades_array;
-            resp["filled_quantity"] = filled_qty;
-            resp["remaining_quantity"] = remaining_qty;
 
-            res.status = 200;
-            res.set_content(resp.dump(), "application/json");
+            // --- 4. Per-item results, in request order ---
+            JsonWriter &resp = response_writer();
+            size_t ok = 0;
+            resp.begin_object().key("results").begin_array();
+            for (size_t i = 0; i < items.size(); ++i) {
+                const BookOp *op = results[i];
+                resp.begin_object();
+                if (!op) {
+                    resp.field("error", errors[i]).field("index", i).field("status", "rejected");
+                } else if (op->type == BookOp::Type::Cancel) {
+                    resp.field("cancelled", op->cancelled).field("index", i);
+                    resp.field("order_id", format_order_id(op->order_id));
+                    resp.field("status", op->cancelled ? "ok" : "not_found");
+                    ok += op->cancelled;
+                } else if (op->type == BookOp::Type::Replace && !op->cancelled) {
+                    resp.field("index", i).field("order_id", format_order_id(op->order_id));
+                    resp.field("status", "not_found");
+                } else {
+                    write_order_result(resp, op->order, op->trades);
+                    resp.field("index", i);
+                    if (op->type == BookOp::Type::Replace) {
+                        resp.field("replaced_order_id", format_order_id(op->order_id));
+                    }
+                    resp.field("status", "ok");
+                    ++ok;
+                }
+                resp.end_object();
+            }
+            resp.end_array().field("succeeded", ok).field("total", items.size()).end_object();
+            res.set_content(resp.str(), "application/json");
 
         } catch (const json::parse_error &e) {
             res.status = 400;
@@ -226,10 +436,11 @@ void setup_server(int port) {
             res.set_content(err.dump(), "application/json");
         }
     });
-    
+
     // Create Stop Order
     svr.Post("/orders/stop", [&](const httplib::Request &req, httplib::Response &res) {
         add_cors(res);
+        if (refuse_read_only(res)) return;
         try {
             auto j = json::parse(req.body);
             std::vector<std::string> required = {"symbol", "stop_type", "side", "quantity", "trigger_price"};
@@ -243,9 +454,16 @@ void setup_server(int port) {
             }
             std::string symbol = j["symbol"].get<std::string>();
             std::string stop_type_str = j["stop_type"].get<std::string>();
-            std::string side = j["side"].get<std::string>();
+            Side side;
+            if (!parse_side(j["side"].get<std::string>(), side)) {
+                res.status = 400;
+                json err = {{"error", "invalid side. Use: buy or sell"}};
+                res.set_content(err.dump(), "application/json");
+                return;
+            }
+            SymbolEntry &entry = g_symbol_registry.get_or_create(symbol);
             StopOrder so;
-            so.symbol = symbol;
+            so.symbol_id = entry.id;
             so.side = side;
             so.quantity = static_cast<long long>(j["quantity"].get<double>() * 1000000.0);
             so.trigger_price = static_cast<long long>(j["trigger_price"].get<double>() * 100.0);
@@ -259,29 +477,42 @@ void setup_server(int port) {
                 }
                 so.limit_price = static_cast<long long>(j["limit_price"].get<double>() * 100.0);
                 so.stop_type = StopOrderType::STOP_LIMIT;
+            } else if (stop_type_str == "trailing_stop") {
+                // trigger_price is the first trigger; it then trails the best price by trail_amount
+                so.trail_amount = j.contains("trail_amount")
+                                      ? static_cast<long long>(j["trail_amount"].get<double>() * 100.0) : 0;
+                if (so.trail_amount <= 0) {
+                    res.status = 400;
+                    json err = {{"error", "trailing_stop requires a positive trail_amount"}};
+                    res.set_content(err.dump(), "application/json");
+                    return;
+                }
+                so.stop_type = StopOrderType::TRAILING_STOP;
             } else {
                 so.stop_type = StopOrderType::STOP_LOSS;
             }
-            so.order_id = "STO-" + std::to_string(g_total_orders.fetch_add(1) + 1);
+            so.order_id = next_order_id(entry.id);
             so.created_at = std::chrono::system_clock::now();
-            so.best_price = (side == "buy") ? 999999999999LL : 0;
-            json order_json = {
-                {"order_id", so.order_id}, {"symbol", so.symbol}, {"order_type", "stop"},
-                {"stop_type", stop_type_str}, {"side", so.side}, {"quantity", so.quantity},
-                {"trigger_price", so.trigger_price}, {"limit_price", so.limit_price},
-                {"timestamp", to_iso8601(so.created_at)}
-            };
-            global_wal.append_order(order_json);
-            StopOrderManager* manager_ptr;
-            {
-                std::lock_guard<std::mutex> lk(g_global_mutex);
-                manager_ptr = &g_stop_order_managers.try_emplace(symbol, symbol).first->second;
-                g_order_id_to_symbol[so.order_id] = symbol;
+            json order_json = stop_order_to_json(so);
+            uint64_t wal_seq = global_wal.append_stop_order(so);
+            if (g_matching_engine) {
+                EngineRequest req;
+                req.type = EngineRequest::Type::StopOrder;
+                req.symbol_id = entry.id;
+                req.stop = so;
+                g_matching_engine->execute(req);
+            } else {
+                entry.stops.add_stop_order(so);
+            }
+            if (!wait_committed(wal_seq)) {
+                res.status = 503;
+                json err = {{"error", "stop order accepted but WAL sync or replication failed"}, {"stop_order_id", order_json["order_id"]}};
+                res.set_content(err.dump(), "application/json");
+                return;
             }
-            manager_ptr->add_stop_order(so);
             json resp = {
                 {"status", "accepted"},
-                {"stop_order_id", so.order_id},
+                {"stop_order_id", order_json["order_id"]},
                 {"order", order_json}
             };
             res.set_content(resp.dump(), "application/json");
@@ -296,65 +527,30 @@ void setup_server(int port) {
     // --- Cancel order ---
     svr.Delete(R"(/orders/(.+))", [&](const httplib::Request &req, httplib::Response &res) {
         add_cors(res);
+        if (refuse_read_only(res)) return;
         try {
-            std::string order_id = req.matches[1].str();
-            std::string symbol;
-            {
-                std::lock_guard<std::mutex> lk(g_global_mutex);
-                auto it = g_order_id_to_symbol.find(order_id);
-                if (it == g_order_id_to_symbol.end()) {
-                    res.status = 404;
-                    json err = {{"error", "order not found or already executed"}};
-                    res.set_content(err.dump(), "application/json");
-                    return;
-                }
-                symbol = it->second;
-            }
-
-            bool cancelled_book = false;
-            bool cancelled_stop = false;
-            OrderBook* book_ptr = nullptr;
-            {
-                std::lock_guard<std::mutex> lk(g_global_mutex);
-                if (g_order_books.count(symbol)) {
-                    book_ptr = &g_order_books.at(symbol);
-                    cancelled_book = book_ptr->cancel_order(order_id);
-                }
-                if (g_stop_order_managers.count(symbol)) {
-                    cancelled_stop = g_stop_order_managers.at(symbol).cancel_stop_order(order_id);
-                }
+            std::string order_id_str = req.matches[1].str();
+            uint64_t order_id = 0;
+            if (!parse_order_id(order_id_str, order_id)) {
+                res.status = 404;
+                json err = {{"error", "order not found or already executed"}};
+                res.set_content(err.dump(), "application/json");
+                return;
             }
-
-            bool cancelled = cancelled_book || cancelled_stop;
-
-            if (cancelled) {
-                global_wal.append_cancel(order_id, "user_request");
-                {
-                    std::lock_guard<std::mutex> lk(g_global_mutex);
-                    g_order_id_to_symbol.erase(order_id);
-                }
-                
-                // --- 3. ASYNCHRONOUS BROADCAST (THE REAL FIX) ---
-                if (g_ws_server && g_ws_server->is_running() && book_ptr) {
-                    auto bids_copy = book_ptr->top_bids(10);
-                    auto asks_copy = book_ptr->top_asks(10);
-                    
-                    // --- REMOVED: std::thread().detach() ---
-
-                    // --- ADDED: Fast, non-blocking queue push ---
-                    g_broadcast_queue.push_book_update(symbol, bids_copy, asks_copy);
-                }
-                
-                json resp = {
-                    {"cancelled", true}, {"order_id", order_id}, {"symbol", symbol},
-                    {"timestamp", to_iso8601(std::chrono::system_clock::now())}
-                };
-                res.set_content(resp.dump(), "application/json");
-            } else {
+            SymbolEntry *entry = nullptr;
+            uint64_t wal_seq = 0;
+            if (!submit_cancel(order_id, entry, wal_seq)) {
                 res.status = 404;
-                json err = {{"error", "order not found or already filled/cancelled"}};
+                json err = {{"error", entry ? "order not found or already filled/cancelled"
+                                            : "order not found or already executed"}};
                 res.set_content(err.dump(), "application/json");
+                return;
             }
+            json resp = {
+                {"cancelled", true}, {"order_id", order_id_str}, {"symbol", entry->symbol},
+                {"timestamp", to_iso8601(std::chrono::system_clock::now())}
+            };
+            res.set_content(resp.dump(), "application/json");
             
         } catch (const std::exception &e) {
             res.status = 500;
@@ -363,24 +559,96 @@ void setup_server(int port) {
         }
     });
 
+    // --- Amend order: {"quantity", "price"}, either may be omitted ---
+    // One WAL record; a size-down at the same price keeps queue priority
+    svr.Patch(R"(/orders/(.+))", [&](const httplib::Request &req, httplib::Response &res) {
+        add_cors(res);
+        if (refuse_read_only(res)) return;
+        auto fail = [&](int status, const std::string &message) {
+            res.status = status;
+            json err = {{"error", message}};
+            res.set_content(err.dump(), "application/json");
+        };
+        try {
+            uint64_t order_id = 0;
+            if (!parse_order_id(req.matches[1].str(), order_id)) {
+                fail(404, "order not found or not resting");
+                return;
+            }
+            auto j = json::parse(req.body);
+            if (!j.is_object() || (!j.contains("quantity") && !j.contains("price"))) {
+                fail(400, "quantity or price required");
+                return;
+            }
+            long long quantity = 0, price = 0;
+            if (j.contains("quantity")) {
+                std::string error = json_to_fixed(j["quantity"], "quantity", QUANTITY_DECIMALS, quantity);
+                if (error.empty() && quantity <= 0) error = "quantity must be positive";
+                if (!error.empty()) {
+                    fail(400, error);
+                    return;
+                }
+            }
+            if (j.contains("price")) {
+                std::string error = json_to_fixed(j["price"], "price", PRICE_DECIMALS, price);
+                if (error.empty() && price <= 0) error = "price must be positive";
+                if (!error.empty()) {
+                    fail(400, error);
+                    return;
+                }
+            }
+
+            SymbolEntry *entry = nullptr;
+            AmendResult result;
+            uint64_t wal_seq = 0;
+            switch (submit_amend(order_id, quantity, price, entry, result, wal_seq)) {
+            case OrderReject::None: break;
+            case OrderReject::PriceOutsideBand:
+                fail(400, "price outside configured band for " + entry->symbol);
+                return;
+            case OrderReject::UnknownOrder:
+                fail(404, "order not found or not resting");
+                return;
+            default:
+                fail(400, "invalid amend");
+                return;
+            }
+            if (!wait_committed(wal_seq)) {
+                res.status = 503;
+                json err = {{"error", "amend applied but WAL sync or replication failed"}, {"order_id", format_order_id(order_id)}};
+                res.set_content(err.dump(), "application/json");
+                return;
+            }
+
+            JsonWriter &resp = response_writer();
+            resp.begin_object().field("amended", true);
+            write_order_result(resp, result.order, result.trades);
+            resp.field("requeued", result.requeued).end_object();
+            res.set_content(resp.str(), "application/json");
+
+        } catch (const json::parse_error &e) {
+            fail(400, "invalid json: " + std::string(e.what()));
+        } catch (const std::exception &e) {
+            fail(500, "internal error: " + std::string(e.what()));
+        }
+    });
+
     // --- View orderbook ---
     svr.Get(R"(/orderbook/(.+))", [&](const httplib::Request &req, httplib::Response &res) {
         add_cors(res);
         std::string symbol = req.matches[1].str();
         int depth = 10;
-        OrderBook* book_ptr;
-        {
-            std::lock_guard<std::mutex> lk(g_global_mutex);
-            if (!g_order_books.count(symbol)) {
-                res.status = 404;
-                json err = {{"error", "symbol not found"}};
-                res.set_content(err.dump(), "application/json");
-                return;
-            }
-            book_ptr = &g_order_books.at(symbol);
+        SymbolEntry *entry = g_symbol_registry.find(symbol);
+        if (!entry) {
+            res.status = 404;
+            json err = {{"error", "symbol not found"}};
+            res.set_content(err.dump(), "application/json");
+            return;
         }
-        auto bids = book_ptr->top_bids(depth);
-        auto asks = book_ptr->top_asks(depth);
+        OrderBook* book_ptr = &entry->book;
+        auto snapshot = book_ptr->depth_snapshot(depth);
+        const auto &bids = snapshot->bids;
+        const auto &asks = snapshot->asks;
         auto mk_levels = [](const std::vector<std::pair<long long,long long>> &lvls) {
             json arr = json::array();
             for (auto &p : lvls) {
@@ -404,26 +672,38 @@ void setup_server(int port) {
     svr.Get(R"(/trades/(.+))", [&](const httplib::Request &req, httplib::Response &res) {
         add_cors(res);
         std::string symbol = req.matches[1].str();
-        int limit = 50;
-        auto entries = global_wal.replay();
+        size_t limit = 50;
+        uint64_t since_trade_id = 0;
+        if (req.has_param("limit")) {
+            uint64_t value = 0;
+            if (!parse_count(req.get_param_value("limit"), value) || value == 0) {
+                res.status = 400;
+                res.set_content(json{{"error", "limit must be a positive integer"}}.dump(), "application/json");
+                return;
+            }
+            limit = static_cast<size_t>(std::min<uint64_t>(value, OrderBook::RECENT_TRADES));
+        }
+        if (req.has_param("since_trade_id") &&
+            !parse_trade_id(req.get_param_value("since_trade_id"), since_trade_id)) {
+            res.status = 400;
+            res.set_content(json{{"error", "invalid since_trade_id"}}.dump(), "application/json");
+            return;
+        }
+
+        // Served from the book's recent-trades ring: O(limit), no WAL access
         json trades_array = json::array();
-        int count = 0;
-        for (auto it = entries.rbegin(); it != entries.rend() && count < limit; ++it) {
-            if (it->contains("type") && (*it)["type"] == "trade") {
-                auto payload = (*it)["payload"];
-                if (payload["symbol"] == symbol) {
-                    json trade_display = payload;
-                    trade_display["price"] = payload["price"].get<long long>() / 100.0;
-                    trade_display["quantity"] = payload["quantity"].get<long long>() / 1000000.0;
-                    trades_array.push_back(trade_display);
-                    count++;
-                }
+        if (SymbolEntry *entry = g_symbol_registry.find(symbol)) {
+            for (const auto &t : entry->book.recent_trades(limit, since_trade_id)) {
+                json trade_display = trade_to_json(t);
+                trade_display["price"] = t.price / 100.0;
+                trade_display["quantity"] = t.quantity / 1000000.0;
+                trades_array.push_back(trade_display);
             }
         }
         json response = {
             {"symbol", symbol},
             {"trades", trades_array},
-            {"count", count}
+            {"count", trades_array.size()}
         };
         res.set_content(response.dump(), "application/json");
     });
@@ -436,22 +716,105 @@ void setup_server(int port) {
         stats["total_trades"] = g_total_trades.load();
         stats["ws_clients"] = g_ws_server ? g_ws_server->client_count() : 0;
         json symbols = json::object();
-        {
-            std::lock_guard<std::mutex> lk(g_global_mutex);
-            stats["symbols_count"] = g_order_books.size();
-            for (auto &[symbol, book] : g_order_books) {
-                auto bids = book.top_bids(1);
-                auto asks = book.top_asks(1);
-                json entry;
-                entry["best_bid"] = bids.empty() ? json(nullptr) : json(bids[0].first / 100.0);
-                entry["best_ask"] = asks.empty() ? json(nullptr) : json(asks[0].first / 100.0);
-                symbols[symbol] = entry;
-            }
-        }
+        stats["symbols_count"] = g_symbol_registry.size();
+        g_symbol_registry.for_each([&](const SymbolEntry &sym) {
+            long long best_bid = 0, best_ask = 0;
+            bool has_bid = sym.book.best_bid(best_bid);
+            bool has_ask = sym.book.best_ask(best_ask);
+            json entry;
+            entry["best_bid"] = has_bid ? json(best_bid / 100.0) : json(nullptr);
+            entry["best_ask"] = has_ask ? json(best_ask / 100.0) : json(nullptr);
+            symbols[sym.symbol] = entry;
+        });
         stats["symbols"] = symbols;
+        if (g_replication_primary) {
+            stats["replication"] = {{"role", "primary"},
+                                    {"standbys", g_replication_primary->standby_count()},
+                                    {"last_seq", g_replication_primary->last_seq()},
+                                    {"min_acked_seq", g_replication_primary->min_acked_seq()}};
+        } else if (g_replication_standby) {
+            stats["replication"] = {{"role", g_replication_standby->promoted() ? "promoted" : "standby"},
+                                    {"connected", g_replication_standby->connected()},
+                                    {"applied_seq", g_replication_standby->applied_seq()}};
+        }
         res.set_content(stats.dump(), "application/json");
     });
 
+    // Failover: a standby stops following and starts taking writes
+    svr.Post("/replication/promote", [&](const httplib::Request&, httplib::Response& res) {
+        add_cors(res);
+        if (!g_replication_standby || !g_replication_standby->promote()) {
+            res.status = 409;
+            res.set_content(json({{"error", "not a standby, or already promoted"}}).dump(), "application/json");
+            return;
+        }
+        json resp = {{"promoted", true}, {"seq", g_replication_standby->applied_seq()}};
+        res.set_content(resp.dump(), "application/json");
+    });
+
+    // Prometheus text format: stage latency histograms, counters and queue depths
+    svr.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+        std::string out;
+        out.reserve(16384);
+        metrics::write_stage_histograms(out);
+        metrics::write_metric(out, "matching_engine_orders_total", "counter", "Orders accepted",
+                              g_total_orders.load());
+        metrics::write_metric(out, "matching_engine_trades_total", "counter", "Trades executed",
+                              g_total_trades.load());
+        metrics::write_metric(out, "matching_engine_symbols", "gauge", "Symbols with a book",
+                              g_symbol_registry.size());
+        metrics::write_metric(out, "matching_engine_wal_pending_writes", "gauge",
+                              "WAL records queued for the writer thread", global_wal.pending_writes());
+        metrics::write_metric(out, "matching_engine_wal_entries_total", "counter", "WAL records appended",
+                              global_wal.total_entries());
+        metrics::write_metric(out, "matching_engine_wal_durable_seq", "gauge",
+                              "Highest WAL sequence number known durable", global_wal.durable_seq());
+
+        BroadcastStats bq = g_broadcast_queue.stats();
+        metrics::write_metric(out, "matching_engine_broadcast_queue_depth", "gauge",
+                              "Market-data messages queued across broadcast shards", bq.queue_depth);
+        metrics::write_metric(out, "matching_engine_broadcast_queue_capacity", "gauge",
+                              "Broadcast ring capacity across shards", bq.queue_capacity);
+        metrics::write_metric(out, "matching_engine_broadcast_pushed_total", "counter",
+                              "Market-data messages queued", bq.pushed);
+        metrics::write_metric(out, "matching_engine_broadcast_dropped_total", "counter",
+                              "Market-data messages dropped on a full ring", bq.dropped);
+        metrics::write_metric(out, "matching_engine_broadcast_conflated_total", "counter",
+                              "Book updates superseded before they were sent", bq.conflated);
+
+        WebSocketStats ws = g_ws_server ? g_ws_server->stats() : WebSocketStats();
+        metrics::write_metric(out, "matching_engine_ws_clients", "gauge", "Connected WebSocket clients",
+                              g_ws_server ? g_ws_server->client_count() : 0);
+        metrics::write_metric(out, "matching_engine_ws_send_backlog_frames", "gauge",
+                              "Frames queued to WebSocket clients", ws.queued_frames);
+        metrics::write_metric(out, "matching_engine_ws_send_backlog_bytes", "gauge",
+                              "Bytes queued to WebSocket clients", ws.queued_bytes);
+        metrics::write_metric(out, "matching_engine_ws_send_backlog_max_client_bytes", "gauge",
+                              "Largest send backlog of a single WebSocket client", ws.max_client_queued_bytes);
+        metrics::write_metric(out, "matching_engine_ws_frames_dropped_total", "counter",
+                              "Frames evicted from full client queues", ws.frames_dropped);
+        metrics::write_metric(out, "matching_engine_ws_frames_conflated_total", "counter",
+                              "Queued book frames replaced by newer ones", ws.frames_conflated);
+        metrics::write_metric(out, "matching_engine_ws_slow_disconnects_total", "counter",
+                              "Clients disconnected for a full send queue", ws.slow_disconnects);
+        metrics::write_metric(out, "matching_engine_gateway_sessions", "gauge", "Binary order-entry sessions",
+                              g_order_gateway ? g_order_gateway->session_count() : 0);
+        if (g_replication_primary) {
+            metrics::write_metric(out, "matching_engine_replication_standbys", "gauge", "Connected standbys",
+                                  g_replication_primary->standby_count());
+            metrics::write_metric(out, "matching_engine_replication_min_acked_seq", "gauge",
+                                  "WAL sequence number durable on every connected standby",
+                                  g_replication_primary->min_acked_seq());
+        }
+        if (g_replication_standby) {
+            metrics::write_metric(out, "matching_engine_replication_applied_seq", "gauge",
+                                  "Last replicated WAL sequence number applied", g_replication_standby->applied_seq());
+            metrics::write_metric(out, "matching_engine_replication_connected", "gauge",
+                                  "1 while following the primary", g_replication_standby->connected() ? 1 : 0);
+        }
+        res.set_content(out, "text/plain; version=0.0.4");
+    });
+
     std::cout << "[HTTP] Server listening on port " << port << "\n";
     svr.listen("0.0.0.0", port);
 }
@@ -1,181 +1,241 @@
 #include "../include/stop_order_manager.h"
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 
-StopOrderManager::StopOrderManager(const std::string &symbol) : symbol_(symbol) {}
+StopOrderManager::StopOrderManager(uint32_t symbol_id) : symbol_id_(symbol_id) {}
 
-std::string StopOrderManager::generate_stop_order_id() {
-    auto id = stop_order_counter_.fetch_add(1);
-    std::ostringstream ss;
-    ss << "STOP-" << id;
-    return ss.str();
+uint64_t StopOrderManager::generate_stop_order_id() {
+    return stop_order_counter_.fetch_add(1);
 }
 
-std::string StopOrderManager::add_stop_order(const StopOrder &order) {
+uint64_t StopOrderManager::add_stop_order(const StopOrder &order) {
     std::lock_guard<std::mutex> lock(mu_);
     
     StopOrder stop = order;
-    if (stop.order_id.empty()) {
+    if (stop.order_id == 0) {
         stop.order_id = generate_stop_order_id();
     }
-    
-    // Initialize best price for trailing stops
-    if (stop.stop_type == StopOrderType::TRAILING_STOP) {
-        stop.best_price = stop.trigger_price;
-    }
-    
-    // Add to appropriate map
-    if (stop.side == "buy") {
-        buy_stops_.insert({stop.trigger_price, stop});
-    } else {
-        sell_stops_.insert({stop.trigger_price, stop});
-    }
-    
-    order_index_[stop.order_id] = stop.trigger_price;
-    
-    return stop.order_id;
+    uint64_t id = stop.order_id;
+    insert_locked(std::move(stop));
+    return id;
 }
 
 void StopOrderManager::add_stop_order_from_replay(const StopOrder &order) {
     std::lock_guard<std::mutex> lock(mu_);
-    
-    // Add to appropriate map
-    if (order.side == "buy") {
-        buy_stops_.insert({order.trigger_price, order});
-    } else {
-        sell_stops_.insert({order.trigger_price, order});
+    insert_locked(order);
+}
+
+void StopOrderManager::insert_locked(StopOrder stop) {
+    StopRef ref;
+    ref.side = stop.side;
+    bool is_buy = (stop.side == Side::Buy);
+    if (stop.stop_type == StopOrderType::TRAILING_STOP && stop.trail_amount > 0) {
+        // A new trailing stop starts one trail away from its trigger
+        if (stop.best_price == 0) {
+            stop.best_price = is_buy ? stop.trigger_price - stop.trail_amount
+                                     : stop.trigger_price + stop.trail_amount;
+        }
+        Buckets &buckets = (is_buy ? buy_trailing_ : sell_trailing_)[stop.trail_amount];
+        BucketPtr &bucket = buckets[stop.best_price];
+        if (!bucket) {
+            bucket = std::make_shared<TrailBucket>();
+            bucket->best = stop.best_price;
+        }
+        refresh_trailing(stop, bucket->best);
+        uint64_t id = stop.order_id;
+        bucket->stops.push_back(std::move(stop));
+        ref.kind = Kind::Trailing;
+        ref.bucket = bucket;
+        ref.trailing = std::prev(bucket->stops.end());
+        order_index_[id] = std::move(ref);
+        return;
     }
-    
-    // Add to index for cancellation
-    order_index_[order.order_id] = order.trigger_price;
+
+    uint64_t id = stop.order_id;
+    long long trigger = stop.trigger_price;
+    ref.fixed = (is_buy ? buy_stops_ : sell_stops_).emplace(trigger, std::move(stop));
+    order_index_[id] = std::move(ref);
+}
+
+StopOrderManager::BucketPtr StopOrderManager::root_of(BucketPtr &bucket) {
+    BucketPtr root = bucket;
+    while (root->merged_into) root = root->merged_into;
+    // Path compression: later lookups through this chain are O(1)
+    for (BucketPtr cur = bucket; cur != root;) {
+        BucketPtr next = cur->merged_into;
+        cur->merged_into = root;
+        cur = next;
+    }
+    bucket = root;
+    return root;
 }
 
-bool StopOrderManager::cancel_stop_order(const std::string &order_id) {
+void StopOrderManager::refresh_trailing(StopOrder &stop, long long best) {
+    stop.best_price = best;
+    stop.trigger_price = stop.side == Side::Buy ? best + stop.trail_amount : best - stop.trail_amount;
+}
+
+bool StopOrderManager::cancel_stop_order(uint64_t order_id) {
     std::lock_guard<std::mutex> lock(mu_);
     
     auto it = order_index_.find(order_id);
     if (it == order_index_.end()) return false;
-    
-    long long trigger_price = it->second;
-    
-    // Search in buy stops
-    auto range = buy_stops_.equal_range(trigger_price);
-    for (auto iter = range.first; iter != range.second; ++iter) {
-        if (iter->second.order_id == order_id) {
-            buy_stops_.erase(iter);
-            order_index_.erase(it);
-            return true;
+
+    StopRef &ref = it->second;
+    bool is_buy = (ref.side == Side::Buy);
+    if (ref.kind == Kind::Fixed) {
+        (is_buy ? buy_stops_ : sell_stops_).erase(ref.fixed);
+    } else {
+        BucketPtr root = root_of(ref.bucket);
+        long long trail = ref.trailing->trail_amount;
+        root->stops.erase(ref.trailing);
+        if (root->stops.empty()) {
+            auto &groups = is_buy ? buy_trailing_ : sell_trailing_;
+            auto group = groups.find(trail);
+            group->second.erase(root->best);
+            if (group->second.empty()) groups.erase(group);
         }
     }
-    
-    // Search in sell stops
-    range = sell_stops_.equal_range(trigger_price);
-    for (auto iter = range.first; iter != range.second; ++iter) {
-        if (iter->second.order_id == order_id) {
-            sell_stops_.erase(iter);
-            order_index_.erase(it);
-            return true;
+    order_index_.erase(it);
+    return true;
+}
+
+void StopOrderManager::update_trailing_stops(long long current_price) {
+    std::lock_guard<std::mutex> lock(mu_);
+    update_trailing_locked(current_price);
+}
+
+void StopOrderManager::update_trailing_locked(long long current_price) {
+    // Folds [first, last) into the bucket at current_price
+    auto merge = [&](Buckets &buckets, Buckets::iterator target, Buckets::iterator first, Buckets::iterator last) {
+        for (auto it = first; it != last; ++it) {
+            BucketPtr &from = it->second;
+            target->second->stops.splice(target->second->stops.end(), from->stops);
+            from->merged_into = target->second;
+        }
+        buckets.erase(first, last);
+    };
+    auto target_at = [&](Buckets &buckets) {
+        auto target = buckets.try_emplace(current_price).first;
+        if (!target->second) {
+            target->second = std::make_shared<TrailBucket>();
+            target->second->best = current_price;
         }
+        return target;
+    };
+
+    // Buys track the low: every bucket above the price moves down to it
+    for (auto &group : buy_trailing_) {
+        Buckets &buckets = group.second;
+        if (buckets.upper_bound(current_price) == buckets.end()) continue;
+        auto target = target_at(buckets);
+        merge(buckets, target, std::next(target), buckets.end());
     }
-    
-    return false;
+    // Sells track the high: every bucket below the price moves up to it
+    for (auto &group : sell_trailing_) {
+        Buckets &buckets = group.second;
+        if (buckets.empty() || buckets.begin()->first >= current_price) continue;
+        auto target = target_at(buckets);
+        merge(buckets, target, buckets.begin(), target);
+    }
+}
+
+Order StopOrderManager::to_order(const StopOrder &stop) const {
+    Order order;
+    order.order_id = stop.order_id;
+    order.symbol_id = stop.symbol_id;
+    order.side = stop.side;
+    order.quantity = stop.quantity;
+    order.timestamp = std::chrono::system_clock::now();
+
+    if (stop.stop_type == StopOrderType::STOP_LIMIT) {
+        order.order_type = OrderType::Limit;
+        order.price = stop.limit_price;
+    } else {
+        order.order_type = OrderType::Market;
+        order.price = 0;
+    }
+    return order;
 }
 
 std::vector<Order> StopOrderManager::check_triggers(long long last_trade_price) {
     std::lock_guard<std::mutex> lock(mu_);
     std::vector<Order> triggered_orders;
-    
-    // Check buy stops (trigger when price rises above trigger)
-    auto buy_it = buy_stops_.begin();
-    while (buy_it != buy_stops_.end()) {
-        if (last_trade_price >= buy_it->first) {
-            const StopOrder &stop = buy_it->second;
-            
-            Order order;
-            order.order_id = stop.order_id;
-            order.symbol = stop.symbol;
-            order.side = stop.side;
-            order.quantity = stop.quantity;
-            order.timestamp = std::chrono::system_clock::now();
-            
-            if (stop.stop_type == StopOrderType::STOP_LIMIT) {
-                order.order_type = "limit";
-                order.price = stop.limit_price;
-            } else {
-                order.order_type = "market";
-                order.price = 0;
-            }
-            
-            triggered_orders.push_back(order);
+    update_trailing_locked(last_trade_price);
+
+    // Check buy stops (trigger when price rises to the trigger)
+    while (!buy_stops_.empty() && buy_stops_.begin()->first <= last_trade_price) {
+        auto it = buy_stops_.begin();
+        triggered_orders.push_back(to_order(it->second));
+        order_index_.erase(it->second.order_id);
+        buy_stops_.erase(it);
+    }
+
+    // Check sell stops (trigger when price falls to the trigger)
+    while (!sell_stops_.empty() && std::prev(sell_stops_.end())->first >= last_trade_price) {
+        auto it = std::prev(sell_stops_.end());
+        triggered_orders.push_back(to_order(it->second));
+        order_index_.erase(it->second.order_id);
+        sell_stops_.erase(it);
+    }
+
+    // Trailing stops fire a whole bucket at a time
+    auto fire = [&](BucketPtr bucket) {
+        for (StopOrder &stop : bucket->stops) {
+            refresh_trailing(stop, bucket->best);
+            triggered_orders.push_back(to_order(stop));
             order_index_.erase(stop.order_id);
-            buy_it = buy_stops_.erase(buy_it);
-        } else {
-            break;  // Stops are sorted, no need to check further
         }
+    };
+    for (auto group = buy_trailing_.begin(); group != buy_trailing_.end();) {
+        Buckets &buckets = group->second;
+        while (!buckets.empty() && buckets.begin()->first + group->first <= last_trade_price) {
+            fire(buckets.begin()->second);
+            buckets.erase(buckets.begin());
+        }
+        group = buckets.empty() ? buy_trailing_.erase(group) : std::next(group);
     }
-    
-    // Check sell stops (trigger when price falls below trigger)
-    auto sell_it = sell_stops_.begin();
-    while (sell_it != sell_stops_.end()) {
-        if (last_trade_price <= sell_it->first) {
-            const StopOrder &stop = sell_it->second;
-            
-            Order order;
-            order.order_id = stop.order_id;
-            order.symbol = stop.symbol;
-            order.side = stop.side;
-            order.quantity = stop.quantity;
-            order.timestamp = std::chrono::system_clock::now();
-            
-            if (stop.stop_type == StopOrderType::STOP_LIMIT) {
-                order.order_type = "limit";
-                order.price = stop.limit_price;
-            } else {
-                order.order_type = "market";
-                order.price = 0;
-            }
-            
-            triggered_orders.push_back(order);
-            order_index_.erase(stop.order_id);
-            sell_it = sell_stops_.erase(sell_it);
-        } else {
-            break;
+    for (auto group = sell_trailing_.begin(); group != sell_trailing_.end();) {
+        Buckets &buckets = group->second;
+        while (!buckets.empty() && std::prev(buckets.end())->first - group->first >= last_trade_price) {
+            fire(std::prev(buckets.end())->second);
+            buckets.erase(std::prev(buckets.end()));
         }
+        group = buckets.empty() ? sell_trailing_.erase(group) : std::next(group);
     }
     
     return triggered_orders;
 }
 
-void StopOrderManager::update_trailing_stops(long long current_price) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
-    // Update buy trailing stops (track lowest price)
-    for (auto &pair : buy_stops_) {
-        StopOrder &stop = const_cast<StopOrder&>(pair.second);
-        if (stop.stop_type == StopOrderType::TRAILING_STOP) {
-            if (current_price < stop.best_price) {
-                stop.best_price = current_price;
-                // Adjust trigger price
-                stop.trigger_price = current_price + stop.trail_amount;
-            }
-        }
+void StopOrderManager::process_trades(OrderBook &book, const std::vector<Trade> &trades,
+                                      std::vector<TriggeredStop> &fired, TriggerHook on_trigger, bool in_batch) {
+    if (trades.empty() || size() == 0) return; // the usual case: nothing to trigger
+    std::vector<long long> prices;
+    for (const Trade &t : trades) {
+        if (prices.empty() || prices.back() != t.price) prices.push_back(t.price);
     }
-    
-    // Update sell trailing stops (track highest price)
-    for (auto &pair : sell_stops_) {
-        StopOrder &stop = const_cast<StopOrder&>(pair.second);
-        if (stop.stop_type == StopOrderType::TRAILING_STOP) {
-            if (current_price > stop.best_price) {
-                stop.best_price = current_price;
-                // Adjust trigger price
-                stop.trigger_price = current_price - stop.trail_amount;
+    // Every stop fires once, so the cascade ends
+    for (size_t i = 0; i < prices.size(); ++i) {
+        for (Order &order : check_triggers(prices[i])) {
+            TriggeredStop stop;
+            stop.order = std::move(order);
+            if (on_trigger) on_trigger(stop);
+            if (in_batch) {
+                book.add_order_in_batch(stop.order, stop.trades);
+            } else {
+                book.add_order(stop.order, stop.trades);
+            }
+            for (const Trade &t : stop.trades) {
+                if (prices.back() != t.price) prices.push_back(t.price);
             }
+            fired.push_back(std::move(stop));
         }
     }
 }
 
 std::vector<StopOrder> StopOrderManager::get_active_stops() const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mu_));
+    std::lock_guard<std::mutex> lock(mu_);
     std::vector<StopOrder> stops;
     
     for (const auto &pair : buy_stops_) {
@@ -184,6 +244,30 @@ std::vector<StopOrder> StopOrderManager::get_active_stops() const {
     for (const auto &pair : sell_stops_) {
         stops.push_back(pair.second);
     }
+    for (const auto *groups : {&buy_trailing_, &sell_trailing_}) {
+        for (const auto &group : *groups) {
+            for (const auto &bucket : group.second) {
+                for (StopOrder stop : bucket.second->stops) {
+                    refresh_trailing(stop, bucket.second->best);
+                    stops.push_back(std::move(stop));
+                }
+            }
+        }
+    }
     
     return stops;
-}
\ No newline at end of file
+}
+
+void StopOrderManager::clear() {
+    std::lock_guard<std::mutex> lock(mu_);
+    buy_stops_.clear();
+    sell_stops_.clear();
+    buy_trailing_.clear();
+    sell_trailing_.clear();
+    order_index_.clear();
+}
+
+size_t StopOrderManager::size() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return order_index_.size();
+}
@@ -0,0 +1,76 @@
+// ============================================================================
+// FILE: src/symbol_registry.cpp
+// ============================================================================
+#include "../include/symbol_registry.h"
+#include "../include/engine_config.h"
+#include <functional>
+#include <stdexcept>
+
+SymbolEntry::SymbolEntry(uint32_t id_, const std::string &symbol_)
+    : id(id_), symbol(symbol_), book(id_), stops(id_) {}
+
+SymbolEntry::SymbolEntry(uint32_t id_, const std::string &symbol_, const PriceBand &band)
+    : id(id_), symbol(symbol_), book(id_, band), stops(id_) {}
+
+SymbolRegistry::SymbolRegistry(size_t max_symbols) : max_symbols_(max_symbols) {
+    // Keep the table at most half full so probe chains stay short
+    size_t cap = 2;
+    while (cap < max_symbols * 2) cap <<= 1;
+    mask_ = cap - 1;
+    slots_.reset(new std::atomic<SymbolEntry*>[cap]);
+    for (size_t i = 0; i < cap; ++i) slots_[i].store(nullptr, std::memory_order_relaxed);
+    entries_.reset(new std::atomic<SymbolEntry*>[max_symbols]);
+    for (size_t i = 0; i < max_symbols; ++i) entries_[i].store(nullptr, std::memory_order_relaxed);
+}
+
+SymbolEntry *SymbolRegistry::probe(const std::string &symbol, size_t &slot) const {
+    slot = std::hash<std::string>{}(symbol) & mask_;
+    for (;;) {
+        SymbolEntry *entry = slots_[slot].load(std::memory_order_acquire);
+        if (!entry || entry->symbol == symbol) return entry;
+        slot = (slot + 1) & mask_;
+    }
+}
+
+SymbolEntry *SymbolRegistry::find(const std::string &symbol) const {
+    size_t slot;
+    return probe(symbol, slot);
+}
+
+SymbolEntry &SymbolRegistry::get_or_create(const std::string &symbol) {
+    size_t slot;
+    if (SymbolEntry *entry = probe(symbol, slot)) return *entry;
+
+    std::lock_guard<std::mutex> lk(create_mu_);
+    // Re-probe: another thread may have created it, and slot may have moved
+    if (SymbolEntry *entry = probe(symbol, slot)) return *entry;
+
+    size_t id = count_.load(std::memory_order_relaxed);
+    if (id >= max_symbols_) {
+        throw std::runtime_error("symbol registry full, cannot add " + symbol);
+    }
+    if (const PriceBand *band = g_engine_config.price_band(symbol)) {
+        owned_.push_back(std::make_unique<SymbolEntry>(static_cast<uint32_t>(id), symbol, *band));
+    } else {
+        owned_.push_back(std::make_unique<SymbolEntry>(static_cast<uint32_t>(id), symbol));
+    }
+    SymbolEntry *entry = owned_.back().get();
+    entries_[id].store(entry, std::memory_order_release);
+    count_.store(id + 1, std::memory_order_release);
+    // Logged before lookups can find it, so no record naming the symbol
+    // precedes its symbol record
+    if (create_hook_) create_hook_(*entry);
+    // Publishing into the table last makes the entry visible fully built
+    slots_[slot].store(entry, std::memory_order_release);
+    return *entry;
+}
+
+void SymbolRegistry::set_create_hook(CreateHook hook) {
+    std::lock_guard<std::mutex> lk(create_mu_);
+    create_hook_ = std::move(hook);
+}
+
+SymbolEntry *SymbolRegistry::at(uint32_t id) const {
+    if (id >= size()) return nullptr;
+    return entries_[id].load(std::memory_order_acquire);
+}
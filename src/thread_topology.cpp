@@ -0,0 +1,81 @@
+// ============================================================================
+// FILE: src/thread_topology.cpp
+// ============================================================================
+#include "../include/thread_topology.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+bool parse_cpu_list(const std::string &text, std::vector<int> &cpus) {
+    cpus.clear();
+    size_t pos = 0, n = text.size();
+    while (n > 0 && (text[n - 1] == '\n' || text[n - 1] == ' ')) --n;
+    if (n == 0) return true;
+    auto number = [&](int &out) {
+        size_t start = pos;
+        out = 0;
+        while (pos < n && text[pos] >= '0' && text[pos] <= '9' && out < 1000000) out = out * 10 + (text[pos++] - '0');
+        return pos > start;
+    };
+    for (;;) {
+        int first = 0, last = 0;
+        if (!number(first)) return false;
+        last = first;
+        if (pos < n && text[pos] == '-') {
+            ++pos;
+            if (!number(last) || last < first) return false;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+        if (pos == n) return true;
+        if (text[pos++] != ',') return false;
+    }
+}
+
+std::vector<int> numa_node_cpus(int node) {
+    std::vector<int> cpus;
+    if (node < 0) return cpus;
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string line;
+    if (!in || !std::getline(in, line) || !parse_cpu_list(line, cpus)) cpus.clear();
+    return cpus;
+}
+
+void place_current_thread(const ThreadGroupConfig &group, size_t index, const char *name) {
+#ifdef __linux__
+    std::string thread_name = std::string(name) + "-" + std::to_string(index);
+    thread_name.resize(std::min<size_t>(thread_name.size(), 15)); // kernel limit
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+
+    if (!group.places_threads()) return;
+    std::vector<int> cpus;
+    if (!group.cpus.empty()) {
+        cpus.push_back(group.cpus[index % group.cpus.size()]);
+    } else {
+        cpus = numa_node_cpus(group.numa_node);
+        if (cpus.empty()) {
+            std::cerr << "[Threads] " << name << ": no CPUs found for NUMA node " << group.numa_node << std::endl;
+            return;
+        }
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        std::cerr << "[Threads] Failed to pin " << thread_name << " to "
+                  << (group.cpus.empty() ? "NUMA node " + std::to_string(group.numa_node)
+                                         : "CPU " + std::to_string(cpus[0]))
+                  << std::endl;
+    }
+#else
+    (void)group;
+    (void)index;
+    (void)name;
+#endif
+}
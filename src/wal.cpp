@@ -1,18 +1,300 @@
 // FILE: src/wal.cpp
 #include "../include/wal.h"
+#include "../include/byte_codec.h"
+#include "../include/crc32.h"
+#include "../include/global_state.h"
+#include "../include/iso_time.h"
+#include "../include/metrics.h"
+#include "../include/order_json.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <stdexcept>
 #include <filesystem>
-#include <queue> // Include queue
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-WAL::WAL(const std::string &path)
-    : path_(path), running_(false) {
-    
+// --- Thin fd wrappers (fdatasync is what makes group commit worth it) ---
+static int os_open_append(const std::string &path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+static bool os_write_all(int fd, const std::string &buf) {
+    const char *p = buf.data();
+    size_t left = buf.size();
+    while (left > 0) {
+#ifdef _WIN32
+        int n = _write(fd, p, static_cast<unsigned int>(left));
+#else
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        if (n <= 0) return false;
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool os_sync(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#elif defined(__APPLE__)
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+static void os_close(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+static int64_t now_ns() { return to_ns(std::chrono::system_clock::now()); }
+
+static const std::string &symbol_of(uint32_t symbol_id) {
+    static const std::string unknown;
+    SymbolEntry *entry = g_symbol_registry.at(symbol_id);
+    return entry ? entry->symbol : unknown;
+}
+
+// Bumped when a record's payload layout changes; decoders accept every
+// version. Trade v2 stores timestamp_ns as an i64 instead of an ISO string.
+static uint8_t record_version(WalRecordType type) {
+    return type == WalRecordType::Trade ? 2 : 1;
+}
+
+void WAL::encode_binary(const WalRecord &rec, std::string &out) {
+    size_t start = out.size();
+    out.resize(start + WAL_HEADER_SIZE);
+    switch (rec.type) {
+    case WalRecordType::Order: {
+        const Order &o = rec.order;
+        put_u64(out, o.order_id);
+        put_u8(out, static_cast<uint8_t>(o.order_type));
+        put_u8(out, static_cast<uint8_t>(o.side));
+        put_i64(out, o.quantity);
+        put_i64(out, o.price);
+        put_i64(out, to_ns(o.timestamp));
+        put_str(out, symbol_of(o.symbol_id));
+        break;
+    }
+    case WalRecordType::StopOrder: {
+        const StopOrder &so = rec.stop;
+        put_u64(out, so.order_id);
+        put_u8(out, static_cast<uint8_t>(so.stop_type));
+        put_u8(out, static_cast<uint8_t>(so.side));
+        put_i64(out, so.quantity);
+        put_i64(out, so.trigger_price);
+        put_i64(out, so.limit_price);
+        put_i64(out, so.trail_amount);
+        put_i64(out, to_ns(so.created_at));
+        put_str(out, symbol_of(so.symbol_id));
+        put_str(out, so.user_id);
+        break;
+    }
+    case WalRecordType::Trade: {
+        const Trade &t = rec.trade;
+        put_u64(out, t.trade_id);
+        put_u64(out, t.maker_order_id);
+        put_u64(out, t.taker_order_id);
+        put_u8(out, static_cast<uint8_t>(t.aggressor_side));
+        put_i64(out, t.price);
+        put_i64(out, t.quantity);
+        put_i64(out, t.maker_fee);
+        put_i64(out, t.taker_fee);
+        put_str(out, symbol_of(t.symbol_id));
+        put_i64(out, t.timestamp_ns);
+        break;
+    }
+    case WalRecordType::Cancel:
+        put_u64(out, rec.order_id);
+        put_str(out, rec.text);
+        break;
+    case WalRecordType::Amend:
+        put_u64(out, rec.order.order_id);
+        put_i64(out, rec.order.quantity);
+        put_i64(out, rec.previous_quantity);
+        put_i64(out, rec.order.price);
+        put_i64(out, to_ns(rec.order.timestamp));
+        break;
+    case WalRecordType::Symbol:
+        put_u32(out, rec.symbol_id);
+        put_str(out, rec.symbol);
+        break;
+    case WalRecordType::Json:
+        out += rec.text;
+        break;
+    }
+
+    std::string header;
+    header.reserve(WAL_HEADER_SIZE);
+    put_u32(header, static_cast<uint32_t>(out.size() - start - WAL_HEADER_SIZE));
+    put_u8(header, static_cast<uint8_t>(rec.type));
+    put_u8(header, record_version(rec.type));
+    put_u16(header, 0);
+    put_u64(header, rec.seq);
+    put_i64(header, rec.timestamp_ns);
+    uint32_t crc = crc32(header.data(), header.size());
+    crc = crc32(out.data() + start + WAL_HEADER_SIZE, out.size() - start - WAL_HEADER_SIZE, crc);
+    put_u32(header, crc);
+    std::memcpy(&out[start], header.data(), WAL_HEADER_SIZE);
+}
+
+// Decodes one payload; the symbol name is left in rec.symbol (see resolve_symbol)
+static bool decode_payload(WalRecordType type, uint8_t version, ByteReader r, WalRecord &rec) {
+    rec.type = type;
+    switch (type) {
+    case WalRecordType::Order: {
+        Order &o = rec.order;
+        o.order_id = r.u64();
+        o.order_type = static_cast<OrderType>(r.u8());
+        o.side = static_cast<Side>(r.u8());
+        o.quantity = r.i64();
+        o.price = r.i64();
+        o.timestamp = from_ns(r.i64());
+        rec.symbol = r.str();
+        if (!r.ok) return false;
+        return true;
+    }
+    case WalRecordType::StopOrder: {
+        StopOrder &so = rec.stop;
+        so.order_id = r.u64();
+        so.stop_type = static_cast<StopOrderType>(r.u8());
+        so.side = static_cast<Side>(r.u8());
+        so.quantity = r.i64();
+        so.trigger_price = r.i64();
+        so.limit_price = r.i64();
+        so.trail_amount = r.i64();
+        so.created_at = from_ns(r.i64());
+        rec.symbol = r.str();
+        so.user_id = r.str();
+        if (!r.ok) return false;
+        return true;
+    }
+    case WalRecordType::Trade: {
+        Trade &t = rec.trade;
+        t.trade_id = r.u64();
+        t.maker_order_id = r.u64();
+        t.taker_order_id = r.u64();
+        t.aggressor_side = static_cast<Side>(r.u8());
+        t.price = r.i64();
+        t.quantity = r.i64();
+        t.maker_fee = r.i64();
+        t.taker_fee = r.i64();
+        rec.symbol = r.str();
+        if (version >= 2) {
+            t.timestamp_ns = r.i64();
+        } else if (!parse_iso8601(r.str(), t.timestamp_ns)) {
+            t.timestamp_ns = 0;
+        }
+        if (!r.ok) return false;
+        return true;
+    }
+    case WalRecordType::Cancel:
+        rec.order_id = r.u64();
+        rec.text = r.str();
+        return r.ok;
+    case WalRecordType::Amend:
+        rec.order.order_id = r.u64();
+        rec.order.quantity = r.i64();
+        rec.previous_quantity = r.i64();
+        rec.order.price = r.i64();
+        rec.order.timestamp = from_ns(r.i64());
+        return r.ok;
+    case WalRecordType::Symbol:
+        rec.symbol_id = r.u32();
+        rec.symbol = r.str();
+        return r.ok && !rec.symbol.empty();
+    case WalRecordType::Json:
+        rec.text.assign(reinterpret_cast<const char *>(r.p), r.end - r.p);
+        return true;
+    }
+    return false;
+}
+
+nlohmann::json WAL::record_to_json(const WalRecord &rec) {
+    const char *type = "json";
+    nlohmann::json payload;
+    switch (rec.type) {
+    case WalRecordType::Order: type = "order"; payload = order_to_json(rec.order); break;
+    case WalRecordType::StopOrder: type = "stop_order"; payload = stop_order_to_json(rec.stop); break;
+    case WalRecordType::Trade: type = "trade"; payload = trade_to_json(rec.trade); break;
+    case WalRecordType::Cancel:
+        type = "cancel";
+        payload = {{"order_id", format_order_id(rec.order_id)}, {"reason", rec.text}};
+        break;
+    case WalRecordType::Amend:
+        type = "amend";
+        payload = {{"order_id", format_order_id(rec.order.order_id)}, {"quantity", rec.order.quantity},
+                   {"previous_quantity", rec.previous_quantity}, {"price", rec.order.price},
+                   {"timestamp_ns", to_ns(rec.order.timestamp)}};
+        break;
+    case WalRecordType::Symbol:
+        type = "symbol";
+        payload = {{"symbol", rec.symbol}, {"id", rec.symbol_id}};
+        break;
+    case WalRecordType::Json:
+        return nlohmann::json::parse(rec.text);
+    }
+    return {
+        {"type", type},
+        {"seq", rec.seq},
+        {"timestamp", rec.timestamp_ns},
+        {"payload", payload}
+    };
+}
+
+WAL::WAL(const std::string &path) {
+    config_.path = path;
+    open_file();
+    start_writer();
+}
+
+WAL::WAL(const WalConfig &config) : config_(config) {
+    open_file();
+    start_writer();
+}
+
+WAL::~WAL() {
+    stop(); // Ensure thread is stopped and queue is flushed
+    close_file();
+    std::cout << "[WAL] Closed. Total entries: " << total_entries_.load() << std::endl;
+}
+
+void WAL::configure(const WalConfig &config) {
+    stop();
+    close_file();
+    config_ = config;
+    io_error_ = false;
+    open_file();
+    start_writer();
+    std::cout << "[WAL] " << (config_.format == WalFormat::Binary ? "Binary" : "JSON")
+              << " log at " << config_.path << std::endl;
+}
+
+void WAL::open_file() {
     // Ensure directory exists
-    std::filesystem::path file_path(path_);
-    std::filesystem::path dir_path = file_path.parent_path();
-    
+    std::filesystem::path dir_path = std::filesystem::path(config_.path).parent_path();
     if (!dir_path.empty() && !std::filesystem::exists(dir_path)) {
         try {
             std::filesystem::create_directories(dir_path);
@@ -21,26 +303,44 @@ WAL::WAL(const std::string &path)
             std::cerr << "[WAL] Failed to create directory: " << e.what() << std::endl;
         }
     }
-    
-    // Open in append mode
-    ofs_.open(path_, std::ios::out | std::ios::app);
-    if (!ofs_.is_open()) {
-        std::cerr << "[WAL] Failed to open WAL file: " << path_ << std::endl;
-        throw std::runtime_error("Cannot open WAL file: " + path_);
+
+    // Refuse to append one format to a file written in the other
+    bool has_data = false;
+    bool is_binary = false;
+    {
+        std::ifstream ifs(config_.path, std::ios::binary);
+        char magic[sizeof(WAL_FILE_MAGIC)] = {};
+        if (ifs.read(magic, sizeof(magic)) || ifs.gcount() > 0) has_data = true;
+        is_binary = ifs.gcount() == sizeof(magic) && std::memcmp(magic, WAL_FILE_MAGIC, sizeof(magic)) == 0;
+    }
+    bool want_binary = config_.format == WalFormat::Binary;
+    if (has_data && is_binary != want_binary) {
+        throw std::runtime_error("WAL file " + config_.path + " is not in the configured " +
+                                 (want_binary ? "binary" : "json") + " format");
+    }
+
+    fd_ = os_open_append(config_.path);
+    if (fd_ < 0) {
+        std::cerr << "[WAL] Failed to open WAL file: " << config_.path << std::endl;
+        throw std::runtime_error("Cannot open WAL file: " + config_.path);
+    }
+    if (want_binary && !has_data) {
+        os_write_all(fd_, std::string(WAL_FILE_MAGIC, sizeof(WAL_FILE_MAGIC)));
     }
-    
-    // Start the writer thread
-    running_ = true;
-    writer_thread_ = std::thread(&WAL::writer_thread_loop, this);
-    std::cout << "[WAL] Initialized. Asynchronous writer thread started." << std::endl;
 }
 
-WAL::~WAL() {
-    stop(); // Ensure thread is stopped and queue is flushed
-    if (ofs_.is_open()) {
-        ofs_.close();
+void WAL::close_file() {
+    std::lock_guard<std::mutex> lk(io_mu_);
+    if (fd_ >= 0) {
+        os_close(fd_);
+        fd_ = -1;
     }
-    std::cout << "[WAL] Closed. Total entries: " << total_entries_.load() << std::endl;
+}
+
+void WAL::start_writer() {
+    last_sync_ = std::chrono::steady_clock::now();
+    running_ = true;
+    writer_thread_ = std::thread(&WAL::writer_thread_loop, this);
 }
 
 void WAL::stop() {
@@ -50,74 +350,270 @@ void WAL::stop() {
         if (writer_thread_.joinable()) {
             writer_thread_.join(); // Wait for it to finish
         }
+        durable_cv_.notify_all(); // Release anyone still waiting on a sync
         std::cout << "[WAL] Writer thread stopped." << std::endl;
     }
 }
 
-void WAL::append_json(const nlohmann::json &j) {
-    if (!running_.load()) return; // Don't accept new entries if stopping
+uint64_t WAL::enqueue(WalRecord rec) {
+    if (!running_.load()) return 0; // Don't accept new entries if stopping
+    metrics::StageTimer timer(Stage::WalEnqueue);
+    rec.timestamp_ns = now_ns();
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        seq = rec.seq = ++next_seq_;
+        queue_.push_back(std::move(rec));
+    }
+    total_entries_.fetch_add(1, std::memory_order_relaxed);
+    cv_.notify_one();
+    return seq;
+}
+
+uint64_t WAL::append_json(const nlohmann::json &j) {
+    WalRecord rec;
+    rec.type = WalRecordType::Json;
+    rec.text = j.dump();
+    return enqueue(std::move(rec));
+}
+
+uint64_t WAL::append_order(const Order &o) {
+    WalRecord rec;
+    rec.type = WalRecordType::Order;
+    rec.order = o;
+    return enqueue(std::move(rec));
+}
+
+uint64_t WAL::append_trade(const Trade &t) {
+    WalRecord rec;
+    rec.type = WalRecordType::Trade;
+    rec.trade = t;
+    return enqueue(std::move(rec));
+}
+
+uint64_t WAL::append_stop_order(const StopOrder &so) {
+    WalRecord rec;
+    rec.type = WalRecordType::StopOrder;
+    rec.stop = so;
+    return enqueue(std::move(rec));
+}
+
+uint64_t WAL::append_cancel(uint64_t order_id, const std::string &reason) {
+    WalRecord rec;
+    rec.type = WalRecordType::Cancel;
+    rec.order_id = order_id;
+    rec.text = reason;
+    return enqueue(std::move(rec));
+}
+
+uint64_t WAL::append_amend(const Order &amended, long long previous_quantity) {
+    WalRecord rec;
+    rec.type = WalRecordType::Amend;
+    rec.order = amended;
+    rec.previous_quantity = previous_quantity;
+    return enqueue(std::move(rec));
+}
 
-    // Serialize outside the lock (fast)
-    std::string line = j.dump();
+uint64_t WAL::append_symbol(uint32_t symbol_id, const std::string &symbol) {
+    WalRecord rec;
+    rec.type = WalRecordType::Symbol;
+    rec.symbol_id = symbol_id;
+    rec.symbol = symbol;
+    return enqueue(std::move(rec));
+}
 
+uint64_t WAL::append_batch(std::vector<WalRecord> &records) {
+    if (!running_.load() || records.empty()) return 0;
+    metrics::StageTimer timer(Stage::WalEnqueue);
+    int64_t ts = now_ns();
+    uint64_t seq;
     {
-        // Lock, push to queue (very fast)
         std::lock_guard<std::mutex> lk(mu_);
-        queue_.push(std::move(line));
+        for (WalRecord &rec : records) {
+            rec.timestamp_ns = ts;
+            rec.seq = ++next_seq_;
+            queue_.push_back(std::move(rec));
+        }
+        seq = next_seq_;
     }
+    total_entries_.fetch_add(records.size(), std::memory_order_relaxed);
+    records.clear();
+    cv_.notify_one();
+    return seq;
+}
 
-    // Increment total and signal writer thread
-    total_entries_.fetch_add(1, std::memory_order_relaxed);
+uint64_t WAL::append_replicated(std::vector<WalRecord> &records) {
+    if (!running_.load() || records.empty()) return 0;
+    metrics::StageTimer timer(Stage::WalEnqueue);
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (records[i].seq != next_seq_ + 1 + i) return 0;
+        }
+        for (WalRecord &rec : records) queue_.push_back(std::move(rec));
+        seq = next_seq_ += records.size();
+    }
+    total_entries_.fetch_add(records.size(), std::memory_order_relaxed);
+    records.clear();
     cv_.notify_one();
+    return seq;
+}
+
+void WAL::set_batch_tap(BatchTap tap) {
+    std::lock_guard<std::mutex> lk(io_mu_);
+    tap_ = std::move(tap);
 }
 
 void WAL::writer_thread_loop() {
-    std::queue<std::string> local_queue;
+    place_current_thread(config_.threads, 0, "wal");
+    std::vector<WalRecord> batch;
+    const bool group = config_.sync == WalSync::Group;
+    const auto interval = std::chrono::microseconds(config_.sync_interval_us);
 
-    while (running_.load()) {
+    for (;;) {
         {
             std::unique_lock<std::mutex> lk(mu_);
-            // Wait until queue has data OR we are stopping
-            cv_.wait(lk, [&]{ return !queue_.empty() || !running_.load(); });
+            auto ready = [&]{ return !queue_.empty() || !running_.load(); };
+            if (config_.threads.busy_poll) {
+                // Poll with the lock dropped between looks; appenders'
+                // notify_one then finds no sleeper to wake
+                while (!ready() && !(group && unsynced_records_ > 0 &&
+                                     std::chrono::steady_clock::now() >= last_sync_ + interval)) {
+                    lk.unlock();
+                    std::this_thread::yield();
+                    lk.lock();
+                }
+                if (!ready()) {
+                    lk.unlock();
+                    sync_pending();
+                    continue;
+                }
+            } else if (group && unsynced_records_ > 0) {
+                // Idle with unsynced records: sync once the interval runs out
+                if (!cv_.wait_until(lk, last_sync_ + interval, ready)) {
+                    lk.unlock();
+                    sync_pending();
+                    continue;
+                }
+            } else {
+                cv_.wait(lk, ready);
+            }
 
             // If we are stopping and the queue is empty, we can exit
             if (!running_.load() && queue_.empty()) {
                 break;
             }
-
-            // Atomically swap the global queue with our empty local one
-            std::swap(local_queue, queue_);
+            std::swap(batch, queue_);
         } // Lock is released here
 
-        // Now, write all entries from the local queue (no lock held)
-        while (!local_queue.empty()) {
-            ofs_ << local_queue.front() << '\n';
-            local_queue.pop();
+        write_batch(batch);
+        batch.clear();
+    }
+
+    // Nothing can be appended any more; make what we wrote durable
+    sync_pending();
+}
+
+void WAL::write_batch(std::vector<WalRecord> &batch) {
+    if (batch.empty()) return;
+    std::lock_guard<std::mutex> lk(io_mu_);
+    if (io_error_.load()) return; // dropped: see wait_durable
+    uint64_t write_start = metrics::now_ns();
+    write_buf_.clear();
+    for (const auto &rec : batch) {
+        if (config_.format == WalFormat::Binary) {
+            encode_binary(rec, write_buf_);
+        } else if (rec.type == WalRecordType::Json) {
+            write_buf_ += rec.text;
+            write_buf_ += '\n';
+        } else {
+            write_buf_ += record_to_json(rec).dump();
+            write_buf_ += '\n';
         }
+    }
 
-        // Flush the entire batch to disk
-        if (ofs_.is_open()) {
-            ofs_.flush();
+    // One write per batch; the queue swap is what groups concurrent appends
+    bool written = fd_ >= 0;
+    long long fault = fail_next_write_.exchange(-1);
+    if (written && fault >= 0) {
+        os_write_all(fd_, write_buf_.substr(0, std::min(write_buf_.size(), static_cast<size_t>(fault))));
+        written = false;
+    } else if (written) {
+        written = os_write_all(fd_, write_buf_);
+    }
+    if (!written) {
+        std::cerr << "[WAL] Write failed for " << batch.size() << " entries; no further records are written"
+                  << std::endl;
+        io_error_ = true;
+        durable_cv_.notify_all();
+        return;
+    }
+    written_seq_ = batch.back().seq;
+    metrics::record(Stage::WalWrite, metrics::now_ns() - write_start);
+    if (tap_) {
+        if (config_.format != WalFormat::Binary) {
+            tap_buf_.clear();
+            for (const auto &rec : batch) encode_binary(rec, tap_buf_);
         }
+        tap_(batch, config_.format == WalFormat::Binary ? write_buf_ : tap_buf_);
     }
 
-    // --- Shutdown sequence ---
-    // We've exited the loop, but there might be stragglers
-    // that arrived between running_=false and the loop check.
-    std::cout << "[WAL] Writer thread shutting down. Draining final queue..." << std::endl;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        std::swap(local_queue, queue_); // Get any final items
+    switch (config_.sync) {
+    case WalSync::None:
+        publish_durable(written_seq_);
+        break;
+    case WalSync::Batch:
+        unsynced_records_ += batch.size();
+        sync_locked();
+        break;
+    case WalSync::Group:
+        unsynced_records_ += batch.size();
+        if ((config_.sync_every_records > 0 && unsynced_records_ >= config_.sync_every_records) ||
+            std::chrono::steady_clock::now() - last_sync_ >= std::chrono::microseconds(config_.sync_interval_us)) {
+            sync_locked();
+        }
+        break;
     }
-    
-    while (!local_queue.empty()) {
-        ofs_ << local_queue.front() << '\n';
-        local_queue.pop();
+}
+
+void WAL::sync_pending() {
+    std::lock_guard<std::mutex> lk(io_mu_);
+    sync_locked();
+}
+
+void WAL::sync_locked() {
+    last_sync_ = std::chrono::steady_clock::now();
+    // A later fdatasync can succeed without the failed pages ever reaching disk
+    if (unsynced_records_ == 0 || fd_ < 0 || io_error_.load()) return;
+    uint64_t sync_start = metrics::now_ns();
+    bool synced = os_sync(fd_);
+    metrics::record(Stage::WalSync, metrics::now_ns() - sync_start);
+    if (!synced) {
+        std::cerr << "[WAL] fdatasync failed; no further records are written" << std::endl;
+        io_error_ = true;
+        durable_cv_.notify_all();
+        return;
     }
-    if (ofs_.is_open()) {
-        ofs_.flush(); // Final flush
+    unsynced_records_ = 0;
+    publish_durable(written_seq_);
+}
+
+void WAL::publish_durable(uint64_t seq) {
+    {
+        std::lock_guard<std::mutex> lk(durable_mu_);
+        durable_seq_.store(seq, std::memory_order_release);
     }
-    std::cout << "[WAL] Writer thread shutdown complete." << std::endl;
+    durable_cv_.notify_all();
+}
+
+bool WAL::wait_durable(uint64_t seq) {
+    if (seq == 0) return !io_error_.load();
+    std::unique_lock<std::mutex> lk(durable_mu_);
+    durable_cv_.wait(lk, [&]{
+        return durable_seq_.load(std::memory_order_acquire) >= seq || io_error_.load() || !running_.load();
+    });
+    return durable_seq_.load(std::memory_order_acquire) >= seq && !io_error_.load();
 }
 
 size_t WAL::pending_writes() {
@@ -125,112 +621,409 @@ size_t WAL::pending_writes() {
     return queue_.size();
 }
 
-void WAL::append_order(const nlohmann::json &order_json) {
-    nlohmann::json j = {
-        {"type", "order"},
-        {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()},
-        {"payload", order_json}
-    };
-    append_json(j);
+void WAL::flush() {
+    uint64_t target;
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        target = next_seq_;
+    }
+    wait_durable(target);
 }
 
-void WAL::append_trade(const nlohmann::json &trade_json) {
-    nlohmann::json j = {
-        {"type", "trade"},
-        {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()},
-        {"payload", trade_json}
-    };
-    append_json(j);
+// JSON log line -> typed record; the symbol is left in rec.symbol like the binary decoder
+static bool json_to_record(const nlohmann::json &j, WalRecord &rec) {
+    std::string type = j.value("type", std::string());
+    const nlohmann::json &payload = j.contains("payload") ? j["payload"] : j;
+    // Older WALs logged stop orders as "order" records with order_type "stop"
+    if (type == "order" && payload.value("order_type", std::string()) == "stop") type = "stop_order";
+    if (j.contains("seq") && j["seq"].is_number_unsigned()) rec.seq = j["seq"].get<uint64_t>();
+    if (j.contains("timestamp") && j["timestamp"].is_number()) rec.timestamp_ns = j["timestamp"].get<int64_t>();
+    if (type == "order") {
+        rec.type = WalRecordType::Order;
+        rec.order = order_from_json(payload, rec.symbol);
+    } else if (type == "stop_order") {
+        rec.type = WalRecordType::StopOrder;
+        rec.stop = stop_order_from_json(payload, rec.symbol);
+    } else if (type == "trade") {
+        rec.type = WalRecordType::Trade;
+        rec.trade = trade_from_json(payload, rec.symbol);
+    } else if (type == "cancel") {
+        rec.type = WalRecordType::Cancel;
+        if (!parse_order_id(payload.at("order_id").get<std::string>(), rec.order_id)) return false;
+        rec.text = payload.value("reason", std::string());
+    } else if (type == "amend") {
+        rec.type = WalRecordType::Amend;
+        if (!parse_order_id(payload.at("order_id").get<std::string>(), rec.order.order_id)) return false;
+        rec.order.quantity = payload.at("quantity").get<long long>();
+        rec.previous_quantity = payload.at("previous_quantity").get<long long>();
+        rec.order.price = payload.at("price").get<long long>();
+        rec.order.timestamp = from_ns(payload.at("timestamp_ns").get<int64_t>());
+    } else if (type == "symbol") {
+        rec.type = WalRecordType::Symbol;
+        rec.symbol = payload.at("symbol").get<std::string>();
+        rec.symbol_id = payload.at("id").get<uint32_t>();
+    } else {
+        rec.type = WalRecordType::Json;
+        rec.text = j.dump();
+    }
+    return true;
 }
 
-void WAL::append_cancel(const std::string &order_id, const std::string &reason) {
-    nlohmann::json j = {
-        {"type", "cancel"},
-        {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()},
-        {"payload", {
-            {"order_id", order_id},
-            {"reason", reason}
-        }}
-    };
-    append_json(j);
+// Interns the decoded symbol name; called on the applying thread, in log order
+static void resolve_symbol(WalRecord &rec) {
+    if (rec.symbol.empty()) return;
+    uint32_t id = g_symbol_registry.get_or_create(rec.symbol).id;
+    switch (rec.type) {
+    case WalRecordType::Order: rec.order.symbol_id = id; break;
+    case WalRecordType::StopOrder: rec.stop.symbol_id = id; break;
+    case WalRecordType::Trade: rec.trade.symbol_id = id; break;
+    default: break;
+    }
+}
+
+// One binary record at rec_base (header + payload_len bytes): header fields,
+// CRC check and payload; symbols are left for resolve_symbol
+static bool decode_record(const unsigned char *rec_base, uint32_t payload_len, WalRecord &rec) {
+    ByteReader h{rec_base + 4, rec_base + WAL_HEADER_SIZE};
+    uint8_t type = h.u8();
+    uint8_t version = h.u8();
+    h.u16(); // reserved
+    rec.seq = h.u64();
+    rec.timestamp_ns = h.i64();
+    uint32_t crc = h.u32();
+    uint32_t actual = crc32(rec_base, WAL_HEADER_SIZE - 4);
+    actual = crc32(rec_base + WAL_HEADER_SIZE, payload_len, actual);
+    ByteReader r{rec_base + WAL_HEADER_SIZE, rec_base + WAL_HEADER_SIZE + payload_len};
+    return actual == crc && decode_payload(static_cast<WalRecordType>(type), version, r, rec);
 }
 
-void WAL::flush_internal() {
-    // This function must be called with the mutex already locked
-    if (ofs_.is_open()) {
-        ofs_.flush();
+bool WAL::decode_binary(const char *data, size_t len, std::vector<WalRecord> &out) {
+    const unsigned char *base = reinterpret_cast<const unsigned char *>(data);
+    size_t pos = 0;
+    while (pos < len) {
+        if (len - pos < WAL_HEADER_SIZE) return false;
+        ByteReader h{base + pos, base + pos + 4};
+        uint32_t payload_len = h.u32();
+        if (len - pos - WAL_HEADER_SIZE < payload_len) return false;
+        WalRecord rec;
+        if (!decode_record(base + pos, payload_len, rec)) return false;
+        resolve_symbol(rec);
+        out.push_back(std::move(rec));
+        pos += WAL_HEADER_SIZE + payload_len;
     }
+    return true;
 }
 
-void WAL::flush() {
-    // Public flush just flushes the OS buffer
-    std::lock_guard<std::mutex> lk(mu_);
-    flush_internal();
+namespace {
+// Read-only view of the log: an mmap where available, chunked reads otherwise.
+// view() returns bytes [offset, offset+len) valid until the next call.
+class WalFileView {
+public:
+    explicit WalFileView(const std::string &path) {
+#ifndef _WIN32
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) return;
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) return;
+        size_ = static_cast<size_t>(st.st_size);
+        open_ = true;
+        if (size_ == 0) return;
+        void *m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (m != MAP_FAILED) {
+            map_ = static_cast<const char *>(m);
+            ::madvise(m, size_, MADV_SEQUENTIAL);
+            return;
+        }
+#endif
+        ifs_.open(path, std::ios::binary);
+        if (!ifs_.is_open()) return;
+        ifs_.seekg(0, std::ios::end);
+        size_ = static_cast<size_t>(ifs_.tellg());
+        open_ = true;
+    }
+
+    ~WalFileView() {
+#ifndef _WIN32
+        if (map_) ::munmap(const_cast<char *>(map_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    bool is_open() const { return open_; }
+    size_t size() const { return size_; }
+
+    const char *view(size_t offset, size_t len) {
+        if (map_) return map_ + offset;
+        buf_.resize(len);
+        ifs_.clear();
+        ifs_.seekg(static_cast<std::streamoff>(offset));
+        ifs_.read(&buf_[0], static_cast<std::streamsize>(len));
+        return buf_.data();
+    }
+
+    // Drops pages of an applied prefix so RSS stays around one window
+    void release(size_t offset, size_t len) {
+#ifndef _WIN32
+        if (!map_) return;
+        long page = ::sysconf(_SC_PAGESIZE);
+        size_t begin = offset / page * page;
+        size_t end = (offset + len) / page * page;
+        if (end > begin) ::madvise(const_cast<char *>(map_) + begin, end - begin, MADV_DONTNEED);
+#else
+        (void)offset; (void)len;
+#endif
+    }
+
+private:
+    bool open_ = false;
+    size_t size_ = 0;
+    const char *map_ = nullptr;
+#ifndef _WIN32
+    int fd_ = -1;
+#endif
+    std::ifstream ifs_;
+    std::string buf_;
+};
+
+struct ParsedSlice {
+    std::vector<WalRecord> records;
+    size_t first_bad = SIZE_MAX; // binary: index of the first corrupt record
+    uint64_t errors = 0;
+};
 }
 
-std::vector<nlohmann::json> WAL::replay() {
-    std::vector<nlohmann::json> entries;
-    std::cout << "[WAL] Replaying from: " << path_ << std::endl;
-    
-    std::ifstream ifs(path_);
-    if (!ifs.is_open()) {
-        std::cerr << "[WAL] Cannot open file for replay: " << path_ << std::endl;
-        return entries;
-    }
-    
-    std::string line;
-    size_t line_num = 0;
-    size_t errors = 0;
-    
-    while (std::getline(ifs, line)) {
-        line_num++;
-        if (line.empty()) continue;
-        try {
-            nlohmann::json j = nlohmann::json::parse(line);
-            entries.push_back(j);
-        } catch (const std::exception &e) {
-            std::cerr << "[WAL] Parse error at line " << line_num 
-                      << ": " << e.what() << std::endl;
-            errors++;
+// Runs f(i) for i in [0, n) on up to n threads (the caller takes slice 0)
+template <class F>
+static void parallel_for(size_t n, F &&f) {
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < n; ++i) workers.emplace_back([&f, i] { f(i); });
+    if (n > 0) f(0);
+    for (auto &w : workers) w.join();
+}
+
+WalReplayStats WAL::replay_file(const std::string &path, const ApplyFn &apply,
+                                size_t threads, size_t window_bytes) {
+    WalReplayStats stats;
+    auto started = std::chrono::steady_clock::now();
+    std::cout << "[WAL] Replaying from: " << path << std::endl;
+
+    WalFileView file(path);
+    if (!file.is_open()) {
+        std::cerr << "[WAL] Cannot open file for replay: " << path << std::endl;
+        return stats;
+    }
+    if (threads == 0) threads = std::min<size_t>(8, std::max(1u, std::thread::hardware_concurrency()));
+    if (window_bytes < 4096) window_bytes = 4096;
+
+    const size_t size = file.size();
+    bool binary = false;
+    size_t pos = 0;
+    if (size >= sizeof(WAL_FILE_MAGIC)) {
+        binary = std::memcmp(file.view(0, sizeof(WAL_FILE_MAGIC)), WAL_FILE_MAGIC, sizeof(WAL_FILE_MAGIC)) == 0;
+        if (binary) pos = sizeof(WAL_FILE_MAGIC);
+    }
+
+    std::vector<ParsedSlice> slices(threads);
+    size_t window = window_bytes;
+    bool stop = false;
+    while (pos < size && !stop) {
+        size_t len = std::min(window, size - pos);
+        bool at_eof = pos + len == size;
+        const char *data = file.view(pos, len);
+        size_t consumed = 0;
+        for (auto &slice : slices) {
+            slice.records.clear();
+            slice.first_bad = SIZE_MAX;
+            slice.errors = 0;
+        }
+
+        if (binary) {
+            // Sequential header walk to find record boundaries, then CRC
+            // checks and decoding in parallel
+            std::vector<std::pair<size_t, uint32_t>> spans;
+            const unsigned char *base = reinterpret_cast<const unsigned char *>(data);
+            while (len - consumed >= WAL_HEADER_SIZE) {
+                ByteReader h{base + consumed, base + consumed + 4};
+                uint32_t payload_len = h.u32();
+                if (len - consumed - WAL_HEADER_SIZE < payload_len) break;
+                spans.emplace_back(consumed, payload_len);
+                consumed += WAL_HEADER_SIZE + payload_len;
+            }
+            size_t per = (spans.size() + threads - 1) / threads;
+            parallel_for(threads, [&](size_t t) {
+                ParsedSlice &slice = slices[t];
+                size_t begin = std::min(spans.size(), t * per);
+                size_t end = std::min(spans.size(), begin + per);
+                for (size_t i = begin; i < end; ++i) {
+                    WalRecord rec;
+                    if (!decode_record(base + spans[i].first, spans[i].second, rec)) {
+                        slice.first_bad = slice.records.size();
+                        return;
+                    }
+                    slice.records.push_back(std::move(rec));
+                }
+            });
+        } else {
+            // Split at newlines; a partial last line waits for the next window
+            size_t end = len;
+            if (!at_eof) {
+                while (end > 0 && data[end - 1] != '\n') --end;
+            }
+            consumed = end;
+            std::vector<size_t> cuts(threads + 1, end);
+            cuts[0] = 0;
+            for (size_t t = 1; t < threads; ++t) {
+                size_t c = std::max(cuts[t - 1], end * t / threads);
+                while (c < end && c > 0 && data[c - 1] != '\n') ++c;
+                cuts[t] = c;
+            }
+            parallel_for(threads, [&](size_t t) {
+                ParsedSlice &slice = slices[t];
+                size_t p = cuts[t];
+                while (p < cuts[t + 1]) {
+                    const char *nl = static_cast<const char *>(std::memchr(data + p, '\n', cuts[t + 1] - p));
+                    size_t line_end = nl ? static_cast<size_t>(nl - data) : cuts[t + 1];
+                    if (line_end > p) {
+                        WalRecord rec;
+                        try {
+                            auto j = nlohmann::json::parse(data + p, data + line_end);
+                            if (json_to_record(j, rec)) slice.records.push_back(std::move(rec));
+                            else slice.errors++;
+                        } catch (const std::exception &) {
+                            slice.errors++;
+                        }
+                    }
+                    p = line_end + 1;
+                }
+            });
         }
+
+        if (consumed == 0) {
+            if (at_eof) break;  // torn tail: nothing complete left
+            window *= 2;        // a single record larger than the window
+            continue;
+        }
+
+        // Apply in log order; a corrupt binary record ends the replay
+        for (auto &slice : slices) {
+            for (size_t i = 0; i < slice.records.size(); ++i) {
+                WalRecord &rec = slice.records[i];
+                resolve_symbol(rec);
+                if (rec.seq > stats.last_seq) stats.last_seq = rec.seq;
+                try {
+                    apply(rec);
+                } catch (const std::exception &e) {
+                    std::cerr << "[WAL] Apply error for seq " << rec.seq << ": " << e.what() << std::endl;
+                    stats.errors++;
+                }
+                stats.records++;
+            }
+            stats.errors += slice.errors;
+            if (slice.first_bad != SIZE_MAX) {
+                std::cerr << "[WAL] Corrupt record after seq " << stats.last_seq << ", stopping replay" << std::endl;
+                stats.errors++;
+                stats.torn_tail = true;
+                stop = true;
+                break;
+            }
+        }
+        file.release(pos, consumed);
+        pos += consumed;
+        stats.bytes = pos;
+        window = window_bytes;
+    }
+    if (pos < size) {
+        stats.torn_tail = true;
+        std::cerr << "[WAL] Ignoring " << (size - pos) << " trailing bytes (torn or corrupt tail)" << std::endl;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "[WAL] Replay complete. Entries: " << stats.records << ", Errors: " << stats.errors
+              << ", " << (stats.bytes / (1024.0 * 1024.0)) << " MB in " << stats.seconds << " s ("
+              << static_cast<uint64_t>(stats.records_per_sec()) << " records/s, "
+              << stats.mb_per_sec() << " MB/s)" << std::endl;
+    return stats;
+}
+
+WalReplayStats WAL::replay_stream(const ApplyFn &apply, size_t threads, size_t window_bytes) {
+    WalReplayStats stats = replay_file(config_.path, apply, threads, window_bytes);
+    note_replayed_seq(stats.last_seq);
+    return stats;
+}
+
+void WAL::note_replayed_seq(uint64_t seq) {
+    // Keep sequence numbers increasing across restarts; what is already on
+    // disk counts as written and durable
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (seq > next_seq_) next_seq_ = seq;
+    }
+    {
+        std::lock_guard<std::mutex> lk(io_mu_);
+        if (seq > written_seq_) written_seq_ = seq;
+    }
+    if (seq > durable_seq()) publish_durable(seq);
+}
+
+std::string WAL::segment_path(const std::string &path, uint64_t last_seq) {
+    std::string digits = std::to_string(last_seq);
+    return path + ".seg-" + std::string(digits.size() < 20 ? 20 - digits.size() : 0, '0') + digits;
+}
+
+uint64_t WAL::seal_segment(std::string &sealed_path) {
+    std::lock_guard<std::mutex> lk(io_mu_);
+    if (written_seq_ <= sealed_seq_) return 0; // nothing new since the last seal
+
+    // The writer only touches the file under io_mu_, so every record up to
+    // written_seq_ is in the sealed file and every later one in the new file
+    sync_locked();
+    if (fd_ >= 0) {
+        os_close(fd_);
+        fd_ = -1;
+    }
+    sealed_path = segment_path(config_.path, written_seq_);
+    try {
+        std::filesystem::rename(config_.path, sealed_path);
+    } catch (...) {
+        open_file(); // keep appending to the unsealed file
+        throw;
     }
-    
-    ifs.close();
-    std::cout << "[WAL] Replay complete. Entries: " << entries.size() 
-              << ", Errors: " << errors << std::endl;
+    sealed_seq_ = written_seq_;
+    open_file();
+    return sealed_seq_;
+}
+
+std::vector<nlohmann::json> WAL::replay() {
+    std::vector<nlohmann::json> entries;
+    replay_stream([&](WalRecord &rec) { entries.push_back(record_to_json(rec)); });
     return entries;
 }
 
 void WAL::rotate(const std::string &new_path) {
-    // Lock to ensure writer thread is not using ofs_
-    std::lock_guard<std::mutex> lk(mu_);
-    
-    // Flush current data
-    flush_internal();
-    
-    // Close current file
-    if (ofs_.is_open()) {
-        ofs_.close();
-    }
-    
+    // Lock to ensure writer thread is not using fd_
+    std::lock_guard<std::mutex> lk(io_mu_);
+
+    // Make what we have durable before closing
+    sync_locked();
+    if (fd_ >= 0) {
+        os_close(fd_);
+        fd_ = -1;
+    }
+
     // Rename old file
     try {
         auto now = std::chrono::system_clock::now();
         auto timestamp = std::chrono::system_clock::to_time_t(now);
-        std::string backup_path = path_ + "." + std::to_string(timestamp);
-        
-        std::filesystem::rename(path_, backup_path);
+        std::string backup_path = config_.path + "." + std::to_string(timestamp);
+
+        std::filesystem::rename(config_.path, backup_path);
         std::cout << "[WAL] Rotated to: " << backup_path << std::endl;
     } catch (const std::exception &e) {
         std::cerr << "[WAL] Rotation error: " << e.what() << std::endl;
     }
-    
+
     // Open new file
-    path_ = new_path;
-    ofs_.open(path_, std::ios::out | std::ios::app);
-    if (!ofs_.is_open()) {
-        throw std::runtime_error("Failed to open new WAL file: " + path_);
-    }
-    
-    std::cout << "[WAL] New file opened: " << path_ << std::endl;
+    config_.path = new_path;
+    open_file();
+    std::cout << "[WAL] New file opened: " << config_.path << std::endl;
 }
@@ -2,18 +2,28 @@
 // FILE: src/ws_server.cpp (Production-Ready WebSocket Implementation)
 // ============================================================================
 #include "../include/ws_server.h"
+#include "../include/engine_config.h"
 #include "../include/order_book.h"
+#include "../include/order_json.h"
+#include "../include/json_writer.h"
+#include "../include/md_binary.h"
+#include "../include/metrics.h"
+#include "../include/global_state.h"
 #include "../vendor/json.hpp"
 #include <iostream>
 #include <thread>
 #include <vector>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <unordered_map>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
+#include <array>
+#include <deque>
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -29,6 +39,13 @@ typedef SOCKET socket_t;
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
 typedef int socket_t;
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
@@ -93,8 +110,41 @@ namespace ws {
         out.assign(reinterpret_cast<const char*>(hash.data()), hashLen);
         return out;
         #else
-        // Non-Windows: not implemented in this minimal build
-        return std::string();
+        // FIPS 180-1; only used for the handshake, so simplicity over speed
+        auto rol = [](uint32_t v, int bits) { return (v << bits) | (v >> (32 - bits)); };
+        uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::string msg = input;
+        uint64_t bit_len = static_cast<uint64_t>(input.size()) * 8;
+        msg.push_back(static_cast<char>(0x80));
+        while (msg.size() % 64 != 56) msg.push_back('\0');
+        for (int i = 7; i >= 0; --i) msg.push_back(static_cast<char>((bit_len >> (i * 8)) & 0xFF));
+
+        for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; ++i) {
+                const unsigned char *b = reinterpret_cast<const unsigned char*>(msg.data() + chunk + i * 4);
+                w[i] = (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+            }
+            for (int i = 16; i < 80; ++i) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+                else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+                else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+                uint32_t tmp = rol(a, 5) + f + e + k + w[i];
+                e = d; d = c; c = rol(b, 30); b = a; a = tmp;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        std::string out;
+        for (uint32_t v : h) {
+            for (int i = 3; i >= 0; --i) out.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+        }
+        return out;
         #endif
     }
     
@@ -105,10 +155,10 @@ namespace ws {
         return base64_encode(hash);
     }
     
-    std::string encode_frame(const std::string &payload) {
+    std::string encode_frame(const std::string &payload, uint8_t opcode = 0x1) {
         std::vector<uint8_t> frame;
         
-        frame.push_back(0x81); // FIN=1, opcode=1 (text)
+        frame.push_back(0x80 | opcode); // FIN=1, opcode (1 = text)
         
         size_t len = payload.size();
         if (len <= 125) {
@@ -134,6 +184,7 @@ namespace ws {
         bool masked;
         std::string payload;
         bool valid;
+        size_t size; // bytes consumed from the input when valid
     };
     
     Frame decode_frame(const uint8_t* data, size_t len) {
@@ -177,15 +228,925 @@ namespace ws {
         }
         
         frame.valid = true;
+        frame.size = pos + payload_len;
         return frame;
     }
+
+    // Extracts Sec-WebSocket-Key from an upgrade request and builds the 101
+    // response; empty if the request is not a valid upgrade
+    std::string handshake_response(const std::string &request) {
+        std::string key;
+        size_t key_pos = request.find("Sec-WebSocket-Key:");
+        if (key_pos != std::string::npos) {
+            size_t start = request.find_first_not_of(" \t", key_pos + 18);
+            size_t end = request.find("\r\n", start);
+            if (start != std::string::npos && end != std::string::npos) {
+                key = request.substr(start, end - start);
+            }
+        }
+        if (key.empty()) return std::string();
+
+        std::string accept_key = compute_accept_key(key);
+        if (accept_key.empty()) return std::string();
+
+        std::ostringstream response;
+        response << "HTTP/1.1 101 Switching Protocols\r\n";
+        response << "Upgrade: websocket\r\n";
+        response << "Connection: Upgrade\r\n";
+        response << "Sec-WebSocket-Accept: " << accept_key << "\r\n";
+        response << "\r\n";
+        return response.str();
+    }
+
+    // "GET /?format=binary" opts the connection into binary market data
+    bool wants_binary(const std::string &request) {
+        size_t line_end = request.find("\r\n");
+        std::string line = request.substr(0, line_end);
+        size_t q = line.find('?');
+        return q != std::string::npos && line.find("format=binary", q) != std::string::npos;
+    }
+
+    std::string welcome_message(const std::string &connection_id) {
+        json welcome = {
+            {"type", "connected"},
+            {"message", "Connected to matching engine"},
+            {"connection_id", connection_id},
+            {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()}
+        };
+        return encode_frame(welcome.dump());
+    }
+}
+
+static const char *to_string(WsChannel channel) {
+    switch (channel) {
+    case WsChannel::Trades: return "trades";
+    case WsChannel::Depth: return "depth";
+    case WsChannel::Bbo: return "bbo";
+    }
+    return "trades";
+}
+
+static bool parse_channel(const std::string &s, WsChannel &out) {
+    if (s == "trades") { out = WsChannel::Trades; return true; }
+    if (s == "depth") { out = WsChannel::Depth; return true; }
+    if (s == "bbo") { out = WsChannel::Bbo; return true; }
+    return false;
+}
+
+static std::string conflate_key_for(const std::string &symbol, WsChannel channel) {
+    if (channel == WsChannel::Depth) return symbol;
+    if (channel == WsChannel::Bbo) return symbol + "/bbo";
+    return std::string(); // every trade matters
+}
+
+// Last published best bid/ask per symbol, so BBO frames go out only on change
+class BboCache {
+public:
+    bool update(const std::string &symbol, const std::array<long long, 4> &bbo) {
+        std::lock_guard<std::mutex> lock(mu_);
+        auto [it, inserted] = last_.try_emplace(symbol, bbo);
+        if (!inserted && it->second == bbo) return false;
+        it->second = bbo;
+        return true;
+    }
+
+private:
+    std::mutex mu_;
+    std::unordered_map<std::string, std::array<long long, 4>> last_;
+};
+
+// Market-data messages are rendered with JsonWriter into a per-thread buffer.
+// Keys are emitted in sorted order, as nlohmann's dump() did, so the wire
+// format is unchanged.
+static JsonWriter &message_writer() {
+    thread_local JsonWriter w;
+    w.clear();
+    return w;
+}
+
+static int64_t now_ticks() {
+    return static_cast<int64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+static void write_levels(JsonWriter &w, const std::vector<std::pair<long long, long long>> &levels) {
+    w.begin_array();
+    for (const auto &[price, qty] : levels) {
+        w.begin_object().field("price", price).field("quantity", qty).end_object();
+    }
+    w.end_array();
+}
+
+// {"data":{"asks","bids","seq","symbol","timestamp"},"type":type}
+static const std::string &depth_message(const char *type, const std::string &symbol,
+                                        const std::vector<std::pair<long long, long long>> &bids,
+                                        const std::vector<std::pair<long long, long long>> &asks,
+                                        uint64_t seq) {
+    JsonWriter &w = message_writer();
+    w.begin_object().key("data").begin_object();
+    w.key("asks");
+    write_levels(w, asks);
+    w.key("bids");
+    write_levels(w, bids);
+    w.field("seq", seq).field("symbol", symbol).field("timestamp", now_ticks());
+    w.end_object().field("type", type).end_object();
+    return w.str();
+}
+
+static std::string orderbook_message(const std::string &symbol,
+                                     const std::vector<std::pair<long long, long long>> &bids,
+                                     const std::vector<std::pair<long long, long long>> &asks,
+                                     uint64_t seq) {
+    return depth_message("orderbook", symbol, bids, asks, seq);
+}
+
+// Payload encodings a broadcast is needed in (bit mask)
+enum : unsigned { FORMAT_JSON = 1, FORMAT_BINARY = 2 };
+
+static int64_t now_ns() {
+    return to_ns(std::chrono::system_clock::now());
+}
+
+// Thread-local buffer for binary messages, like message_writer()
+static std::string &binary_buffer() {
+    thread_local std::string out;
+    out.clear();
+    return out;
+}
+
+// Full window at the sequence number the delta stream is at, so a client can
+// apply every depth_update with a larger seq on top of it
+static std::string depth_resync_message(const std::string &symbol, bool binary) {
+    std::shared_ptr<const DepthSnapshot> book;
+    uint64_t seq = 0;
+    if (!g_broadcast_queue.depth_state(symbol, book, seq)) {
+        SymbolEntry *entry = g_symbol_registry.find(symbol);
+        book = entry ? entry->book.depth_snapshot(10) : std::make_shared<const DepthSnapshot>();
+        seq = 0;
+    }
+    if (!binary) return ws::encode_frame(orderbook_message(symbol, book->bids, book->asks, seq));
+    std::string &out = binary_buffer();
+    md_binary::encode_depth(out, md_binary::DepthSnapshotMsg, symbol, seq, book->bids, book->asks, now_ns());
+    return ws::encode_frame(out, 0x2);
+}
+
+#ifdef __linux__ // epoll: a fixed pool of event-loop workers
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
+static constexpr size_t WS_MAX_HANDSHAKE_BYTES = 8192;
+static constexpr size_t WS_MAX_INBOUND_BYTES = 1 << 20;
+static constexpr int WS_MAX_IOV = 64; // frames per sendmsg()
+static constexpr size_t WS_MAX_TOPICS = 1024; // (symbol, channel) subscriptions per connection
+static constexpr auto WS_PING_INTERVAL = std::chrono::seconds(30);
+static constexpr auto WS_HANDSHAKE_TIMEOUT = std::chrono::seconds(10);
+
+// An encoded frame, built once per broadcast and shared by every queue it
+// sits in. Book/BBO updates carry a per-symbol key so a backlog can be
+// conflated; only full-state frames (snapshots, BBO) may replace a queued
+// one, since dropping a depth delta would leave a sequence gap.
+struct OutFrame {
+    std::string bytes;
+    std::string conflate_key;
+    bool full_state = true;
+};
+using OutFramePtr = std::shared_ptr<const OutFrame>;
+
+static OutFramePtr make_frame(std::string bytes, std::string conflate_key = std::string(),
+                              bool full_state = true) {
+    return std::make_shared<const OutFrame>(OutFrame{std::move(bytes), std::move(conflate_key), full_state});
 }
 
+struct WSConnection;
+
+struct WSWorker {
+    size_t index = 0;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    std::thread thread;
+    std::unordered_map<socket_t, std::shared_ptr<WSConnection>> conns; // worker thread only
+
+    std::mutex pending_mutex; // connections with newly queued frames
+    std::vector<std::shared_ptr<WSConnection>> pending;
+};
+
+struct WSCounters {
+    std::atomic<uint64_t> frames_dropped{0};
+    std::atomic<uint64_t> frames_conflated{0};
+    std::atomic<uint64_t> slow_disconnects{0};
+};
+
+// A non-blocking client socket owned by one worker. Any thread may queue
+// frames; only the worker writes them, gathering up to WS_MAX_IOV frames per
+// sendmsg(). The queue is bounded by WebSocketConfig and overflows according
+// to its slow-consumer policy.
+struct WSConnection {
+    socket_t socket;
+    WSWorker *worker;
+    std::atomic<bool> active;
+    std::string id;
+
+    // Worker thread only
+    bool upgraded = false;
+    std::string inbuf;
+    std::chrono::steady_clock::time_point last_activity;
+    // Set by the first subscribe; until then the client gets every frame
+    bool filtered = false;
+    std::vector<std::pair<std::string, WsChannel>> topics;
+    // Market data as md_binary frames instead of JSON; written by the worker
+    // under index_mutex, read by broadcasters under it
+    bool binary = false;
+
+    WSConnection(socket_t s, WSWorker *w)
+        : socket(s), worker(w), active(true), last_activity(std::chrono::steady_clock::now()) {
+        static std::atomic<uint64_t> counter{1};
+        id = "conn_" + std::to_string(counter.fetch_add(1));
+    }
+
+    // Queues a frame (or merges it into a queued one); true if the caller
+    // must hand the connection to its worker, which has no flush pending.
+    bool enqueue(const OutFramePtr &frame, const WebSocketConfig &config, WSCounters &counters) {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        if (!active.load()) return false;
+
+        const bool conflatable = !frame->conflate_key.empty() &&
+                                 config.slow_consumer == SlowConsumerPolicy::Conflate;
+        if (conflatable && frame->full_state && replace_book_frame_locked(frame)) {
+            counters.frames_conflated.fetch_add(1, std::memory_order_relaxed);
+            return false; // already scheduled: the old frame was still queued
+        }
+
+        while (over_limit_locked(frame->bytes.size(), config)) {
+            size_t droppable = head_offset_ ? 1 : 0; // never cut a frame mid-write
+            if (config.slow_consumer == SlowConsumerPolicy::Disconnect || queue_.size() <= droppable) break;
+            erase_locked(queue_.begin() + droppable);
+            counters.frames_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (config.slow_consumer == SlowConsumerPolicy::Disconnect &&
+            over_limit_locked(frame->bytes.size(), config)) {
+            counters.slow_disconnects.fetch_add(1, std::memory_order_relaxed);
+            fail_locked();
+            return false;
+        }
+
+        queue_.push_back({frame, next_serial_});
+        if (conflatable) pending_book_[frame->conflate_key] = next_serial_;
+        ++next_serial_;
+        queued_bytes_ += frame->bytes.size();
+
+        if (flush_scheduled_ || want_write_) return false;
+        flush_scheduled_ = true;
+        return true;
+    }
+
+    // Worker: writes as much of the queue as the socket takes, then waits
+    // for EPOLLOUT if anything is left; false if the socket failed
+    bool flush() {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        flush_scheduled_ = false;
+        if (!active.load()) return false;
+        metrics::StageTimer timer(Stage::WsSend);
+
+        while (!queue_.empty()) {
+            iovec iov[WS_MAX_IOV];
+            int n = 0;
+            for (size_t i = 0; i < queue_.size() && n < WS_MAX_IOV; ++i, ++n) {
+                const std::string &bytes = queue_[i].frame->bytes;
+                size_t offset = i == 0 ? head_offset_ : 0;
+                iov[n].iov_base = const_cast<char*>(bytes.data() + offset);
+                iov[n].iov_len = bytes.size() - offset;
+            }
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = static_cast<size_t>(n);
+            ssize_t sent = sendmsg(socket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                fail_locked();
+                return false;
+            }
+            consume_locked(static_cast<size_t>(sent));
+        }
+
+        bool need_write = !queue_.empty();
+        if (need_write != want_write_) {
+            want_write_ = need_write;
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP | (need_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            ev.data.fd = socket;
+            epoll_ctl(worker->epoll_fd, EPOLL_CTL_MOD, socket, &ev);
+        }
+        return true;
+    }
+
+    // Frames and bytes still waiting to be written
+    void backlog(size_t &frames, size_t &bytes) {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        frames = queue_.size();
+        bytes = queued_bytes_ - head_offset_;
+    }
+
+    // Worker: after this no other thread touches the descriptor
+    void close() {
+        std::lock_guard<std::mutex> lock(send_mutex);
+        active = false;
+        queue_.clear();
+        pending_book_.clear();
+        epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, socket, nullptr);
+        ::close(socket);
+    }
+
+private:
+    struct Queued {
+        OutFramePtr frame;
+        uint64_t serial; // increasing along the queue, for conflation lookups
+    };
+
+    std::mutex send_mutex; // guards everything below and closing the socket
+    std::deque<Queued> queue_;
+    size_t head_offset_ = 0; // bytes of queue_.front() already written
+    size_t queued_bytes_ = 0;
+    uint64_t next_serial_ = 0;
+    std::unordered_map<std::string, uint64_t> pending_book_; // symbol -> serial of its queued update
+    bool flush_scheduled_ = false; // on the worker's pending list
+    bool want_write_ = false;      // EPOLLOUT armed
+
+    bool over_limit_locked(size_t incoming, const WebSocketConfig &config) const {
+        return queue_.size() + 1 > config.max_queued_frames ||
+               queued_bytes_ + incoming > config.max_queued_bytes;
+    }
+
+    // Swaps a queued, not yet started update for the same symbol in place
+    bool replace_book_frame_locked(const OutFramePtr &frame) {
+        auto it = pending_book_.find(frame->conflate_key);
+        if (it == pending_book_.end()) return false;
+        auto pos = std::lower_bound(queue_.begin(), queue_.end(), it->second,
+                                    [](const Queued &q, uint64_t serial) { return q.serial < serial; });
+        if (pos == queue_.end() || pos->serial != it->second) return false;
+        if (pos == queue_.begin() && head_offset_ > 0) return false;
+        queued_bytes_ += frame->bytes.size();
+        queued_bytes_ -= pos->frame->bytes.size();
+        pos->frame = frame;
+        return true;
+    }
+
+    void erase_locked(std::deque<Queued>::iterator pos) {
+        forget_book_locked(*pos);
+        queued_bytes_ -= pos->frame->bytes.size();
+        queue_.erase(pos);
+    }
+
+    void forget_book_locked(const Queued &q) {
+        if (q.frame->conflate_key.empty()) return;
+        auto it = pending_book_.find(q.frame->conflate_key);
+        if (it != pending_book_.end() && it->second == q.serial) pending_book_.erase(it);
+    }
+
+    void consume_locked(size_t sent) {
+        while (sent > 0) {
+            size_t left = queue_.front().frame->bytes.size() - head_offset_;
+            if (sent < left) {
+                head_offset_ += sent;
+                return;
+            }
+            sent -= left;
+            head_offset_ = 0;
+            erase_locked(queue_.begin());
+        }
+    }
+
+    // Wakes the worker (EPOLLHUP), which then closes the connection
+    void fail_locked() {
+        active = false;
+        shutdown(socket, SHUT_RDWR);
+    }
+};
+
+using ConnectionList = std::vector<std::shared_ptr<WSConnection>>;
+
+// Who receives what. Broadcasts read it under a shared lock (queueing a frame
+// never blocks); connects, disconnects and (un)subscribes take it exclusively.
+struct SubscriptionIndex {
+    static constexpr size_t CHANNELS = 3;
+
+    ConnectionList all;        // every upgraded connection
+    ConnectionList unfiltered; // never subscribed: everything goes to them
+    std::unordered_map<std::string, std::array<ConnectionList, CHANNELS>> topics;
+
+    static void remove(ConnectionList &list, const std::shared_ptr<WSConnection> &conn) {
+        auto it = std::find(list.begin(), list.end(), conn);
+        if (it == list.end()) return;
+        *it = std::move(list.back());
+        list.pop_back();
+    }
+
+    // Drops a topic once nobody holds any of its channels, so names clients
+    // made up do not accumulate
+    void unsubscribe(const std::string &symbol, WsChannel channel, const std::shared_ptr<WSConnection> &conn) {
+        auto it = topics.find(symbol);
+        if (it == topics.end()) return;
+        remove(it->second[static_cast<size_t>(channel)], conn);
+        for (const ConnectionList &list : it->second) {
+            if (!list.empty()) return;
+        }
+        topics.erase(it);
+    }
+
+    const ConnectionList *subscribers(const std::string &symbol, WsChannel channel) const {
+        auto it = topics.find(symbol);
+        if (it == topics.end()) return nullptr;
+        const ConnectionList &list = it->second[static_cast<size_t>(channel)];
+        return list.empty() ? nullptr : &list;
+    }
+};
+
+class WebSocketServerImpl {
+public:
+    socket_t server_socket;
+    SubscriptionIndex index;
+    mutable std::shared_mutex index_mutex;
+    std::atomic<bool> running;
+    BboCache bbo_cache;
+    std::vector<std::unique_ptr<WSWorker>> workers;
+    WebSocketConfig config;
+    WSCounters counters;
+    int port_;
+    
+    WebSocketServerImpl(int port)
+        : server_socket(INVALID_SOCKET), running(false), port_(port) {}
+    
+    ~WebSocketServerImpl() {
+        stop();
+    }
+
+    size_t worker_count() const {
+        if (config.threads.count > 0) return config.threads.count;
+        size_t hw = std::thread::hardware_concurrency();
+        return std::max<size_t>(1, std::min<size_t>(4, hw / 2));
+    }
+    
+    bool start() {
+        server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (server_socket == INVALID_SOCKET) {
+            std::cerr << "[WS] Socket creation failed\n";
+            return false;
+        }
+        
+        int opt = 1;
+        setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port_);
+        
+        if (bind(server_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR) {
+            std::cerr << "[WS] Bind failed on port " << port_ << "\n";
+            CLOSE_SOCKET(server_socket);
+            server_socket = INVALID_SOCKET;
+            return false;
+        }
+        
+        if (listen(server_socket, 1024) == SOCKET_ERROR) {
+            std::cerr << "[WS] Listen failed\n";
+            CLOSE_SOCKET(server_socket);
+            server_socket = INVALID_SOCKET;
+            return false;
+        }
+
+        // Every worker waits on the listening socket; EPOLLEXCLUSIVE wakes
+        // only one of them per incoming connection, which then owns it
+        for (size_t i = 0; i < worker_count(); ++i) {
+            auto w = std::make_unique<WSWorker>();
+            w->index = i;
+            w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            w->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (w->epoll_fd < 0 || w->wake_fd < 0) {
+                std::cerr << "[WS] epoll setup failed\n";
+                if (w->epoll_fd >= 0) ::close(w->epoll_fd);
+                if (w->wake_fd >= 0) ::close(w->wake_fd);
+                close_workers();
+                CLOSE_SOCKET(server_socket);
+                server_socket = INVALID_SOCKET;
+                return false;
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+            ev.data.fd = server_socket;
+            epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, server_socket, &ev);
+            ev.events = EPOLLIN;
+            ev.data.fd = w->wake_fd;
+            epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake_fd, &ev);
+            workers.push_back(std::move(w));
+        }
+
+        running = true;
+        for (auto &w : workers) {
+            w->thread = std::thread(&WebSocketServerImpl::worker_loop, this, w.get());
+        }
+        
+        std::cout << "[WS] Server started on port " << port_ << " (epoll, "
+                  << workers.size() << " workers)\n";
+        return true;
+    }
+    
+    void stop() {
+        if (!running.load()) return;
+        
+        std::cout << "[WS] Stopping server...\n";
+        running = false;
+
+        for (auto &w : workers) {
+            uint64_t one = 1;
+            ssize_t ignored = write(w->wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+        for (auto &w : workers) {
+            if (w->thread.joinable()) w->thread.join();
+            for (auto &[fd, conn] : w->conns) conn->close();
+            w->conns.clear();
+            w->pending.clear();
+        }
+        close_workers();
+        
+        if (server_socket != INVALID_SOCKET) {
+            CLOSE_SOCKET(server_socket);
+            server_socket = INVALID_SOCKET;
+        }
+        
+        std::unique_lock<std::shared_mutex> lock(index_mutex);
+        index = SubscriptionIndex();
+        
+        std::cout << "[WS] Server stopped\n";
+    }
+
+    void close_workers() {
+        for (auto &w : workers) {
+            ::close(w->epoll_fd);
+            ::close(w->wake_fd);
+        }
+        workers.clear();
+    }
+    
+    void worker_loop(WSWorker *w) {
+        place_current_thread(config.threads, w->index, "ws");
+        epoll_event events[256];
+        auto last_sweep = std::chrono::steady_clock::now();
+        const int timeout_ms = config.threads.busy_poll ? 0 : 1000;
+
+        while (running.load()) {
+            int n = epoll_wait(w->epoll_fd, events, 256, timeout_ms);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[WS] epoll_wait error\n";
+                break;
+            }
+
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                uint32_t ev = events[i].events;
+                if (fd == server_socket) {
+                    accept_clients(w);
+                    continue;
+                }
+                if (fd == w->wake_fd) {
+                    uint64_t value;
+                    ssize_t ignored = read(w->wake_fd, &value, sizeof(value));
+                    (void)ignored;
+                    flush_pending(w);
+                    continue;
+                }
+
+                auto it = w->conns.find(fd);
+                if (it == w->conns.end()) continue;
+                std::shared_ptr<WSConnection> conn = it->second;
+
+                bool ok = !(ev & (EPOLLERR | EPOLLHUP));
+                if (ok && (ev & (EPOLLIN | EPOLLRDHUP))) ok = on_readable(conn);
+                if (ok && (ev & EPOLLOUT)) ok = conn->flush();
+                if (!ok) close_client(w, conn);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_sweep >= std::chrono::seconds(1)) {
+                last_sweep = now;
+                sweep(w, now);
+            }
+        }
+    }
+
+    // Connections that broadcasts queued frames for since the last wakeup
+    void flush_pending(WSWorker *w) {
+        std::vector<std::shared_ptr<WSConnection>> batch;
+        {
+            std::lock_guard<std::mutex> lock(w->pending_mutex);
+            batch.swap(w->pending);
+        }
+        for (auto &conn : batch) {
+            if (!w->conns.count(conn->socket) || w->conns[conn->socket] != conn) continue; // closed meanwhile
+            if (!conn->flush()) close_client(w, conn);
+        }
+    }
+
+    // Worker thread: queue and write right away
+    bool send_now(const std::shared_ptr<WSConnection> &conn, std::string bytes) {
+        conn->enqueue(make_frame(std::move(bytes)), config, counters);
+        return conn->flush();
+    }
+
+    void accept_clients(WSWorker *w) {
+        while (true) {
+            socket_t client = accept4(server_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client == INVALID_SOCKET) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK && running.load()) {
+                    std::cerr << "[WS] Accept failed\n";
+                }
+                return;
+            }
+            int one = 1;
+            setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            auto conn = std::make_shared<WSConnection>(client, w);
+            w->conns[client] = conn;
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = client;
+            if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, client, &ev) < 0) {
+                close_client(w, conn);
+            }
+        }
+    }
+
+    // Reads everything available; false once the connection should close
+    bool on_readable(const std::shared_ptr<WSConnection> &conn) {
+        char buffer[16384];
+        while (true) {
+            ssize_t bytes = recv(conn->socket, buffer, sizeof(buffer), 0);
+            if (bytes > 0) {
+                conn->inbuf.append(buffer, static_cast<size_t>(bytes));
+                if (conn->inbuf.size() > WS_MAX_INBOUND_BYTES) return false;
+                continue;
+            }
+            if (bytes == 0) return false;
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        conn->last_activity = std::chrono::steady_clock::now();
+
+        if (!conn->upgraded) {
+            size_t end = conn->inbuf.find("\r\n\r\n");
+            if (end == std::string::npos) return conn->inbuf.size() <= WS_MAX_HANDSHAKE_BYTES;
+
+            std::string request = conn->inbuf.substr(0, end + 4);
+            std::string handshake = ws::handshake_response(request);
+            if (handshake.empty()) return false;
+            conn->inbuf.erase(0, end + 4);
+            conn->upgraded = true;
+            if (!send_now(conn, std::move(handshake))) return false;
+
+            size_t total;
+            {
+                std::unique_lock<std::shared_mutex> lock(index_mutex);
+                conn->binary = ws::wants_binary(request);
+                index.all.push_back(conn);
+                index.unfiltered.push_back(conn);
+                total = index.all.size();
+            }
+            std::cout << "[WS] Client " << conn->id << " connected (total: " << total << ")\n";
+            if (!send_now(conn, ws::welcome_message(conn->id))) return false;
+        }
+
+        size_t pos = 0;
+        while (pos < conn->inbuf.size()) {
+            ws::Frame frame = ws::decode_frame(reinterpret_cast<const uint8_t*>(conn->inbuf.data()) + pos,
+                                               conn->inbuf.size() - pos);
+            if (!frame.valid) break; // incomplete: wait for more bytes
+            pos += frame.size;
+
+            if (frame.opcode == 0x8) { // Close
+                return false;
+            } else if (frame.opcode == 0x9) { // Ping
+                if (!send_now(conn, ws::encode_frame(frame.payload, 0xA))) return false;
+            } else if (frame.opcode == 0xA) { // Pong
+                // Keep alive received
+            } else if (frame.opcode == 0x1 && frame.fin) { // Text: a control request
+                for (auto &reply : handle_request(conn, frame.payload)) {
+                    if (!send_now(conn, std::move(reply))) return false;
+                }
+            }
+        }
+        conn->inbuf.erase(0, pos);
+        return true;
+    }
+
+    // {"op": "subscribe" | "unsubscribe", "symbols": [...], "channels": ["trades", "depth", "bbo"]}
+    // ("channels" defaults to all three; subscribe may also set "format":
+    // "json" | "binary"), or {"op": "snapshot", "symbols": [...]} for a depth
+    // resync; returns the encoded reply frames to send back
+    std::vector<std::string> handle_request(const std::shared_ptr<WSConnection> &conn, const std::string &text) {
+        json request = json::parse(text, nullptr, false);
+        auto error = [](const std::string &message) {
+            return std::vector<std::string>{ws::encode_frame(json{{"type", "error"}, {"message", message}}.dump())};
+        };
+        if (!request.is_object() || !request.contains("op") || !request["op"].is_string()) {
+            return error("expected {\"op\": \"subscribe\" | \"unsubscribe\" | \"snapshot\", ...}");
+        }
+        std::string op = request["op"].get<std::string>();
+        if (op != "subscribe" && op != "unsubscribe" && op != "snapshot") return error("unknown op: " + op);
+        if (!request.contains("symbols") || !request["symbols"].is_array()) return error("symbols must be an array");
+
+        std::vector<std::string> symbols;
+        for (const auto &s : request["symbols"]) {
+            if (!s.is_string()) return error("symbols must be strings");
+            symbols.push_back(s.get<std::string>());
+        }
+        if (op == "snapshot") {
+            std::vector<std::string> replies;
+            for (const auto &symbol : symbols) replies.push_back(depth_resync_message(symbol, conn->binary));
+            return replies;
+        }
+        std::vector<WsChannel> channels;
+        if (request.contains("channels")) {
+            if (!request["channels"].is_array()) return error("channels must be an array");
+            for (const auto &c : request["channels"]) {
+                WsChannel channel;
+                if (!c.is_string() || !parse_channel(c.get<std::string>(), channel)) {
+                    return error("channels must be trades, depth or bbo");
+                }
+                channels.push_back(channel);
+            }
+        } else {
+            channels = {WsChannel::Trades, WsChannel::Depth, WsChannel::Bbo};
+        }
+        bool binary = conn->binary;
+        if (request.contains("format")) {
+            const json &format = request["format"];
+            if (op != "subscribe" || !format.is_string() || (format != "json" && format != "binary")) {
+                return error("format must be json or binary, on subscribe");
+            }
+            binary = format == "binary";
+        }
+
+        {
+            std::unique_lock<std::shared_mutex> lock(index_mutex);
+            if (op == "subscribe") {
+                size_t held = conn->topics.size();
+                for (const auto &symbol : symbols) {
+                    for (WsChannel channel : channels) {
+                        auto topic = std::make_pair(symbol, channel);
+                        if (std::find(conn->topics.begin(), conn->topics.end(), topic) == conn->topics.end()) ++held;
+                    }
+                }
+                if (held > WS_MAX_TOPICS) {
+                    return error("at most " + std::to_string(WS_MAX_TOPICS) + " subscriptions per connection");
+                }
+            }
+            conn->binary = binary;
+            if (!conn->filtered) {
+                conn->filtered = true;
+                SubscriptionIndex::remove(index.unfiltered, conn);
+            }
+            for (const auto &symbol : symbols) {
+                for (WsChannel channel : channels) {
+                    auto topic = std::make_pair(symbol, channel);
+                    auto it = std::find(conn->topics.begin(), conn->topics.end(), topic);
+                    if (op == "subscribe" && it == conn->topics.end()) {
+                        conn->topics.push_back(topic);
+                        index.topics[symbol][static_cast<size_t>(channel)].push_back(conn);
+                    } else if (op == "unsubscribe" && it != conn->topics.end()) {
+                        conn->topics.erase(it);
+                        index.unsubscribe(symbol, channel, conn);
+                    }
+                }
+            }
+        }
+
+        json channel_names = json::array();
+        for (WsChannel channel : channels) channel_names.push_back(to_string(channel));
+        json reply = {{"type", op == "subscribe" ? "subscribed" : "unsubscribed"},
+                      {"symbols", symbols}, {"channels", channel_names}};
+        if (op == "subscribe") reply["format"] = binary ? "binary" : "json";
+        return {ws::encode_frame(reply.dump())};
+    }
+
+    // Once a second: drop failed or stalled connections, ping idle ones
+    void sweep(WSWorker *w, std::chrono::steady_clock::time_point now) {
+        std::vector<std::shared_ptr<WSConnection>> dead;
+        for (auto &[fd, conn] : w->conns) {
+            if (!conn->active.load()) {
+                dead.push_back(conn);
+            } else if (!conn->upgraded) {
+                if (now - conn->last_activity >= WS_HANDSHAKE_TIMEOUT) dead.push_back(conn);
+            } else if (now - conn->last_activity >= WS_PING_INTERVAL) {
+                conn->last_activity = now;
+                send_now(conn, ws::encode_frame(std::string(), 0x9));
+            }
+        }
+        for (auto &conn : dead) close_client(w, conn);
+    }
+
+    void close_client(WSWorker *w, std::shared_ptr<WSConnection> conn) {
+        socket_t fd = conn->socket;
+        conn->close();
+        w->conns.erase(fd);
+        if (!conn->upgraded) return;
+        {
+            std::unique_lock<std::shared_mutex> lock(index_mutex);
+            SubscriptionIndex::remove(index.all, conn);
+            if (!conn->filtered) SubscriptionIndex::remove(index.unfiltered, conn);
+            for (const auto &[symbol, channel] : conn->topics) {
+                index.unsubscribe(symbol, channel, conn);
+            }
+        }
+        std::cout << "[WS] Client " << conn->id << " disconnected\n";
+    }
+
+    // Encodings the interested clients want (FORMAT_* mask), so callers skip
+    // building messages nobody would receive
+    unsigned listeners(const std::string &symbol, WsChannel channel) const {
+        std::shared_lock<std::shared_mutex> lock(index_mutex);
+        unsigned formats = 0;
+        const ConnectionList *lists[2] = {&index.unfiltered, index.subscribers(symbol, channel)};
+        for (const ConnectionList *list : lists) {
+            if (!list) continue;
+            for (const auto &conn : *list) {
+                formats |= conn->binary ? FORMAT_BINARY : FORMAT_JSON;
+                if (formats == (FORMAT_JSON | FORMAT_BINARY)) return formats;
+            }
+        }
+        return formats;
+    }
+    
+    // Encodes once per format and queues the same buffer for every interested
+    // client; the socket writes happen on the workers, so a slow client only
+    // fills its own queue. An empty payload skips clients of that format.
+    void broadcast(const std::string &text, const std::string &binary, const std::string &symbol,
+                   WsChannel channel, bool full_state) {
+        std::string key = conflate_key_for(symbol, channel);
+        OutFramePtr text_frame = text.empty() ? nullptr : make_frame(ws::encode_frame(text), key, full_state);
+        OutFramePtr binary_frame = binary.empty() ? nullptr : make_frame(ws::encode_frame(binary, 0x2), key, full_state);
+
+        std::vector<std::vector<std::shared_ptr<WSConnection>>> wake(workers.size());
+        {
+            std::shared_lock<std::shared_mutex> lock(index_mutex);
+            const ConnectionList *lists[2] = {&index.unfiltered, index.subscribers(symbol, channel)};
+            for (const ConnectionList *list : lists) {
+                if (!list) continue;
+                for (auto &conn : *list) {
+                    const OutFramePtr &frame = conn->binary ? binary_frame : text_frame;
+                    if (frame && conn->enqueue(frame, config, counters)) wake[conn->worker->index].push_back(conn);
+                }
+            }
+        }
+        for (size_t i = 0; i < wake.size(); ++i) {
+            if (wake[i].empty()) continue;
+            {
+                std::lock_guard<std::mutex> lock(workers[i]->pending_mutex);
+                auto &pending = workers[i]->pending;
+                pending.insert(pending.end(), wake[i].begin(), wake[i].end());
+            }
+            uint64_t one = 1;
+            ssize_t ignored = write(workers[i]->wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+    
+    size_t client_count() const {
+        std::shared_lock<std::shared_mutex> lock(index_mutex);
+        return std::count_if(index.all.begin(), index.all.end(),
+                            [](const auto &c) { return c->active.load(); });
+    }
+
+    WebSocketStats stats() const {
+        WebSocketStats s;
+        s.frames_dropped = counters.frames_dropped.load();
+        s.frames_conflated = counters.frames_conflated.load();
+        s.slow_disconnects = counters.slow_disconnects.load();
+        std::shared_lock<std::shared_mutex> lock(index_mutex);
+        for (const auto &c : index.all) {
+            if (!c->active.load()) continue;
+            size_t frames = 0, bytes = 0;
+            c->backlog(frames, bytes);
+            s.queued_frames += frames;
+            s.queued_bytes += bytes;
+            s.max_client_queued_bytes = std::max<uint64_t>(s.max_client_queued_bytes, bytes);
+        }
+        return s;
+    }
+};
+
+#else // select(): one thread per client
+
 struct WSConnection {
     socket_t socket;
     std::atomic<bool> active;
     std::string id;
     std::mutex send_mutex;
+    bool binary = false; // set at handshake, before the connection is shared
     
     WSConnection(socket_t s) : socket(s), active(true) {
         static std::atomic<uint64_t> counter{1};
@@ -367,40 +1328,15 @@ public:
         }
         
         buffer[bytes] = '\0';
-        std::string request(buffer);
-        
-        std::string key;
-        size_t key_pos = request.find("Sec-WebSocket-Key:");
-        if (key_pos != std::string::npos) {
-            size_t start = request.find_first_not_of(" \t", key_pos + 18);
-            size_t end = request.find("\r\n", start);
-            if (start != std::string::npos && end != std::string::npos) {
-                key = request.substr(start, end - start);
-            }
-        }
-        
-        if (key.empty()) {
+        std::string handshake = ws::handshake_response(std::string(buffer));
+        if (handshake.empty()) {
             CLOSE_SOCKET(client_socket);
             return;
         }
-        
-        std::string accept_key = ws::compute_accept_key(key);
-        if (accept_key.empty()) {
-            CLOSE_SOCKET(client_socket);
-            return;
-        }
-        
-        std::ostringstream response;
-        response << "HTTP/1.1 101 Switching Protocols\r\n";
-        response << "Upgrade: websocket\r\n";
-        response << "Connection: Upgrade\r\n";
-        response << "Sec-WebSocket-Accept: " << accept_key << "\r\n";
-        response << "\r\n";
-        
-        std::string handshake = response.str();
         send(client_socket, handshake.c_str(), handshake.size(), 0);
         
         auto conn = std::make_shared<WSConnection>(client_socket);
+        conn->binary = ws::wants_binary(std::string(buffer));
         {
             std::lock_guard<std::mutex> lock(connections_mutex);
             connections.push_back(conn);
@@ -409,13 +1345,7 @@ public:
         std::cout << "[WS] Client " << conn->id << " connected (total: " 
                   << connections.size() << ")\n";
         
-        json welcome = {
-            {"type", "connected"},
-            {"message", "Connected to matching engine"},
-            {"connection_id", conn->id},
-            {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()}
-        };
-        conn->send(ws::encode_frame(welcome.dump()));
+        conn->send(ws::welcome_message(conn->id));
         
         while (running.load() && conn->active.load()) {
             fd_set readfds;
@@ -467,12 +1397,20 @@ public:
         CLOSE_SOCKET(client_socket);
     }
     
-    void broadcast(const std::string &message) {
-        std::string frame = ws::encode_frame(message);
+    // Slow-consumer limits and subscriptions only apply to the epoll backend
+    WebSocketConfig config;
+    BboCache bbo_cache;
+
+    unsigned listeners(const std::string &, WsChannel) const { return FORMAT_JSON | FORMAT_BINARY; }
+
+    void broadcast(const std::string &text, const std::string &binary, const std::string &, WsChannel, bool) {
+        std::string text_frame = text.empty() ? std::string() : ws::encode_frame(text);
+        std::string binary_frame = binary.empty() ? std::string() : ws::encode_frame(binary, 0x2);
         
         std::lock_guard<std::mutex> lock(connections_mutex);
         for (auto &conn : connections) {
-            if (conn->active.load()) {
+            const std::string &frame = conn->binary ? binary_frame : text_frame;
+            if (conn->active.load() && !frame.empty()) {
                 conn->send(frame);
             }
         }
@@ -483,8 +1421,12 @@ public:
         return std::count_if(connections.begin(), connections.end(),
                             [](const auto &c) { return c->active.load(); });
     }
+
+    WebSocketStats stats() const { return WebSocketStats(); }
 };
 
+#endif
+
 // WebSocketServer wrapper implementation
 WebSocketServer::WebSocketServer(int port) 
     : port_(port), running_(false), server_impl_(nullptr) {
@@ -498,6 +1440,10 @@ WebSocketServer::~WebSocketServer() {
     }
 }
 
+void WebSocketServer::configure(const WebSocketConfig &config) {
+    static_cast<WebSocketServerImpl*>(server_impl_)->config = config;
+}
+
 void WebSocketServer::start() {
     auto impl = static_cast<WebSocketServerImpl*>(server_impl_);
     if (impl->start()) {
@@ -513,57 +1459,102 @@ void WebSocketServer::stop() {
 }
 
 void WebSocketServer::broadcast_trade(const Trade &trade) {
-    json j = {
-        {"type", "trade"},
-        {"data", {
-            {"trade_id", trade.trade_id},
-            {"symbol", trade.symbol},
-            {"price", trade.price},
-            {"quantity", trade.quantity},
-            {"aggressor_side", trade.aggressor_side},
-            {"maker_order_id", trade.maker_order_id},
-            {"taker_order_id", trade.taker_order_id},
-            {"maker_fee", trade.maker_fee},
-            {"taker_fee", trade.taker_fee},
-            {"timestamp", trade.timestamp_iso}
-        }}
-    };
-    
-    broadcast_json(j.dump());
+    if (!running_.load()) return;
+    auto impl = static_cast<WebSocketServerImpl*>(server_impl_);
+    SymbolEntry *entry = g_symbol_registry.at(trade.symbol_id);
+    const std::string symbol = entry ? entry->symbol : std::string();
+    unsigned formats = impl->listeners(symbol, WsChannel::Trades);
+    if (!formats) return;
+
+    JsonWriter &w = message_writer();
+    if (formats & FORMAT_JSON) {
+        w.begin_object().key("data");
+        write_trade_json(w, trade);
+        w.field("type", "trade").end_object();
+    }
+    std::string &bin = binary_buffer();
+    if (formats & FORMAT_BINARY) md_binary::encode_trade(bin, trade, symbol);
+    broadcast_message(w.str(), bin, symbol, WsChannel::Trades);
 }
 
 void WebSocketServer::broadcast_orderbook_update(
     const std::string &symbol,
     const std::vector<std::pair<long long, long long>> &bids,
+    const std::vector<std::pair<long long, long long>> &asks,
+    uint64_t seq) {
+    if (!running_.load()) return;
+    publish_bbo(symbol, bids, asks);
+    publish_depth(md_binary::DepthSnapshotMsg, symbol, seq, bids, asks);
+}
+
+void WebSocketServer::broadcast_depth_update(
+    const std::string &symbol, uint64_t seq,
+    const std::vector<std::pair<long long, long long>> &bid_changes,
+    const std::vector<std::pair<long long, long long>> &ask_changes,
+    const std::vector<std::pair<long long, long long>> &bids,
     const std::vector<std::pair<long long, long long>> &asks) {
-    
-    json bids_array = json::array();
-    for (const auto &[price, qty] : bids) {
-        bids_array.push_back({{"price", price}, {"quantity", qty}});
-    }
-    
-    json asks_array = json::array();
-    for (const auto &[price, qty] : asks) {
-        asks_array.push_back({{"price", price}, {"quantity", qty}});
+    if (!running_.load()) return;
+    publish_bbo(symbol, bids, asks);
+    publish_depth(md_binary::DepthUpdateMsg, symbol, seq, bid_changes, ask_changes);
+}
+
+void WebSocketServer::publish_depth(uint16_t kind, const std::string &symbol, uint64_t seq,
+                                    const std::vector<std::pair<long long, long long>> &bids,
+                                    const std::vector<std::pair<long long, long long>> &asks) {
+    auto impl = static_cast<WebSocketServerImpl*>(server_impl_);
+    unsigned formats = impl->listeners(symbol, WsChannel::Depth);
+    if (!formats) return;
+
+    const bool snapshot = kind == md_binary::DepthSnapshotMsg;
+    static const std::string none;
+    const std::string *text = &none;
+    if (formats & FORMAT_JSON) text = &depth_message(snapshot ? "orderbook" : "depth_update", symbol, bids, asks, seq);
+    std::string &bin = binary_buffer();
+    if (formats & FORMAT_BINARY) {
+        md_binary::encode_depth(bin, static_cast<md_binary::Template>(kind), symbol, seq, bids, asks, now_ns());
     }
-    
-    json j = {
-        {"type", "orderbook"},
-        {"data", {
-            {"symbol", symbol},
-            {"bids", bids_array},
-            {"asks", asks_array},
-            {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()}
-        }}
+    // Deltas must not replace each other in a client queue (see enqueue)
+    broadcast_message(*text, bin, symbol, WsChannel::Depth, snapshot);
+}
+
+void WebSocketServer::publish_bbo(const std::string &symbol,
+                                  const std::vector<std::pair<long long, long long>> &bids,
+                                  const std::vector<std::pair<long long, long long>> &asks) {
+    auto impl = static_cast<WebSocketServerImpl*>(server_impl_);
+    std::array<long long, 4> bbo = {
+        bids.empty() ? 0 : bids[0].first, bids.empty() ? 0 : bids[0].second,
+        asks.empty() ? 0 : asks[0].first, asks.empty() ? 0 : asks[0].second
     };
-    
-    broadcast_json(j.dump());
+    unsigned formats = impl->listeners(symbol, WsChannel::Bbo);
+    if (!formats || !impl->bbo_cache.update(symbol, bbo)) return;
+
+    JsonWriter &w = message_writer();
+    if (formats & FORMAT_JSON) {
+        auto level = [&w](const char *key, bool empty, long long value) {
+            w.key(key);
+            if (empty) w.null();
+            else w.value(value);
+        };
+        w.begin_object().key("data").begin_object();
+        level("ask", asks.empty(), bbo[2]);
+        level("ask_quantity", asks.empty(), bbo[3]);
+        level("bid", bids.empty(), bbo[0]);
+        level("bid_quantity", bids.empty(), bbo[1]);
+        w.field("symbol", symbol).field("timestamp", now_ticks());
+        w.end_object().field("type", "bbo").end_object();
+    }
+    std::string &bin = binary_buffer();
+    if (formats & FORMAT_BINARY) {
+        md_binary::encode_bbo(bin, symbol, !bids.empty(), bbo[0], bbo[1], !asks.empty(), bbo[2], bbo[3], now_ns());
+    }
+    broadcast_message(w.str(), bin, symbol, WsChannel::Bbo);
 }
 
-void WebSocketServer::broadcast_json(const std::string &json_msg) {
+void WebSocketServer::broadcast_message(const std::string &json_msg, const std::string &binary_msg,
+                                        const std::string &symbol, WsChannel channel, bool full_state) {
     if (!running_.load()) return;
     auto impl = static_cast<WebSocketServerImpl*>(server_impl_);
-    impl->broadcast(json_msg);
+    impl->broadcast(json_msg, binary_msg, symbol, channel, full_state);
 }
 
 size_t WebSocketServer::client_count() const {
@@ -572,4 +1563,9 @@ size_t WebSocketServer::client_count() const {
     return impl->client_count();
 }
 
+WebSocketStats WebSocketServer::stats() const {
+    if (!server_impl_) return WebSocketStats();
+    return static_cast<WebSocketServerImpl*>(server_impl_)->stats();
+}
+
 WebSocketServer* global_ws_server = nullptr;
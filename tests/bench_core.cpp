@@ -0,0 +1,332 @@
+// ============================================================================
+// FILE: tests/bench_core.cpp (In-process matching core benchmark)
+// ============================================================================
+// Drives OrderBook, StopOrderManager, WAL and BroadcastQueue directly, with no
+// HTTP or JSON in the way, so a change to the core shows up in the numbers
+// without network noise. Every profile uses a seeded generator: the same
+// profile, op count and seed replay the same order flow.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../include/latency_histogram.h"
+#include "../include/order_book.h"
+#include "../include/stop_order_manager.h"
+#include "../include/broadcast_queue.h"
+#include "../include/wal.h"
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr long long MID = 5'000'000;   // 50000.00
+static constexpr long long UNIT = 1'000'000;  // 1.0 quantity
+
+struct BenchResult {
+    std::string name;
+    uint64_t ops = 0;
+    double seconds = 0;
+    LatencyHistogram latency; // ns per timed operation
+};
+
+struct OrderFlow {
+    explicit OrderFlow(uint64_t seed) : rng(seed) {}
+
+    std::mt19937_64 rng;
+    uint64_t next_id = 1;
+    std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+
+    long long uniform(long long lo, long long hi) {
+        return std::uniform_int_distribution<long long>(lo, hi)(rng);
+    }
+    bool chance(double p) { return std::uniform_real_distribution<double>(0, 1)(rng) < p; }
+
+    Order limit(Side side, long long price, long long quantity) {
+        return Order{next_id++, 0, OrderType::Limit, side, quantity, price, now};
+    }
+    Order market(Side side, long long quantity) {
+        return Order{next_id++, 0, OrderType::Market, side, quantity, 0, now};
+    }
+    // A resting price `depth` ticks away from the touch on its own side
+    Order passive(Side side, long long depth) {
+        long long price = side == Side::Buy ? MID - 1 - depth : MID + 1 + depth;
+        return limit(side, price, UNIT * uniform(1, 10));
+    }
+    Side side() { return chance(0.5) ? Side::Buy : Side::Sell; }
+};
+
+template <typename F>
+static void timed(BenchResult &r, F &&op) {
+    auto t0 = Clock::now();
+    op();
+    auto t1 = Clock::now();
+    r.latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+}
+
+// Wall time around the whole loop, untimed setup inside it included
+template <typename F>
+static BenchResult run_profile(const std::string &name, uint64_t ops, F &&body) {
+    BenchResult r;
+    r.name = name;
+    r.ops = ops;
+    auto start = Clock::now();
+    body(r);
+    r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return r;
+}
+
+// Passive build-up: non-crossing limit orders within 1000 ticks of the touch
+static BenchResult bench_passive(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    OrderBook book(0);
+    return run_profile("passive", ops, [&](BenchResult &r) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            Order o = flow.passive(flow.side(), flow.uniform(0, 999));
+            timed(r, [&] { book.add_order(o); });
+        }
+    });
+}
+
+// Aggressive sweeps: each market order takes out 1-8 resting orders over up
+// to 20 levels; the liquidity it consumed is put back untimed first. Fills
+// go to one reused buffer, as the order entry path does.
+static BenchResult bench_aggressive(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    OrderBook book(0);
+    std::vector<Trade> fills;
+    for (int i = 0; i < 2000; ++i) {
+        book.add_order(flow.limit(Side::Buy, MID - 1 - i % 200, UNIT));
+        book.add_order(flow.limit(Side::Sell, MID + 1 + i % 200, UNIT));
+    }
+    return run_profile("aggressive", ops, [&](BenchResult &r) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            Side taker = i % 2 ? Side::Buy : Side::Sell;
+            Side maker = taker == Side::Buy ? Side::Sell : Side::Buy;
+            long long sweep = flow.uniform(1, 8);
+            for (long long k = 0; k < sweep; ++k) book.add_order(flow.passive(maker, flow.uniform(0, 19)));
+            Order o = flow.market(taker, sweep * UNIT);
+            timed(r, [&] {
+                fills.clear();
+                book.add_order(o, fills);
+            });
+        }
+    });
+}
+
+// Market making: mostly adds and cancels of resting quotes near the touch,
+// with one small crossing order in ten
+static BenchResult bench_cancel_heavy(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    OrderBook book(0);
+    std::vector<uint64_t> live;
+    for (int i = 0; i < 10000; ++i) {
+        Order o = flow.passive(flow.side(), flow.uniform(0, 49));
+        book.add_order(o);
+        live.push_back(o.order_id);
+    }
+    return run_profile("cancel_heavy", ops, [&](BenchResult &r) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            double roll = std::uniform_real_distribution<double>(0, 1)(flow.rng);
+            if (roll < 0.45 && !live.empty()) {
+                size_t at = static_cast<size_t>(flow.uniform(0, static_cast<long long>(live.size()) - 1));
+                uint64_t id = live[at];
+                live[at] = live.back();
+                live.pop_back();
+                timed(r, [&] { book.cancel_order(id); }); // may already be filled
+            } else if (roll < 0.9) {
+                Order o = flow.passive(flow.side(), flow.uniform(0, 49));
+                live.push_back(o.order_id);
+                timed(r, [&] { book.add_order(o); });
+            } else {
+                Order o = flow.market(flow.side(), UNIT * flow.uniform(1, 3));
+                timed(r, [&] { book.add_order(o); });
+            }
+        }
+    });
+}
+
+// Deep book: 20,000 price levels a side, orders added and cancelled anywhere
+// in it. Runs once map-backed and once on a price-band ladder.
+static BenchResult bench_deep(const std::string &name, OrderBook &book, uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    const long long levels = 20000;
+    std::vector<uint64_t> live;
+    for (long long i = 0; i < levels; ++i) {
+        for (Side s : {Side::Buy, Side::Sell}) {
+            Order o = flow.passive(s, i);
+            book.add_order(o);
+            live.push_back(o.order_id);
+        }
+    }
+    return run_profile(name, ops, [&](BenchResult &r) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            if (flow.chance(0.5)) {
+                size_t at = static_cast<size_t>(flow.uniform(0, static_cast<long long>(live.size()) - 1));
+                uint64_t id = live[at];
+                live[at] = live.back();
+                live.pop_back();
+                timed(r, [&] { book.cancel_order(id); });
+            } else {
+                Order o = flow.passive(flow.side(), flow.uniform(0, levels - 1));
+                live.push_back(o.order_id);
+                timed(r, [&] { book.add_order(o); });
+            }
+        }
+    });
+}
+
+// Stop triggers: 20,000 fixed and 20,000 trailing stops (ten trail widths)
+// against a random-walk last price; each op is one check_triggers call and
+// the fired stops are replaced untimed
+static BenchResult bench_stops(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    StopOrderManager stops(0);
+    auto add_stop = [&](long long price, bool trailing) {
+        StopOrder s;
+        s.side = flow.side();
+        s.quantity = UNIT;
+        s.created_at = flow.now;
+        long long away = flow.uniform(50, 5000);
+        if (trailing) {
+            s.stop_type = StopOrderType::TRAILING_STOP;
+            s.trail_amount = 100 * flow.uniform(1, 10);
+            s.trigger_price = s.side == Side::Buy ? price + s.trail_amount : price - s.trail_amount;
+        } else {
+            s.trigger_price = s.side == Side::Buy ? price + away : price - away;
+        }
+        stops.add_stop_order(s);
+    };
+    for (int i = 0; i < 20000; ++i) {
+        add_stop(MID, false);
+        add_stop(MID, true);
+    }
+    long long price = MID;
+    return run_profile("stops", ops, [&](BenchResult &r) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            price += flow.uniform(-5, 5);
+            std::vector<Order> fired;
+            timed(r, [&] { fired = stops.check_triggers(price); });
+            for (size_t k = 0; k < fired.size(); ++k) add_stop(price, k % 2 == 1);
+        }
+    });
+}
+
+// WAL producer cost: append_order as seen by a matching thread (sync none,
+// binary). Wall time includes the final flush, so ops/s is what the writer
+// actually sustained to the page cache.
+static BenchResult bench_wal(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    WalConfig config;
+    config.path = "./data/bench_core_wal.bin";
+    config.format = WalFormat::Binary;
+    config.sync = WalSync::None;
+    std::filesystem::create_directories("./data");
+    std::filesystem::remove(config.path);
+    BenchResult r;
+    {
+        WAL wal(config);
+        r = run_profile("wal", ops, [&](BenchResult &res) {
+            for (uint64_t i = 0; i < ops; ++i) {
+                Order o = flow.passive(flow.side(), flow.uniform(0, 999));
+                timed(res, [&] { wal.append_order(o); });
+            }
+            wal.flush();
+        });
+        wal.stop();
+    }
+    std::filesystem::remove(config.path);
+    return r;
+}
+
+// Market-data producer cost: push_trade plus a book update every fourth
+// push, over eight symbols spread across the shards
+static BenchResult bench_broadcast(uint64_t ops, uint64_t seed) {
+    OrderFlow flow(seed);
+    BroadcastQueue queue;
+    queue.start();
+    auto snapshot = std::make_shared<DepthSnapshot>();
+    for (int i = 0; i < 10; ++i) {
+        snapshot->bids.push_back({MID - 1 - i, UNIT});
+        snapshot->asks.push_back({MID + 1 + i, UNIT});
+    }
+    BenchResult r = run_profile("broadcast", ops, [&](BenchResult &res) {
+        for (uint64_t i = 0; i < ops; ++i) {
+            uint32_t symbol = static_cast<uint32_t>(i % 8);
+            if (i % 4 == 3) {
+                timed(res, [&] { queue.push_book_update(symbol, snapshot); });
+                continue;
+            }
+            Trade t{};
+            t.trade_id = i + 1;
+            t.maker_order_id = flow.next_id++;
+            t.taker_order_id = flow.next_id++;
+            t.symbol_id = symbol;
+            t.price = MID + flow.uniform(-10, 10);
+            t.quantity = UNIT;
+            timed(res, [&] { queue.push_trade(t); });
+        }
+    });
+    BroadcastStats stats = queue.stats();
+    queue.stop();
+    if (stats.dropped) std::cout << "  (broadcast: " << stats.dropped << " pushes dropped on a full ring)\n";
+    return r;
+}
+
+static void print_header() {
+    std::printf("%-14s %10s %12s %9s %9s %9s %10s %9s\n", "profile", "ops", "ops/s", "p50", "p99", "p99.9",
+                "max", "mean");
+}
+
+static void print_row(const BenchResult &r) {
+    const LatencyHistogram &h = r.latency;
+    double rate = r.seconds > 0 ? static_cast<double>(r.ops) / r.seconds : 0;
+    std::printf("%-14s %10llu %12.0f %9llu %9llu %9llu %10llu %9.0f\n", r.name.c_str(),
+                static_cast<unsigned long long>(r.ops), rate,
+                static_cast<unsigned long long>(h.percentile(50)),
+                static_cast<unsigned long long>(h.percentile(99)),
+                static_cast<unsigned long long>(h.percentile(99.9)),
+                static_cast<unsigned long long>(h.max()), h.mean());
+}
+
+int main(int argc, char **argv) {
+    std::string profile = argc > 1 ? argv[1] : "all";
+    uint64_t ops = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 42;
+
+    PriceBand band;
+    band.min_price = MID - 50000;
+    band.max_price = MID + 50000;
+    band.tick_size = 1;
+
+    std::vector<std::pair<std::string, std::function<BenchResult()>>> profiles = {
+        {"passive", [&] { return bench_passive(ops, seed); }},
+        {"aggressive", [&] { return bench_aggressive(ops, seed); }},
+        {"cancel_heavy", [&] { return bench_cancel_heavy(ops, seed); }},
+        {"deep", [&] { OrderBook book(0); return bench_deep("deep", book, ops, seed); }},
+        {"deep_ladder", [&] { OrderBook book(0, band); return bench_deep("deep_ladder", book, ops, seed); }},
+        {"stops", [&] { return bench_stops(ops, seed); }},
+        {"wal", [&] { return bench_wal(ops, seed); }},
+        {"broadcast", [&] { return bench_broadcast(ops, seed); }},
+    };
+
+    std::cout << "Matching core benchmark: " << ops << " ops per profile, seed " << seed
+              << " (latencies in ns)\n\n";
+    print_header();
+    bool matched = false;
+    for (auto &p : profiles) {
+        if (profile != "all" && profile != p.first) continue;
+        matched = true;
+        print_row(p.second());
+    }
+    if (!matched) {
+        std::cerr << "Unknown profile '" << profile << "'. Usage: ./bench_core [profile|all] [ops] [seed]\n"
+                  << "Profiles:";
+        for (auto &p : profiles) std::cerr << " " << p.first;
+        std::cerr << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -8,8 +8,21 @@
 #include <chrono>
 #include <random>
 #include <sstream>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
 #include "../vendor/httplib.h"
 #include "../vendor/json.hpp"
+#include "../include/latency_histogram.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
 
 using json = nlohmann::json;
 
@@ -161,14 +174,442 @@ private:
     }
 };
 
+// ----------------------------------------------------------------------------
+// Open-loop mode
+// ----------------------------------------------------------------------------
+// Requests go out on a fixed schedule (op i is due at start + i / rate), and
+// latency is measured from that intended send time, not from when the
+// connection got around to it. A server stall therefore shows up as latency
+// for every order that should have been sent during it, instead of silently
+// lowering the offered load (coordinated omission). Each connection owns
+// every connections-th op; one that falls behind sends back to back until it
+// catches up.
+struct OpenLoopConfig {
+    std::string host = "localhost";
+    int http_port = 8080;
+    int ws_port = 9002;
+    double rate = 1000;          // ops/sec over all connections
+    double duration_s = 10;
+    int connections = 8;
+    int symbols = 1;             // BENCH-0 .. BENCH-(n-1)
+    double buy_ratio = 0.5;
+    double mid_price = 50000.0;
+    std::string price_dist = "normal"; // normal (stddev = spread) | uniform (mid +- spread)
+    double price_spread = 50.0;
+    double qty_min = 0.1;
+    double qty_max = 2.0;
+    double cancel_ratio = 0.0;   // share of ops that cancel one of the connection's resting orders
+    bool market_data = true;     // WebSocket subscriber for order-to-trade-message latency
+    uint64_t seed = 42;
+    std::string json_path;       // "-" = stdout
+};
+
+static json histogram_json(const LatencyHistogram &h) {
+    static const double levels[] = {1, 5, 10, 25, 50, 75, 90, 95, 99, 99.5, 99.9, 99.95, 99.99, 100};
+    json percentiles = json::array();
+    for (double p : levels) {
+        percentiles.push_back({{"percentile", p}, {"value_ns", h.percentile(p)}});
+    }
+    return {{"count", h.count()}, {"min_ns", h.min()}, {"mean_ns", h.mean()},
+            {"max_ns", h.max()}, {"percentiles", percentiles}};
+}
+
+class OpenLoopBenchmark {
+public:
+    explicit OpenLoopBenchmark(const OpenLoopConfig &config) : config_(config) {
+        for (int i = 0; i < config_.symbols; ++i) symbols_.push_back("BENCH-" + std::to_string(i));
+    }
+
+    int run() {
+        std::cout << "\n========================================\n";
+        std::cout << "  Open-Loop Order Benchmark\n";
+        std::cout << "========================================\n";
+        std::cout << "Target rate:       " << config_.rate << " ops/sec\n";
+        std::cout << "Duration:          " << config_.duration_s << " seconds\n";
+        std::cout << "Connections:       " << config_.connections << "\n";
+        std::cout << "Symbols:           " << config_.symbols << "\n";
+        std::cout << "Cancel ratio:      " << config_.cancel_ratio << "\n";
+        std::cout << "========================================\n\n";
+
+        total_ops_ = static_cast<uint64_t>(config_.rate * config_.duration_s);
+        workers_.resize(config_.connections);
+
+        std::thread md;
+        if (config_.market_data) {
+            md_ready_ = false;
+            md = std::thread(&OpenLoopBenchmark::market_data_thread, this);
+            for (int i = 0; i < 200 && !md_ready_.load(); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            if (!md_ready_.load()) std::cerr << "Market data: no WebSocket subscription, skipping\n";
+        }
+
+        start_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < config_.connections; ++i) {
+            threads.emplace_back(&OpenLoopBenchmark::worker_thread, this, i);
+        }
+        for (auto &t : threads) t.join();
+        end_ = std::chrono::steady_clock::now();
+
+        if (md.joinable()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500)); // let the last trades arrive
+            md_stop_ = true;
+            md.join();
+        }
+
+        json report = build_report();
+        print_report(report);
+        if (config_.json_path == "-") {
+            std::cout << report.dump(2) << "\n";
+        } else if (!config_.json_path.empty()) {
+            std::ofstream out(config_.json_path);
+            out << report.dump(2) << "\n";
+            std::cout << "Wrote " << config_.json_path << "\n";
+        }
+        return 0;
+    }
+
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Worker {
+        LatencyHistogram order_latency;  // intended send -> response
+        LatencyHistogram order_service;  // actual send -> response
+        LatencyHistogram cancel_latency; // intended send -> response
+        uint64_t orders = 0, cancels = 0, failed = 0, late = 0;
+        std::vector<std::pair<uint64_t, TimePoint>> intended; // order id -> intended send
+    };
+
+    OpenLoopConfig config_;
+    std::vector<std::string> symbols_;
+    std::vector<Worker> workers_;
+    uint64_t total_ops_ = 0;
+    TimePoint start_, end_;
+
+    std::atomic<bool> md_ready_{false};
+    std::atomic<bool> md_stop_{false};
+    std::vector<std::pair<uint64_t, TimePoint>> md_arrivals_; // taker order id -> trade message arrival
+
+    static uint64_t ns_between(TimePoint from, TimePoint to) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+        return ns > 0 ? static_cast<uint64_t>(ns) : 0;
+    }
+
+    TimePoint intended_time(uint64_t op) const {
+        return start_ + std::chrono::nanoseconds(static_cast<long long>(op * 1e9 / config_.rate));
+    }
+
+    void worker_thread(int id) {
+        Worker &w = workers_[id];
+        httplib::Client cli("http://" + config_.host + ":" + std::to_string(config_.http_port));
+        cli.set_connection_timeout(10, 0);
+        cli.set_read_timeout(10, 0);
+        cli.set_write_timeout(10, 0);
+        cli.set_keep_alive(true);
+
+        std::mt19937_64 gen(config_.seed * 1000003 + id);
+        std::uniform_real_distribution<> unit(0.0, 1.0);
+        std::normal_distribution<> normal_price(config_.mid_price, config_.price_spread);
+        std::uniform_real_distribution<> uniform_price(config_.mid_price - config_.price_spread,
+                                                       config_.mid_price + config_.price_spread);
+        std::uniform_real_distribution<> qty_dist(config_.qty_min, config_.qty_max);
+        std::uniform_int_distribution<int> symbol_dist(0, config_.symbols - 1);
+        std::vector<uint64_t> resting;
+
+        for (uint64_t op = id; op < total_ops_; op += config_.connections) {
+            TimePoint due = intended_time(op);
+            if (std::chrono::steady_clock::now() < due) {
+                std::this_thread::sleep_until(due);
+            } else if (std::chrono::steady_clock::now() - due > std::chrono::milliseconds(1)) {
+                ++w.late;
+            }
+
+            if (!resting.empty() && unit(gen) < config_.cancel_ratio) {
+                size_t at = static_cast<size_t>(unit(gen) * resting.size()) % resting.size();
+                uint64_t order_id = resting[at];
+                resting[at] = resting.back();
+                resting.pop_back();
+                auto res = cli.Delete("/orders/ORD-" + std::to_string(order_id));
+                w.cancel_latency.record(ns_between(due, std::chrono::steady_clock::now()));
+                ++w.cancels;
+                // 404 is a normal outcome: the order filled before the cancel got there
+                if (!res || (res->status != 200 && res->status != 404)) ++w.failed;
+                continue;
+            }
+
+            double price = config_.price_dist == "uniform" ? uniform_price(gen) : normal_price(gen);
+            json order = {
+                {"symbol", symbols_[symbol_dist(gen)]},
+                {"order_type", "limit"},
+                {"side", unit(gen) < config_.buy_ratio ? "buy" : "sell"},
+                {"quantity", qty_dist(gen)},
+                {"price", std::max(0.01, price)}
+            };
+            std::string payload = order.dump();
+
+            TimePoint sent = std::chrono::steady_clock::now();
+            auto res = cli.Post("/orders", payload, "application/json");
+            TimePoint done = std::chrono::steady_clock::now();
+            w.order_latency.record(ns_between(due, done));
+            w.order_service.record(ns_between(sent, done));
+            ++w.orders;
+            if (!res || res->status != 200) {
+                ++w.failed;
+                continue;
+            }
+            try {
+                auto j = json::parse(res->body);
+                uint64_t order_id = 0;
+                std::string id_str = j["order"]["order_id"].get<std::string>();
+                if (id_str.rfind("ORD-", 0) == 0) order_id = std::stoull(id_str.substr(4));
+                if (order_id == 0) continue;
+                w.intended.emplace_back(order_id, due);
+                if (j.value("remaining_quantity", 0LL) > 0) resting.push_back(order_id);
+            } catch (const std::exception &) {
+                ++w.failed;
+            }
+        }
+    }
+
+#ifndef _WIN32
+    static int connect_tcp(const std::string &host, int port) {
+        addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0 || !res) return -1;
+        int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(res);
+        return fd;
+    }
+
+    static void send_text_frame(int fd, const std::string &text) {
+        std::string frame;
+        frame.push_back(static_cast<char>(0x81));
+        if (text.size() < 126) {
+            frame.push_back(static_cast<char>(0x80 | text.size()));
+        } else {
+            frame.push_back(static_cast<char>(0x80 | 126));
+            frame.push_back(static_cast<char>(text.size() >> 8));
+            frame.push_back(static_cast<char>(text.size() & 0xFF));
+        }
+        const char mask[4] = {0x5a, 0x13, 0x7c, 0x21};
+        frame.append(mask, 4);
+        for (size_t i = 0; i < text.size(); ++i) frame.push_back(text[i] ^ mask[i % 4]);
+        send(fd, frame.data(), frame.size(), 0);
+    }
+
+    // Pops one complete frame off `pending`; false if it needs more bytes
+    static bool take_frame(std::string &pending, int &opcode, std::string &payload) {
+        if (pending.size() < 2) return false;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(pending.data());
+        size_t len = p[1] & 0x7F, header = 2;
+        if (len == 126) {
+            if (pending.size() < 4) return false;
+            len = (size_t(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (len == 127) {
+            if (pending.size() < 10) return false;
+            len = 0;
+            for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+            header = 10;
+        }
+        if (pending.size() < header + len) return false;
+        opcode = p[0] & 0x0F;
+        payload = pending.substr(header, len);
+        pending.erase(0, header + len);
+        return true;
+    }
+
+    // Subscribes to the benchmark symbols' trades and timestamps each trade
+    // message on arrival; matched to the taker order's intended send afterwards
+    void market_data_thread() {
+        int fd = connect_tcp(config_.host, config_.ws_port);
+        if (fd < 0) return;
+        timeval tv{0, 200000};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        std::string upgrade = "GET / HTTP/1.1\r\nHost: " + config_.host +
+                              "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        send(fd, upgrade.data(), upgrade.size(), 0);
+
+        std::string pending;
+        char buf[65536];
+        size_t header_end = std::string::npos;
+        for (int tries = 0; tries < 20 && header_end == std::string::npos; ++tries) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n > 0) pending.append(buf, static_cast<size_t>(n));
+            header_end = pending.find("\r\n\r\n");
+        }
+        if (header_end == std::string::npos || pending.find(" 101") == std::string::npos) {
+            close(fd);
+            return;
+        }
+        pending.erase(0, header_end + 4);
+        json sub = {{"op", "subscribe"}, {"symbols", symbols_}, {"channels", {"trades"}}};
+        send_text_frame(fd, sub.dump());
+        md_ready_ = true;
+
+        int opcode = 0;
+        std::string payload;
+        while (!md_stop_.load()) {
+            ssize_t n = recv(fd, buf, sizeof(buf), 0);
+            if (n == 0) break;
+            if (n < 0) continue; // timeout: check md_stop_
+            TimePoint arrived = std::chrono::steady_clock::now();
+            pending.append(buf, static_cast<size_t>(n));
+            while (take_frame(pending, opcode, payload)) {
+                if (opcode != 0x1) continue;
+                auto j = json::parse(payload, nullptr, false);
+                if (j.is_discarded() || j.value("type", "") != "trade" || !j.contains("data")) continue;
+                std::string taker = j["data"].value("taker_order_id", "");
+                if (taker.rfind("ORD-", 0) == 0) md_arrivals_.emplace_back(std::stoull(taker.substr(4)), arrived);
+            }
+        }
+        close(fd);
+    }
+#else
+    void market_data_thread() {}
+#endif
+
+    json build_report() {
+        LatencyHistogram order_latency, order_service, cancel_latency, md_latency;
+        uint64_t orders = 0, cancels = 0, failed = 0, late = 0;
+        std::unordered_map<uint64_t, TimePoint> intended;
+        for (const auto &w : workers_) {
+            order_latency.merge(w.order_latency);
+            order_service.merge(w.order_service);
+            cancel_latency.merge(w.cancel_latency);
+            orders += w.orders;
+            cancels += w.cancels;
+            failed += w.failed;
+            late += w.late;
+            for (const auto &e : w.intended) intended.emplace(e.first, e.second);
+        }
+        for (const auto &a : md_arrivals_) {
+            auto it = intended.find(a.first);
+            if (it != intended.end()) md_latency.record(ns_between(it->second, a.second));
+        }
+
+        double seconds = std::chrono::duration<double>(end_ - start_).count();
+        json report = {
+            {"mode", "open_loop"},
+            {"config", {{"rate", config_.rate}, {"duration_s", config_.duration_s},
+                        {"connections", config_.connections}, {"symbols", config_.symbols},
+                        {"buy_ratio", config_.buy_ratio}, {"mid_price", config_.mid_price},
+                        {"price_dist", config_.price_dist}, {"price_spread", config_.price_spread},
+                        {"qty_min", config_.qty_min}, {"qty_max", config_.qty_max},
+                        {"cancel_ratio", config_.cancel_ratio}, {"seed", config_.seed}}},
+            {"elapsed_s", seconds},
+            {"ops", orders + cancels},
+            {"orders", orders},
+            {"cancels", cancels},
+            {"failed", failed},
+            {"behind_schedule", late}, // ops sent more than 1 ms after their intended time
+            {"achieved_rate", seconds > 0 ? (orders + cancels) / seconds : 0},
+            {"latency", {{"order", histogram_json(order_latency)},
+                         {"order_service", histogram_json(order_service)},
+                         {"cancel", histogram_json(cancel_latency)},
+                         {"market_data", histogram_json(md_latency)}}}
+        };
+        return report;
+    }
+
+    static void print_latency(const char *name, const json &h) {
+        auto at = [&](double p) {
+            for (const auto &e : h["percentiles"]) {
+                if (e["percentile"].get<double>() == p) return e["value_ns"].get<uint64_t>() / 1e6;
+            }
+            return 0.0;
+        };
+        std::cout << name << "count " << h["count"].get<uint64_t>() << "  p50 " << at(50) << "  p99 "
+                  << at(99) << "  p99.9 " << at(99.9) << "  max " << h["max_ns"].get<uint64_t>() / 1e6
+                  << " ms\n";
+    }
+
+    static void print_report(const json &r) {
+        std::cout << "\n========================================\n";
+        std::cout << "  Open-Loop Results\n";
+        std::cout << "========================================\n";
+        std::cout << "Ops:               " << r["ops"].get<uint64_t>() << " (" << r["orders"].get<uint64_t>()
+                  << " orders, " << r["cancels"].get<uint64_t>() << " cancels)\n";
+        std::cout << "Failed:            " << r["failed"].get<uint64_t>() << "\n";
+        std::cout << "Behind schedule:   " << r["behind_schedule"].get<uint64_t>() << "\n";
+        std::cout << "Achieved rate:     " << r["achieved_rate"].get<double>() << " ops/sec\n";
+        std::cout << "----------------------------------------\n";
+        const json &l = r["latency"];
+        print_latency("Order:        ", l["order"]);
+        print_latency("  (service):  ", l["order_service"]);
+        print_latency("Cancel:       ", l["cancel"]);
+        print_latency("Market data:  ", l["market_data"]);
+        std::cout << "========================================\n\n";
+    }
+};
+
+// --key=value or --key value
+static bool parse_open_loop_args(int argc, char **argv, OpenLoopConfig &c) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i], value;
+        if (arg.rfind("--", 0) != 0) return false;
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            value = arg.substr(eq + 1);
+            arg = arg.substr(0, eq);
+        } else if (arg != "--open-loop" && arg != "--no-market-data") {
+            if (i + 1 >= argc) return false;
+            value = argv[++i];
+        }
+        if (arg == "--open-loop") continue;
+        else if (arg == "--no-market-data") c.market_data = false;
+        else if (arg == "--host") c.host = value;
+        else if (arg == "--http-port") c.http_port = std::stoi(value);
+        else if (arg == "--ws-port") c.ws_port = std::stoi(value);
+        else if (arg == "--rate") c.rate = std::stod(value);
+        else if (arg == "--duration") c.duration_s = std::stod(value);
+        else if (arg == "--connections") c.connections = std::stoi(value);
+        else if (arg == "--symbols") c.symbols = std::stoi(value);
+        else if (arg == "--buy-ratio") c.buy_ratio = std::stod(value);
+        else if (arg == "--mid") c.mid_price = std::stod(value);
+        else if (arg == "--price-dist") c.price_dist = value;
+        else if (arg == "--price-spread") c.price_spread = std::stod(value);
+        else if (arg == "--qty-min") c.qty_min = std::stod(value);
+        else if (arg == "--qty-max") c.qty_max = std::stod(value);
+        else if (arg == "--cancel-ratio") c.cancel_ratio = std::stod(value);
+        else if (arg == "--seed") c.seed = std::stoull(value);
+        else if (arg == "--json") c.json_path = value;
+        else return false;
+    }
+    return c.rate > 0 && c.duration_s > 0 && c.connections > 0 && c.symbols > 0 &&
+           (c.price_dist == "normal" || c.price_dist == "uniform");
+}
+
 int main(int argc, char **argv) {
+    if (argc > 1 && std::string(argv[1]).rfind("--", 0) == 0) {
+        OpenLoopConfig open_loop;
+        if (!parse_open_loop_args(argc, argv, open_loop)) {
+            std::cerr << "Usage: " << argv[0] << " --open-loop [--rate=1000] [--duration=10] [--connections=8]\n"
+                      << "         [--symbols=1] [--buy-ratio=0.5] [--mid=50000] [--price-dist=normal|uniform]\n"
+                      << "         [--price-spread=50] [--qty-min=0.1] [--qty-max=2] [--cancel-ratio=0]\n"
+                      << "         [--seed=42] [--json=out.json|-] [--host=localhost] [--http-port=8080]\n"
+                      << "         [--ws-port=9002] [--no-market-data]\n";
+            return 1;
+        }
+        OpenLoopBenchmark benchmark(open_loop);
+        return benchmark.run();
+    }
+
     BenchmarkConfig config;
     
     if (argc > 1) config.num_threads = std::stoi(argv[1]);
     if (argc > 2) config.orders_per_thread = std::stoi(argv[2]);
     
     std::cout << "Usage: " << argv[0] << " [threads=4] [orders_per_thread=1000]\n";
-    std::cout << "Example: " << argv[0] << " 8 1000\n\n";
+    std::cout << "Example: " << argv[0] << " 8 1000\n";
+    std::cout << "Open loop: " << argv[0] << " --open-loop --rate=5000 --duration=30 --json=results.json\n\n";
     
     OrderBenchmark benchmark(config);
     benchmark.run();
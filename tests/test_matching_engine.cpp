@@ -0,0 +1,331 @@
+// ============================================================================
+// FILE: tests/test_matching_engine.cpp
+// ============================================================================
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/mpsc_ring.h"
+#include "../include/matching_engine.h"
+#include "../include/global_state.h"
+#include "../include/thread_topology.h"
+#include "../include/wal.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+void test_mpsc_ring() {
+    std::cout << "[TEST] MPSC ring preserves per-producer order...\n";
+    MpscRing<long long> ring(1024);
+    const int producers = 4;
+    const long long per_producer = 50000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (long long i = 0; i < per_producer; ++i) {
+                while (!ring.try_push(p * per_producer + i)) std::this_thread::yield();
+            }
+        });
+    }
+
+    std::vector<long long> last(producers, -1);
+    long long received = 0, value = 0;
+    while (received < producers * per_producer) {
+        if (!ring.try_pop(value)) continue;
+        int p = static_cast<int>(value / per_producer);
+        assert(value % per_producer == last[p] + 1);
+        last[p] = value % per_producer;
+        ++received;
+    }
+    for (auto &t : threads) t.join();
+    assert(!ring.try_pop(value));
+
+    // The depth gauge follows a consumer that never goes idle
+    MpscRing<long long> busy(256);
+    for (long long i = 0; i < 200; ++i) assert(busy.try_push(i));
+    for (int i = 0; i < 128; ++i) assert(busy.try_pop(value));
+    assert(busy.size() == 72);
+    std::cout << "[TEST] PASS - MPSC ring passed\n";
+}
+
+void test_matching_engine_shards() {
+    std::cout << "[TEST] Single-writer matching engine...\n";
+    MatchingEngineConfig config;
+    config.shards = 2;
+    config.ring_capacity = 64;
+    MatchingEngine engine(config);
+    engine.start();
+
+    const uint32_t symbol_id = g_symbol_registry.get_or_create("ENGINE-TEST").id;
+    const int threads_n = 4;
+    const int orders_per_thread = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threads_n; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < orders_per_thread; ++i) {
+                EngineRequest req;
+                req.type = EngineRequest::Type::NewOrder;
+                req.symbol_id = symbol_id;
+                req.order = Order{static_cast<uint64_t>(t * orders_per_thread + i + 1), symbol_id, OrderType::Limit,
+                                  Side::Sell, 1000, 1000000 + (i % 10) * 100, std::chrono::system_clock::now()};
+                engine.execute(req);
+                assert(req.trades.empty() && req.book != nullptr);
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    // Everything rested; a market sweep through the shard fills it all
+    EngineRequest sweep;
+    sweep.type = EngineRequest::Type::NewOrder;
+    sweep.symbol_id = symbol_id;
+    sweep.order = Order{100000, symbol_id, OrderType::Market, Side::Buy, 1000LL * threads_n * orders_per_thread, 0,
+                        std::chrono::system_clock::now()};
+    engine.execute(sweep);
+    assert(sweep.trades.size() == static_cast<size_t>(threads_n * orders_per_thread));
+    assert(sweep.trades.front().price == 1000000);
+
+    EngineRequest cancel;
+    cancel.type = EngineRequest::Type::Cancel;
+    cancel.symbol_id = symbol_id;
+    cancel.order_id = 1;
+    engine.execute(cancel);
+    assert(!cancel.cancelled);
+
+    // A batch is one round trip; the shard also cancels stops it holds
+    StopOrder stop;
+    stop.order_id = 200001;
+    stop.symbol_id = symbol_id;
+    stop.side = Side::Sell;
+    stop.quantity = 1000;
+    stop.trigger_price = 1;
+    g_symbol_registry.at(symbol_id)->stops.add_stop_order(stop);
+    std::vector<BookOp> ops(3);
+    ops[0].order = Order{200002, symbol_id, OrderType::Limit, Side::Sell, 1000, 2000000, std::chrono::system_clock::now()};
+    ops[1].type = BookOp::Type::Cancel;
+    ops[1].order_id = 200002;
+    ops[2].type = BookOp::Type::Cancel;
+    ops[2].order_id = 200001;
+    EngineRequest batch;
+    batch.type = EngineRequest::Type::Batch;
+    batch.symbol_id = symbol_id;
+    batch.ops = &ops;
+    engine.execute(batch);
+    assert(ops[1].cancelled && ops[2].cancelled && batch.book != nullptr && batch.wal_seq > 0);
+
+    // Stops fire after the op that triggered them, as if the ops came one at
+    // a time: the sell stop hit by op 0 finds no bid, op 1's bid comes later
+    uint32_t batch_symbol = g_symbol_registry.get_or_create("ENGINE-BATCH-STOPS").id;
+    auto now = std::chrono::system_clock::now();
+    SymbolEntry &batch_entry = *g_symbol_registry.at(batch_symbol);
+    batch_entry.book.add_order(Order{300001, batch_symbol, OrderType::Limit, Side::Sell, 1000, 100, now});
+    StopOrder sell_stop;
+    sell_stop.order_id = 300002;
+    sell_stop.symbol_id = batch_symbol;
+    sell_stop.side = Side::Sell;
+    sell_stop.quantity = 500;
+    sell_stop.trigger_price = 100;
+    batch_entry.stops.add_stop_order(sell_stop);
+    std::vector<BookOp> stop_ops(2);
+    stop_ops[0].order = Order{300003, batch_symbol, OrderType::Limit, Side::Buy, 1000, 100, now};
+    stop_ops[1].order = Order{300004, batch_symbol, OrderType::Limit, Side::Buy, 500, 99, now};
+    EngineRequest stop_batch;
+    stop_batch.type = EngineRequest::Type::Batch;
+    stop_batch.symbol_id = batch_symbol;
+    stop_batch.ops = &stop_ops;
+    engine.execute(stop_batch);
+    assert(stop_ops[0].trades.size() == 1 && stop_ops[1].trades.empty());
+    assert(stop_batch.fired.size() == 1 && stop_batch.fired[0].trades.empty());
+    long long bid = 0;
+    assert(batch_entry.book.best_bid(bid) && bid == 99);
+
+    // A Replace takes its order id only once the cancel found its target
+    std::vector<BookOp> gone(2);
+    gone[0].type = BookOp::Type::Replace;
+    gone[0].order_id = 399999;
+    gone[0].order = Order{0, batch_symbol, OrderType::Limit, Side::Buy, 100, 98, now};
+    gone[1].type = BookOp::Type::Replace;
+    gone[1].order_id = 300004;
+    gone[1].order = Order{0, batch_symbol, OrderType::Limit, Side::Buy, 100, 98, now};
+    EngineRequest gone_batch;
+    gone_batch.type = EngineRequest::Type::Batch;
+    gone_batch.symbol_id = batch_symbol;
+    gone_batch.ops = &gone;
+    uint64_t ids = g_total_orders.load();
+    engine.execute(gone_batch);
+    assert(!gone[0].cancelled && gone[0].order.order_id == 0);
+    assert(gone[1].cancelled && gone[1].order.order_id == make_order_id(batch_symbol, ids + 1));
+    assert(g_total_orders.load() == ids + 1);
+
+    // A trade through a buy stop fires it on the shard in the same request
+    StopOrder buy_stop = stop;
+    buy_stop.order_id = 200003;
+    buy_stop.side = Side::Buy;
+    buy_stop.trigger_price = 3000000;
+    g_symbol_registry.at(symbol_id)->stops.add_stop_order(buy_stop);
+    for (uint64_t id : {200004, 200005}) {
+        EngineRequest ask;
+        ask.type = EngineRequest::Type::NewOrder;
+        ask.symbol_id = symbol_id;
+        ask.order = Order{id, symbol_id, OrderType::Limit, Side::Sell, 1000, 3000000, std::chrono::system_clock::now()};
+        engine.execute(ask);
+    }
+    EngineRequest lift;
+    lift.type = EngineRequest::Type::NewOrder;
+    lift.symbol_id = symbol_id;
+    lift.order = Order{200006, symbol_id, OrderType::Market, Side::Buy, 1000, 0, std::chrono::system_clock::now()};
+    engine.execute(lift);
+    assert(lift.trades.size() == 1 && lift.fired.size() == 1);
+    assert(lift.fired[0].order.order_id == 200003 && lift.fired[0].trades.size() == 1);
+    assert(lift.fired[0].trades[0].maker_order_id == 200005);
+
+    engine.stop();
+    std::cout << "[TEST] PASS - Matching engine passed\n";
+}
+
+void test_symbol_registry() {
+    std::cout << "[TEST] Symbol registry concurrent create/find...\n";
+    SymbolRegistry registry(64);
+    const int threads_n = 8;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<SymbolEntry*>> seen(threads_n);
+    for (int t = 0; t < threads_n; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 40; ++i) {
+                seen[t].push_back(&registry.get_or_create("SYM-" + std::to_string(i)));
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    assert(registry.size() == 40);
+    for (int t = 1; t < threads_n; ++t) assert(seen[t] == seen[0]);
+    for (int i = 0; i < 40; ++i) {
+        SymbolEntry *entry = registry.find("SYM-" + std::to_string(i));
+        assert(entry == seen[0][i]);
+        assert(registry.at(entry->id) == entry);
+    }
+    assert(registry.find("MISSING") == nullptr);
+
+    size_t visited = 0;
+    registry.for_each([&](const SymbolEntry &) { ++visited; });
+    assert(visited == 40);
+
+    bool threw = false;
+    for (int i = 40; i <= 64 && !threw; ++i) {
+        try { registry.get_or_create("SYM-" + std::to_string(i)); } catch (const std::runtime_error &) { threw = true; }
+    }
+    assert(threw && registry.size() == 64);
+    std::cout << "[TEST] PASS - Symbol registry passed\n";
+}
+
+void test_thread_topology() {
+    std::cout << "[TEST] Thread groups: config, placement, busy-poll shards...\n";
+    std::vector<int> cpus;
+    assert(parse_cpu_list("0-3,8,10-11\n", cpus) && cpus == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+    assert(parse_cpu_list("", cpus) && cpus.empty());
+    assert(!parse_cpu_list("3-1", cpus) && !parse_cpu_list("1,,2", cpus) && !parse_cpu_list("x", cpus));
+
+    const std::string path = "./data/test_threads_config.json";
+    {
+        std::ofstream out(path);
+        out << R"({"gateway": {"port": 0, "busy_poll": true},
+                  "threads": {"matching": {"count": 3, "cpus": "0-1", "busy_poll": true},
+                              "wal": {"cpus": [1]}, "broadcast": {"count": 2},
+                              "websocket": {"count": 1, "numa_node": 0}, "http": {"count": 4}}})";
+    }
+    EngineConfig config = EngineConfig::load(path);
+    assert(config.matching.shards == 3 && config.matching.threads.cpus == std::vector<int>({0, 1}));
+    assert(config.matching.threads.busy_poll && config.gateway.threads.busy_poll);
+    assert(config.wal.threads.cpus == std::vector<int>({1}) && config.broadcast.threads.count == 2);
+    assert(config.websocket.threads.numa_node == 0 && config.http.threads.count == 4);
+    {
+        std::ofstream out(path);
+        out << R"({"threads": {"wal": {"count": 2}}})";
+    }
+    bool threw = false;
+    try { EngineConfig::load(path); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    // A ladder band is allocated up front, so its size is capped
+    {
+        std::ofstream out(path);
+        out << R"({"max_ladder_levels": 1000,
+                  "price_bands": {"CAP": {"min_price": 100.0, "max_price": 109.99, "tick_size": 0.01}}})";
+    }
+    assert(EngineConfig::load(path).price_band("CAP")->num_levels() == 1000);
+    {
+        std::ofstream out(path);
+        out << R"({"max_ladder_levels": 1000,
+                  "price_bands": {"CAP": {"min_price": 100.0, "max_price": 110.0, "tick_size": 0.01}}})";
+    }
+    threw = false;
+    try { EngineConfig::load(path); } catch (const std::runtime_error &) { threw = true; }
+    assert(threw);
+    std::remove(path.c_str());
+
+#ifdef __linux__
+    // Pin to the first CPU this process may use; the thread takes its name
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    assert(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    int first = 0;
+    while (!CPU_ISSET(first, &allowed)) ++first;
+    ThreadGroupConfig group;
+    group.cpus = {first};
+    std::thread([&] {
+        place_current_thread(group, 5, "test");
+        cpu_set_t now;
+        CPU_ZERO(&now);
+        assert(pthread_getaffinity_np(pthread_self(), sizeof(now), &now) == 0);
+        assert(CPU_COUNT(&now) == 1 && CPU_ISSET(first, &now));
+        char name[16] = {};
+        assert(pthread_getname_np(pthread_self(), name, sizeof(name)) == 0 && std::string(name) == "test-5");
+    }).join();
+#endif
+
+    // A pinned, busy-polling shard still serves requests and stops cleanly
+    MatchingEngineConfig engine_config;
+    engine_config.shards = 1;
+    engine_config.threads.busy_poll = true;
+#ifdef __linux__
+    engine_config.threads.cpus = {first};
+#endif
+    MatchingEngine engine(engine_config);
+    engine.start();
+    EngineRequest req;
+    req.type = EngineRequest::Type::NewOrder;
+    req.symbol_id = g_symbol_registry.get_or_create("TOPOLOGY-TEST").id;
+    req.order = Order{1, req.symbol_id, OrderType::Limit, Side::Buy, 1000000, 10000, std::chrono::system_clock::now()};
+    engine.execute(req);
+    assert(req.trades.empty() && g_symbol_registry.find("TOPOLOGY-TEST")->book.best_bid(req.order.price));
+    engine.stop();
+    std::cout << "[TEST] PASS - Thread groups passed\n";
+}
+
+void run_matching_engine_tests() {
+    std::cout << "\n========================================\n";
+    std::cout << "  Running Matching Engine Tests\n";
+    std::cout << "========================================\n\n";
+
+    test_mpsc_ring();
+    test_symbol_registry();
+    // Shard requests are logged through global_wal: keep them out of ./data/wal.jsonl
+    WalConfig previous = global_wal.config();
+    WalConfig config = previous;
+    config.path = "./data/test_engine_wal.jsonl";
+    std::filesystem::remove(config.path);
+    global_wal.configure(config);
+    test_matching_engine_shards();
+    global_wal.configure(previous);
+    std::filesystem::remove(config.path);
+    test_thread_topology();
+}
@@ -2,17 +2,25 @@
 #include <cassert>
 #include <chrono>
 #include "../include/order_store.h"
+#include "../include/latency_histogram.h"
+#include "../include/order_parser.h"
+#include "../include/global_state.h"
 
 // forward declaration implemented in test_order_book.cpp
 void run_order_book_tests();
+void run_matching_engine_tests();
+void run_wal_tests();
+void run_ws_server_tests();
+void run_order_gateway_tests();
 
 int main() {
+    g_broadcast_queue.start(); // the server starts it once its config is loaded
     OrderStore store("./data/test_wal.jsonl");
     Order o1;
     o1.order_id = store.next_id();
-    o1.symbol = "BTC-USDT";
-    o1.order_type = "limit";
-    o1.side = "buy";
+    o1.symbol_id = 0;
+    o1.order_type = OrderType::Limit;
+    o1.side = Side::Buy;
     o1.quantity = 1000000;
     o1.price = 5000000;
     o1.timestamp = std::chrono::system_clock::now();
@@ -24,8 +32,85 @@ int main() {
     o2.order_id = store.next_id();
     assert(o2.order_id != o1.order_id);
 
+    // Ids are integers internally; prefixes only exist at the API boundary
+    uint64_t id = 0;
+    assert(parse_order_id(format_order_id(42), id) && id == 42);
+    assert(parse_order_id("STO-7", id) && id == 7);
+    assert(parse_order_id("19", id) && id == 19);
+    assert(!parse_order_id("ORD-", id) && !parse_order_id("ORD-12x", id));
+    assert(!parse_order_id("99999999999999999999999", id));
+
+    // Order ids carry their symbol; pre-layout ids (top field 0) do not
+    uint32_t symbol_id = 0;
+    uint64_t tagged = make_order_id(0, 1);
+    assert(tagged != 1 && order_id_symbol(tagged, symbol_id) && symbol_id == 0);
+    assert(order_id_symbol(make_order_id(16383, ORDER_ID_SEQ_MASK), symbol_id) && symbol_id == 16383);
+    assert((make_order_id(7, 5) & ORDER_ID_SEQ_MASK) == 5 && make_order_id(7, 5) < make_order_id(7, 6));
+    assert(!order_id_symbol(42, symbol_id));
+    assert(parse_order_id(format_order_id(tagged), id) && id == tagged);
+    Side side;
+    OrderType type;
+    assert(parse_side(to_string(Side::Sell), side) && side == Side::Sell);
+    assert(parse_order_type(to_string(OrderType::Fok), type) && type == OrderType::Fok);
+    assert(!parse_order_type("stop", type));
+
+    // Exact decimal -> fixed point (0.29 * 100 as a double truncates to 28)
+    long long fx = 0;
+    assert(decimal_to_fixed("0.29", PRICE_DECIMALS, fx) && fx == 29);
+    assert(decimal_to_fixed("50000.5", PRICE_DECIMALS, fx) && fx == 5000050);
+    assert(decimal_to_fixed("0.0000019", QUANTITY_DECIMALS, fx) && fx == 1);
+    assert(decimal_to_fixed("1.5e-1", QUANTITY_DECIMALS, fx) && fx == 150000);
+    assert(decimal_to_fixed("2E3", PRICE_DECIMALS, fx) && fx == 200000);
+    assert(decimal_to_fixed("-0.5", PRICE_DECIMALS, fx) && fx == -50);
+    assert(decimal_to_fixed("0", QUANTITY_DECIMALS, fx) && fx == 0);
+    assert(decimal_to_fixed("92233720368547758.07", PRICE_DECIMALS, fx) && fx == 9223372036854775807LL);
+    assert(!decimal_to_fixed("92233720368547758.08", PRICE_DECIMALS, fx));
+    assert(!decimal_to_fixed("1e300", QUANTITY_DECIMALS, fx));
+    for (const char *bad : {"", "-", "01", "1.", ".5", "1e", "+1", "1x", "0x10", "1..2"}) {
+        assert(!decimal_to_fixed(bad, PRICE_DECIMALS, fx));
+    }
+
+    // On-demand /orders parsing: valid orders only, everything else goes to the DOM path
+    OrderFields f;
+    assert(parse_order_fast(R"( {"symbol":"BTC-USDT", "order_type":"limit","side":"sell",
+                                "quantity":0.29,"price":50000.07,"client":"x","tag":null} )", f));
+    assert(f.symbol == "BTC-USDT" && f.order_type == OrderType::Limit && f.side == Side::Sell);
+    assert(f.quantity == 290000 && f.price == 5000007);
+    assert(parse_order_fast(R"({"side":"buy","quantity":1,"order_type":"market","symbol":"ETH"})", f));
+    assert(f.order_type == OrderType::Market && f.price == 0 && f.quantity == 1000000);
+    for (const char *bad : {
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":1})",             // no price
+             R"({"symbol":"BTC","order_type":"stop","side":"buy","quantity":1,"price":1})",    // bad type
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":0,"price":1})",   // zero qty
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":"1","price":1})", // string qty
+             R"({"symbol":"B\u0054C","order_type":"limit","side":"buy","quantity":1,"price":1})",  // escape
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":1,"price":1,"x":{}})",
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":1,"price":1,})",
+             R"({"symbol":"BTC","order_type":"limit","side":"buy","quantity":1,"price":1} x)",
+             "[]", ""}) {
+        assert(!parse_order_fast(bad, f));
+    }
+
+    // Benchmark histogram: exact below 256, within 1/128 above, percentiles capped at max
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 1000; ++v) h.record(v);
+    assert(h.count() == 1000 && h.min() == 1 && h.max() == 1000);
+    assert(h.percentile(10) == 100 && h.percentile(100) == 1000);
+    uint64_t p99 = h.percentile(99);
+    assert(p99 >= 990 && p99 <= 990 + 990 / 128);
+    assert(LatencyHistogram::highest_in(LatencyHistogram::index_of(123456789)) >= 123456789);
+    assert(LatencyHistogram::highest_in(LatencyHistogram::index_of(123456789)) <= 123456789 + 123456789 / 128);
+    LatencyHistogram tail;
+    tail.record(5'000'000);
+    h.merge(tail);
+    assert(h.count() == 1001 && h.max() == 5'000'000 && h.percentile(99.99) >= 4'960'000);
+
     // run order_book tests
     run_order_book_tests();
+    run_matching_engine_tests();
+    run_wal_tests();
+    run_ws_server_tests();
+    run_order_gateway_tests();
 
     return 0;
 }
\ No newline at end of file
@@ -4,19 +4,23 @@
 #include <cassert>
 #include <chrono>
 #include <iostream>
+#include <random>
+#include <string>
 #include <thread>
 #include "../include/order_book.h"
 #include "../include/order.h"
+#include "../include/stop_order_manager.h"
+#include "../include/metrics.h"
 
 void test_basic_matching() {
     std::cout << "[TEST] Basic limit order matching...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
 
-    Order sell{"S1", "BTC-USDT", "limit", "sell", 1000000, 1000000, 
+    Order sell{1, 0, OrderType::Limit, Side::Sell, 1000000, 1000000, 
                std::chrono::system_clock::now()};
     ob.add_order(sell);
 
-    Order buy{"B1", "BTC-USDT", "limit", "buy", 500000, 1100000, 
+    Order buy{101, 0, OrderType::Limit, Side::Buy, 500000, 1100000, 
               std::chrono::system_clock::now()};
     auto trades = ob.add_order(buy);
     
@@ -28,16 +32,16 @@ void test_basic_matching() {
 
 void test_market_order() {
     std::cout << "[TEST] Market order execution...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
-    Order s1{"S1", "BTC-USDT", "limit", "sell", 300000, 1000000, 
+    Order s1{1, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
              std::chrono::system_clock::now()};
-    Order s2{"S2", "BTC-USDT", "limit", "sell", 300000, 1000000, 
+    Order s2{2, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
              std::chrono::system_clock::now()};
     ob.add_order(s1);
     ob.add_order(s2);
 
-    Order market_buy{"B1", "BTC-USDT", "market", "buy", 500000, 0, 
+    Order market_buy{101, 0, OrderType::Market, Side::Buy, 500000, 0, 
                      std::chrono::system_clock::now()};
     auto trades = ob.add_order(market_buy);
     
@@ -49,13 +53,13 @@ void test_market_order() {
 
 void test_ioc_order() {
     std::cout << "[TEST] IOC (Immediate-or-Cancel) order...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
-    Order sell{"S1", "BTC-USDT", "limit", "sell", 300000, 1000000, 
+    Order sell{1, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
                std::chrono::system_clock::now()};
     ob.add_order(sell);
     
-    Order ioc{"B1", "BTC-USDT", "ioc", "buy", 500000, 1100000, 
+    Order ioc{101, 0, OrderType::Ioc, Side::Buy, 500000, 1100000, 
               std::chrono::system_clock::now()};
     auto trades = ob.add_order(ioc);
     
@@ -71,20 +75,20 @@ void test_ioc_order() {
 
 void test_fok_order() {
     std::cout << "[TEST] FOK (Fill-or-Kill) order...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
-    Order sell{"S1", "BTC-USDT", "limit", "sell", 300000, 1000000, 
+    Order sell{1, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
                std::chrono::system_clock::now()};
     ob.add_order(sell);
     
     // FOK that cannot be fully filled - should be cancelled
-    Order fok1{"B1", "BTC-USDT", "fok", "buy", 500000, 1100000, 
+    Order fok1{101, 0, OrderType::Fok, Side::Buy, 500000, 1100000, 
                std::chrono::system_clock::now()};
     auto trades1 = ob.add_order(fok1);
     assert(trades1.empty()); // Order cancelled
     
     // FOK that can be fully filled
-    Order fok2{"B2", "BTC-USDT", "fok", "buy", 300000, 1100000, 
+    Order fok2{102, 0, OrderType::Fok, Side::Buy, 300000, 1100000, 
                std::chrono::system_clock::now()};
     auto trades2 = ob.add_order(fok2);
     assert(trades2.size() == 1);
@@ -93,15 +97,44 @@ void test_fok_order() {
     std::cout << "[TEST] PASS - FOK order passed\n";
 }
 
+void test_fill_buffer_and_fok_levels() {
+    std::cout << "[TEST] Fill buffer and level-aggregate FOK...\n";
+    OrderBook ob(0);
+    auto now = std::chrono::system_clock::now();
+    for (uint64_t i = 0; i < 3; ++i) {
+        ob.add_order(Order{1 + i, 0, OrderType::Limit, Side::Sell, 100000, 1000000, now});
+        ob.add_order(Order{11 + i, 0, OrderType::Limit, Side::Sell, 100000, 1000100, now});
+    }
+    // A partial fill leaves 50000 open at 1000000
+    std::vector<Trade> fills;
+    assert(ob.add_order(Order{20, 0, OrderType::Ioc, Side::Buy, 250000, 1000000, now}, fills) == 3);
+    assert(fills.size() == 3 && fills[2].maker_order_id == 3 && fills[2].quantity == 50000);
+
+    // Appends without clearing; a failed FOK leaves the buffer as it was
+    assert(ob.add_order(Order{21, 0, OrderType::Fok, Side::Buy, 50001, 1000000, now}, fills) == 0);
+    assert(ob.add_order(Order{22, 0, OrderType::Fok, Side::Buy, 350001, 1000100, now}, fills) == 0);
+    assert(fills.size() == 3);
+
+    // Exactly what the two levels hold sweeps both
+    fills.clear();
+    const Trade *buffer = fills.data();
+    assert(ob.add_order(Order{23, 0, OrderType::Fok, Side::Buy, 350000, 1000100, now}, fills) == 4);
+    assert(fills.data() == buffer); // reused capacity, no reallocation
+    assert(fills[0].maker_order_id == 3 && fills[0].quantity == 50000 && fills[3].maker_order_id == 13);
+    long long ask = 0;
+    assert(!ob.best_ask(ask));
+    std::cout << "[TEST] PASS - Fill buffer and level-aggregate FOK passed\n";
+}
+
 void test_partial_fill() {
     std::cout << "[TEST] Partial fill with resting order...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
-    Order s1{"S1", "BTC-USDT", "limit", "sell", 300000, 1000000, 
+    Order s1{1, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
              std::chrono::system_clock::now()};
     ob.add_order(s1);
 
-    Order buy{"B1", "BTC-USDT", "limit", "buy", 500000, 1100000, 
+    Order buy{101, 0, OrderType::Limit, Side::Buy, 500000, 1100000, 
               std::chrono::system_clock::now()};
     auto trades = ob.add_order(buy);
     
@@ -114,14 +147,14 @@ void test_partial_fill() {
 
 void test_price_time_priority() {
     std::cout << "[TEST] Price-time priority (FIFO)...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
     // Add three sell orders at same price
-    Order s1{"S1", "BTC-USDT", "limit", "sell", 100000, 1000000, 
+    Order s1{1, 0, OrderType::Limit, Side::Sell, 100000, 1000000, 
              std::chrono::system_clock::now()};
-    Order s2{"S2", "BTC-USDT", "limit", "sell", 100000, 1000000, 
+    Order s2{2, 0, OrderType::Limit, Side::Sell, 100000, 1000000, 
              std::chrono::system_clock::now()};
-    Order s3{"S3", "BTC-USDT", "limit", "sell", 100000, 1000000, 
+    Order s3{3, 0, OrderType::Limit, Side::Sell, 100000, 1000000, 
              std::chrono::system_clock::now()};
     
     ob.add_order(s1);
@@ -131,29 +164,29 @@ void test_price_time_priority() {
     ob.add_order(s3);
     
     // Buy order should match S1 first (FIFO)
-    Order buy{"B1", "BTC-USDT", "limit", "buy", 100000, 1100000, 
+    Order buy{101, 0, OrderType::Limit, Side::Buy, 100000, 1100000, 
               std::chrono::system_clock::now()};
     auto trades = ob.add_order(buy);
     
     assert(trades.size() == 1);
-    assert(trades[0].maker_order_id == "S1");
+    assert(trades[0].maker_order_id == 1);
     std::cout << "[TEST] PASS - Price-time priority passed\n";
 }
 
 void test_fee_calculation() {
     std::cout << "[TEST] Fee calculation...\n";
-    OrderBook ob("BTC-USDT");
+    OrderBook ob(0);
     
     FeeConfig fees;
     fees.maker_fee_bps = 10;  // 0.10%
     fees.taker_fee_bps = 20;  // 0.20%
     ob.set_fee_config(fees);
     
-    Order sell{"S1", "BTC-USDT", "limit", "sell", 1000000, 5000000, 
+    Order sell{1, 0, OrderType::Limit, Side::Sell, 1000000, 5000000, 
                std::chrono::system_clock::now()};
     ob.add_order(sell);
     
-    Order buy{"B1", "BTC-USDT", "limit", "buy", 1000000, 5000000, 
+    Order buy{101, 0, OrderType::Limit, Side::Buy, 1000000, 5000000, 
               std::chrono::system_clock::now()};
     auto trades = ob.add_order(buy);
     
@@ -165,6 +198,440 @@ void test_fee_calculation() {
     std::cout << "[TEST] PASS - Fee calculation passed\n";
 }
 
+void test_partial_fill_keeps_maker_priority() {
+    std::cout << "[TEST] Partially filled maker keeps queue position...\n";
+    OrderBook ob(0);
+
+    Order s1{1, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
+             std::chrono::system_clock::now()};
+    Order s2{2, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
+             std::chrono::system_clock::now()};
+    ob.add_order(s1);
+    ob.add_order(s2);
+
+    Order b1{101, 0, OrderType::Limit, Side::Buy, 100000, 1000000, 
+             std::chrono::system_clock::now()};
+    auto t1 = ob.add_order(b1);
+    assert(t1.size() == 1 && t1[0].maker_order_id == 1);
+
+    // S1 still has 200000 left and must be matched before S2
+    Order b2{102, 0, OrderType::Limit, Side::Buy, 250000, 1000000, 
+             std::chrono::system_clock::now()};
+    auto t2 = ob.add_order(b2);
+    assert(t2.size() == 2);
+    assert(t2[0].maker_order_id == 1 && t2[0].quantity == 200000);
+    assert(t2[1].maker_order_id == 2 && t2[1].quantity == 50000);
+
+    auto asks = ob.top_asks(5);
+    assert(asks.size() == 1 && asks[0].second == 250000);
+    std::cout << "[TEST] PASS - Maker priority after partial fill passed\n";
+}
+
+void test_cancel_order() {
+    std::cout << "[TEST] Cancel resting orders...\n";
+    OrderBook ob(0);
+
+    Order s1{1, 0, OrderType::Limit, Side::Sell, 100000, 1000000, 
+             std::chrono::system_clock::now()};
+    Order s2{2, 0, OrderType::Limit, Side::Sell, 200000, 1000000, 
+             std::chrono::system_clock::now()};
+    Order s3{3, 0, OrderType::Limit, Side::Sell, 300000, 1000000, 
+             std::chrono::system_clock::now()};
+    Order s4{4, 0, OrderType::Limit, Side::Sell, 400000, 1010000, 
+             std::chrono::system_clock::now()};
+    ob.add_order(s1);
+    ob.add_order(s2);
+    ob.add_order(s3);
+    ob.add_order(s4);
+
+    // Cancel from the middle of a level, then an entire level
+    assert(ob.cancel_order(2));
+    assert(!ob.cancel_order(2));
+    assert(ob.cancel_order(4));
+    assert(!ob.cancel_order(999));
+
+    auto asks = ob.top_asks(5);
+    assert(asks.size() == 1);
+    assert(asks[0].first == 1000000 && asks[0].second == 400000);
+
+    Order buy{101, 0, OrderType::Market, Side::Buy, 400000, 0, 
+              std::chrono::system_clock::now()};
+    auto trades = ob.add_order(buy);
+    assert(trades.size() == 2);
+    assert(trades[0].maker_order_id == 1);
+    assert(trades[1].maker_order_id == 3);
+    assert(ob.top_asks(5).empty());
+    assert(!ob.cancel_order(3)); // fully filled makers leave the index
+    std::cout << "[TEST] PASS - Cancel orders passed\n";
+}
+
+void test_ladder_matches_map_book() {
+    std::cout << "[TEST] Ladder book matches map book...\n";
+    PriceBand band;
+    band.min_price = 900000;
+    band.max_price = 1100000;
+    band.tick_size = 10;
+    OrderBook map_book(0);
+    OrderBook ladder_book(0, band);
+    assert(!map_book.uses_ladder() && ladder_book.uses_ladder());
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<long long> tick_dist(0, (band.max_price - band.min_price) / band.tick_size);
+    std::uniform_int_distribution<long long> qty_dist(1, 50);
+    std::uniform_int_distribution<int> kind_dist(0, 9);
+    std::vector<uint64_t> live;
+
+    for (int i = 0; i < 20000; ++i) {
+        int kind = kind_dist(gen);
+        if (kind == 0 && !live.empty()) {
+            std::uniform_int_distribution<size_t> pick(0, live.size() - 1);
+            size_t idx = pick(gen);
+            bool a = map_book.cancel_order(live[idx]);
+            bool b = ladder_book.cancel_order(live[idx]);
+            assert(a == b);
+            live[idx] = live.back();
+            live.pop_back();
+            continue;
+        }
+        Order o;
+        o.order_id = static_cast<uint64_t>(i) + 1;
+        o.symbol_id = 0;
+        o.order_type = kind == 1 ? OrderType::Market : (kind == 2 ? OrderType::Ioc : (kind == 3 ? OrderType::Fok : OrderType::Limit));
+        o.side = (gen() & 1) ? Side::Buy : Side::Sell;
+        o.quantity = qty_dist(gen) * 1000;
+        o.price = o.order_type == OrderType::Market ? 0 : band.min_price + tick_dist(gen) * band.tick_size;
+        o.timestamp = std::chrono::system_clock::now();
+
+        auto ta = map_book.add_order(o);
+        auto tb = ladder_book.add_order(o);
+        assert(ta.size() == tb.size());
+        for (size_t k = 0; k < ta.size(); ++k) {
+            assert(ta[k].maker_order_id == tb[k].maker_order_id);
+            assert(ta[k].price == tb[k].price && ta[k].quantity == tb[k].quantity);
+        }
+        if (o.order_type == OrderType::Limit) live.push_back(o.order_id);
+    }
+    assert(map_book.top_bids(50) == ladder_book.top_bids(50));
+    assert(map_book.top_asks(50) == ladder_book.top_asks(50));
+    std::cout << "[TEST] PASS - Ladder/map parity passed\n";
+}
+
+void test_ladder_band_edges() {
+    std::cout << "[TEST] Ladder book band edges...\n";
+    PriceBand band;
+    band.min_price = 100;
+    band.max_price = 100 + 100000;
+    OrderBook ob(0, band);
+
+    assert(!ob.accepts_price(99));
+    assert(!ob.accepts_price(band.max_price + 1));
+    assert(ob.accepts_price(band.min_price) && ob.accepts_price(band.max_price));
+
+    // Out-of-band limits are rejected without resting
+    Order bad{301, 0, OrderType::Limit, Side::Buy, 1000, 50, std::chrono::system_clock::now()};
+    assert(ob.add_order(bad).empty());
+    assert(ob.top_bids(1).empty());
+
+    // Levels far apart exercise the summary bitmap
+    Order b1{101, 0, OrderType::Limit, Side::Buy, 1000, band.min_price, std::chrono::system_clock::now()};
+    Order b2{102, 0, OrderType::Limit, Side::Buy, 2000, band.min_price + 70000, std::chrono::system_clock::now()};
+    Order a1{201, 0, OrderType::Limit, Side::Sell, 3000, band.max_price, std::chrono::system_clock::now()};
+    ob.add_order(b1);
+    ob.add_order(b2);
+    ob.add_order(a1);
+    auto bids = ob.top_bids(5);
+    assert(bids.size() == 2 && bids[0].first == band.min_price + 70000 && bids[1].first == band.min_price);
+
+    Order sweep{1, 0, OrderType::Market, Side::Sell, 3000, 0, std::chrono::system_clock::now()};
+    auto trades = ob.add_order(sweep);
+    assert(trades.size() == 2 && trades[0].maker_order_id == 102 && trades[1].maker_order_id == 101);
+    assert(ob.top_bids(5).empty());
+    assert(ob.top_asks(5).size() == 1 && ob.top_asks(5)[0].first == band.max_price);
+    std::cout << "[TEST] PASS - Ladder band edges passed\n";
+}
+
+void test_depth_snapshot_cache() {
+    std::cout << "[TEST] Level aggregates and cached depth snapshot...\n";
+    OrderBook ob(0);
+    for (int i = 0; i < 5; ++i) {
+        Order s{static_cast<uint64_t>(i) + 1, 0, OrderType::Limit, Side::Sell, 100000, 1000000 + i * 100,
+                std::chrono::system_clock::now()};
+        ob.add_order(s);
+    }
+    Order extra{10, 0, OrderType::Limit, Side::Sell, 50000, 1000000, std::chrono::system_clock::now()};
+    ob.add_order(extra);
+
+    auto snap = ob.depth_snapshot(3);
+    assert(snap->asks.size() == 3);
+    assert(snap->asks[0].first == 1000000 && snap->asks[0].second == 150000);
+    assert(ob.depth_snapshot(3) == snap); // unchanged book: same cached object
+
+    // Changes below the third level leave the snapshot untouched
+    Order deep{11, 0, OrderType::Limit, Side::Sell, 100000, 1000400, std::chrono::system_clock::now()};
+    ob.add_order(deep);
+    assert(ob.cancel_order(5));
+    assert(ob.depth_snapshot(3) == snap);
+
+    // A partial fill at the top rebuilds it with the new aggregate
+    Order buy{101, 0, OrderType::Market, Side::Buy, 120000, 0, std::chrono::system_clock::now()};
+    ob.add_order(buy);
+    auto snap2 = ob.depth_snapshot(3);
+    assert(snap2 != snap && snap2->version > snap->version);
+    assert(snap2->asks[0].first == 1000000 && snap2->asks[0].second == 30000);
+    assert(ob.mark_published(snap2->version));
+    assert(!ob.mark_published(snap2->version));
+
+    long long best = 0;
+    assert(ob.best_ask(best) && best == 1000000);
+    assert(!ob.best_bid(best));
+    std::cout << "[TEST] PASS - Depth snapshot cache passed\n";
+}
+
+void test_recent_trades_ring() {
+    std::cout << "[TEST] Recent trades ring...\n";
+    OrderBook ob(0);
+    assert(ob.recent_trades(10).empty());
+    for (int i = 0; i < 5; ++i) {
+        Order s{static_cast<uint64_t>(i) + 1, 0, OrderType::Limit, Side::Sell, 1000, 1000000,
+                std::chrono::system_clock::now()};
+        Order b{static_cast<uint64_t>(i) + 101, 0, OrderType::Market, Side::Buy, 1000, 0,
+                std::chrono::system_clock::now()};
+        ob.add_order(s);
+        assert(ob.add_order(b).size() == 1);
+    }
+    auto all = ob.recent_trades(50);
+    assert(all.size() == 5);
+    assert(all[0].taker_order_id == 105 && all[4].taker_order_id == 101); // newest first
+    for (size_t i = 1; i < all.size(); ++i) assert(all[i - 1].trade_id > all[i].trade_id);
+
+    auto newest = ob.recent_trades(2);
+    assert(newest.size() == 2 && newest[0].trade_id == all[0].trade_id);
+
+    // since_trade_id returns the trades right after it, still newest first
+    auto after = ob.recent_trades(2, all[4].trade_id);
+    assert(after.size() == 2 && after[0].trade_id == all[2].trade_id && after[1].trade_id == all[3].trade_id);
+    assert(ob.recent_trades(10, all[0].trade_id).empty());
+
+    // A full ring overwrites its oldest trades
+    TradeRing<Trade> ring(3);
+    for (uint64_t id = 1; id <= 7; ++id) {
+        Trade t{};
+        t.trade_id = id;
+        ring.push(t);
+    }
+    auto kept = ring.recent(10);
+    assert(ring.size() == 3 && kept.size() == 3 && kept[0].trade_id == 7 && kept[2].trade_id == 5);
+    assert(ring.recent(10, 2).size() == 3 && ring.recent(1, 5)[0].trade_id == 6);
+    std::cout << "[TEST] PASS - Recent trades ring passed\n";
+}
+
+void test_apply_batch() {
+    std::cout << "[TEST] Batched book operations...\n";
+    OrderBook ob(0);
+    auto now = std::chrono::system_clock::now();
+    std::vector<BookOp> ops(5);
+    ops[0].order = Order{1, 0, OrderType::Limit, Side::Sell, 1000, 1000000, now};
+    ops[1].order = Order{2, 0, OrderType::Limit, Side::Sell, 1000, 1000000, now};
+    ops[2].type = BookOp::Type::Replace; // moves order 1 behind order 2
+    ops[2].order_id = 1;
+    ops[2].order = Order{3, 0, OrderType::Limit, Side::Sell, 500, 1000000, now};
+    ops[3].type = BookOp::Type::Cancel;
+    ops[3].order_id = 99; // unknown
+    ops[4].order = Order{4, 0, OrderType::Market, Side::Buy, 1200, 0, now};
+    ob.apply_batch(ops);
+
+    assert(ops[0].trades.empty() && ops[1].trades.empty());
+    assert(ops[2].cancelled && ops[2].trades.empty());
+    assert(!ops[3].cancelled);
+    // Same result as applying the ops one by one
+    assert(ops[4].trades.size() == 2);
+    assert(ops[4].trades[0].maker_order_id == 2 && ops[4].trades[0].quantity == 1000);
+    assert(ops[4].trades[1].maker_order_id == 3 && ops[4].trades[1].quantity == 200);
+    assert(!ob.cancel_order(1) && ob.cancel_order(3));
+
+    // A replace of an order that is gone adds nothing
+    std::vector<BookOp> again(1);
+    again[0].type = BookOp::Type::Replace;
+    again[0].order_id = 1;
+    again[0].order = Order{5, 0, OrderType::Limit, Side::Buy, 10, 1, now};
+    ob.apply_batch(again);
+    assert(!again[0].cancelled && ob.top_bids(1).empty());
+    std::cout << "[TEST] PASS - Batched book operations passed\n";
+}
+
+void test_amend_order() {
+    std::cout << "[TEST] Amend keeps priority on size-down only...\n";
+    OrderBook ob(0);
+    auto now = std::chrono::system_clock::now();
+    ob.add_order(Order{1, 0, OrderType::Limit, Side::Sell, 1000, 10000, now});
+    ob.add_order(Order{2, 0, OrderType::Limit, Side::Sell, 1000, 10000, now});
+
+    // Size-down in place: order 1 still trades first
+    AmendResult down = ob.amend_order(1, 400, 0);
+    assert(down.amended && !down.requeued && down.previous_quantity == 1000);
+    assert(down.order.quantity == 400 && down.order.price == 10000);
+    assert(ob.top_asks(1)[0].second == 1400);
+    auto t1 = ob.add_order(Order{10, 0, OrderType::Market, Side::Buy, 300, 0, now});
+    assert(t1.size() == 1 && t1[0].maker_order_id == 1);
+
+    // Size-up goes behind order 3; a new price moves order 1 to its own level
+    ob.add_order(Order{3, 0, OrderType::Limit, Side::Sell, 500, 10000, now});
+    AmendResult up = ob.amend_order(2, 2000, 10000);
+    assert(up.amended && up.requeued && up.trades.empty());
+    AmendResult moved = ob.amend_order(1, 0, 10100);
+    assert(moved.amended && moved.requeued && moved.order.quantity == 100);
+    auto asks = ob.top_asks(2);
+    assert(asks.size() == 2 && asks[0].second == 2500 && asks[1].first == 10100 && asks[1].second == 100);
+    auto t2 = ob.add_order(Order{11, 0, OrderType::Market, Side::Buy, 600, 0, now});
+    assert(t2.size() == 2 && t2[0].maker_order_id == 3 && t2[1].maker_order_id == 2);
+
+    // A re-priced bid that crosses trades like a new order
+    ob.add_order(Order{4, 0, OrderType::Limit, Side::Buy, 500, 9800, now});
+    AmendResult cross = ob.amend_order(4, 0, 10000);
+    assert(cross.amended && cross.trades.size() == 1 && cross.trades[0].maker_order_id == 2);
+    assert(cross.trades[0].taker_order_id == 4 && cross.trades[0].quantity == 500);
+    assert(ob.top_bids(1).empty());
+
+    assert(!ob.amend_order(4, 100, 0).amended);  // filled
+    assert(!ob.amend_order(99, 100, 0).amended); // unknown
+    assert(!ob.amend_order(2, -1, 0).amended);
+    std::cout << "[TEST] PASS - Amend passed\n";
+}
+
+static StopOrder make_stop(uint64_t id, Side side, StopOrderType type, long long trigger, long long quantity,
+                           long long trail = 0) {
+    StopOrder so;
+    so.order_id = id;
+    so.side = side;
+    so.stop_type = type;
+    so.trigger_price = trigger;
+    so.quantity = quantity;
+    so.trail_amount = trail;
+    return so;
+}
+
+// Trigger hook probe: the fired ids, and whether the book had an ask yet
+static OrderBook *g_trigger_book = nullptr;
+static std::vector<std::pair<uint64_t, bool>> g_trigger_calls;
+
+static void record_trigger(TriggeredStop &stop) {
+    long long ask = 0;
+    g_trigger_calls.push_back({stop.order.order_id, g_trigger_book->best_ask(ask)});
+}
+
+void test_stop_triggers() {
+    std::cout << "[TEST] Stops fire inline and cascade...\n";
+    StopOrderManager stops(0);
+    // Sell stops fire highest trigger first once the price falls to them
+    stops.add_stop_order(make_stop(1, Side::Sell, StopOrderType::STOP_LOSS, 9000, 100));
+    stops.add_stop_order(make_stop(2, Side::Sell, StopOrderType::STOP_LOSS, 11000, 100));
+    stops.add_stop_order(make_stop(3, Side::Buy, StopOrderType::STOP_LOSS, 12000, 100));
+    auto fired = stops.check_triggers(10000);
+    assert(fired.size() == 1 && fired[0].order_id == 2 && fired[0].order_type == OrderType::Market);
+    assert(stops.check_triggers(11500).empty());
+    fired = stops.check_triggers(12000);
+    assert(fired.size() == 1 && fired[0].order_id == 3 && fired[0].side == Side::Buy);
+    assert(stops.cancel_stop_order(1) && !stops.cancel_stop_order(1) && stops.size() == 0);
+
+    // A sell at 100 fires the stop at 100, whose sell trades at 99 and fires the one at 99
+    OrderBook ob(0);
+    auto now = std::chrono::system_clock::now();
+    ob.add_order(Order{10, 0, OrderType::Limit, Side::Buy, 100, 10000, now});
+    ob.add_order(Order{11, 0, OrderType::Limit, Side::Buy, 100, 9900, now});
+    ob.add_order(Order{12, 0, OrderType::Limit, Side::Buy, 100, 9800, now});
+    stops.add_stop_order(make_stop(20, Side::Sell, StopOrderType::STOP_LOSS, 10000, 100));
+    StopOrder limit = make_stop(21, Side::Sell, StopOrderType::STOP_LIMIT, 9900, 300);
+    limit.limit_price = 9750;
+    stops.add_stop_order(limit);
+    auto trades = ob.add_order(Order{13, 0, OrderType::Market, Side::Sell, 100, 0, now});
+    std::vector<TriggeredStop> cascade;
+    g_trigger_book = &ob;
+    stops.process_trades(ob, trades, cascade, record_trigger);
+    assert(cascade.size() == 2);
+    // The hook runs before each order enters the book (21 rests its remainder)
+    assert(g_trigger_calls == (std::vector<std::pair<uint64_t, bool>>{{20, false}, {21, false}}));
+    assert(cascade[0].order.order_id == 20 && cascade[0].trades.size() == 1 && cascade[0].trades[0].price == 9900);
+    assert(cascade[1].order.order_id == 21 && cascade[1].order.price == 9750);
+    assert(cascade[1].trades.size() == 1 && cascade[1].trades[0].maker_order_id == 12);
+    long long ask = 0;
+    assert(ob.best_ask(ask) && ask == 9750 && ob.top_asks(1)[0].second == 200); // the rest of 21
+    assert(stops.size() == 0);
+    std::cout << "[TEST] PASS - Stop triggers passed\n";
+}
+
+void test_trailing_stops() {
+    std::cout << "[TEST] Trailing stops follow the extreme price...\n";
+    StopOrderManager stops(0);
+    // Sells trail the high by 500: triggers start at 9500 and 9550
+    stops.add_stop_order(make_stop(1, Side::Sell, StopOrderType::TRAILING_STOP, 9500, 100, 500));
+    stops.add_stop_order(make_stop(2, Side::Sell, StopOrderType::TRAILING_STOP, 9550, 100, 500));
+    stops.add_stop_order(make_stop(3, Side::Sell, StopOrderType::TRAILING_STOP, 9000, 100, 1000));
+    assert(stops.check_triggers(10100).empty()); // 1 and 2 now share the 10100 high
+    auto active = stops.get_active_stops();
+    assert(active.size() == 3);
+    for (const StopOrder &so : active) {
+        if (so.order_id == 3) assert(so.trigger_price == 9100 && so.best_price == 10100);
+        else assert(so.trigger_price == 9600 && so.best_price == 10100);
+    }
+    assert(stops.check_triggers(10400).empty());
+    assert(stops.cancel_stop_order(2)); // cancel after its bucket merged twice
+    assert(stops.check_triggers(10000).empty());
+    auto fired = stops.check_triggers(9900);
+    assert(fired.size() == 1 && fired[0].order_id == 1 && fired[0].order_type == OrderType::Market);
+    fired = stops.check_triggers(9400);
+    assert(fired.size() == 1 && fired[0].order_id == 3);
+
+    // Buys trail the low
+    stops.add_stop_order(make_stop(4, Side::Buy, StopOrderType::TRAILING_STOP, 10500, 100, 500));
+    assert(stops.check_triggers(9800).empty()); // trigger 10300
+    assert(stops.check_triggers(10200).empty());
+    fired = stops.check_triggers(10300);
+    assert(fired.size() == 1 && fired[0].order_id == 4 && fired[0].side == Side::Buy);
+    assert(stops.size() == 0 && stops.get_active_stops().empty());
+    std::cout << "[TEST] PASS - Trailing stops passed\n";
+}
+
+void test_stage_metrics() {
+    std::cout << "[TEST] Stage histograms and Prometheus output...\n";
+    assert(metrics::bucket_of(0) == 0 && metrics::bucket_of(64) == 0);
+    assert(metrics::bucket_of(65) == 1 && metrics::bucket_of(128) == 1 && metrics::bucket_of(129) == 2);
+    assert(metrics::bucket_of(UINT64_MAX) == metrics::BUCKETS - 1);
+
+    // Every book write stamps the lock wait and the match
+    metrics::StageTotals match_before = metrics::totals(Stage::Match);
+    metrics::StageTotals wait_before = metrics::totals(Stage::BookLockWait);
+    OrderBook ob(0);
+    auto now = std::chrono::system_clock::now();
+    ob.add_order(Order{1, 0, OrderType::Limit, Side::Sell, 1000000, 1000000, now});
+    ob.cancel_order(1);
+    assert(metrics::totals(Stage::Match).count == match_before.count + 2);
+    assert(metrics::totals(Stage::BookLockWait).count == wait_before.count + 2);
+
+    // Shards from other threads are summed on scrape, and outlive the thread
+    metrics::StageTotals parse_before = metrics::totals(Stage::Parse);
+    std::thread t([] {
+        metrics::record(Stage::Parse, 100);
+        metrics::record(Stage::Parse, 5000);
+    });
+    t.join();
+    metrics::record(Stage::Parse, 100);
+    metrics::StageTotals parse = metrics::totals(Stage::Parse);
+    assert(parse.count == parse_before.count + 3);
+    assert(parse.sum_ns == parse_before.sum_ns + 5200);
+    assert(parse.buckets[1] == parse_before.buckets[1] + 2);
+
+    std::string out;
+    metrics::write_stage_histograms(out);
+    metrics::write_metric(out, "matching_engine_test_total", "counter", "Test counter", 7);
+    assert(out.find("# TYPE matching_engine_stage_seconds histogram\n") != std::string::npos);
+    assert(out.find("matching_engine_stage_seconds_bucket{stage=\"parse\",le=\"6.4e-08\"}") != std::string::npos);
+    assert(out.find("matching_engine_stage_seconds_count{stage=\"parse\"} " + std::to_string(parse.count) + "\n") !=
+           std::string::npos);
+    assert(out.find("stage=\"ws_send\",le=\"+Inf\"") != std::string::npos);
+    assert(out.find("# TYPE matching_engine_test_total counter\nmatching_engine_test_total 7\n") != std::string::npos);
+    std::cout << "[TEST] PASS - Stage metrics passed\n";
+}
+
 void run_order_book_tests() {
     std::cout << "\n========================================\n";
     std::cout << "  Running Order Book Tests\n";
@@ -174,9 +641,21 @@ void run_order_book_tests() {
     test_market_order();
     test_ioc_order();
     test_fok_order();
+    test_fill_buffer_and_fok_levels();
     test_partial_fill();
     test_price_time_priority();
     test_fee_calculation();
+    test_partial_fill_keeps_maker_priority();
+    test_cancel_order();
+    test_ladder_matches_map_book();
+    test_ladder_band_edges();
+    test_depth_snapshot_cache();
+    test_recent_trades_ring();
+    test_apply_batch();
+    test_amend_order();
+    test_stop_triggers();
+    test_trailing_stops();
+    test_stage_metrics();
     
     std::cout << "\n========================================\n";
     std::cout << "  All Tests Passed!\n";
@@ -0,0 +1,280 @@
+// ============================================================================
+// FILE: tests/test_order_gateway.cpp
+// ============================================================================
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/order_gateway.h"
+#include "../include/order_entry.h"
+#include "../include/byte_codec.h"
+#include "../include/global_state.h"
+#include "../include/replication.h"
+#include "../include/wal.h"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace gateway_proto;
+
+static const int TEST_GATEWAY_PORT = 19103;
+
+static int gw_connect() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval tv{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_GATEWAY_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+static void gw_send(int fd, const std::string &msg) {
+    assert(send(fd, msg.data(), msg.size(), 0) == static_cast<ssize_t>(msg.size()));
+}
+
+static std::string new_order(uint64_t client_id, const std::string &symbol, uint8_t side, uint8_t type,
+                             long long price, long long quantity) {
+    std::string m;
+    put_u16(m, NEW_ORDER_SIZE);
+    put_u8(m, NewOrder);
+    put_u64(m, client_id);
+    std::string sym = symbol;
+    sym.resize(SYMBOL_LEN, '\0');
+    m += sym;
+    put_u8(m, side);
+    put_u8(m, type);
+    put_i64(m, price);
+    put_i64(m, quantity);
+    return m;
+}
+
+static std::string cancel(uint64_t client_id, uint64_t order_id) {
+    std::string m;
+    put_u16(m, CANCEL_SIZE);
+    put_u8(m, Cancel);
+    put_u64(m, client_id);
+    put_u64(m, order_id);
+    return m;
+}
+
+static std::string amend(uint64_t client_id, uint64_t order_id, long long price, long long quantity) {
+    std::string m;
+    put_u16(m, AMEND_SIZE);
+    put_u8(m, Amend);
+    put_u64(m, client_id);
+    put_u64(m, order_id);
+    put_i64(m, price);
+    put_i64(m, quantity);
+    return m;
+}
+
+// Reads one whole message; its type is body[2]
+static bool gw_read(int fd, std::string &pending, std::string &msg) {
+    char buf[4096];
+    for (;;) {
+        if (pending.size() >= 2) {
+            size_t size = static_cast<unsigned char>(pending[0]) | (static_cast<unsigned char>(pending[1]) << 8);
+            if (pending.size() >= size) {
+                msg = pending.substr(0, size);
+                pending.erase(0, size);
+                return true;
+            }
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        pending.append(buf, static_cast<size_t>(n));
+    }
+}
+
+static ByteReader body(const std::string &msg) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(msg.data());
+    return ByteReader{p + HEADER_SIZE, p + msg.size()};
+}
+
+struct AckMsg {
+    uint64_t client_order_id, order_id;
+    uint8_t status;
+    long long filled, leaves;
+};
+
+static AckMsg read_ack(int fd, std::string &pending) {
+    std::string msg;
+    assert(gw_read(fd, pending, msg));
+    assert(static_cast<uint8_t>(msg[2]) == Ack && msg.size() == ACK_SIZE);
+    ByteReader r = body(msg);
+    AckMsg a;
+    a.client_order_id = r.u64();
+    a.order_id = r.u64();
+    a.status = r.u8();
+    a.filled = r.i64();
+    a.leaves = r.i64();
+    assert(r.i64() > 0 && r.ok);
+    return a;
+}
+
+void test_gateway_order_flow() {
+    std::cout << "[TEST] Binary gateway acks, fills and rejects...\n";
+    GatewayConfig config;
+    config.port = TEST_GATEWAY_PORT;
+    OrderGateway gateway(config);
+    assert(gateway.start());
+
+    int maker = gw_connect(), taker = gw_connect();
+    std::string maker_in, taker_in, msg;
+
+    // Resting sell: acked open with its order id
+    gw_send(maker, new_order(1, "GWTEST", 1, 1, 10000, 5'000'000));
+    AckMsg rest = read_ack(maker, maker_in);
+    assert(rest.client_order_id == 1 && rest.order_id > 0);
+    assert(rest.status == static_cast<uint8_t>(OrderStatus::Open));
+    assert(rest.filled == 0 && rest.leaves == 5'000'000);
+
+    // Crossing buy: ack, then a taker fill here and a maker fill on the first session
+    gw_send(taker, new_order(7, "GWTEST", 0, 1, 10100, 2'000'000));
+    AckMsg hit = read_ack(taker, taker_in);
+    assert(hit.client_order_id == 7);
+    assert(hit.status == static_cast<uint8_t>(OrderStatus::Filled) && hit.filled == 2'000'000 && hit.leaves == 0);
+    assert(gw_read(taker, taker_in, msg) && static_cast<uint8_t>(msg[2]) == Fill && msg.size() == FILL_SIZE);
+    ByteReader f = body(msg);
+    assert(f.u64() == 7 && f.u64() == hit.order_id);
+    uint64_t trade_id = f.u64();
+    assert(f.i64() == 10000 && f.i64() == 2'000'000);
+    assert(f.u8() == 0 && f.u8() == 1); // buy, taker
+
+    assert(gw_read(maker, maker_in, msg) && static_cast<uint8_t>(msg[2]) == Fill);
+    ByteReader m = body(msg);
+    assert(m.u64() == 1 && m.u64() == rest.order_id && m.u64() == trade_id);
+    assert(m.i64() == 10000 && m.i64() == 2'000'000);
+    assert(m.u8() == 1 && m.u8() == 0); // sell, maker
+
+    // Cancel the rest; a second cancel is unknown
+    gw_send(maker, cancel(2, rest.order_id));
+    AckMsg cx = read_ack(maker, maker_in);
+    assert(cx.client_order_id == 2 && cx.order_id == rest.order_id);
+    assert(cx.status == static_cast<uint8_t>(OrderStatus::Cancelled));
+    long long ask = 0;
+    assert(!g_symbol_registry.find("GWTEST")->book.best_ask(ask));
+
+    gw_send(maker, cancel(3, rest.order_id));
+    assert(gw_read(maker, maker_in, msg) && static_cast<uint8_t>(msg[2]) == Reject && msg.size() == REJECT_SIZE);
+    ByteReader rj = body(msg);
+    assert(rj.u64() == 3 && rj.u8() == static_cast<uint8_t>(OrderReject::UnknownOrder));
+
+    // Field validation matches the HTTP API
+    gw_send(taker, new_order(8, "GWTEST", 0, 1, 10000, 0));
+    assert(gw_read(taker, taker_in, msg) && static_cast<uint8_t>(msg[2]) == Reject);
+    ByteReader q = body(msg);
+    assert(q.u64() == 8 && q.u8() == static_cast<uint8_t>(OrderReject::InvalidQuantity));
+
+    // Amend in place, then re-priced through the other side's resting order
+    gw_send(maker, new_order(4, "GWTEST", 1, 1, 10200, 3'000'000));
+    AckMsg resting = read_ack(maker, maker_in);
+    gw_send(maker, amend(5, resting.order_id, 0, 1'000'000));
+    AckMsg down = read_ack(maker, maker_in);
+    assert(down.client_order_id == 5 && down.order_id == resting.order_id);
+    assert(down.status == static_cast<uint8_t>(OrderStatus::Open) && down.leaves == 1'000'000);
+    assert(g_symbol_registry.find("GWTEST")->book.top_asks(1)[0].second == 1'000'000);
+    gw_send(taker, new_order(9, "GWTEST", 0, 1, 10000, 1'000'000));
+    AckMsg bid = read_ack(taker, taker_in);
+    gw_send(maker, amend(6, resting.order_id, 10000, 0));
+    AckMsg crossed = read_ack(maker, maker_in);
+    assert(crossed.status == static_cast<uint8_t>(OrderStatus::Filled) && crossed.filled == 1'000'000);
+    assert(gw_read(maker, maker_in, msg) && static_cast<uint8_t>(msg[2]) == Fill); // taker fill
+    assert(gw_read(taker, taker_in, msg) && static_cast<uint8_t>(msg[2]) == Fill); // maker fill
+    ByteReader mf = body(msg);
+    assert(mf.u64() == 9 && mf.u64() == bid.order_id);
+    gw_send(maker, amend(7, resting.order_id, 0, 500'000));
+    assert(gw_read(maker, maker_in, msg) && static_cast<uint8_t>(msg[2]) == Reject);
+
+    // A frame of the wrong length closes the session
+    std::string bad;
+    put_u16(bad, 4);
+    put_u8(bad, NewOrder);
+    put_u8(bad, 0);
+    gw_send(taker, bad);
+    char c;
+    assert(recv(taker, &c, 1, 0) == 0);
+
+    close(maker);
+    close(taker);
+    gateway.stop();
+    assert(!gateway.is_running());
+    std::cout << "[TEST] PASS - Binary gateway passed\n";
+}
+
+void test_gateway_commit_failure() {
+    std::cout << "[TEST] Binary gateway rejects orders whose commit fails...\n";
+    GatewayConfig config;
+    config.port = TEST_GATEWAY_PORT;
+    OrderGateway gateway(config);
+    assert(gateway.start());
+
+    // A quorum primary no standby ever acks: every commit times out
+    ReplicationConfig rc;
+    rc.port = 19104;
+    rc.ack = ReplicationAck::Quorum;
+    rc.ack_timeout_ms = 300;
+    ReplicationPrimary primary(rc, global_wal, RecoveryState{});
+    assert(primary.start());
+    g_replication_primary = &primary;
+
+    int held = gw_connect(), other = gw_connect();
+    std::string held_in, other_in, msg;
+    auto t0 = std::chrono::steady_clock::now();
+    gw_send(held, new_order(1, "GWCOMMIT", 1, 1, 10000, 1'000'000));
+    gw_send(held, new_order(2, "GWCOMMIT", 1, 1, 10000, 0));
+
+    // The event loop keeps serving other sessions while the commit is pending
+    gw_send(other, new_order(3, "GWCOMMIT", 0, 1, 10000, 0));
+    assert(gw_read(other, other_in, msg) && static_cast<uint8_t>(msg[2]) == Reject);
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(rc.ack_timeout_ms));
+
+    // No Ack for the uncommitted order, and the held session keeps its order
+    assert(gw_read(held, held_in, msg) && static_cast<uint8_t>(msg[2]) == Reject);
+    assert(std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds(rc.ack_timeout_ms));
+    ByteReader nc = body(msg);
+    assert(nc.u64() == 1 && nc.u8() == static_cast<uint8_t>(OrderReject::NotCommitted));
+    assert(gw_read(held, held_in, msg) && static_cast<uint8_t>(msg[2]) == Reject);
+    ByteReader iq = body(msg);
+    assert(iq.u64() == 2 && iq.u8() == static_cast<uint8_t>(OrderReject::InvalidQuantity));
+
+    g_replication_primary = nullptr;
+    primary.stop();
+    auto ask = g_symbol_registry.find("GWCOMMIT")->book.top_asks(1);
+    assert(ask.size() == 1 && ask[0].second == 1'000'000);
+    close(held);
+    close(other);
+    gateway.stop();
+    std::cout << "[TEST] PASS - Binary gateway commit failure passed\n";
+}
+#endif
+
+void run_order_gateway_tests() {
+    std::cout << "\n========================================\n";
+    std::cout << "  Running Order Gateway Tests\n";
+    std::cout << "========================================\n\n";
+
+#ifdef __linux__
+    // Gateway orders are logged through global_wal: keep them out of ./data/wal.jsonl
+    WalConfig previous = global_wal.config();
+    WalConfig config = previous;
+    config.path = "./data/test_gateway_wal.jsonl";
+    std::filesystem::remove(config.path);
+    global_wal.configure(config);
+
+    test_gateway_order_flow();
+    test_gateway_commit_failure();
+
+    global_wal.configure(previous);
+    std::filesystem::remove(config.path);
+#endif
+}
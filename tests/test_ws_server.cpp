@@ -0,0 +1,535 @@
+// ============================================================================
+// FILE: tests/test_ws_server.cpp
+// ============================================================================
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/ws_server.h"
+#include "../include/order_book.h"
+#include "../include/global_state.h"
+#include "../include/engine_config.h"
+#include "../include/broadcast_queue.h"
+#include "../include/json_writer.h"
+#include "../include/md_binary.h"
+#include "../include/order_json.h"
+
+void test_json_writer() {
+    std::cout << "[TEST] JsonWriter matches the json DOM output...\n";
+    JsonWriter w;
+    std::string tricky = std::string("q\"b\\s\n\x01/") + "\xc3\xa9";
+    w.begin_object().field("a", -5).key("b").begin_array().value(true).null().value(tricky).end_array()
+     .key("c").begin_object().end_object().field("d", uint64_t{18446744073709551615ull}).end_object();
+    json expected = {{"a", -5}, {"b", {true, nullptr, tricky}}, {"c", json::object()}, {"d", 18446744073709551615ull}};
+    assert(w.str() == expected.dump());
+    assert(json::parse(w.str()) == expected);
+
+    // Trades render byte-for-byte like trade_to_json, symbol escaping included
+    Trade t{};
+    t.trade_id = 12;
+    t.maker_order_id = 3;
+    t.taker_order_id = 4;
+    t.symbol_id = g_symbol_registry.get_or_create("JSON\"W").id;
+    t.aggressor_side = Side::Sell;
+    t.price = -1;
+    t.quantity = 250;
+    t.maker_fee = 7;
+    t.timestamp_ns = 1704067200000000042LL;
+    w.clear();
+    write_trade_json(w, t);
+    assert(w.str() == trade_to_json(t).dump());
+    assert(w.str().find("\"timestamp\":\"2024-01-01T00:00:00.000000042Z\"") != std::string::npos);
+
+    Order o{99, t.symbol_id, OrderType::Ioc, Side::Buy, 1500000, 5000007,
+            std::chrono::system_clock::time_point(std::chrono::seconds(1704067200))};
+    json order_json = order_to_json(o);
+    order_json["status"] = "partially_filled";
+    w.clear();
+    write_order_json(w, o, "partially_filled");
+    assert(w.str() == order_json.dump());
+    std::cout << "[TEST] PASS - JsonWriter passed\n";
+}
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const int TEST_WS_PORT = 19102;
+
+static int ws_connect(int rcvbuf = 0) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval tv{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (rcvbuf) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_WS_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+// Reads until `needle` shows up in what was received so far (or timeout)
+static bool ws_read_until(int fd, std::string &received, const std::string &needle) {
+    char buf[4096];
+    while (received.find(needle) == std::string::npos) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        received.append(buf, static_cast<size_t>(n));
+    }
+    return true;
+}
+
+static void ws_upgrade(int fd) {
+    std::string req = "GET / HTTP/1.1\r\nUpgrade: websocket\r\nSec-WebSocket-Key: x3JJHMbDL1EzLkh9GBhXDw==\r\n\r\n";
+    send(fd, req.data(), req.size(), 0);
+}
+
+static bool wait_for_clients(const WebSocketServer &server, size_t n) {
+    for (int i = 0; i < 200 && server.client_count() != n; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return server.client_count() == n;
+}
+
+void test_ws_handshake_and_broadcast() {
+    std::cout << "[TEST] WebSocket handshake, ping and broadcast...\n";
+    WebSocketServer server(TEST_WS_PORT);
+    server.start();
+    assert(server.is_running());
+
+    // RFC 6455 section 1.3 sample key; the request arrives in two pieces
+    int fd = ws_connect();
+    std::string part1 = "GET / HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n";
+    std::string part2 = "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                        "Sec-WebSocket-Version: 13\r\n\r\n";
+    send(fd, part1.data(), part1.size(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    send(fd, part2.data(), part2.size(), 0);
+
+    std::string received;
+    assert(ws_read_until(fd, received, "\"connected\""));
+    assert(received.find("101 Switching Protocols") != std::string::npos);
+    assert(received.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != std::string::npos);
+
+    // Masked ping with a payload comes back as a pong echoing it
+    const unsigned char ping[] = {0x89, 0x82, 1, 2, 3, 4, 'h' ^ 1, 'i' ^ 2};
+    send(fd, ping, sizeof(ping), 0);
+    received.clear();
+    assert(ws_read_until(fd, received, "hi"));
+    assert(static_cast<unsigned char>(received[0]) == 0x8A && received[1] == 2);
+
+    // Many more clients than worker threads, all receiving broadcasts
+    std::vector<int> others;
+    for (int i = 0; i < 64; ++i) {
+        int c = ws_connect();
+        ws_upgrade(c);
+        others.push_back(c);
+    }
+    assert(wait_for_clients(server, 65));
+
+    Trade t{};
+    t.trade_id = 77;
+    t.symbol_id = g_symbol_registry.get_or_create("WS-TEST").id;
+    t.aggressor_side = Side::Buy;
+    t.price = 100;
+    t.quantity = 5;
+    server.broadcast_trade(t);
+    received.clear();
+    assert(ws_read_until(fd, received, "T-77"));
+    for (int c : others) {
+        std::string r;
+        assert(ws_read_until(c, r, "T-77"));
+        close(c);
+    }
+    assert(wait_for_clients(server, 1));
+
+    // A close frame ends the connection
+    const unsigned char close_frame[] = {0x88, 0x80, 0, 0, 0, 0};
+    send(fd, close_frame, sizeof(close_frame), 0);
+    assert(wait_for_clients(server, 0));
+    close(fd);
+
+    server.stop();
+    assert(!server.is_running());
+    std::cout << "[TEST] PASS - WebSocket server passed\n";
+}
+
+// Client frames must be masked (RFC 6455 5.3); payloads here are < 126 bytes
+static void ws_send_text(int fd, const std::string &text) {
+    std::string frame;
+    frame.push_back(static_cast<char>(0x81));
+    if (text.size() < 126) {
+        frame.push_back(static_cast<char>(0x80 | text.size()));
+    } else {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>(text.size() >> 8));
+        frame.push_back(static_cast<char>(text.size() & 0xff));
+    }
+    const char mask[4] = {0x11, 0x22, 0x33, 0x44};
+    frame.append(mask, 4);
+    for (size_t i = 0; i < text.size(); ++i) frame.push_back(text[i] ^ mask[i % 4]);
+    send(fd, frame.data(), frame.size(), 0);
+}
+
+void test_ws_subscriptions() {
+    std::cout << "[TEST] Per-symbol channel subscriptions...\n";
+    WebSocketServer server(TEST_WS_PORT);
+    server.start();
+    int all = ws_connect(), sub = ws_connect();
+    ws_upgrade(all);
+    ws_upgrade(sub);
+    std::string r_all, r_sub;
+    assert(ws_read_until(all, r_all, "\"connected\"") && ws_read_until(sub, r_sub, "\"connected\""));
+
+    ws_send_text(sub, R"({"op":"subscribe","symbols":["WS-B"],"channels":["trades","bbo"]})");
+    assert(ws_read_until(sub, r_sub, "\"subscribed\""));
+    ws_send_text(sub, R"({"op":"subscribe","symbols":["WS-B"],"channels":["nope"]})");
+    assert(ws_read_until(sub, r_sub, "\"error\""));
+    // Made-up names cannot grow the index without bound
+    std::string many = R"({"op":"subscribe","symbols":[)";
+    for (int i = 0; i < 400; ++i) many += (i ? ",\"X-" : "\"X-") + std::to_string(i) + "\"";
+    r_sub.clear();
+    ws_send_text(sub, many + "]}");
+    assert(ws_read_until(sub, r_sub, "subscriptions per connection"));
+
+    Trade t{};
+    t.aggressor_side = Side::Sell;
+    t.trade_id = 901;
+    t.symbol_id = g_symbol_registry.get_or_create("WS-A").id;
+    server.broadcast_trade(t); // only the unfiltered client
+    t.trade_id = 902;
+    t.symbol_id = g_symbol_registry.get_or_create("WS-B").id;
+    server.broadcast_trade(t);
+    std::vector<std::pair<long long, long long>> bids{{100, 1}}, asks{{101, 2}};
+    server.broadcast_orderbook_update("WS-B", bids, asks); // bbo for sub, depth for all
+    server.broadcast_orderbook_update("WS-B", bids, asks); // unchanged top: no second bbo
+
+    r_sub.clear();
+    assert(ws_read_until(sub, r_sub, "\"bbo\""));
+    assert(r_sub.find("T-902") != std::string::npos && r_sub.find("T-901") == std::string::npos);
+    assert(r_sub.find("\"orderbook\"") == std::string::npos);
+    assert(ws_read_until(all, r_all, "\"orderbook\""));
+    assert(r_all.find("T-901") != std::string::npos && r_all.find("T-902") != std::string::npos);
+
+    // After unsubscribing from trades only the bbo channel is left
+    ws_send_text(sub, R"({"op":"unsubscribe","symbols":["WS-B"],"channels":["trades"]})");
+    assert(ws_read_until(sub, r_sub, "\"unsubscribed\""));
+    t.trade_id = 903;
+    server.broadcast_trade(t);
+    asks[0].first = 102;
+    server.broadcast_orderbook_update("WS-B", bids, asks);
+    r_sub.clear();
+    assert(ws_read_until(sub, r_sub, "102"));
+    assert(r_sub.find("T-903") == std::string::npos);
+
+    close(all);
+    close(sub);
+    server.stop();
+    std::cout << "[TEST] PASS - Subscriptions passed\n";
+}
+
+void test_depth_deltas() {
+    std::cout << "[TEST] Sequenced depth deltas and resync...\n";
+    // Merge of two windows: removed levels get quantity 0
+    std::vector<std::pair<long long, long long>> before{{105, 1}, {103, 2}, {101, 3}};
+    std::vector<std::pair<long long, long long>> after{{106, 4}, {105, 1}, {101, 5}};
+    auto changes = diff_levels(before, after, true);
+    assert((changes == std::vector<std::pair<long long, long long>>{{106, 4}, {103, 0}, {101, 5}}));
+    assert(diff_levels(after, after, true).empty());
+    assert((diff_levels({{200, 1}}, {{199, 1}, {200, 2}}, false) ==
+            std::vector<std::pair<long long, long long>>{{199, 1}, {200, 2}}));
+
+    WebSocketServer server(TEST_WS_PORT);
+    server.start();
+    WebSocketServer *previous = g_ws_server;
+    g_ws_server = &server;
+
+    int fd = ws_connect();
+    ws_upgrade(fd);
+    std::string received;
+    assert(ws_read_until(fd, received, "\"connected\""));
+
+    SymbolEntry &depth_entry = g_symbol_registry.get_or_create("WS-DEPTH");
+    uint32_t depth_id = depth_entry.id;
+    OrderBook &book = depth_entry.book;
+    auto now = std::chrono::system_clock::now();
+    book.add_order(Order{1, 0, OrderType::Limit, Side::Sell, 10, 777001, now});
+    g_broadcast_queue.push_book_update(depth_id, book.depth_snapshot(10));
+    // The first window of a stream is a full snapshot
+    received.clear();
+    assert(ws_read_until(fd, received, "\"seq\":1"));
+    assert(received.find("\"orderbook\"") != std::string::npos);
+
+    book.add_order(Order{2, 0, OrderType::Limit, Side::Buy, 7, 666002, now});
+    g_broadcast_queue.push_book_update(depth_id, book.depth_snapshot(10));
+    received.clear();
+    assert(ws_read_until(fd, received, "\"seq\":2"));
+    // Only the new bid level; a bbo frame precedes it
+    std::string delta = received.substr(received.rfind("{\"data\""));
+    assert(delta.find("\"depth_update\"") != std::string::npos);
+    assert(delta.find("{\"price\":666002") != std::string::npos && delta.find("777001") == std::string::npos);
+
+    // On request, the window at the current stream position
+    ws_send_text(fd, R"({"op":"snapshot","symbols":["WS-DEPTH"]})");
+    received.clear();
+    assert(ws_read_until(fd, received, "\"seq\":2"));
+    assert(received.find("\"orderbook\"") != std::string::npos && received.find("777001") != std::string::npos);
+
+    std::shared_ptr<const DepthSnapshot> state;
+    uint64_t seq = 0;
+    assert(g_broadcast_queue.depth_state("WS-DEPTH", state, seq) && seq == 2);
+    assert(state->bids.size() == 1 && state->asks.size() == 1);
+
+    g_ws_server = previous;
+    close(fd);
+    server.stop();
+    std::cout << "[TEST] PASS - Depth deltas passed\n";
+}
+
+void test_broadcast_ordering() {
+    std::cout << "[TEST] Broadcast shards keep per-symbol order...\n";
+    WebSocketServer server(TEST_WS_PORT);
+    server.start();
+    WebSocketServer *previous = g_ws_server;
+    g_ws_server = &server;
+
+    int fd = ws_connect();
+    ws_upgrade(fd);
+    std::string received;
+    assert(ws_read_until(fd, received, "\"connected\""));
+
+    SymbolEntry &entry = g_symbol_registry.get_or_create("WS-ORDER");
+    BroadcastStats before = g_broadcast_queue.stats();
+    assert(before.shards >= 1 && before.queue_capacity >= BroadcastQueue::RING_CAPACITY);
+
+    const uint64_t first_id = 900001, n = 300;
+    auto now = std::chrono::system_clock::now();
+    for (uint64_t id = first_id; id < first_id + n; ++id) {
+        Trade t{};
+        t.trade_id = id;
+        t.symbol_id = entry.id;
+        t.price = 1000;
+        t.quantity = 1;
+        g_broadcast_queue.push_trade(t);
+        if (id % 10 == 0) {
+            entry.book.add_order(Order{id, entry.id, OrderType::Limit, Side::Buy, 1, static_cast<long long>(id), now});
+            g_broadcast_queue.push_book_update(entry.id, entry.book.depth_snapshot(10));
+        }
+    }
+    assert(ws_read_until(fd, received, "T-" + std::to_string(first_id + n - 1)));
+    size_t last_pos = 0;
+    for (uint64_t id = first_id; id < first_id + n; ++id) {
+        size_t pos = received.find("\"T-" + std::to_string(id) + "\"");
+        assert(pos != std::string::npos && pos > last_pos);
+        last_pos = pos;
+    }
+
+    BroadcastStats after = g_broadcast_queue.stats();
+    assert(after.pushed - before.pushed == n + n / 10);
+    assert(after.dropped == before.dropped);
+
+    g_ws_server = previous;
+    close(fd);
+    server.stop();
+    std::cout << "[TEST] PASS - Broadcast ordering passed\n";
+}
+
+// Reads the next complete server frame (unmasked) out of `pending`
+static bool ws_read_frame(int fd, std::string &pending, int &opcode, std::string &payload) {
+    char buf[4096];
+    for (;;) {
+        if (pending.size() >= 2) {
+            const unsigned char *p = reinterpret_cast<const unsigned char *>(pending.data());
+            size_t len = p[1] & 0x7F, header = 2;
+            if (len == 126 && pending.size() >= 4) {
+                len = (size_t(p[2]) << 8) | p[3];
+                header = 4;
+            } else if (len == 127 && pending.size() >= 10) {
+                len = 0;
+                for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+                header = 10;
+            }
+            if (len < 126 || header > 2) {
+                if (pending.size() >= header + len) {
+                    opcode = p[0] & 0x0F;
+                    payload = pending.substr(header, len);
+                    pending.erase(0, header + len);
+                    return true;
+                }
+            }
+        }
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        pending.append(buf, static_cast<size_t>(n));
+    }
+}
+
+// Skips text frames until a binary one arrives
+static bool ws_read_binary(int fd, std::string &pending, std::string &payload) {
+    int opcode = 0;
+    while (ws_read_frame(fd, pending, opcode, payload)) {
+        if (opcode == 0x2) return true;
+    }
+    return false;
+}
+
+void test_ws_binary_format() {
+    std::cout << "[TEST] Binary market-data format...\n";
+    WebSocketServer server(TEST_WS_PORT);
+    server.start();
+    WebSocketServer *previous = g_ws_server;
+    g_ws_server = &server;
+
+    // One client negotiates at handshake, one switches on subscribe, one stays JSON
+    int hs = ws_connect(), sub = ws_connect(), text = ws_connect();
+    std::string req = "GET /feed?format=binary HTTP/1.1\r\nUpgrade: websocket\r\n"
+                      "Sec-WebSocket-Key: x3JJHMbDL1EzLkh9GBhXDw==\r\n\r\n";
+    send(hs, req.data(), req.size(), 0);
+    ws_upgrade(sub);
+    ws_upgrade(text);
+    std::string r_hs, r_sub, r_text;
+    assert(ws_read_until(hs, r_hs, "\"connected\"") && ws_read_until(sub, r_sub, "\"connected\"") &&
+           ws_read_until(text, r_text, "\"connected\""));
+    ws_send_text(sub, R"({"op":"subscribe","symbols":["WS-BIN"],"format":"binary"})");
+    assert(ws_read_until(sub, r_sub, "\"format\":\"binary\""));
+    ws_send_text(sub, R"({"op":"unsubscribe","symbols":["WS-BIN"],"format":"json"})");
+    assert(ws_read_until(sub, r_sub, "\"error\""));
+    r_hs = r_hs.substr(r_hs.find("\r\n\r\n") + 4);
+    r_sub.clear();
+
+    Trade t{};
+    t.trade_id = 4242;
+    t.maker_order_id = 7;
+    t.taker_order_id = 8;
+    t.symbol_id = g_symbol_registry.get_or_create("WS-BIN").id;
+    t.aggressor_side = Side::Sell;
+    t.price = 123456;
+    t.quantity = 1000000;
+    t.timestamp_ns = 1704067200123456789LL;
+    server.broadcast_trade(t);
+
+    for (int fd : {hs, sub}) {
+        std::string &pending = fd == hs ? r_hs : r_sub;
+        std::string payload;
+        assert(ws_read_binary(fd, pending, payload));
+        ByteReader r{reinterpret_cast<const unsigned char *>(payload.data()),
+                     reinterpret_cast<const unsigned char *>(payload.data()) + payload.size()};
+        assert(r.u16() == md_binary::TRADE_BLOCK && r.u16() == md_binary::TradeMsg);
+        assert(r.u16() == md_binary::SCHEMA_ID && r.u16() == md_binary::SCHEMA_VERSION);
+        assert(r.u64() == 4242 && r.u64() == 7 && r.u64() == 8);
+        assert(r.i64() == 123456 && r.i64() == 1000000);
+        r.i64(); r.i64();
+        assert(r.i64() == 1704067200123456789LL && r.u8() == 1); // execution time, not send time
+        assert(r.str() == "WS-BIN" && r.ok && r.p == r.end);
+        // Far smaller than the JSON rendering of the same trade
+        assert(payload.size() * 2 < trade_to_json(t).dump().size());
+    }
+    assert(ws_read_until(text, r_text, "T-4242")); // JSON clients are unaffected
+
+    // Depth delta and BBO with levels, then a binary resync snapshot
+    std::vector<std::pair<long long, long long>> bids{{100, 5}}, asks{{101, 6}, {102, 7}};
+    server.broadcast_depth_update("WS-BIN", 3, {}, asks, bids, asks);
+    std::string payload;
+    bool saw_bbo = false, saw_delta = false;
+    while (!(saw_bbo && saw_delta) && ws_read_binary(hs, r_hs, payload)) {
+        ByteReader r{reinterpret_cast<const unsigned char *>(payload.data()),
+                     reinterpret_cast<const unsigned char *>(payload.data()) + payload.size()};
+        uint16_t block = r.u16(), id = r.u16();
+        r.u16(); r.u16();
+        if (id == md_binary::BboMsg) {
+            assert(block == md_binary::BBO_BLOCK);
+            assert(r.i64() == 100 && r.i64() == 5 && r.i64() == 101 && r.i64() == 6);
+            r.i64();
+            assert(r.u8() == 3 && r.str() == "WS-BIN");
+            saw_bbo = true;
+        } else if (id == md_binary::DepthUpdateMsg) {
+            assert(r.u64() == 3);
+            r.i64();
+            assert(r.u16() == 0 && r.u16() == 2);
+            assert(r.i64() == 101 && r.i64() == 6 && r.i64() == 102 && r.i64() == 7);
+            assert(r.str() == "WS-BIN" && r.ok && r.p == r.end);
+            saw_delta = true;
+        }
+    }
+    assert(saw_bbo && saw_delta);
+
+    ws_send_text(hs, R"({"op":"snapshot","symbols":["WS-BIN"]})");
+    assert(ws_read_binary(hs, r_hs, payload));
+    assert(payload.size() > 4 && static_cast<unsigned char>(payload[2]) == md_binary::DepthSnapshotMsg);
+
+    g_ws_server = previous;
+    close(hs);
+    close(sub);
+    close(text);
+    server.stop();
+    std::cout << "[TEST] PASS - Binary format passed\n";
+}
+
+void test_ws_slow_consumer() {
+    std::cout << "[TEST] Slow consumer policies...\n";
+    std::vector<std::pair<long long, long long>> bids, asks{{424242, 1}};
+    for (long long i = 0; i < 1500; ++i) bids.push_back({1000000 - i, 100000 + i}); // ~50 KB per update
+
+    for (SlowConsumerPolicy policy : {SlowConsumerPolicy::DropOldest, SlowConsumerPolicy::Conflate,
+                                      SlowConsumerPolicy::Disconnect}) {
+        WebSocketServer server(TEST_WS_PORT);
+        WebSocketConfig config;
+        config.max_queued_frames = 16;
+        config.max_queued_bytes = 1 << 20;
+        config.slow_consumer = policy;
+        server.configure(config);
+        server.start();
+
+        int slow = ws_connect(4096);
+        ws_upgrade(slow);
+        std::string received;
+        assert(ws_read_until(slow, received, "\"connected\""));
+
+        // The client reads nothing meanwhile; broadcasting must not wait for it
+        for (int i = 0; i < 60; ++i) {
+            server.broadcast_orderbook_update("WS-SLOW", bids, i == 59 ? asks : bids);
+        }
+
+        WebSocketStats stats = server.stats();
+        if (policy == SlowConsumerPolicy::Disconnect) {
+            assert(wait_for_clients(server, 0));
+            assert(server.stats().slow_disconnects == 1);
+        } else {
+            if (policy == SlowConsumerPolicy::DropOldest) {
+                assert(stats.frames_dropped > 0 && stats.frames_conflated == 0);
+            } else {
+                // Same symbol every time: the backlog never exceeds one queued update
+                assert(stats.frames_conflated > 0 && stats.frames_dropped == 0);
+            }
+            assert(server.client_count() == 1);
+            received.clear();
+            assert(ws_read_until(slow, received, "424242")); // the newest update always gets through
+        }
+        close(slow);
+        server.stop();
+    }
+    std::cout << "[TEST] PASS - Slow consumer policies passed\n";
+}
+#endif
+
+void run_ws_server_tests() {
+    std::cout << "\n========================================\n";
+    std::cout << "  Running WebSocket Server Tests\n";
+    std::cout << "========================================\n\n";
+
+    test_json_writer();
+#ifndef _WIN32
+    test_ws_handshake_and_broadcast();
+    test_ws_subscriptions();
+    test_depth_deltas();
+    test_broadcast_ordering();
+    test_ws_binary_format();
+    test_ws_slow_consumer();
+#endif
+}